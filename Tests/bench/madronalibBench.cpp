@@ -0,0 +1,1152 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// madronalib_bench: microbenchmarks for the DSP library.
+//
+// Times every operator in MLDSPOps.h, the processors in MLDSPFilters.h and
+// MLDSPGens.h, map() from MLDSPFunctional.h, table lookups, Resampler,
+// convolution, FFT and STFT, DSPBuffer and Queue throughput and Symbol
+// lookups. For each benchmark the time per sample is reported in nanoseconds
+// and, on x86, in cycles of the time stamp counter. For Queue and Symbol
+// benchmarks a "sample" is one element or one lookup.
+//
+// usage: madronalib_bench [options]
+//   --json               print results as JSON, one benchmark per line.
+//   --filter <text>      run only the benchmarks whose names contain text.
+//   --min-time <ms>      minimum time for each trial, default 2.
+//   --baseline <file>    compare to the results in a JSON file from an earlier
+//                        run, and return 1 if any benchmark is slower.
+//   --threshold <ratio>  slowdown allowed before a benchmark fails the
+//                        comparison, default 0.1 (10%).
+//
+// Each benchmark is run for several trials and the fastest is reported,
+// which is the most repeatable measure on a busy machine. Build in Release
+// for meaningful numbers.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "MLTextUtils.h"
+#include "madronalib.h"
+#include "mldsp.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+#define ML_BENCH_HAS_CYCLE_COUNTER 1
+#endif
+
+using namespace ml;
+
+namespace
+{
+// ----------------------------------------------------------------
+// keeping the compiler honest
+
+// make the compiler compute value and assume that all memory may have been
+// read or written, so that globals are reloaded on the next call.
+template <typename T>
+inline void sink(const T& value)
+{
+#if defined(_MSC_VER)
+  static volatile const void* p;
+  p = &value;
+  _ReadWriteBarrier();
+#else
+  asm volatile("" : : "r"(&value) : "memory");
+#endif
+}
+
+// inputs are globals so that sink() forces them to be reloaded.
+DSPVector gAudio;
+DSPVector gX1, gX2, gX3;
+DSPVectorInt gI1, gI2, gI3;
+
+void makeInputs()
+{
+  NoiseGen noise;
+  gAudio = noise() * DSPVector(0.5f);
+
+  // x1 in (0, 1], x2 in [0.5, 1.5), x3 in [0, 1): valid arguments for every op.
+  DSPVector index = columnIndex() * DSPVector(1.f / kFloatsPerDSPVector);
+  gX1 = index * DSPVector(0.9f) + DSPVector(0.1f);
+  gX2 = index + DSPVector(0.5f);
+  gX3 = index;
+  gI1 = columnIndexInt();
+  gI2 = DSPVectorInt(7);
+  gI3 = greaterThan(gX3, DSPVector(0.5f));
+}
+
+// ----------------------------------------------------------------
+// timing
+
+uint64_t readCycleCounter()
+{
+#ifdef ML_BENCH_HAS_CYCLE_COUNTER
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+struct Result
+{
+  std::string name;
+  double nsPerSample;
+  double cyclesPerSample;
+};
+
+struct Options
+{
+  bool json{false};
+  std::string filter;
+  double minTimeMs{2.0};
+  std::string baseline;
+  double threshold{0.1};
+};
+
+class Runner
+{
+  static constexpr int kTrials = 7;
+
+  const Options& mOptions;
+  std::vector<Result> mResults;
+
+  template <typename FN>
+  static void timeCalls(FN& fn, size_t calls, double& ns, double& cycles)
+  {
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t c0 = readCycleCounter();
+    for (size_t i = 0; i < calls; ++i)
+    {
+      fn();
+    }
+    uint64_t c1 = readCycleCounter();
+    auto t1 = std::chrono::steady_clock::now();
+    ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+    cycles = static_cast<double>(c1 - c0);
+  }
+
+ public:
+  explicit Runner(const Options& options) : mOptions(options) {}
+
+  const std::vector<Result>& getResults() const { return mResults; }
+
+  // time fn, which processes samplesPerCall samples each time it is called.
+  template <typename FN>
+  void run(const std::string& name, int samplesPerCall, FN fn)
+  {
+    if (name.find(mOptions.filter) == std::string::npos) return;
+
+    // find a number of calls that takes at least the minimum trial time.
+    const double minNs = mOptions.minTimeMs * 1e6;
+    size_t calls = 1;
+    double ns, cycles;
+    for (;;)
+    {
+      timeCalls(fn, calls, ns, cycles);
+      if (ns >= minNs) break;
+      calls *= 2;
+    }
+
+    double bestNs = ns;
+    double bestCycles = cycles;
+    for (int i = 0; i < kTrials; ++i)
+    {
+      timeCalls(fn, calls, ns, cycles);
+      bestNs = std::min(bestNs, ns);
+      bestCycles = std::min(bestCycles, cycles);
+    }
+
+    const double samples = static_cast<double>(calls) * samplesPerCall;
+    Result r{name, bestNs / samples, bestCycles / samples};
+    if (!mOptions.json)
+    {
+      printResult(r);
+    }
+    mResults.push_back(r);
+  }
+
+  static void printResult(const Result& r)
+  {
+#ifdef ML_BENCH_HAS_CYCLE_COUNTER
+    std::printf("%-40s %12.4f %14.4f\n", r.name.c_str(), r.nsPerSample, r.cyclesPerSample);
+#else
+    std::printf("%-40s %12.4f %14s\n", r.name.c_str(), r.nsPerSample, "-");
+#endif
+  }
+};
+
+// ----------------------------------------------------------------
+// configuration
+
+const char* getSIMDName()
+{
+#if defined(ML_DSP_RUNTIME_DISPATCH)
+  return getSIMDLevelName(getSIMDLevel());
+#elif defined(__AVX512F__)
+  return "AVX512";
+#elif defined(__AVX2__)
+  return "AVX2";
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  return "NEON";
+#else
+  return "SSE2";
+#endif
+}
+
+// ----------------------------------------------------------------
+// benchmarks
+
+#define ML_BENCH_OP1(opName) \
+  r.run("ops/" #opName, kFloatsPerDSPVector, [] { sink(opName(gX1)); });
+#define ML_BENCH_OP2(opName) \
+  r.run("ops/" #opName, kFloatsPerDSPVector, [] { sink(opName(gX1, gX2)); });
+#define ML_BENCH_OP2_INT32(opName) \
+  r.run("ops/" #opName, kFloatsPerDSPVector, [] { sink(opName(gI1, gI2)); });
+#define ML_BENCH_OP3(opName) \
+  r.run("ops/" #opName, kFloatsPerDSPVector, [] { sink(opName(gX1, gX2, gX3)); });
+#define ML_BENCH_OP1_F2I(opName) \
+  r.run("ops/" #opName, kFloatsPerDSPVector, [] { sink(opName(gX1)); });
+#define ML_BENCH_OP1_I2F(opName) \
+  r.run("ops/" #opName, kFloatsPerDSPVector, [] { sink(opName(gI1)); });
+#define ML_BENCH_OP3_FFI2F(opName) \
+  r.run("ops/" #opName, kFloatsPerDSPVector, [] { sink(opName(gX1, gX2, gI3)); });
+#define ML_BENCH_OP3_III2I(opName) \
+  r.run("ops/" #opName "Int", kFloatsPerDSPVector, [] { sink(opName(gI1, gI2, gI3)); });
+#define ML_BENCH_REDUCTION(opName) \
+  r.run("reductions/" #opName, kFloatsPerDSPVector, [] { sink(opName(gX1)); });
+
+void benchOps(Runner& r)
+{
+  // every op with a kernel, from the lists in MLDSPDispatch.h.
+  ML_DSP_OP1_KERNELS(ML_BENCH_OP1)
+  ML_DSP_OP2_KERNELS(ML_BENCH_OP2)
+  ML_DSP_OP2_INT32_KERNELS(ML_BENCH_OP2_INT32)
+  ML_DSP_OP3_KERNELS(ML_BENCH_OP3)
+  ML_DSP_OP1_F2I_KERNELS(ML_BENCH_OP1_F2I)
+  ML_DSP_OP1_I2F_KERNELS(ML_BENCH_OP1_I2F)
+  ML_DSP_OP2_FF2I_KERNELS(ML_BENCH_OP2)
+  ML_DSP_OP3_FFI2F_KERNELS(ML_BENCH_OP3_FFI2F)
+  ML_DSP_OP3_III2I_KERNELS(ML_BENCH_OP3_III2I)
+  ML_DSP_REDUCTION_KERNELS(ML_BENCH_REDUCTION)
+
+  // other ops.
+  ML_BENCH_REDUCTION(mean)
+  ML_BENCH_OP1(normalize)
+  ML_BENCH_OP1(rotateLeft)
+  ML_BENCH_OP1(rotateRight)
+  r.run("ops/interpolateDSPVectorLinear", kFloatsPerDSPVector,
+        [] { sink(interpolateDSPVectorLinear(gX1[0], gX2[0])); });
+  r.run("ops/multiplyAdd", kFloatsPerDSPVector, [] { sink(gX1 * gX2 + gX3); });
+  r.run("ops/add<8>", kFloatsPerDSPVector * 8, [] {
+    DSPVectorArray<8> x(repeatRows<8>(gX1));
+    sink(x + x);
+  });
+}
+
+#undef ML_BENCH_OP1
+#undef ML_BENCH_OP2
+#undef ML_BENCH_OP2_INT32
+#undef ML_BENCH_OP3
+#undef ML_BENCH_OP1_F2I
+#undef ML_BENCH_OP1_I2F
+#undef ML_BENCH_OP3_FFI2F
+#undef ML_BENCH_OP3_III2I
+#undef ML_BENCH_REDUCTION
+
+// run a filter with one audio input.
+template <typename FILTER>
+void benchFilter(Runner& r, const char* name, FILTER& f)
+{
+  r.run(std::string("filters/") + name, kFloatsPerDSPVector, [&] { sink(f(gAudio)); });
+}
+
+// run an FDN with SIZE lines and delays spread over a few thousand samples,
+// typical of a reverb.
+template <int SIZE>
+void benchFDN(Runner& r, typename FDN<SIZE>::matrixType matrix, bool modulated)
+{
+  FDN<SIZE> fdn;
+  std::array<float, SIZE> times, gains, cutoffs, omegas, depths;
+  for (int n = 0; n < SIZE; ++n)
+  {
+    times[n] = 800.f + 3000.f * n / SIZE + 7.f * (n % 3);
+    gains[n] = 0.9f;
+    cutoffs[n] = 0.2f;
+    omegas[n] = 1e-5f * (n + 1);
+    depths[n] = modulated ? 4.f : 0.f;
+  }
+  fdn.setMaxDelayInSamples(4000.f);
+  fdn.setDelaysInSamples(times);
+  fdn.setFilterCutoffs(cutoffs);
+  fdn.setModulation(omegas, depths);
+  fdn.mFeedbackGains = gains;
+  fdn.setFeedbackMatrix(matrix);
+
+  const char* matrixNames[] = {"Householder", "Hadamard", "user"};
+  std::string name = "filters/FDN<" + std::to_string(SIZE) + "> " + matrixNames[matrix];
+  if (modulated) name += " modulated";
+  r.run(name, kFloatsPerDSPVector, [&] { sink(fdn(gAudio).constRow(0)); });
+}
+
+// run ten allpasses in series with the delay lengths of the rtaudio reverb
+// example, with their memory on the heap or in one DelayArena.
+void benchAllpassChain(Runner& r, DelayArena* pArena)
+{
+  constexpr int kStages = 10;
+  const float times[kStages] = {210, 158, 429, 366, 1279, 926, 3440, 3969, 4895, 4234};
+  std::array<Allpass<IntegerDelay>, kStages> allpasses;
+  for (int i = 0; i < kStages; ++i)
+  {
+    allpasses[i].setMaxDelayInSamples(times[i] * 2.f, pArena);
+    allpasses[i].setDelayInSamples(times[i]);
+    allpasses[i].mGain = 0.6f;
+  }
+  const std::string name = std::string("filters/Allpass x10 ") + (pArena ? "DelayArena" : "heap");
+  r.run(name, kFloatsPerDSPVector, [&] {
+    DSPVector y = gAudio;
+    for (auto& ap : allpasses)
+    {
+      ap.processInPlace(y);
+    }
+    sink(y);
+  });
+}
+
+void benchFilters(Runner& r)
+{
+  const float omega = 0.05f;
+  const float k = 0.5f;
+  const float A = 2.f;
+
+  // audio rate modulation computes the coefficients for each sample.
+  const DSPVector vOmega = DSPVector(omega) + gAudio * DSPVector(0.01f);
+  const DSPVector vk(k), vA(A);
+
+  Lopass lopass;
+  lopass.mCoeffs = Lopass::coeffs(omega, k);
+  benchFilter(r, "Lopass", lopass);
+  r.run("filters/Lopass modulated", kFloatsPerDSPVector,
+        [&] { sink(lopass(gAudio, Lopass::vcoeffs(vOmega, vk))); });
+
+  LopassD lopassD;
+  lopassD.mCoeffs = LopassD::coeffs(omega, k);
+  benchFilter(r, "LopassD", lopassD);
+
+  Hipass hipass;
+  hipass.mCoeffs = Hipass::coeffs(omega, k);
+  benchFilter(r, "Hipass", hipass);
+
+  HipassD hipassD;
+  hipassD.mCoeffs = HipassD::coeffs(omega, k);
+  benchFilter(r, "HipassD", hipassD);
+
+  Bandpass bandpass;
+  bandpass.mCoeffs = Bandpass::coeffs(omega, k);
+  benchFilter(r, "Bandpass", bandpass);
+
+  LoShelf loShelf;
+  loShelf.mCoeffs = LoShelf::coeffs({omega, k, A});
+  benchFilter(r, "LoShelf", loShelf);
+  auto loShelfCoeffs = LoShelf::vcoeffs({omega, k, A}, {omega * 2.f, k, A});
+  r.run("filters/LoShelf vcoeffs", kFloatsPerDSPVector,
+        [&] { sink(loShelf(gAudio, loShelfCoeffs)); });
+
+  HiShelf hiShelf;
+  hiShelf.mCoeffs = HiShelf::coeffs({omega, k, A});
+  benchFilter(r, "HiShelf", hiShelf);
+  auto hiShelfCoeffs = HiShelf::vcoeffs({omega, k, A}, {omega * 2.f, k, A});
+  r.run("filters/HiShelf vcoeffs", kFloatsPerDSPVector,
+        [&] { sink(hiShelf(gAudio, hiShelfCoeffs)); });
+
+  Bell bell;
+  bell.mCoeffs = Bell::coeffs(omega, k, A);
+  benchFilter(r, "Bell", bell);
+  r.run("filters/Bell modulated", kFloatsPerDSPVector,
+        [&] { sink(bell(gAudio, Bell::vcoeffs(vOmega, vk, vA))); });
+
+  BellD bellD;
+  bellD.mCoeffs = BellD::coeffs(omega, k, A);
+  benchFilter(r, "BellD", bellD);
+
+  // single channels computing a SIMD vector of outputs per step.
+  StateSpaceFilter<Lopass> lopassStateSpace;
+  lopassStateSpace.setCoeffs(Lopass::coeffs(omega, k));
+  benchFilter(r, "StateSpaceFilter<Lopass>", lopassStateSpace);
+
+  StateSpaceFilter<LoShelf> loShelfStateSpace;
+  loShelfStateSpace.setCoeffs(LoShelf::coeffs({omega, k, A}));
+  benchFilter(r, "StateSpaceFilter<LoShelf>", loShelfStateSpace);
+
+  StateSpaceFilter<Bell> bellStateSpace;
+  bellStateSpace.setCoeffs(Bell::coeffs(omega, k, A));
+  benchFilter(r, "StateSpaceFilter<Bell>", bellStateSpace);
+
+  OnePole onePole;
+  onePole.mCoeffs = OnePole::coeffs(omega);
+  benchFilter(r, "OnePole", onePole);
+
+  OnePoleD onePoleD;
+  onePoleD.mCoeffs = OnePoleD::coeffs(omega);
+  benchFilter(r, "OnePoleD", onePoleD);
+
+  DCBlocker dcBlocker;
+  dcBlocker.mCoeffs = DCBlocker::coeffs(omega);
+  benchFilter(r, "DCBlocker", dcBlocker);
+
+  Differentiator differentiator;
+  benchFilter(r, "Differentiator", differentiator);
+
+  Integrator integrator;
+  integrator.mLeak = 0.001f;
+  benchFilter(r, "Integrator", integrator);
+
+  Peak peak;
+  peak.mCoeffs = Peak::coeffs(omega);
+  benchFilter(r, "Peak", peak);
+
+  RMS rms;
+  rms.mCoeffs = RMS::coeffs(omega);
+  benchFilter(r, "RMS", rms);
+
+  // delays, long enough that their memory is not all in L1.
+  const int delay = 10000;
+  const DSPVector vDelay(static_cast<float>(delay));
+  const DSPVector vDelayModulated = vDelay + gAudio;
+
+  IntegerDelay integerDelay(delay);
+  benchFilter(r, "IntegerDelay", integerDelay);
+  r.run("filters/IntegerDelay modulated", kFloatsPerDSPVector,
+        [&] { sink(integerDelay(gAudio, vDelay)); });
+
+  IntegerDelayHalf integerDelayHalf(delay);
+  benchFilter(r, "IntegerDelayHalf", integerDelayHalf);
+
+  IntegerDelayInt16 integerDelayInt16(delay);
+  benchFilter(r, "IntegerDelayInt16", integerDelayInt16);
+
+  // eight taps spread over one delay line, at constant and modulated delays.
+  MultiTapDelay<8> multiTap(static_cast<float>(delay));
+  std::array<float, 8> tapDelays;
+  DSPVectorArray<8> vTapDelays;
+  for (int t = 0; t < 8; ++t)
+  {
+    tapDelays[t] = delay * (t + 1) / 8.f - 2.5f;
+    vTapDelays.row(t) = DSPVector(tapDelays[t]) + gAudio;
+  }
+  multiTap.setDelaysInSamples(tapDelays);
+  r.run("filters/MultiTapDelay<8>", kFloatsPerDSPVector, [&] { sink(multiTap(gAudio)); });
+  r.run("filters/MultiTapDelay<8> modulated", kFloatsPerDSPVector,
+        [&] { sink(multiTap(gAudio, vTapDelays)); });
+
+  Allpass1 allpass1(Allpass1::coeffs(0.75f));
+  benchFilter(r, "Allpass1", allpass1);
+
+  FractionalDelay fractionalDelay(delay + 0.5f);
+  benchFilter(r, "FractionalDelay", fractionalDelay);
+  r.run("filters/FractionalDelay modulated", kFloatsPerDSPVector,
+        [&] { sink(fractionalDelay(gAudio, vDelayModulated)); });
+
+  FractionalDelayLinear fractionalDelayLinear(delay + 2.f);
+  r.run("filters/FractionalDelayLinear modulated", kFloatsPerDSPVector,
+        [&] { sink(fractionalDelayLinear(gAudio, vDelayModulated)); });
+  FractionalDelayLagrange fractionalDelayLagrange(delay + 2.f);
+  r.run("filters/FractionalDelayLagrange modulated", kFloatsPerDSPVector,
+        [&] { sink(fractionalDelayLagrange(gAudio, vDelayModulated)); });
+  FractionalDelaySinc fractionalDelaySinc(delay + 2.f);
+  r.run("filters/FractionalDelaySinc modulated", kFloatsPerDSPVector,
+        [&] { sink(fractionalDelaySinc(gAudio, vDelayModulated)); });
+  FractionalDelayThiran fractionalDelayThiran(delay + 0.5f);
+  benchFilter(r, "FractionalDelayThiran", fractionalDelayThiran);
+
+  PitchbendableDelay pitchbendableDelay;
+  pitchbendableDelay.setMaxDelayInSamples(delay * 2.f);
+  r.run("filters/PitchbendableDelay", kFloatsPerDSPVector,
+        [&] { sink(pitchbendableDelay(gAudio, vDelayModulated)); });
+
+  Allpass<IntegerDelay> allpass;
+  allpass.setMaxDelayInSamples(delay * 2.f);
+  allpass.setDelayInSamples(delay);
+  allpass.mGain = 0.5f;
+  benchFilter(r, "Allpass<IntegerDelay>", allpass);
+
+  Allpass<PitchbendableDelay> allpassModulated;
+  allpassModulated.setMaxDelayInSamples(delay * 2.f);
+  allpassModulated.mGain = 0.5f;
+  r.run("filters/Allpass<PitchbendableDelay>", kFloatsPerDSPVector,
+        [&] { sink(allpassModulated(gAudio, vDelayModulated)); });
+
+  benchAllpassChain(r, nullptr);
+  DelayArena arena(1 << 20, true);
+  benchAllpassChain(r, &arena);
+
+  benchFDN<16>(r, FDN<16>::kHouseholder, false);
+  benchFDN<16>(r, FDN<16>::kHadamard, false);
+  benchFDN<16>(r, FDN<16>::kHadamard, true);
+  benchFDN<64>(r, FDN<64>::kHadamard, false);
+  benchFDN<64>(r, FDN<64>::kHadamard, true);
+
+  // the half band filter processes two vectors at the higher rate per call.
+  HalfBandFilter halfBand;
+  r.run("filters/HalfBandFilter upsample", kFloatsPerDSPVector * 2, [&] {
+    sink(halfBand.upsampleFirstHalf(gAudio));
+    sink(halfBand.upsampleSecondHalf(gAudio));
+  });
+  r.run("filters/HalfBandFilter downsample", kFloatsPerDSPVector * 2,
+        [&] { sink(halfBand.downsample(gAudio, gAudio)); });
+
+  SIMDHalfBandFilter<1> simdHalfBand;
+  DSPVector up1, up2;
+  r.run("filters/SIMDHalfBandFilter<1> upsample", kFloatsPerDSPVector * 2, [&] {
+    simdHalfBand.upsample(gAudio, up1, up2);
+    sink(up1);
+    sink(up2);
+  });
+  r.run("filters/SIMDHalfBandFilter<1> downsample", kFloatsPerDSPVector * 2,
+        [&] { sink(simdHalfBand.downsample(gAudio, gAudio)); });
+
+  SIMDHalfBandFilter<8> simdHalfBank8;
+  const DSPVectorArray<8> audio8 = repeatRows<8>(gAudio);
+  DSPVectorArray<8> up8a, up8b;
+  r.run("filters/SIMDHalfBandFilter<8> upsample", kFloatsPerDSPVector * 2 * 8, [&] {
+    simdHalfBank8.upsample(audio8, up8a, up8b);
+    sink(up8a.constRow(0));
+    sink(up8b.constRow(7));
+  });
+
+  Upsampler<2> upsampler(2);
+  r.run("filters/Upsampler 2ch 2oct", kFloatsPerDSPVector * 2 * 4, [&] {
+    upsampler.write(concatRows(gAudio, gAudio));
+    for (int i = 0; i < 4; ++i)
+    {
+      sink(upsampler.read().constRow(0));
+    }
+  });
+
+  Downsampler downsampler(2, 2);
+  r.run("filters/Downsampler 2ch 2oct", kFloatsPerDSPVector * 2, [&] {
+    if (downsampler.write(concatRows(gAudio, gAudio)))
+    {
+      sink(downsampler.read<2>());
+    }
+  });
+
+  PLL pll;
+  PhasorGen pllInput;
+  DSPVector pllPhasor = pllInput(DSPVector(0.001f));
+  r.run("filters/PLL", kFloatsPerDSPVector,
+        [&] { sink(pll(pllPhasor, DSPVector(2.f), DSPVector(1.f / 48000.f))); });
+}
+
+void benchGens(Runner& r)
+{
+  const DSPVector freq(0.01f);
+
+  TickGen tickGen;
+  r.run("gens/TickGen", kFloatsPerDSPVector, [&] { sink(tickGen(freq)); });
+
+  ImpulseGen impulseGen;
+  r.run("gens/ImpulseGen", kFloatsPerDSPVector, [&] { sink(impulseGen(freq)); });
+
+  NoiseGen noiseGen;
+  r.run("gens/NoiseGen", kFloatsPerDSPVector, [&] { sink(noiseGen()); });
+
+  TestSineGen testSineGen;
+  r.run("gens/TestSineGen", kFloatsPerDSPVector, [&] { sink(testSineGen(freq)); });
+
+  PhasorGen phasorGen;
+  r.run("gens/PhasorGen", kFloatsPerDSPVector, [&] { sink(phasorGen(freq)); });
+
+  SineGen sineGen;
+  r.run("gens/SineGen", kFloatsPerDSPVector, [&] { sink(sineGen(freq)); });
+
+  PulseGen pulseGen;
+  r.run("gens/PulseGen", kFloatsPerDSPVector, [&] { sink(pulseGen(freq, DSPVector(0.25f))); });
+
+  SawGen sawGen;
+  r.run("gens/SawGen", kFloatsPerDSPVector, [&] { sink(sawGen(freq)); });
+
+  // alternate targets so that the glide is always running.
+  LinearGlide linearGlide;
+  linearGlide.setGlideTimeInSamples(kFloatsPerDSPVector * 4.f);
+  int glideCounter = 0;
+  r.run("gens/LinearGlide", kFloatsPerDSPVector,
+        [&] { sink(linearGlide(((glideCounter++ >> 3) & 1) ? 1.f : 0.f)); });
+}
+
+// map() as it was before it took a template callable, for comparison.
+template <size_t ROWS>
+DSPVectorArray<ROWS> mapStdFunction(std::function<float(float)> f, const DSPVectorArray<ROWS> x)
+{
+  DSPVectorArray<ROWS> y;
+  for (int n = 0; n < kFloatsPerDSPVector * ROWS; ++n)
+  {
+    y[n] = f(x[n]);
+  }
+  return y;
+}
+
+void benchFunctional(Runner& r)
+{
+  // a waveshaper as might be written for one voice.
+  auto shaper = [](float x) { return x / (1.f + fabsf(x)); };
+  r.run("functional/map waveshaper", kFloatsPerDSPVector, [&] { sink(map(shaper, gAudio)); });
+  r.run("functional/map waveshaper std::function", kFloatsPerDSPVector,
+        [&] { sink(mapStdFunction(shaper, gAudio)); });
+
+  auto cubic = [](float x) { return x - x * x * x * (1.f / 3.f); };
+  r.run("functional/map cubic", kFloatsPerDSPVector, [&] { sink(map(cubic, gAudio)); });
+  r.run("functional/map cubic std::function", kFloatsPerDSPVector,
+        [&] { sink(mapStdFunction(cubic, gAudio)); });
+
+  Upsample2xFunction<1> upsampled;
+  Lopass lopass;
+  lopass.mCoeffs = Lopass::coeffs(0.05f, 0.5f);
+  r.run("functional/Upsample2xFunction Lopass", kFloatsPerDSPVector,
+        [&] { sink(upsampled([&](const DSPVector& x) { return lopass(x); }, gAudio)); });
+
+  // oversampled distortion.
+  auto distort = [](const DSPVector& x) { return tanhApprox(x * DSPVector(4.f)); };
+  Upsample2xFunction<1> upsampled2x;
+  Upsample4xFunction<1> upsampled4x;
+  Upsample8xFunction<1> upsampled8x;
+  r.run("functional/Upsample2xFunction tanh", kFloatsPerDSPVector,
+        [&] { sink(upsampled2x(distort, gAudio)); });
+  r.run("functional/Upsample4xFunction tanh", kFloatsPerDSPVector,
+        [&] { sink(upsampled4x(distort, gAudio)); });
+  r.run("functional/Upsample8xFunction tanh", kFloatsPerDSPVector,
+        [&] { sink(upsampled8x(distort, gAudio)); });
+
+  // a 32 voice bank, with all voices and with 4 voices active.
+  constexpr int kVoices = 32;
+  Bank<Lopass, kVoices> bank;
+  for (int j = 0; j < kVoices; ++j)
+  {
+    bank[j].mCoeffs = Lopass::coeffs(0.01f * (j + 1), 0.5f);
+  }
+  DSPVectorArray<kVoices> voices = repeatRows<kVoices>(gAudio);
+  RowMask<kVoices> fourActive;
+  for (int j : {0, 9, 17, 30})
+  {
+    fourActive.set(j, true);
+  }
+  DSPVectorArray<kVoices> bankOut;
+  r.run("functional/Bank<Lopass, 32>", kFloatsPerDSPVector * kVoices, [&] {
+    bank.process(voices, bankOut);
+    sink(bankOut);
+  });
+  r.run("functional/Bank<Lopass, 32> 4 active", kFloatsPerDSPVector * kVoices, [&] {
+    bank.process(fourActive, voices, bankOut);
+    sink(bankOut);
+  });
+
+  SIMDBank<Lopass, kVoices> simdBank;
+  for (int j = 0; j < kVoices; ++j)
+  {
+    simdBank.setCoeffs(j, bank[j].mCoeffs);
+  }
+  r.run("functional/SIMDBank<Lopass, 32>", kFloatsPerDSPVector * kVoices, [&] {
+    simdBank.process(voices, bankOut);
+    sink(bankOut);
+  });
+}
+
+constexpr float sineFn(float x) { return const_math::sin(x); }
+constexpr LookupTable<1024> kSineTable(sineFn, 0.f, kTwoPi);
+
+void benchTables(Runner& r)
+{
+  // lookups over the whole table, to compare with ops/sin.
+  const DSPVector phase = fractionalPart(abs(gX1)) * DSPVector(kTwoPi);
+  const DSPVectorInt index = roundFloatToInt(phase * DSPVector(1024.f / kTwoPi));
+  r.run("tables/lookupNearest", kFloatsPerDSPVector,
+        [&] { sink(lookupNearest(kSineTable, phase)); });
+  r.run("tables/lookupLinear", kFloatsPerDSPVector,
+        [&] { sink(lookupLinear(kSineTable, phase)); });
+  r.run("tables/lookupCubic", kFloatsPerDSPVector, [&] { sink(lookupCubic(kSineTable, phase)); });
+  r.run("tables/lookup int", kFloatsPerDSPVector, [&] { sink(lookup(kSineTable, index)); });
+}
+
+// resample a sine, returning the largest error after the filter has settled
+// compared to the ideal output, or the peak output if the sine is above the
+// output Nyquist frequency.
+double resampleError(const ResamplerQuality& q, double inRate, double outRate, double freq)
+{
+  Resampler<1> resampler(outRate / inRate, q);
+  const bool aliased = (freq > outRate * 0.5);
+  double maxErr = 0.;
+  int n = 0;
+  size_t m = 0;
+  for (int v = 0; v < 256; ++v)
+  {
+    DSPVector x;
+    for (int i = 0; i < kFloatsPerDSPVector; ++i)
+    {
+      x[i] = static_cast<float>(std::sin(kTwoPiD * freq * n++ / inRate));
+    }
+    resampler.write(x);
+    while (resampler.getReadAvailable() >= kFloatsPerDSPVector)
+    {
+      DSPVector y = resampler.read();
+      for (int i = 0; i < kFloatsPerDSPVector; ++i, ++m)
+      {
+        if (m < 256) continue;
+        const double ideal = aliased ? 0. : std::sin(kTwoPiD * freq * m / outRate);
+        maxErr = std::max(maxErr, std::fabs(y[i] - ideal));
+      }
+    }
+  }
+  return maxErr;
+}
+
+// the throughput of each Resampler quality preset, and when printing a table,
+// its quality: the error for a 10kHz sine converted from 44.1kHz to 48kHz and
+// the level of a 30kHz sine after converting from 96kHz to 44.1kHz.
+void benchResample(Runner& r, const Options& options)
+{
+  struct Preset
+  {
+    const char* name;
+    ResamplerQuality quality;
+  };
+  const Preset presets[] = {{"cubic", kResampleCubic},
+                            {"low", kResampleLow},
+                            {"medium", kResampleMedium},
+                            {"high", kResampleHigh}};
+
+  for (const auto& p : presets)
+  {
+    Resampler<1> up(48000. / 44100., p.quality);
+    r.run(std::string("resample/Resampler ") + p.name + " 44.1k>48k", kFloatsPerDSPVector, [&] {
+      up.write(gAudio);
+      while (up.getReadAvailable() >= kFloatsPerDSPVector)
+      {
+        sink(up.read());
+      }
+    });
+
+    Resampler<1> down(44100. / 96000., p.quality);
+    r.run(std::string("resample/Resampler ") + p.name + " 96k>44.1k", kFloatsPerDSPVector, [&] {
+      down.write(gAudio);
+      while (down.getReadAvailable() >= kFloatsPerDSPVector)
+      {
+        sink(down.read());
+      }
+    });
+
+    Resampler<2> stereo(48000. / 44100., p.quality);
+    const DSPVectorArray<2> audio2 = concatRows(gAudio, gAudio);
+    r.run(std::string("resample/Resampler<2> ") + p.name + " 44.1k>48k",
+          kFloatsPerDSPVector * 2, [&] {
+            stereo.write(audio2);
+            while (stereo.getReadAvailable() >= kFloatsPerDSPVector)
+            {
+              sink(stereo.read());
+            }
+          });
+  }
+
+  if (!options.json && std::string("resample/Resampler").find(options.filter) != std::string::npos)
+  {
+    std::printf("\n%-40s %12s %14s\n", "resample quality", "error dB", "alias dB");
+    for (const auto& p : presets)
+    {
+      const double err = resampleError(p.quality, 44100., 48000., 10000.);
+      const double alias = resampleError(p.quality, 96000., 44100., 30000.);
+      std::printf("%-40s %12.1f %14.1f\n", p.name, 20. * std::log10(err),
+                  20. * std::log10(alias));
+    }
+    std::printf("\n");
+  }
+}
+
+// partitioned convolution with impulse responses of increasing length. Direct
+// convolution in the time domain is timed for comparison at the shortest
+// length.
+void benchConvolution(Runner& r)
+{
+  std::vector<float> ir(65536);
+  for (size_t i = 0; i < ir.size(); ++i)
+  {
+    ir[i] = gX1[i % kFloatsPerDSPVector] * std::exp(-8.f * i / ir.size());
+  }
+
+  const int lengths[] = {1024, 8192, 65536};
+  for (int length : lengths)
+  {
+    const int partitionSizes[] = {kFloatsPerDSPVector, kFloatsPerDSPVector * 8};
+    for (int partitionSize : partitionSizes)
+    {
+      PartitionedConvolver c(ir.data(), length, partitionSize);
+      r.run("convolution/Partitioned " + std::to_string(length) + " P" +
+                std::to_string(partitionSize),
+            kFloatsPerDSPVector, [&] { sink(c(gAudio)); });
+    }
+  }
+
+  // the non-uniform convolver with the longest impulse response. In offline
+  // mode all the work is done on this thread. Otherwise this thread only
+  // convolves the head, and the time also includes waiting for the tiers.
+  NonUniformConvolver nonUniform(ir.data(), ir.size());
+  r.run("convolution/NonUniform 65536", kFloatsPerDSPVector, [&] { sink(nonUniform(gAudio)); });
+  NonUniformConvolver nonUniformOffline(ir.data(), ir.size(), true);
+  r.run("convolution/NonUniform 65536 offline", kFloatsPerDSPVector,
+        [&] { sink(nonUniformOffline(gAudio)); });
+
+  // a time domain FIR with the shortest impulse response, using SIMD
+  // operations across the taps.
+  constexpr int kDirectLength = 1024;
+  std::vector<float> reversedIR(ir.rend() - kDirectLength, ir.rend());
+  std::vector<float> history(kDirectLength + kFloatsPerDSPVector);
+  r.run("convolution/direct " + std::to_string(kDirectLength), kFloatsPerDSPVector, [&] {
+    std::copy(history.end() - kDirectLength, history.end(), history.begin());
+    std::copy(gAudio.getConstBuffer(), gAudio.getConstBuffer() + kFloatsPerDSPVector,
+              history.end() - kFloatsPerDSPVector);
+    DSPVector y;
+    for (int n = 0; n < kFloatsPerDSPVector; ++n)
+    {
+      const float* px = history.data() + n + 1;
+      SIMDVectorFloat sum = vecZeros();
+      for (int k = 0; k < kDirectLength; k += kFloatsPerSIMDVector)
+      {
+        sum = vecAdd(sum, vecMul(vecLoadUnaligned(reversedIR.data() + k),
+                                 vecLoadUnaligned(px + k)));
+      }
+      y[n] = vecSumH(sum);
+    }
+    sink(y);
+  });
+}
+
+// the FFT alone, and STFT processing with an empty function and with a
+// spectral gain at two common overlaps.
+void benchSpectral(Runner& r)
+{
+  const int sizes[] = {256, 1024, 4096};
+  for (int size : sizes)
+  {
+    FFT fft(size);
+    Spectrum spectrum(size);
+    std::vector<float> x(size), y(size);
+    for (int i = 0; i < size; ++i)
+    {
+      x[i] = gX1[i % kFloatsPerDSPVector];
+    }
+    r.run("spectral/FFT " + std::to_string(size), size, [&] {
+      fft.forward(x.data(), spectrum);
+      fft.inverse(spectrum, y.data());
+      sink(y[0]);
+    });
+  }
+
+  const int hops[] = {512, 256};
+  for (int hop : hops)
+  {
+    STFT stft(1024, hop);
+    std::vector<float> gains(Spectrum(1024).getPaddedBins(), 0.5f);
+    const std::string name = "spectral/STFT 1024/" + std::to_string(hop);
+    r.run(name + " identity", kFloatsPerDSPVector,
+          [&] { sink(stft(gAudio, [](Spectrum&) {})); });
+    r.run(name + " gains", kFloatsPerDSPVector,
+          [&] { sink(stft(gAudio, [&](Spectrum& s) { applyGains(s, gains.data()); })); });
+  }
+}
+
+template <typename BUFFER>
+void benchBuffer(Runner& r, const char* name)
+{
+  BUFFER buf;
+  buf.resize(kFloatsPerDSPVector * 64);
+  DSPVector y;
+  r.run(std::string("buffers/") + name + " write+read", kFloatsPerDSPVector, [&] {
+    buf.write(gAudio);
+    buf.read(y);
+    sink(y);
+  });
+}
+
+void benchBuffers(Runner& r)
+{
+  benchBuffer<DSPBuffer>(r, "DSPBuffer");
+  benchBuffer<DSPBufferHalf>(r, "DSPBufferHalf");
+  benchBuffer<DSPBufferInt16>(r, "DSPBufferInt16");
+
+  // a block of samples, overlapped by half.
+  DSPBuffer overlapBuf;
+  overlapBuf.resize(kFloatsPerDSPVector * 64);
+  std::vector<float> block(kFloatsPerDSPVector * 2, 0.5f);
+  std::vector<float> out(kFloatsPerDSPVector);
+  r.run("buffers/DSPBuffer overlap-add", kFloatsPerDSPVector, [&] {
+    overlapBuf.writeWithOverlapAdd(block.data(), block.size(), kFloatsPerDSPVector);
+    overlapBuf.read(out.data(), out.size());
+    sink(out[0]);
+  });
+
+  Queue<float> floatQueue(kFloatsPerDSPVector * 4);
+  r.run("buffers/Queue<float> push+pop", kFloatsPerDSPVector, [&] {
+    for (int i = 0; i < kFloatsPerDSPVector; ++i)
+    {
+      floatQueue.push(gAudio[i]);
+    }
+    float f;
+    for (int i = 0; i < kFloatsPerDSPVector; ++i)
+    {
+      floatQueue.pop(f);
+      sink(f);
+    }
+  });
+
+  Queue<DSPVector> vectorQueue(16);
+  r.run("buffers/Queue<DSPVector> push+pop", kFloatsPerDSPVector, [&] {
+    vectorQueue.push(gAudio);
+    sink(vectorQueue.pop());
+  });
+}
+
+void benchSymbols(Runner& r)
+{
+  constexpr int kNames = 1024;
+  constexpr int kLookups = 64;
+
+  // fill the table with some names, as in a typical application.
+  textUtils::NameMaker namer;
+  std::vector<TextFragment> names;
+  std::vector<Symbol> symbols;
+  for (int i = 0; i < kNames; ++i)
+  {
+    names.push_back(namer.nextName());
+    symbols.push_back(Symbol(names.back()));
+  }
+
+  std::map<Symbol, float> orderedMap;
+  std::unordered_map<Symbol, float> unorderedMap;
+  for (int i = 0; i < kNames; ++i)
+  {
+    orderedMap[symbols[i]] = i;
+    unorderedMap[symbols[i]] = i;
+  }
+
+  int start = 0;
+  auto nextStart = [&]() { return start = (start + kLookups) & (kNames - 1); };
+
+  r.run("symbol/from literal", kLookups, [&] {
+    for (int i = 0; i < kLookups; ++i)
+    {
+      sink(Symbol("madronalib_bench"));
+    }
+  });
+  r.run("symbol/from text", kLookups, [&] {
+    int s = nextStart();
+    for (int i = 0; i < kLookups; ++i)
+    {
+      sink(Symbol(names[s + i]));
+    }
+  });
+  r.run("symbol/compare", kLookups, [&] {
+    int s = nextStart();
+    int matches = 0;
+    for (int i = 0; i < kLookups; ++i)
+    {
+      matches += (symbols[s + i] == symbols[i]);
+    }
+    sink(matches);
+  });
+  r.run("symbol/std::map find", kLookups, [&] {
+    int s = nextStart();
+    for (int i = 0; i < kLookups; ++i)
+    {
+      sink(orderedMap.find(symbols[s + i])->second);
+    }
+  });
+  r.run("symbol/std::unordered_map find", kLookups, [&] {
+    int s = nextStart();
+    for (int i = 0; i < kLookups; ++i)
+    {
+      sink(unorderedMap.find(symbols[s + i])->second);
+    }
+  });
+}
+
+// ----------------------------------------------------------------
+// output
+
+std::string jsonEscape(const std::string& s)
+{
+  std::string r;
+  for (char c : s)
+  {
+    if ((c == '"') || (c == '\\')) r += '\\';
+    r += c;
+  }
+  return r;
+}
+
+void printJSON(const std::vector<Result>& results)
+{
+  std::printf("{\n");
+  std::printf("  \"simd\": \"%s\",\n", getSIMDName());
+  std::printf("  \"vector_size\": %d,\n", kFloatsPerDSPVector);
+  std::printf("  \"results\": [\n");
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    const Result& res = results[i];
+    std::printf("    {\"name\": \"%s\", \"ns_per_sample\": %.6g, \"cycles_per_sample\": ",
+                jsonEscape(res.name).c_str(), res.nsPerSample);
+#ifdef ML_BENCH_HAS_CYCLE_COUNTER
+    std::printf("%.6g", res.cyclesPerSample);
+#else
+    std::printf("null");
+#endif
+    std::printf("}%s\n", (i + 1 < results.size()) ? "," : "");
+  }
+  std::printf("  ]\n");
+  std::printf("}\n");
+}
+
+// read the name and ns_per_sample of each result from a file written by
+// printJSON().
+bool readBaseline(const std::string& path, std::map<std::string, double>& baseline)
+{
+  std::ifstream in(path);
+  if (!in) return false;
+  const std::string nameKey = "\"name\": \"";
+  const std::string nsKey = "\"ns_per_sample\": ";
+  std::string line;
+  while (std::getline(in, line))
+  {
+    size_t nameStart = line.find(nameKey);
+    size_t nsStart = line.find(nsKey);
+    if ((nameStart == std::string::npos) || (nsStart == std::string::npos)) continue;
+
+    nameStart += nameKey.size();
+    std::string name;
+    for (size_t i = nameStart; (i < line.size()) && (line[i] != '"'); ++i)
+    {
+      if (line[i] == '\\') ++i;
+      name += line[i];
+    }
+    baseline[name] = std::strtod(line.c_str() + nsStart + nsKey.size(), nullptr);
+  }
+  return true;
+}
+
+// print the ratio of each result to its baseline, and return the number of
+// results slower than the threshold allows. Printed to stderr so that JSON
+// output on stdout is unchanged.
+int compareToBaseline(const std::vector<Result>& results,
+                      const std::map<std::string, double>& baseline, double threshold)
+{
+  int regressions = 0;
+  std::fprintf(stderr, "\n%-40s %12s %12s %8s\n", "benchmark", "baseline ns", "ns", "ratio");
+  for (const auto& res : results)
+  {
+    auto it = baseline.find(res.name);
+    if (it == baseline.end()) continue;
+    double ratio = res.nsPerSample / it->second;
+    bool slower = ratio > 1.0 + threshold;
+    regressions += slower;
+    std::fprintf(stderr, "%-40s %12.4f %12.4f %8.3f%s\n", res.name.c_str(), it->second,
+                 res.nsPerSample, ratio, slower ? "  SLOWER" : "");
+  }
+  std::fprintf(stderr, "%d benchmarks slower than baseline by more than %g%%.\n", regressions,
+               threshold * 100.0);
+  return regressions;
+}
+
+bool parseOptions(int argc, char** argv, Options& options)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    bool hasValue = (i + 1 < argc);
+    if (arg == "--json")
+    {
+      options.json = true;
+    }
+    else if ((arg == "--filter") && hasValue)
+    {
+      options.filter = argv[++i];
+    }
+    else if ((arg == "--min-time") && hasValue)
+    {
+      options.minTimeMs = std::atof(argv[++i]);
+    }
+    else if ((arg == "--baseline") && hasValue)
+    {
+      options.baseline = argv[++i];
+    }
+    else if ((arg == "--threshold") && hasValue)
+    {
+      options.threshold = std::atof(argv[++i]);
+    }
+    else
+    {
+      std::fprintf(stderr,
+                   "usage: madronalib_bench [--json] [--filter <text>] [--min-time <ms>] "
+                   "[--baseline <file>] [--threshold <ratio>]\n");
+      return false;
+    }
+  }
+  return true;
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  Options options;
+  if (!parseOptions(argc, argv, options)) return 2;
+
+  std::map<std::string, double> baseline;
+  if (!options.baseline.empty() && !readBaseline(options.baseline, baseline))
+  {
+    std::fprintf(stderr, "madronalib_bench: could not read %s\n", options.baseline.c_str());
+    return 2;
+  }
+
+  makeInputs();
+
+  if (!options.json)
+  {
+    std::printf("madronalib_bench: %s, vector size %d\n", getSIMDName(), kFloatsPerDSPVector);
+    std::printf("%-40s %12s %14s\n", "benchmark", "ns/sample", "cycles/sample");
+  }
+
+  Runner r(options);
+  benchOps(r);
+  benchFilters(r);
+  benchGens(r);
+  benchFunctional(r);
+  benchTables(r);
+  benchResample(r, options);
+  benchConvolution(r);
+  benchSpectral(r);
+  benchBuffers(r);
+  benchSymbols(r);
+
+  if (options.json)
+  {
+    printJSON(r.getResults());
+  }
+
+  if (!baseline.empty())
+  {
+    return compareToBaseline(r.getResults(), baseline, options.threshold) ? 1 : 0;
+  }
+  return 0;
+}
@@ -156,7 +156,7 @@ TEST_CASE("madronalib/core/dspbuffer/threads", "[dspbuffer][threads]")
 TEST_CASE("madronalib/core/dspbuffer/overlap", "[dspbuffer][overlap]")
 {
   DSPBuffer buf;
-  buf.resize(256);
+  buf.resize(kFloatsPerDSPVector * 4);
 
   DSPVector outputVec, outputVec2;
   int overlap = kFloatsPerDSPVector / 2;
@@ -188,7 +188,7 @@ TEST_CASE("madronalib/core/dspbuffer/overlap", "[dspbuffer][overlap]")
 TEST_CASE("madronalib/core/dspbuffer/vectors", "[dspbuffer][vectors]")
 {
   DSPBuffer buf;
-  buf.resize(256);
+  buf.resize(kFloatsPerDSPVector * 4);
 
   constexpr size_t kRows = 3;
   DSPVectorArray<kRows> inputVec, outputVec;
@@ -213,14 +213,15 @@ TEST_CASE("madronalib/core/dspbuffer/peek", "[dspbuffer][peek]")
 {
   // buffer should be next larger power-of-two size
   DSPBuffer buf;
-  buf.resize(256);
+  buf.resize(kFloatsPerDSPVector * 4);
 
   // write to near end
+  const int nearEnd = kFloatsPerDSPVector * 3 + 11;
   std::vector<float> nines;
-  nines.resize(256);
+  nines.resize(nearEnd);
   std::fill(nines.begin(), nines.end(), 9.f);
-  buf.write(nines.data(), 203);
-  buf.read(nines.data(), 203);
+  buf.write(nines.data(), nearEnd);
+  buf.read(nines.data(), nearEnd);
 
   // write DSPVectors with wrap
   DSPVector v1(columnIndex());
@@ -237,7 +238,8 @@ TEST_CASE("madronalib/core/dspbuffer/peek", "[dspbuffer][peek]")
   floatVec.resize(200);
   buf.peekMostRecent(floatVec.data(), 20);
 
-  REQUIRE(floatVec[0] == 109);
+  // the 19 most recent values from the DSPVectors, then the single sample
+  REQUIRE(floatVec[0] == kFloatsPerDSPVector * 2 - 19);
   REQUIRE(floatVec[19] == 128);
 }
 }  // namespace dspBufferTest
@@ -0,0 +1,141 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// a unit test made using the Catch framework in catch.hpp / tests.cpp.
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "catch.hpp"
+#include "madronalib.h"
+#include "mldsp.h"
+#include "tests.h"
+
+using namespace ml;
+
+namespace dspConvolutionTest
+{
+// the largest difference between the output of the convolver and the direct
+// convolution of the input with the impulse response.
+template <typename CONVOLVER>
+float maxConvolutionError(CONVOLVER& c, const std::vector<float>& ir, int latency)
+{
+  constexpr int kVectors = 64;
+  const std::vector<float> x = makeNoise(kFloatsPerDSPVector * kVectors, 1);
+  std::vector<float> y;
+  for (int v = 0; v < kVectors; ++v)
+  {
+    DSPVector vy = c(DSPVector(x.data() + v * kFloatsPerDSPVector));
+    y.insert(y.end(), vy.getConstBuffer(), vy.getConstBuffer() + kFloatsPerDSPVector);
+  }
+
+  float maxErr = 0.f;
+  for (int n = 0; n + latency < static_cast<int>(y.size()); ++n)
+  {
+    double sum = 0.;
+    for (int k = 0; k < static_cast<int>(ir.size()) && k <= n; ++k)
+    {
+      sum += ir[k] * x[n - k];
+    }
+    maxErr = std::max(maxErr, std::fabs(y[n + latency] - static_cast<float>(sum)));
+  }
+  return maxErr;
+}
+}  // namespace dspConvolutionTest
+
+using namespace dspConvolutionTest;
+
+TEST_CASE("madronalib/core/convolution/partitioned", "[convolution]")
+{
+  const std::vector<float> ir = makeNoise(1000, 2);
+
+  // the output matches direct convolution, with no latency for the default
+  // partition size.
+  PartitionedConvolver c1(ir.data(), ir.size());
+  REQUIRE(c1.getLatency() == 0);
+  REQUIRE(c1.getPartitions() == (1000 + kFloatsPerDSPVector - 1) / kFloatsPerDSPVector);
+  REQUIRE(maxConvolutionError(c1, ir, 0) < 1e-4f);
+
+  // longer partitions add latency.
+  PartitionedConvolver c2(ir.data(), ir.size(), kFloatsPerDSPVector * 4);
+  REQUIRE(c2.getLatency() == kFloatsPerDSPVector * 3);
+  REQUIRE(maxConvolutionError(c2, ir, c2.getLatency()) < 1e-4f);
+
+  // impulse responses shorter than one partition work too.
+  const std::vector<float> shortIR{0.5f, 0.25f, -0.125f};
+  PartitionedConvolver c3(shortIR.data(), shortIR.size());
+  REQUIRE(maxConvolutionError(c3, shortIR, 0) < 1e-5f);
+
+  // an impulse response from a Matrix.
+  Matrix m(3);
+  m[0] = 0.5f;
+  m[1] = 0.25f;
+  m[2] = -0.125f;
+  PartitionedConvolver c4(m);
+  DSPVector impulse;
+  impulse[0] = 1.f;
+  DSPVector y = c4(impulse);
+  REQUIRE(fabsf(y[1] - 0.25f) < 1e-6f);
+  REQUIRE(fabsf(y[3]) < 1e-6f);
+
+  // clear() removes the input history.
+  c4.clear();
+  y = c4(DSPVector());
+  REQUIRE(fabsf(y[1]) < 1e-6f);
+}
+
+TEST_CASE("madronalib/core/convolution/non_uniform", "[convolution]")
+{
+  // a decaying noise impulse response, long enough to need two tiers. The
+  // second tier starts at twice its partition size. The response is scaled so
+  // that the output level, and with it the rounding error, does not depend on
+  // its length.
+  constexpr size_t kSecondTierStart = kFloatsPerDSPVector * NonUniformConvolver::kFirstTierScale *
+                                      NonUniformConvolver::kTierGrowth * 2;
+  std::vector<float> ir = makeNoise(kSecondTierStart * 5 / 4, 3);
+  const float scale = 1.f / std::sqrt(static_cast<float>(ir.size()));
+  for (size_t i = 0; i < ir.size(); ++i)
+  {
+    ir[i] *= scale * expf(-4.f * i / ir.size());
+  }
+
+  NonUniformConvolver realtime(ir.data(), ir.size());
+  NonUniformConvolver offline(ir.data(), ir.size(), true);
+  PartitionedConvolver reference(ir.data(), ir.size());
+  REQUIRE(realtime.getTiers() >= 2);
+  REQUIRE(realtime.getTierPartitionSize(1) > realtime.getTierPartitionSize(0));
+
+  // the output has no latency, and is the same in offline mode as it is with
+  // the tiers computed on background threads.
+  const std::vector<float> x = makeNoise(ir.size() * 2, 4);
+  float maxErr = 0.f;
+  bool matched = true;
+  for (size_t n = 0; n < x.size(); n += kFloatsPerDSPVector)
+  {
+    DSPVector vx(x.data() + n);
+    DSPVector y1 = realtime(vx);
+    DSPVector y2 = offline(vx);
+    DSPVector y3 = reference(vx);
+    matched &= (y1 == y2);
+    maxErr = std::max(maxErr, max(abs(y1 - y3)));
+  }
+  REQUIRE(matched);
+  REQUIRE(maxErr < 1e-4f);
+
+  // after clear(), an impulse gives the impulse response.
+  realtime.clear();
+  DSPVector impulse;
+  impulse[0] = 1.f;
+  maxErr = 0.f;
+  for (size_t n = 0; n < ir.size(); n += kFloatsPerDSPVector)
+  {
+    DSPVector y = realtime(n ? DSPVector() : impulse);
+    for (int i = 0; i < kFloatsPerDSPVector && n + i < ir.size(); ++i)
+    {
+      maxErr = std::max(maxErr, std::fabs(y[i] - ir[n + i]));
+    }
+  }
+  REQUIRE(maxErr < 1e-5f);
+}
@@ -0,0 +1,184 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// a unit test made using the Catch framework in catch.hpp / tests.cpp.
+
+#include <cstring>
+#include <iostream>
+
+#include "catch.hpp"
+#include "madronalib.h"
+#include "mldsp.h"
+#include "tests.h"
+
+using namespace ml;
+
+#ifdef ML_DSP_HAS_KERNEL_DISPATCH
+
+namespace dspDispatchTest
+{
+// enough rows to run every kernel over more than one of the widest vectors.
+constexpr int kRows = 4;
+constexpr int kSize = kFloatsPerDSPVector * kRows;
+
+// inputs covering the useful ranges of the operators.
+struct Inputs
+{
+  DSPVectorArray<kRows> a, b, c;
+  DSPVectorArrayInt<kRows> ia, ib, ic;
+
+  Inputs()
+  {
+    RandomScalarSource r;
+    for (int i = 0; i < kSize; ++i)
+    {
+      float x = r.getFloat();
+      a.getBuffer()[i] = x * 8.f;
+      b.getBuffer()[i] = (x * x + 0.0625f) * 2.f;
+      c.getBuffer()[i] = r.getFloat();
+      ia.getBuffer()[i] = static_cast<int>(x * 1000.f);
+      ib.getBuffer()[i] = static_cast<int>(r.getFloat() * 1000.f);
+      ic.getBuffer()[i] = (i & 3) ? -1 : 0;
+    }
+    // some exact ties for the comparisons
+    for (int i = 0; i < kSize; i += 5)
+    {
+      b.getBuffer()[i] = a.getBuffer()[i];
+    }
+  }
+};
+
+// compare the results of each kernel in the table to the SSE2 kernels.
+bool matchesSSE2(const DSPKernelTable& k, const Inputs& in)
+{
+  const DSPKernelTable& ref = kDSPKernelsSSE2;
+  const float* pa = in.a.getConstBuffer();
+  const float* pb = in.b.getConstBuffer();
+  const float* pc = in.c.getConstBuffer();
+  const float* pia = reinterpret_cast<const float*>(in.ia.getConstBuffer());
+  const float* pib = reinterpret_cast<const float*>(in.ib.getConstBuffer());
+  const float* pic = reinterpret_cast<const float*>(in.ic.getConstBuffer());
+  DSPVectorArray<kRows> y, yRef;
+  float* py = y.getBuffer();
+  float* pyRef = yRef.getBuffer();
+  bool ok = true;
+
+  auto check = [&](const char* name) {
+    if (std::memcmp(py, pyRef, kSize * sizeof(float)) != 0)
+    {
+      std::cout << "kernel " << name << " does not match SSE2\n";
+      ok = false;
+    }
+  };
+
+#define TEST_OP1(opName)            \
+  k.op1.opName(pb, py, kSize);      \
+  ref.op1.opName(pb, pyRef, kSize); \
+  check(#opName);
+#define TEST_OP2(opName)                \
+  k.op2.opName(pa, pb, py, kSize);      \
+  ref.op2.opName(pa, pb, pyRef, kSize); \
+  check(#opName);
+#define TEST_OP2_INT32(opName)                 \
+  k.op2Int32.opName(pia, pib, py, kSize);      \
+  ref.op2Int32.opName(pia, pib, pyRef, kSize); \
+  check(#opName);
+#define TEST_OP3(opName)                    \
+  k.op3.opName(pa, pb, pc, py, kSize);      \
+  ref.op3.opName(pa, pb, pc, pyRef, kSize); \
+  check(#opName);
+#define TEST_OP1_F2I(opName)           \
+  k.op1F2I.opName(pa, py, kSize);      \
+  ref.op1F2I.opName(pa, pyRef, kSize); \
+  check(#opName);
+#define TEST_OP1_I2F(opName)            \
+  k.op1I2F.opName(pia, py, kSize);      \
+  ref.op1I2F.opName(pia, pyRef, kSize); \
+  check(#opName);
+#define TEST_OP2_FF2I(opName)               \
+  k.op2FF2I.opName(pa, pb, py, kSize);      \
+  ref.op2FF2I.opName(pa, pb, pyRef, kSize); \
+  check(#opName);
+#define TEST_OP3_FFI2F(opName)                    \
+  k.op3FFI2F.opName(pa, pb, pic, py, kSize);      \
+  ref.op3FFI2F.opName(pa, pb, pic, pyRef, kSize); \
+  check(#opName);
+#define TEST_OP3_III2I(opName)                      \
+  k.op3III2I.opName(pia, pib, pic, py, kSize);      \
+  ref.op3III2I.opName(pia, pib, pic, pyRef, kSize); \
+  check(#opName);
+
+  ML_DSP_OP1_KERNELS(TEST_OP1)
+  ML_DSP_OP2_KERNELS(TEST_OP2)
+  ML_DSP_OP2_INT32_KERNELS(TEST_OP2_INT32)
+  ML_DSP_OP3_KERNELS(TEST_OP3)
+  ML_DSP_OP1_F2I_KERNELS(TEST_OP1_F2I)
+  ML_DSP_OP1_I2F_KERNELS(TEST_OP1_I2F)
+  ML_DSP_OP2_FF2I_KERNELS(TEST_OP2_FF2I)
+  ML_DSP_OP3_FFI2F_KERNELS(TEST_OP3_FFI2F)
+  ML_DSP_OP3_III2I_KERNELS(TEST_OP3_III2I)
+
+  // lookups, over positions that include both clamped ends of the table.
+  constexpr int kTableSize = 64;
+  float table[kTableSize + 4];
+  for (int i = 0; i < kTableSize + 4; ++i)
+  {
+    table[i] = pc[i];
+  }
+#define TEST_LOOKUP(opName)                                              \
+  k.lookup.opName(table + 1, kTableSize, 5.f, 32.f, pa, py, kSize);      \
+  ref.lookup.opName(table + 1, kTableSize, 5.f, 32.f, pa, pyRef, kSize); \
+  check(#opName);
+
+  ML_DSP_LOOKUP_KERNELS(TEST_LOOKUP)
+
+  // reductions
+  for (int j = 0; j < kRows; ++j)
+  {
+    const float* px = pa + j * kFloatsPerDSPVector;
+#define TEST_REDUCTION(opName)                                        \
+  if (k.reduction.opName(px) != ref.reduction.opName(px))             \
+  {                                                                   \
+    std::cout << "reduction " << #opName << " does not match SSE2\n"; \
+    ok = false;                                                       \
+  }
+    ML_DSP_REDUCTION_KERNELS(TEST_REDUCTION)
+  }
+
+  return ok;
+}
+}  // namespace dspDispatchTest
+
+using namespace dspDispatchTest;
+
+TEST_CASE("madronalib/core/dsp_dispatch", "[dsp_dispatch]")
+{
+  const Inputs inputs;
+  const SIMDLevel detected = detectSIMDLevel();
+  const SIMDLevel initial = getSIMDLevel();
+
+  // without being told otherwise, the library uses the best level.
+  REQUIRE(initial == detected);
+
+  // every supported level gives the same results as SSE2.
+  for (int i = kSSE2; i <= detected; ++i)
+  {
+    SIMDLevel level = static_cast<SIMDLevel>(i);
+    REQUIRE(setSIMDLevel(level));
+    REQUIRE(getSIMDLevel() == level);
+    std::cout << "testing " << getSIMDLevelName(level) << " kernels\n";
+    REQUIRE(matchesSSE2(getDSPKernels(), inputs));
+  }
+
+  // unsupported levels are refused.
+  if (detected < kAVX512)
+  {
+    REQUIRE(!setSIMDLevel(kAVX512));
+  }
+
+  setSIMDLevel(initial);
+  REQUIRE(getSIMDLevel() == initial);
+}
+
+#endif  // ML_DSP_HAS_KERNEL_DISPATCH
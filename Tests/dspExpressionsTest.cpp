@@ -0,0 +1,103 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// a unit test made using the Catch framework in catch.hpp / tests.cpp.
+
+#include <iostream>
+
+#include "catch.hpp"
+#include "madronalib.h"
+#include "mldsp.h"
+#include "tests.h"
+
+using namespace ml;
+
+namespace dspExpressionsTest
+{
+template <size_t ROWS>
+bool bitwiseEqual(const DSPVectorArray<ROWS>& a, const DSPVectorArray<ROWS>& b)
+{
+  return !memcmp(a.getConstBuffer(), b.getConstBuffer(),
+                 sizeof(float) * kFloatsPerDSPVector * ROWS);
+}
+
+template <size_t ROWS>
+bool bitwiseEqual(const DSPVectorArrayInt<ROWS>& a, const DSPVectorArrayInt<ROWS>& b)
+{
+  return !memcmp(a.getConstBuffer(), b.getConstBuffer(),
+                 sizeof(float) * kFloatsPerDSPVector * ROWS);
+}
+
+// the original eager version of phasorToSine(), for comparison.
+inline DSPVector eagerPhasorToSine(DSPVector phasorV)
+{
+  constexpr float sqrt2(static_cast<float>(const_math::sqrt(2.0f)));
+  constexpr float domain(sqrt2 * 4.f);
+  DSPVector domainScaleV(domain);
+  DSPVector domainOffsetV(-sqrt2);
+  constexpr float range(sqrt2 - sqrt2 * sqrt2 * sqrt2 / 6.f);
+  DSPVector scaleV(1.0f / range);
+  DSPVector flipOffsetV(sqrt2 * 2.f);
+  DSPVector oneV(1.f);
+  DSPVector oneSixthV(1.0f / 6.f);
+  DSPVector omegaV = phasorV * (domainScaleV) + (domainOffsetV);
+  DSPVector triangleV = select(flipOffsetV - omegaV, omegaV, greaterThan(omegaV, DSPVector(sqrt2)));
+  return scaleV * triangleV * (oneV - triangleV * triangleV * oneSixthV);
+}
+}  // namespace dspExpressionsTest
+
+using namespace dspExpressionsTest;
+
+TEST_CASE("madronalib/core/dsp_expressions", "[dsp_expressions]")
+{
+  DSPVector a(rangeOpen(-2.f, 2.f));
+  DSPVector b(rangeClosed(0.5f, 3.f));
+  DSPVector c(columnIndex());
+
+  // arithmetic with vectors and floats on either side
+  DSPVector eager1 = a * b + c * 0.25f - 1.f / b;
+  DSPVector lazy1 = lazy(a) * b + lazy(c) * 0.25f - 1.f / lazy(b);
+  REQUIRE(bitwiseEqual(eager1, lazy1));
+
+  // functions of one, two and three arguments
+  DSPVector eager2 = lerp(sin(a), exp(b), clamp(c * 0.1f, DSPVector(0.f), DSPVector(1.f)));
+  DSPVector lazy2 = lerp(sin(lazy(a)), exp(lazy(b)), clamp(lazy(c) * 0.1f, 0.f, 1.f));
+  REQUIRE(bitwiseEqual(eager2, lazy2));
+
+  DSPVector eager3 = max(pow(b, a), sqrt(b)) / min(abs(a), DSPVector(0.5f));
+  DSPVector lazy3 = max(pow(lazy(b), a), sqrt(lazy(b))) / min(abs(lazy(a)), 0.5f);
+  REQUIRE(bitwiseEqual(eager3, lazy3));
+
+  // comparisons and select
+  DSPVectorInt eagerMask = greaterThan(a, b - 2.f);
+  DSPVectorInt lazyMask = greaterThan(lazy(a), lazy(b) - 2.f);
+  REQUIRE(bitwiseEqual(eagerMask, lazyMask));
+
+  DSPVector eager4 = select(a, b * 2.f, eagerMask);
+  DSPVector lazy4 = select(lazy(a), lazy(b) * 2.f, greaterThan(lazy(a), lazy(b) - 2.f));
+  DSPVector lazy5 = select(a, lazy(b) * 2.f, eagerMask);
+  REQUIRE(bitwiseEqual(eager4, lazy4));
+  REQUIRE(bitwiseEqual(eager4, lazy5));
+
+  // expressions held in variables and reused
+  auto x = lazy(a) * 0.5f;
+  auto y = x * x + x;
+  DSPVector eager6 = (a * 0.5f) * (a * 0.5f) + (a * 0.5f);
+  REQUIRE(bitwiseEqual(eager6, DSPVector(y)));
+
+  // assignment to an existing vector, reading the same vector
+  DSPVector d = a;
+  d = lazy(d) * d + 1.f;
+  REQUIRE(bitwiseEqual(d, a * a + 1.f));
+
+  // multiple rows
+  DSPVectorArray<3> m(repeatRows<3>(a));
+  DSPVectorArray<3> eager7 = m * m - exp(m);
+  DSPVectorArray<3> lazy7 = lazy(m) * m - exp(lazy(m));
+  REQUIRE(bitwiseEqual(eager7, lazy7));
+
+  // the lazy phasorToSine matches the eager version
+  DSPVector phasor(rangeOpen(0.f, 1.f));
+  REQUIRE(bitwiseEqual(phasorToSine(phasor), eagerPhasorToSine(phasor)));
+}
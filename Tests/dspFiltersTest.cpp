@@ -0,0 +1,870 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// a unit test made using the Catch framework in catch.hpp / tests.cpp.
+
+#include <iostream>
+
+#include "catch.hpp"
+#include "madronalib.h"
+#include "mldsp.h"
+#include "tests.h"
+
+using namespace ml;
+
+namespace dspFiltersTest
+{
+// run three copies of a single input filter on the same input, using
+// operator(), process() and processInPlace(), and return true if all the
+// outputs are the same.
+template <typename FILTER, typename SETUP>
+bool processMatches(SETUP setup)
+{
+  FILTER f1, f2, f3;
+  setup(f1);
+  setup(f2);
+  setup(f3);
+
+  NoiseGen noise;
+  bool same = true;
+  for (int i = 0; i < 8; ++i)
+  {
+    DSPVector x = noise();
+    DSPVector y1 = f1(x);
+    DSPVector y2;
+    f2.process(x, y2);
+    DSPVector y3 = x;
+    f3.processInPlace(y3);
+    same &= (y1 == y2);
+    same &= (y1 == y3);
+  }
+  return same;
+}
+}  // namespace dspFiltersTest
+
+using namespace dspFiltersTest;
+
+TEST_CASE("madronalib/core/dsp_filters/process", "[dsp_filters]")
+{
+  auto none = [](auto&) {};
+  REQUIRE(processMatches<Lopass>([](Lopass& f) { f.mCoeffs = Lopass::coeffs(0.1f, 0.5f); }));
+  REQUIRE(processMatches<LopassD>([](LopassD& f) { f.mCoeffs = LopassD::coeffs(0.1, 0.5); }));
+  REQUIRE(processMatches<Hipass>([](Hipass& f) { f.mCoeffs = Hipass::coeffs(0.1f, 0.5f); }));
+  REQUIRE(
+      processMatches<Bandpass>([](Bandpass& f) { f.mCoeffs = Bandpass::coeffs(0.1f, 0.5f); }));
+  REQUIRE(processMatches<LoShelf>(
+      [](LoShelf& f) { f.mCoeffs = LoShelf::coeffs({0.1f, 0.5f, 2.f}); }));
+  REQUIRE(processMatches<HiShelf>(
+      [](HiShelf& f) { f.mCoeffs = HiShelf::coeffs({0.1f, 0.5f, 2.f}); }));
+  REQUIRE(processMatches<Bell>([](Bell& f) { f.mCoeffs = Bell::coeffs(0.1f, 0.5f, 2.f); }));
+  REQUIRE(processMatches<OnePole>([](OnePole& f) { f.mCoeffs = OnePole::coeffs(0.1f); }));
+  REQUIRE(
+      processMatches<DCBlocker>([](DCBlocker& f) { f.mCoeffs = DCBlocker::coeffs(0.045f); }));
+  REQUIRE(processMatches<Differentiator>(none));
+  REQUIRE(processMatches<Integrator>([](Integrator& f) { f.mLeak = 0.001f; }));
+  REQUIRE(processMatches<Peak>([](Peak& f) { f.mCoeffs = Peak::coeffs(0.01f); }));
+  REQUIRE(processMatches<RMS>([](RMS& f) { f.mCoeffs = RMS::coeffs(0.01f); }));
+  REQUIRE(processMatches<Allpass1>([](Allpass1& f) { f.mCoeffs = Allpass1::coeffs(0.8f); }));
+
+  // delays shorter and longer than a DSPVector.
+  for (int d : {5, 200})
+  {
+    REQUIRE(processMatches<IntegerDelay>([=](IntegerDelay& f) {
+      f.setMaxDelayInSamples(static_cast<float>(d));
+      f.setDelayInSamples(d);
+    }));
+    REQUIRE(processMatches<IntegerDelayHalf>([=](IntegerDelayHalf& f) {
+      f.setMaxDelayInSamples(static_cast<float>(d));
+      f.setDelayInSamples(d);
+    }));
+    REQUIRE(processMatches<FractionalDelay>([=](FractionalDelay& f) {
+      f.setMaxDelayInSamples(d + 1.f);
+      f.setDelayInSamples(d + 0.5f);
+    }));
+  }
+  REQUIRE(processMatches<Allpass<IntegerDelay>>([](Allpass<IntegerDelay>& f) {
+    f.setMaxDelayInSamples(300.f);
+    f.setDelayInSamples(200.f);
+    f.mGain = 0.5f;
+  }));
+}
+
+TEST_CASE("madronalib/core/dsp_filters/multi_tap", "[dsp_filters]")
+{
+  // integer taps match IntegerDelays with the same delays, and fractional taps
+  // interpolate linearly between two of them.
+  MultiTapDelay<4> taps(1001.f);
+  taps.setDelaysInSamples({{0.f, 5.f, 200.25f, 1000.f}});
+  taps.mGains = {{1.f, 0.5f, 1.f, -1.f}};
+  MultiTapDelay<4> modulatedTaps(1001.f);
+  modulatedTaps.mGains = taps.mGains;
+  const DSPVectorArray<4> vDelays =
+      concatRows(DSPVector(0.f), DSPVector(5.f), DSPVector(200.25f), DSPVector(1000.f));
+  IntegerDelay d5(5), d200(200), d201(201), d1000(1000);
+
+  // the per-sample reads of a modulated IntegerDelay match processSample().
+  IntegerDelay modulated(300), reference(300);
+
+  NoiseGen noise;
+  float maxDiff = 0.f;
+  bool same = true;
+  for (int i = 0; i < 4096 / kFloatsPerDSPVector; ++i)
+  {
+    DSPVector x = noise();
+    DSPVectorArray<4> y = taps(x);
+    maxDiff = std::max(maxDiff, max(abs(y.constRow(0) - x)));
+    maxDiff = std::max(maxDiff, max(abs(y.constRow(1) - d5(x) * DSPVector(0.5f))));
+    const DSPVector y200 = d200(x) * DSPVector(0.75f) + d201(x) * DSPVector(0.25f);
+    maxDiff = std::max(maxDiff, max(abs(y.constRow(2) - y200)));
+    maxDiff = std::max(maxDiff, max(abs(y.constRow(3) + d1000(x))));
+    same &= (modulatedTaps(x, vDelays) == y);
+
+    DSPVector vDelay = DSPVector(150.f) + noise() * DSPVector(140.f);
+    DSPVector y1 = modulated(x, vDelay);
+    DSPVector y2;
+    for (int n = 0; n < kFloatsPerDSPVector; ++n)
+    {
+      reference.setDelayInSamples(static_cast<int>(vDelay[n]));
+      y2[n] = reference.processSample(x[n]);
+    }
+    same &= (y1 == y2);
+  }
+  REQUIRE(maxDiff < 1e-6f);
+  REQUIRE(same);
+}
+
+TEST_CASE("madronalib/core/dsp_filters/fractional_delays", "[dsp_filters]")
+{
+  // with integer delays, all the interpolations match IntegerDelay.
+  auto matchesIntegerDelay = [](auto f) {
+    f.setMaxDelayInSamples(200.f);
+    f.setDelayInSamples(100.f);
+    IntegerDelay reference(100);
+    NoiseGen noise;
+    float maxDiff = 0.f;
+    for (int i = 0; i < 16; ++i)
+    {
+      DSPVector x = noise();
+      maxDiff = std::max(maxDiff, max(abs(f(x) - reference(x))));
+    }
+    return maxDiff < 1e-6f;
+  };
+  REQUIRE(matchesIntegerDelay(FractionalDelayLinear()));
+  REQUIRE(matchesIntegerDelay(FractionalDelayLagrange()));
+  REQUIRE(matchesIntegerDelay(FractionalDelaySinc()));
+  REQUIRE(matchesIntegerDelay(FractionalDelayThiran()));
+
+  // the largest error in delaying a sine by a modulated delay time, after the
+  // delay is full. The delay moves slowly enough that it is nearly constant
+  // over the length of the interpolators.
+  auto sineError = [](auto f, float freq, float depth) {
+    f.setMaxDelayInSamples(200.f);
+    float maxErr = 0.f;
+    for (int v = 0; v < 4096 / kFloatsPerDSPVector; ++v)
+    {
+      DSPVector x, vDelay, ideal;
+      for (int i = 0; i < kFloatsPerDSPVector; ++i)
+      {
+        const double n = v * kFloatsPerDSPVector + i;
+        const double d = 100.37 + depth * std::sin(kTwoPiD * n / 3000.);
+        x[i] = static_cast<float>(std::sin(kTwoPiD * freq * n));
+        vDelay[i] = static_cast<float>(d);
+        ideal[i] = static_cast<float>(std::sin(kTwoPiD * freq * (n - d)));
+      }
+      DSPVector y = f(x, vDelay);
+      if (v * kFloatsPerDSPVector >= 256) maxErr = std::max(maxErr, max(abs(y - ideal)));
+    }
+    return maxErr;
+  };
+  // at low frequencies the error falls with the order of the interpolation.
+  REQUIRE(sineError(FractionalDelayLinear(), 0.05f, 0.f) < 0.02f);
+  REQUIRE(sineError(FractionalDelayLagrange(), 0.05f, 0.f) < 5e-4f);
+  REQUIRE(sineError(FractionalDelaySinc(), 0.05f, 0.f) < 1e-3f);
+  REQUIRE(sineError(FractionalDelayThiran(), 0.05f, 0.f) < 1e-5f);
+
+  // the FIR interpolations are unaffected by modulation.
+  REQUIRE(sineError(FractionalDelayLinear(), 0.05f, 20.f) < 0.02f);
+  REQUIRE(sineError(FractionalDelayLagrange(), 0.05f, 20.f) < 5e-4f);
+  REQUIRE(sineError(FractionalDelaySinc(), 0.05f, 20.f) < 1e-3f);
+
+  // at higher frequencies the sinc and Thiran interpolations are better than
+  // Lagrange.
+  REQUIRE(sineError(FractionalDelayLagrange(), 0.2f, 0.f) < 0.1f);
+  REQUIRE(sineError(FractionalDelaySinc(), 0.2f, 0.f) < 0.01f);
+  REQUIRE(sineError(FractionalDelayThiran(), 0.2f, 0.f) < 0.01f);
+}
+
+TEST_CASE("madronalib/core/dsp_filters/pitchbendable_delay", "[dsp_filters]")
+{
+  // the previous PitchbendableDelay: two FractionalDelays, each with its own
+  // memory, crossfaded.
+  struct TwoBufferPitchbendableDelay
+  {
+    FractionalDelay mDelay1, mDelay2;
+    DSPVector operator()(const DSPVector vInput, const DSPVector vDelayInSamples)
+    {
+      using namespace PitchbendableDelayConsts;
+      DSPVector vy1, vy2;
+      mDelay1.process(vInput, vDelayInSamples, kvDelay1Changes, vy1);
+      mDelay2.process(vInput, vDelayInSamples, kvDelay2Changes, vy2);
+      return lerp(vy1, vy2, kvFade);
+    }
+  };
+
+  // the output is the same with steady, slowly changing and jumping delays.
+  constexpr float kMaxDelay = 1000.f;
+  PitchbendableDelay delay;
+  delay.setMaxDelayInSamples(kMaxDelay);
+  TwoBufferPitchbendableDelay reference;
+  reference.mDelay1.setMaxDelayInSamples(kMaxDelay);
+  reference.mDelay2.setMaxDelayInSamples(kMaxDelay);
+
+  NoiseGen noise;
+  SineGen lfo;
+  bool same = true;
+  for (int v = 0; v < 8192 / kFloatsPerDSPVector; ++v)
+  {
+    DSPVector vDelay;
+    if (v < 32)
+    {
+      vDelay = DSPVector(100.25f);
+    }
+    else if (v < 96)
+    {
+      vDelay = DSPVector(400.f) + lfo(DSPVector(0.001f)) * DSPVector(300.f);
+    }
+    else
+    {
+      vDelay = DSPVector(((v / 4) & 1) ? 50.5f : 900.75f);
+    }
+    DSPVector x = noise();
+    same &= (delay(x, vDelay) == reference(x, vDelay));
+  }
+  REQUIRE(same);
+
+  // after clear(), the output starts from silence.
+  delay.clear();
+  REQUIRE(delay(DSPVector(), DSPVector(100.f)) == DSPVector());
+}
+
+TEST_CASE("madronalib/core/dsp_filters/delay_arena", "[dsp_filters]")
+{
+  DelayArena arena(1 << 20);
+  REQUIRE(arena.getCapacity() == 1 << 20);
+
+  // delays are allocated one after another in the arena.
+  IntegerDelay d1, d2;
+  d1.setMaxDelayInSamples(1500.f, &arena);
+  REQUIRE(arena.getUsed() == 2048 * sizeof(float));
+  d2.setMaxDelayInSamples(1500.f);
+  REQUIRE(arena.getUsed() == 2048 * sizeof(float));
+
+  Allpass<PitchbendableDelay> ap1, ap2;
+  ap1.setMaxDelayInSamples(500.f, &arena);
+  ap2.setMaxDelayInSamples(500.f);
+  ap1.mGain = ap2.mGain = 0.6f;
+  FractionalDelayLagrange fd1, fd2;
+  fd1.setMaxDelayInSamples(300.f, &arena);
+  fd2.setMaxDelayInSamples(300.f);
+  const float base = kFloatsPerDSPVector * 4.f;
+  const std::array<float, 4> fdnDelays{{base + 11, base + 127, base + 203, base + 351}};
+  FDN<4> fdn1, fdn2;
+  fdn1.setMaxDelayInSamples(base + 351, &arena);
+  fdn2.setMaxDelayInSamples(base + 351);
+  fdn1.mFeedbackGains.fill(0.5f);
+  fdn2.mFeedbackGains.fill(0.5f);
+  fdn1.setDelaysInSamples(fdnDelays);
+  fdn2.setDelaysInSamples(fdnDelays);
+  REQUIRE(arena.getOverflow() == 0);
+
+  // delays in the arena sound the same as delays on the heap.
+  d1.setDelayInSamples(777);
+  d2.setDelayInSamples(777);
+  fd1.setDelayInSamples(123.4f);
+  fd2.setDelayInSamples(123.4f);
+  NoiseGen noise;
+  SineGen lfo;
+  bool same = true;
+  for (int v = 0; v < 64; ++v)
+  {
+    DSPVector x = noise();
+    DSPVector vDelay = DSPVector(300.f) + lfo(DSPVector(0.01f)) * DSPVector(100.f);
+    same &= (d1(x) == d2(x));
+    same &= (ap1(x, vDelay) == ap2(x, vDelay));
+    same &= (fd1(x) == fd2(x));
+    same &= (fdn1(x) == fdn2(x));
+  }
+  REQUIRE(same);
+
+  // changing the delays of an FDN within its maximum takes no more memory and
+  // keeps what is in the lines.
+  const size_t used = arena.getUsed();
+  fdn1.setDelaysInSamples({{base, base + 50, base + 100, base + 150}});
+  REQUIRE(arena.getUsed() == used);
+  DSPVectorArray<2> tail = fdn1(DSPVector());
+  const float tailLeft = max(abs(DSPVector(tail.constRow(0))));
+  const float tailRight = max(abs(DSPVector(tail.constRow(1))));
+  REQUIRE(tailLeft > 1e-3f);
+  REQUIRE(tailRight > 1e-3f);
+
+  // a copy of a delay in the arena has its own memory.
+  IntegerDelay d3(d1);
+  DSPVector x = noise();
+  REQUIRE(d3(x) == d1(x));
+
+  // allocations that do not fit are made on the heap instead.
+  DelayArena small(4096);
+  IntegerDelay d4;
+  d4.setMaxDelayInSamples(1500.f, &small);
+  d4.setDelayInSamples(10);
+  REQUIRE(small.getUsed() == 0);
+  REQUIRE(small.getOverflow() == 2048 * sizeof(float));
+  x = noise();
+  d4(x);
+  REQUIRE(d4(DSPVector())[5] == x[kFloatsPerDSPVector - 5]);
+
+  // after reset(), the memory is used again from the start.
+  arena.reset();
+  REQUIRE(arena.getUsed() == 0);
+  d1.setMaxDelayInSamples(1500.f, &arena);
+  REQUIRE(arena.getUsed() == 2048 * sizeof(float));
+
+  // with huge pages asked for, the arena works whether or not the OS gives
+  // them.
+  DelayArena hugeArena(1 << 20, true);
+  REQUIRE(hugeArena.getCapacity() == 1 << 20);
+  PitchbendableDelay pd;
+  pd.setMaxDelayInSamples(10000.f, &hugeArena);
+  REQUIRE(hugeArena.getUsed() == 16384 * sizeof(float));
+  REQUIRE(pd(DSPVector(), DSPVector(100.f)) == DSPVector());
+}
+
+TEST_CASE("madronalib/core/dsp_filters/vcoeffs", "[dsp_filters]")
+{
+  // with constant parameters, filters with per-sample coefficients match the
+  // same filters with scalar coefficients.
+  NoiseGen noise;
+  auto filterMatches = [&](auto& f1, auto& f2, auto vc) {
+    float maxDiff = 0.f;
+    for (int i = 0; i < 16; ++i)
+    {
+      DSPVector x = noise();
+      DSPVector y1 = f1(x);
+      DSPVector y2 = x;
+      f2.processInPlace(y2, vc);
+      maxDiff = std::max(maxDiff, max(abs(y1 - y2)));
+    }
+    return maxDiff < 1e-4f;
+  };
+
+  for (float omega : {0.001f, 0.05f, 0.4f})
+  {
+    const DSPVector vOmega(omega), vk(0.5f), vA(2.f);
+
+    Lopass lopass1, lopass2;
+    lopass1.mCoeffs = Lopass::coeffs(omega, 0.5f);
+    REQUIRE(filterMatches(lopass1, lopass2, Lopass::vcoeffs(vOmega, vk)));
+
+    LopassD lopassD1, lopassD2;
+    lopassD1.mCoeffs = LopassD::coeffs(omega, 0.5);
+    REQUIRE(filterMatches(lopassD1, lopassD2, LopassD::vcoeffs(vOmega, vk)));
+
+    Hipass hipass1, hipass2;
+    hipass1.mCoeffs = Hipass::coeffs(omega, 0.5f);
+    REQUIRE(filterMatches(hipass1, hipass2, Hipass::vcoeffs(vOmega, vk)));
+
+    Bandpass bandpass1, bandpass2;
+    bandpass1.mCoeffs = Bandpass::coeffs(omega, 0.5f);
+    REQUIRE(filterMatches(bandpass1, bandpass2, Bandpass::vcoeffs(vOmega, vk)));
+
+    LoShelf loShelf1, loShelf2;
+    loShelf1.mCoeffs = LoShelf::coeffs({omega, 0.5f, 2.f});
+    REQUIRE(filterMatches(loShelf1, loShelf2, LoShelf::vcoeffs(vOmega, vk, vA)));
+
+    HiShelf hiShelf1, hiShelf2;
+    hiShelf1.mCoeffs = HiShelf::coeffs({omega, 0.5f, 2.f});
+    REQUIRE(filterMatches(hiShelf1, hiShelf2, HiShelf::vcoeffs(vOmega, vk, vA)));
+
+    Bell bell1, bell2;
+    bell1.mCoeffs = Bell::coeffs(omega, 0.5f, 2.f);
+    REQUIRE(filterMatches(bell1, bell2, Bell::vcoeffs(vOmega, vk, vA)));
+  }
+
+  // an audio rate sweep over the whole range stays stable.
+  Lopass lopass;
+  Bell bell;
+  bool finite = true;
+  for (int i = 0; i < 16; ++i)
+  {
+    DSPVector sweep = columnIndex() * DSPVector(0.49f / kFloatsPerDSPVector) + DSPVector(0.001f);
+    DSPVector y1 = lopass(noise(), Lopass::vcoeffs(sweep, DSPVector(0.1f)));
+    DSPVector y2 = bell(noise(), Bell::vcoeffs(sweep, DSPVector(0.1f), DSPVector(4.f)));
+    finite &= (max(abs(y1)) < 100.f) && (max(abs(y2)) < 100.f);
+  }
+  REQUIRE(finite);
+}
+
+TEST_CASE("madronalib/core/dsp_filters/process_gens", "[dsp_filters]")
+{
+  // generators give the same output from process() and operator().
+  const DSPVector freq(0.01f);
+  SineGen s1, s2;
+  PulseGen p1, p2;
+  NoiseGen n1, n2;
+  PhasorGen ph1, ph2;
+  LinearGlide g1, g2;
+  g1.setGlideTimeInSamples(100.f);
+  g2.setGlideTimeInSamples(100.f);
+
+  bool same = true;
+  for (int i = 0; i < 4; ++i)
+  {
+    DSPVector y;
+    s2.process(freq, y);
+    same &= (s1(freq) == y);
+    p2.process(freq, DSPVector(0.25f), y);
+    same &= (p1(freq, DSPVector(0.25f)) == y);
+    n2.process(y);
+    same &= (n1() == y);
+    ph2.process(freq, y);
+    same &= (ph1(freq) == y);
+    g2.process(1.f, y);
+    same &= (g1(1.f) == y);
+  }
+  REQUIRE(same);
+}
+
+TEST_CASE("madronalib/core/dsp_filters/bank", "[dsp_filters]")
+{
+  constexpr int n = 4;
+  DSPVectorArray<n> x;
+  NoiseGen noise;
+  for (int j = 0; j < n; ++j)
+  {
+    x.row(j) = noise();
+  }
+
+  // a bank of filters, each with its own cutoff, matches separate filters.
+  Bank<Lopass, n> bank1, bank2, bank3;
+  std::array<Lopass, n> separate;
+  for (int j = 0; j < n; ++j)
+  {
+    auto c = Lopass::coeffs(0.05f * (j + 1), 0.5f);
+    bank1[j].mCoeffs = bank2[j].mCoeffs = bank3[j].mCoeffs = separate[j].mCoeffs = c;
+  }
+
+  DSPVectorArray<n> y1 = bank1(x);
+  DSPVectorArray<n> y2;
+  bank2.process(x, y2);
+  DSPVectorArray<n> y3 = x;
+  bank3.processInPlace(y3);
+
+  DSPVectorArray<n> ySeparate;
+  for (int j = 0; j < n; ++j)
+  {
+    ySeparate.row(j) = separate[j](x.constRow(j));
+  }
+
+  REQUIRE(y1 == ySeparate);
+  REQUIRE(y2 == ySeparate);
+  REQUIRE(y3 == ySeparate);
+}
+
+TEST_CASE("madronalib/core/dsp_filters/bank_mask", "[dsp_filters]")
+{
+  constexpr int n = 8;
+  DSPVectorArray<n> x;
+  NoiseGen noise;
+  for (int j = 0; j < n; ++j)
+  {
+    x.row(j) = noise();
+  }
+
+  Bank<Lopass, n> all, masked, maskedInPlace;
+  for (int j = 0; j < n; ++j)
+  {
+    auto c = Lopass::coeffs(0.02f * (j + 1), 0.5f);
+    all[j].mCoeffs = masked[j].mCoeffs = maskedInPlace[j].mCoeffs = c;
+  }
+
+  RowMask<n> mask;
+  mask.set(2, true);
+  mask.set(3, true);
+  mask.set(7, true);
+
+  // active rows match the unmasked bank, inactive rows are zero.
+  DSPVectorArray<n> yAll = all(x);
+  DSPVectorArray<n> yMasked = masked(mask, x);
+  DSPVectorArray<n> yInPlace = x;
+  maskedInPlace.processInPlace(mask, yInPlace);
+  REQUIRE(yMasked == maskRows(yAll, mask));
+  REQUIRE(yInPlace == yMasked);
+  masked.process(mask, x, yMasked);
+
+  // inactive processors were never run, so they still match new ones.
+  Lopass fresh;
+  fresh.mCoeffs = masked[0].mCoeffs;
+  REQUIRE(masked[0](x.constRow(0)) == fresh(x.constRow(0)));
+}
+
+TEST_CASE("madronalib/core/dsp_filters/silence", "[dsp_filters]")
+{
+  constexpr int n = 4;
+  RowMask<n> mask(true);
+  std::array<SilenceDetector, n> detectors;
+  for (auto& d : detectors)
+  {
+    d.holdSamples = kFloatsPerDSPVector * 4;
+  }
+
+  // rows 1 and 3 go silent, and are made inactive after the hold time.
+  DSPVectorArray<n> x{0.f};
+  x.row(0) = DSPVector(0.5f);
+  x.row(2) = DSPVector(1e-3f);
+  x.row(3) = DSPVector(1e-6f);
+  for (int i = 0; i < 3; ++i)
+  {
+    deactivateSilentRows(x, detectors, mask);
+  }
+  REQUIRE(mask.size() == n);
+  deactivateSilentRows(x, detectors, mask);
+  REQUIRE(mask.size() == 2);
+  REQUIRE(mask[0]);
+  REQUIRE(!mask[1]);
+  REQUIRE(mask[2]);
+  REQUIRE(!mask[3]);
+
+  // a sound resets the hold time.
+  SilenceDetector d;
+  d.holdSamples = kFloatsPerDSPVector * 2;
+  REQUIRE(!d(DSPVector(0.f)));
+  REQUIRE(!d(DSPVector(1.f)));
+  REQUIRE(!d(DSPVector(0.f)));
+  REQUIRE(d(DSPVector(0.f)));
+}
+
+TEST_CASE("madronalib/core/dsp_filters/simd_bank", "[dsp_filters]")
+{
+  // a SIMDBank gives the same results as a Bank of the same filters, for a
+  // number of rows that is not a multiple of the SIMD vector size.
+  constexpr int n = 11;
+  NoiseGen noise;
+  auto bankMatches = [&](auto& bank, auto& simdBank) {
+    float maxDiff = 0.f;
+    for (int i = 0; i < 4; ++i)
+    {
+      DSPVectorArray<n> x;
+      for (int j = 0; j < n; ++j)
+      {
+        x.row(j) = noise();
+      }
+      DSPVectorArray<n> y1 = bank(x);
+      DSPVectorArray<n> y2 = simdBank(x);
+      maxDiff = std::max(maxDiff, max(addRows(abs(y1 - y2))));
+    }
+    return maxDiff < 1e-5f;
+  };
+
+  Bank<Lopass, n> lopass;
+  SIMDBank<Lopass, n> simdLopass;
+  Bank<Hipass, n> hipass;
+  SIMDBank<Hipass, n> simdHipass;
+  Bank<Bandpass, n> bandpass;
+  SIMDBank<Bandpass, n> simdBandpass;
+  Bank<Bell, n> bell;
+  SIMDBank<Bell, n> simdBell;
+  Bank<OnePole, n> onePole;
+  SIMDBank<OnePole, n> simdOnePole;
+  for (int j = 0; j < n; ++j)
+  {
+    float omega = 0.01f * (j + 1);
+    simdLopass.setCoeffs(j, lopass[j].mCoeffs = Lopass::coeffs(omega, 0.5f));
+    simdHipass.setCoeffs(j, hipass[j].mCoeffs = Hipass::coeffs(omega, 0.5f));
+    simdBandpass.setCoeffs(j, bandpass[j].mCoeffs = Bandpass::coeffs(omega, 0.5f));
+    simdBell.setCoeffs(j, bell[j].mCoeffs = Bell::coeffs(omega, 0.5f, 2.f));
+    simdOnePole.setCoeffs(j, onePole[j].mCoeffs = OnePole::coeffs(omega));
+  }
+  REQUIRE(bankMatches(lopass, simdLopass));
+  REQUIRE(bankMatches(hipass, simdHipass));
+  REQUIRE(bankMatches(bandpass, simdBandpass));
+  REQUIRE(bankMatches(bell, simdBell));
+  REQUIRE(bankMatches(onePole, simdOnePole));
+
+  Bank<LoShelf, n> loShelf;
+  SIMDBank<LoShelf, n> simdLoShelf;
+  Bank<HiShelf, n> hiShelf;
+  SIMDBank<HiShelf, n> simdHiShelf;
+  for (int j = 0; j < n; ++j)
+  {
+    simdLoShelf.setCoeffs(j, loShelf[j].mCoeffs = LoShelf::coeffs({0.01f * (j + 1), 0.5f, 2.f}));
+    simdHiShelf.setCoeffs(j, hiShelf[j].mCoeffs = HiShelf::coeffs({0.01f * (j + 1), 0.5f, 2.f}));
+  }
+  REQUIRE(bankMatches(loShelf, simdLoShelf));
+  REQUIRE(bankMatches(hiShelf, simdHiShelf));
+
+  // clear() resets the state.
+  simdLopass.clear();
+  SIMDBank<Lopass, n> fresh;
+  for (int j = 0; j < n; ++j)
+  {
+    fresh.setCoeffs(j, Lopass::coeffs(0.01f * (j + 1), 0.5f));
+  }
+  DSPVectorArray<n> x(1.f);
+  REQUIRE(simdLopass(x) == fresh(x));
+}
+
+TEST_CASE("madronalib/core/dsp_filters/state_space", "[dsp_filters]")
+{
+  // a StateSpaceFilter gives the same results as its filter.
+  NoiseGen noise;
+  auto filterMatches = [&](auto& filter, auto& stateSpace) {
+    float maxDiff = 0.f;
+    for (int i = 0; i < 64; ++i)
+    {
+      DSPVector x = noise();
+      DSPVector y1 = filter(x);
+      DSPVector y2 = x;
+      stateSpace.processInPlace(y2);
+      maxDiff = std::max(maxDiff, max(abs(y1 - y2)));
+    }
+    return maxDiff < 1e-5f;
+  };
+
+  for (float omega : {0.001f, 0.05f, 0.4f})
+  {
+    Lopass lopass;
+    StateSpaceFilter<Lopass> ssLopass;
+    ssLopass.setCoeffs(lopass.mCoeffs = Lopass::coeffs(omega, 0.5f));
+    REQUIRE(filterMatches(lopass, ssLopass));
+
+    Hipass hipass;
+    StateSpaceFilter<Hipass> ssHipass;
+    ssHipass.setCoeffs(hipass.mCoeffs = Hipass::coeffs(omega, 0.5f));
+    REQUIRE(filterMatches(hipass, ssHipass));
+
+    Bandpass bandpass;
+    StateSpaceFilter<Bandpass> ssBandpass;
+    ssBandpass.setCoeffs(bandpass.mCoeffs = Bandpass::coeffs(omega, 0.5f));
+    REQUIRE(filterMatches(bandpass, ssBandpass));
+
+    LoShelf loShelf;
+    StateSpaceFilter<LoShelf> ssLoShelf;
+    ssLoShelf.setCoeffs(loShelf.mCoeffs = LoShelf::coeffs({omega, 0.5f, 2.f}));
+    REQUIRE(filterMatches(loShelf, ssLoShelf));
+
+    HiShelf hiShelf;
+    StateSpaceFilter<HiShelf> ssHiShelf;
+    ssHiShelf.setCoeffs(hiShelf.mCoeffs = HiShelf::coeffs({omega, 0.5f, 0.5f}));
+    REQUIRE(filterMatches(hiShelf, ssHiShelf));
+
+    Bell bell;
+    StateSpaceFilter<Bell> ssBell;
+    ssBell.setCoeffs(bell.mCoeffs = Bell::coeffs(omega, 0.5f, 2.f));
+    REQUIRE(filterMatches(bell, ssBell));
+
+    OnePole onePole;
+    StateSpaceFilter<OnePole> ssOnePole;
+    ssOnePole.setCoeffs(onePole.mCoeffs = OnePole::coeffs(omega));
+    REQUIRE(filterMatches(onePole, ssOnePole));
+  }
+
+  // clear() resets the state.
+  StateSpaceFilter<Bell> f1, f2;
+  f1.setCoeffs(Bell::coeffs(0.1f, 0.5f, 2.f));
+  f2.setCoeffs(Bell::coeffs(0.1f, 0.5f, 2.f));
+  f1(noise());
+  f1.clear();
+  DSPVector x = noise();
+  REQUIRE(f1(x) == f2(x));
+}
+
+TEST_CASE("madronalib/core/dsp_filters/half_band", "[dsp_filters]")
+{
+  // a SIMDHalfBandFilter matches a HalfBandFilter for each channel.
+  constexpr int n = 5;
+  NoiseGen noise;
+  SIMDHalfBandFilter<n> simdUp, simdDown;
+  std::array<HalfBandFilter, n> up, down;
+  float maxDiff = 0.f;
+  for (int i = 0; i < 8; ++i)
+  {
+    DSPVectorArray<n> x1, x2;
+    for (int j = 0; j < n; ++j)
+    {
+      x1.row(j) = noise();
+      x2.row(j) = noise();
+    }
+    DSPVectorArray<n> y1, y2;
+    simdUp.upsample(x1, y1, y2);
+    DSPVectorArray<n> yDown = simdDown.downsample(x1, x2);
+    for (int j = 0; j < n; ++j)
+    {
+      DSPVector z1 = up[j].upsampleFirstHalf(x1.constRow(j));
+      DSPVector z2 = up[j].upsampleSecondHalf(x1.constRow(j));
+      DSPVector zDown = down[j].downsample(x1.constRow(j), x2.constRow(j));
+      maxDiff = std::max(maxDiff, max(abs(y1.constRow(j) - z1)));
+      maxDiff = std::max(maxDiff, max(abs(y2.constRow(j) - z2)));
+      maxDiff = std::max(maxDiff, max(abs(yDown.constRow(j) - zDown)));
+    }
+  }
+  REQUIRE(maxDiff < 1e-5f);
+
+  // an Upsampler is a cascade of SIMDHalfBandFilters.
+  Upsampler<2> upsampler(2);
+  SIMDHalfBandFilter<2> octave1, octave2;
+  bool same = true;
+  for (int i = 0; i < 4; ++i)
+  {
+    DSPVectorArray<2> x = concatRows(noise(), noise());
+    upsampler.write(x);
+    DSPVectorArray<2> a, b;
+    octave1.upsample(x, a, b);
+    for (auto& v : {a, b})
+    {
+      DSPVectorArray<2> c, d;
+      octave2.upsample(v, c, d);
+      same &= (upsampler.read() == c);
+      same &= (upsampler.read() == d);
+    }
+  }
+  REQUIRE(same);
+}
+
+TEST_CASE("madronalib/core/dsp_filters/resample_functions", "[dsp_filters]")
+{
+  // resampling around an identity function passes DC and low frequencies.
+  auto identity = [](const DSPVector& x) { return x; };
+  auto passes = [&](auto& fn) {
+    // a sine with a period of 64 samples plus DC, measured over whole periods
+    // after the filters settle.
+    constexpr int kVectors = 4096 / kFloatsPerDSPVector;
+    SineGen sine;
+    float maxOut = 0.f;
+    float dcOut = 0.f;
+    for (int i = 0; i < kVectors; ++i)
+    {
+      DSPVector y = fn(identity, sine(DSPVector(1.f / 64)) * DSPVector(0.5f) + DSPVector(0.25f));
+      if (i >= kVectors / 2)
+      {
+        maxOut = std::max(maxOut, max(y));
+        dcOut += sum(y) / 2048.f;
+      }
+    }
+    return (fabsf(maxOut - 0.75f) < 0.01f) && (fabsf(dcOut - 0.25f) < 0.01f);
+  };
+
+  Upsample2xFunction<1> up2;
+  Upsample4xFunction<1> up4;
+  Upsample8xFunction<1> up8;
+  Downsample2xFunction<1> down2;
+  Downsample4xFunction<1> down4;
+  Downsample8xFunction<1> down8;
+  REQUIRE(passes(up2));
+  REQUIRE(passes(up4));
+  REQUIRE(passes(up8));
+  REQUIRE(passes(down2));
+  REQUIRE(passes(down4));
+  REQUIRE(passes(down8));
+}
+
+TEST_CASE("madronalib/core/dsp_filters/fdn", "[dsp_filters]")
+{
+  DSPVector impulse;
+  impulse[0] = 1.f;
+
+  // delays above the minimum of one DSPVector at every vector size.
+  constexpr int kBase = kFloatsPerDSPVector + 36;
+  const std::array<float, 4> delays{{kBase, kBase + 30, kBase + 70, kBase + 130}};
+
+  // an impulse reaches the outputs after the delay times, with the even lines
+  // going to the right channel and the odd lines to the left. Delays longer
+  // than the maximum are clamped to it.
+  auto impulseResponse = [&](float maxDelay, std::vector<float>& left,
+                             std::vector<float>& right) {
+    FDN<4> f;
+    f.setMaxDelayInSamples(maxDelay);
+    f.setDelaysInSamples(delays);
+    for (int v = 0; v < (kBase + 256) / kFloatsPerDSPVector; ++v)
+    {
+      DSPVectorArray<2> y = f(v ? DSPVector() : impulse);
+      left.insert(left.end(), y.constRow(0).getConstBuffer(),
+                  y.constRow(0).getConstBuffer() + kFloatsPerDSPVector);
+      right.insert(right.end(), y.constRow(1).getConstBuffer(),
+                   y.constRow(1).getConstBuffer() + kFloatsPerDSPVector);
+    }
+  };
+  {
+    std::vector<float> left, right;
+    impulseResponse(kBase + 130, left, right);
+    REQUIRE(right[kBase - 1] == 0.f);
+    REQUIRE(right[kBase] == 1.f);
+    REQUIRE(left[kBase + 29] == 0.f);
+    REQUIRE(left[kBase + 30] == 1.f);
+    REQUIRE(right[kBase + 70] == 1.f);
+  }
+  {
+    std::vector<float> left, right;
+    impulseResponse(kBase + 30, left, right);
+    REQUIRE(right[kBase] == 1.f);
+    REQUIRE(right[kBase + 30] == 1.f);
+    REQUIRE(left[kBase + 30] == 2.f);
+    REQUIRE(right[kBase + 70] == 0.f);
+  }
+
+  // the fast Hadamard transform gives the same results as the Hadamard matrix
+  // supplied by the user, and modulation with no change in delay gives the
+  // same results as no modulation.
+  constexpr int kSize = 16;
+  std::array<float, kSize> times, gains, cutoffs, zeros{}, depths;
+  std::array<std::array<float, kSize>, kSize> hadamard;
+  for (int i = 0; i < kSize; ++i)
+  {
+    times[i] = kBase + 37.f * i;
+    gains[i] = 0.8f;
+    cutoffs[i] = 0.2f;
+    depths[i] = 5.f;
+    for (int j = 0; j < kSize; ++j)
+    {
+      // the sign of each element is the parity of the bits i and j share.
+      int bits = i & j, parity = 0;
+      for (; bits; bits >>= 1) parity ^= (bits & 1);
+      hadamard[i][j] = (parity ? -1.f : 1.f) / 4.f;
+    }
+  }
+  FDN<kSize> fast, user, modulated;
+  for (auto* f : {&fast, &user, &modulated})
+  {
+    f->setMaxDelayInSamples(times[kSize - 1] + depths[kSize - 1]);
+    f->setDelaysInSamples(times);
+    f->setFilterCutoffs(cutoffs);
+    f->mFeedbackGains = gains;
+  }
+  fast.setFeedbackMatrix(FDN<kSize>::kHadamard);
+  user.setUserMatrix(hadamard);
+  modulated.setFeedbackMatrix(FDN<kSize>::kHadamard);
+  modulated.setModulation(zeros, depths);
+
+  auto peak = [](const DSPVectorArray<2>& y) {
+    return std::max(max(abs(DSPVector(y.constRow(0)))), max(abs(DSPVector(y.constRow(1)))));
+  };
+  float maxDiff = 0.f, maxModDiff = 0.f, early = 0.f, late = 0.f;
+  constexpr int kVectors = 16384 / kFloatsPerDSPVector;
+  for (int v = 0; v < kVectors; ++v)
+  {
+    const DSPVector x = v ? DSPVector() : impulse;
+    DSPVectorArray<2> y1 = fast(x);
+    DSPVectorArray<2> y2 = user(x);
+    DSPVectorArray<2> y3 = modulated(x);
+    maxDiff = std::max(maxDiff, peak(y1 - y2));
+    maxModDiff = std::max(maxModDiff, peak(y1 - y3));
+    if (v < kVectors / 8) early = std::max(early, peak(y1));
+    if (v >= kVectors * 7 / 8) late = std::max(late, peak(y1));
+  }
+  REQUIRE(maxDiff < 1e-5f);
+  REQUIRE(maxModDiff < 1e-6f);
+
+  // with feedback gains below 1, the network decays.
+  REQUIRE(early > 0.5f);
+  REQUIRE(late < early * 1e-3f);
+}
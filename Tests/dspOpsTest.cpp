@@ -173,6 +173,21 @@ TEST_CASE("madronalib/core/dsp_ops", "[dsp_ops]")
 
     REQUIRE(c == d);
     REQUIRE(d == e);
+
+    // mapping a temporary gives the same results once the call is inlined.
+    auto g = map([](DSPVector x) { return x * 2.f; }, repeatRows<3>(columnIndex()));
+    auto h = map([](DSPVector x, int j) { return x + DSPVector(kFloatsPerDSPVector * j); },
+                 repeatRows<3>(columnIndex()));
+    bool same = true;
+    for (int j = 0; j < 3; ++j)
+    {
+      for (int i = 0; i < kFloatsPerDSPVector; ++i)
+      {
+        same &= (g.constRow(j)[i] == i * 2.f);
+        same &= (h.constRow(j)[i] == static_cast<float>(kFloatsPerDSPVector * j + i));
+      }
+    }
+    REQUIRE(same);
   }
 
   SECTION("row operations")
@@ -287,6 +302,87 @@ TEST_CASE("madronalib/core/dsp_ops", "[dsp_ops]")
   }
 }
 
+TEST_CASE("madronalib/core/dsp_ops/transcendentals", "[dsp_ops]")
+{
+  // the error bounds of each tier are tested by the transcendentalTests target.
+  // here we check signs, quadrants and limits.
+  DSPVector zero(0.f), one(1.f), big(1e6f);
+  DSPVector minusOne(-1.f), minusBig(-1e6f);
+  REQUIRE(tanh(zero) == zero);
+  REQUIRE(tanh(big) == one);
+  REQUIRE(max(abs(tanhApprox(big) - one)) < 1e-6f);
+  REQUIRE(max(abs(tanhFast(big) - one)) < 1e-3f);
+  REQUIRE(tanhFast(minusBig) == zero - tanhFast(big));
+  REQUIRE(max(tanhFast(big)) <= 1.f);
+  REQUIRE(sinh(minusOne) == zero - sinh(one));
+  REQUIRE(atan(minusBig) == zero - atan(big));
+
+  // atan2 matches std::atan2 in all four quadrants, on the axes, and for
+  // signed zeros.
+  const float ys[] = {1.f, 1.f, -1.f, -1.f, 0.f, 0.f, -0.f, -0.f, 2.f, -2.f};
+  const float xs[] = {1.f, -1.f, 1.f, -1.f, 1.f, -1.f, 1.f, -1.f, 0.f, 0.f};
+  DSPVector vy(0.f), vx(1.f);
+  for (int i = 0; i < 10; ++i)
+  {
+    vy[i] = ys[i];
+    vx[i] = xs[i];
+  }
+  DSPVector precise = atan2(vy, vx);
+  DSPVector approx = atan2Approx(vy, vx);
+  DSPVector fast = atan2Fast(vy, vx);
+  bool quadrantsOK = true;
+  for (int i = 0; i < 10; ++i)
+  {
+    float ref = atan2f(ys[i], xs[i]);
+    quadrantsOK &= (fabs(precise[i] - ref) < 1e-6f);
+    quadrantsOK &= (fabs(approx[i] - ref) < 1e-5f);
+    quadrantsOK &= (fabs(fast[i] - ref) < 1e-3f);
+    quadrantsOK &= (std::signbit(precise[i]) == std::signbit(ref));
+  }
+  REQUIRE(quadrantsOK);
+
+  // tan has the right sign on each side of its poles.
+  DSPVector t = tan(DSPVector(1.5707f));
+  REQUIRE(t[0] > 5e3f);
+  t = tan(DSPVector(1.5709f));
+  REQUIRE(t[0] < -5e3f);
+
+  REQUIRE(max(abs(powFast(DSPVector(2.f), DSPVector(3.f)) - DSPVector(8.f))) < 0.02f);
+}
+
+TEST_CASE("madronalib/core/dsp_ops/row_mask", "[dsp_ops]")
+{
+  constexpr int n = 8;
+  DSPVectorArray<n> x = rowIndex<n>() + DSPVectorArray<n>(1.f);
+
+  RowMask<n> mask;
+  REQUIRE(!mask.any());
+  mask.set(5, true);
+  mask.set(1, true);
+  mask.set(6, true);
+  mask.set(6, false);
+  REQUIRE(mask.size() == 2);
+  REQUIRE(mask[1]);
+  REQUIRE(!mask[6]);
+
+  // active rows are listed in order.
+  std::vector<int> active(mask.begin(), mask.end());
+  REQUIRE(active == std::vector<int>({1, 5}));
+
+  REQUIRE(addRows(x, mask) == DSPVector(2.f + 6.f));
+  DSPVectorArray<n> masked = maskRows(x, mask);
+  REQUIRE(addRows(masked) == DSPVector(8.f));
+  REQUIRE(DSPVector(masked.constRow(5)) == x.constRow(5));
+
+  DSPVectorArray<n> packed = packRows(x, mask);
+  REQUIRE(DSPVector(packed.constRow(0)) == DSPVector(2.f));
+  REQUIRE(DSPVector(packed.constRow(1)) == DSPVector(6.f));
+  REQUIRE(DSPVector(packed.constRow(2)) == DSPVector(0.f));
+  REQUIRE(unpackRows(packed, mask) == masked);
+
+  REQUIRE(RowMask<n>(true).size() == n);
+}
+
 TEST_CASE("madronalib/core/projections", "[projections]")
 {
   std::cout << "\n\nPROJECTIONS\n";
@@ -0,0 +1,150 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// a unit test made using the Catch framework in catch.hpp / tests.cpp.
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "catch.hpp"
+#include "madronalib.h"
+#include "mldsp.h"
+#include "tests.h"
+
+using namespace ml;
+
+namespace dspResampleTest
+{
+// the number of input samples in each test.
+constexpr int kTestSamples = 1 << 14;
+
+// resample a sine wave of the given frequency, returning all the output read.
+std::vector<float> resampleSine(Resampler<1>& r, double inRate, double freq)
+{
+  std::vector<float> out;
+  int n = 0;
+  for (int v = 0; v < kTestSamples / kFloatsPerDSPVector; ++v)
+  {
+    DSPVector x;
+    for (int i = 0; i < kFloatsPerDSPVector; ++i)
+    {
+      x[i] = static_cast<float>(std::sin(kTwoPiD * freq * n++ / inRate));
+    }
+    r.write(x);
+    while (r.getReadAvailable() >= kFloatsPerDSPVector)
+    {
+      DSPVector y = r.read();
+      out.insert(out.end(), y.getConstBuffer(), y.getConstBuffer() + kFloatsPerDSPVector);
+    }
+  }
+  return out;
+}
+
+// the largest difference between the output and the ideal resampled sine,
+// after the filter has settled.
+float maxSineError(const ResamplerQuality& q, double inRate, double outRate, double freq)
+{
+  Resampler<1> r(outRate / inRate, q);
+  std::vector<float> out = resampleSine(r, inRate, freq);
+  float maxErr = 0.f;
+  for (size_t i = 256; i < out.size(); ++i)
+  {
+    float ideal = static_cast<float>(std::sin(kTwoPiD * freq * i / outRate));
+    maxErr = std::max(maxErr, std::fabs(out[i] - ideal));
+  }
+  return maxErr;
+}
+
+// the peak level of a sine above the output Nyquist frequency after
+// downsampling.
+float aliasLevel(const ResamplerQuality& q)
+{
+  Resampler<1> r(44100. / 96000., q);
+  std::vector<float> out = resampleSine(r, 96000., 30000.);
+  float peak = 0.f;
+  for (size_t i = 256; i < out.size(); ++i)
+  {
+    peak = std::max(peak, std::fabs(out[i]));
+  }
+  return peak;
+}
+}  // namespace dspResampleTest
+
+using namespace dspResampleTest;
+
+TEST_CASE("madronalib/core/resample/sine", "[resample]")
+{
+  // a sine in the passband is preserved, with errors that decrease with the
+  // quality.
+  REQUIRE(maxSineError(kResampleCubic, 44100., 48000., 1000.) < 1e-4f);
+  REQUIRE(maxSineError(kResampleLow, 44100., 48000., 1000.) < 1e-3f);
+  REQUIRE(maxSineError(kResampleMedium, 44100., 48000., 1000.) < 2e-4f);
+  REQUIRE(maxSineError(kResampleHigh, 44100., 48000., 1000.) < 2e-5f);
+
+  // at higher frequencies cubic interpolation falls behind the sinc filters.
+  REQUIRE(maxSineError(kResampleCubic, 44100., 48000., 10000.) > 0.01f);
+  REQUIRE(maxSineError(kResampleMedium, 44100., 48000., 10000.) < 2e-4f);
+  REQUIRE(maxSineError(kResampleHigh, 48000., 44100., 10000.) < 2e-5f);
+}
+
+TEST_CASE("madronalib/core/resample/alias", "[resample]")
+{
+  // when downsampling, frequencies above the output Nyquist frequency are
+  // removed by the sinc filters but not by cubic interpolation.
+  REQUIRE(aliasLevel(kResampleCubic) > 0.5f);
+  REQUIRE(aliasLevel(kResampleLow) < 1e-3f);
+  REQUIRE(aliasLevel(kResampleMedium) < 1e-4f);
+  REQUIRE(aliasLevel(kResampleHigh) < 1e-5f);
+}
+
+TEST_CASE("madronalib/core/resample/ratio", "[resample]")
+{
+  // the number of output samples made follows the ratio, including changes
+  // to it while running.
+  const double ratios[] = {1.0, 0.5, 1.0884, 3.0};
+  for (double ratio : ratios)
+  {
+    Resampler<1> r(ratio);
+    size_t outputs = 0;
+    for (int v = 0; v < kTestSamples / kFloatsPerDSPVector; ++v)
+    {
+      if (v == kTestSamples / kFloatsPerDSPVector / 2)
+      {
+        r.setRatio(ratio * 1.01);
+      }
+      r.write(DSPVector(1.f));
+      while (r.getReadAvailable() >= kFloatsPerDSPVector)
+      {
+        r.read();
+        outputs += kFloatsPerDSPVector;
+      }
+    }
+    outputs += r.getReadAvailable();
+
+    // half the input at the ratio and half at the changed ratio, less the
+    // samples waiting for the rest of the filter window, to within one input
+    // sample.
+    double expected = kTestSamples * ratio * 1.005 - r.getTaps() / 2 * ratio;
+    REQUIRE(std::fabs(outputs - expected) < ratio * 1.01 + 1.);
+  }
+
+  // channels are resampled independently.
+  Resampler<2> r2(1.5, kResampleLow);
+  Resampler<1> r1(1.5, kResampleLow);
+  bool matched = true;
+  for (int v = 0; v < 64; ++v)
+  {
+    DSPVector x = columnIndex() * DSPVector(1.f / kFloatsPerDSPVector) + DSPVector(v & 1);
+    r1.write(x);
+    r2.write(concatRows(DSPVector(0.5f), x));
+    while (r1.getReadAvailable() >= kFloatsPerDSPVector)
+    {
+      DSPVectorArray<2> y2 = r2.read();
+      matched &= (DSPVector(y2.constRow(1)) == r1.read());
+      if (v > 8) matched &= (fabsf(DSPVector(y2.constRow(0))[0] - 0.5f) < 1e-4f);
+    }
+  }
+  REQUIRE(matched);
+}
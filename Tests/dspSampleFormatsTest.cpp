@@ -0,0 +1,133 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// a unit test made using the Catch framework in catch.hpp / tests.cpp.
+
+#include <iostream>
+
+#include "catch.hpp"
+#include "madronalib.h"
+#include "mldsp.h"
+#include "tests.h"
+
+using namespace ml;
+
+TEST_CASE("madronalib/core/sample_formats/half", "[sample_formats]")
+{
+  REQUIRE(floatToFloat16(0.f).bits == 0x0000);
+  REQUIRE(floatToFloat16(-0.f).bits == 0x8000);
+  REQUIRE(floatToFloat16(1.f).bits == 0x3c00);
+  REQUIRE(floatToFloat16(-2.f).bits == 0xc000);
+  REQUIRE(floatToFloat16(65504.f).bits == 0x7bff);
+  REQUIRE(floatToFloat16(65520.f).bits == 0x7c00);
+  REQUIRE(floatToFloat16(ldexpf(1.f, -24)).bits == 0x0001);
+  REQUIRE(floatToFloat16(ldexpf(1.f, -26)).bits == 0x0000);
+
+  // ties round to even.
+  REQUIRE(floatToFloat16(1.f + ldexpf(1.f, -11)).bits == 0x3c00);
+  REQUIRE(floatToFloat16(1.f + 3.f * ldexpf(1.f, -11)).bits == 0x3c02);
+
+  // every half except NaN survives a round trip through float.
+  bool roundTrip = true;
+  for (int i = 0; i < 65536; ++i)
+  {
+    Float16 h{static_cast<uint16_t>(i)};
+    float f = float16ToFloat(h);
+    if (f == f)
+    {
+      roundTrip &= (floatToFloat16(f).bits == h.bits);
+    }
+  }
+  REQUIRE(roundTrip);
+}
+
+TEST_CASE("madronalib/core/sample_formats/pack", "[sample_formats]")
+{
+  // the SIMD paths give the same results as the scalar conversions, over
+  // lengths that are not a multiple of the SIMD width.
+  constexpr size_t n = 203;
+  RandomScalarSource rand;
+  std::vector<float> src(n), halfOut(n), intOut(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    src[i] = rand.getFloat() * 1.5f;
+  }
+  src[7] = 1e-6f;
+  src[8] = -70000.f;
+
+  std::vector<Float16> halves(n);
+  std::vector<int16_t> ints(n);
+  packSamples(src.data(), halves.data(), n);
+  packSamples(src.data(), ints.data(), n);
+  unpackSamples(halves.data(), halfOut.data(), n);
+  unpackSamples(ints.data(), intOut.data(), n);
+
+  bool same = true;
+  for (size_t i = 0; i < n; ++i)
+  {
+    same &= (halves[i].bits == floatToFloat16(src[i]).bits);
+    same &= (ints[i] == floatToInt16(src[i]));
+    same &= (halfOut[i] == float16ToFloat(halves[i]));
+    same &= (intOut[i] == int16ToFloat(ints[i]));
+  }
+  REQUIRE(same);
+
+  // int16 samples are clipped to [-1, 1].
+  REQUIRE(floatToInt16(1.5f) == 32767);
+  REQUIRE(floatToInt16(-1.5f) == -32767);
+  REQUIRE(int16ToFloat(floatToInt16(1.f)) == 1.f);
+}
+
+TEST_CASE("madronalib/core/sample_formats/buffer", "[sample_formats]")
+{
+  // write and read across the end of the ring.
+  DSPBufferHalf buf;
+  buf.resize(kFloatsPerDSPVector * 4);
+  std::vector<float> fill(kFloatsPerDSPVector * 3 + 5, 0.25f);
+  buf.write(fill.data(), fill.size());
+  buf.read(fill.data(), fill.size());
+
+  DSPVectorArray<2> v1(columnIndex<2>() * DSPVectorArray<2>(1.f / 1024.f));
+  buf.write(v1);
+  DSPVectorArray<2> v2;
+  buf.read(v2);
+  REQUIRE(buf.getReadAvailable() == 0);
+
+  // these values are all exact in half precision.
+  REQUIRE(v2 == v1);
+}
+
+TEST_CASE("madronalib/core/sample_formats/delay", "[sample_formats]")
+{
+  const int delay = 137;
+  IntegerDelay d32(delay);
+  IntegerDelayHalf d16(delay);
+  IntegerDelayInt16 dInt(delay);
+
+  NoiseGen noise;
+  SineGen sine;
+  float maxHalfError = 0.f;
+  float maxIntError = 0.f;
+  for (int i = 0; i < 8; ++i)
+  {
+    DSPVector x = sine(DSPVector(0.01f)) * DSPVector(0.5f) + noise() * DSPVector(0.25f);
+    DSPVector y32 = d32(x);
+    maxHalfError = std::max(maxHalfError, max(abs(d16(x) - y32)));
+    maxIntError = std::max(maxIntError, max(abs(dInt(x) - y32)));
+  }
+  REQUIRE(maxHalfError < 1e-3f);
+  REQUIRE(maxIntError < 2e-5f);
+
+  // a single impulse comes out exactly delayed.
+  IntegerDelayInt16 dImpulse(delay);
+  DSPVector x(0.f), y;
+  x[0] = 1.f;
+  y = dImpulse(x);
+  for (int i = 0; i < delay / kFloatsPerDSPVector; ++i)
+  {
+    y = dImpulse(DSPVector(0.f));
+  }
+  REQUIRE(y[delay % kFloatsPerDSPVector] == 1.f);
+  REQUIRE(sum(y) == 1.f);
+}
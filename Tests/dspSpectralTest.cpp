@@ -0,0 +1,116 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// a unit test made using the Catch framework in catch.hpp / tests.cpp.
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "catch.hpp"
+#include "madronalib.h"
+#include "mldsp.h"
+#include "tests.h"
+
+using namespace ml;
+
+namespace dspSpectralTest
+{
+// the largest difference between the output of the STFT and its input times
+// the gain, delayed by the latency.
+template <typename FN>
+float maxSTFTError(STFT& stft, FN&& fn, float gain)
+{
+  constexpr int kVectors = 128;
+  const std::vector<float> x = makeNoise(kFloatsPerDSPVector * kVectors, 1);
+  const int latency = stft.getLatency();
+  float maxErr = 0.f;
+  for (int v = 0; v < kVectors; ++v)
+  {
+    DSPVector y = stft(DSPVector(x.data() + v * kFloatsPerDSPVector), fn);
+    for (int i = 0; i < kFloatsPerDSPVector; ++i)
+    {
+      const int n = v * kFloatsPerDSPVector + i - latency;
+      const float expected = (n >= 0) ? x[n] * gain : 0.f;
+      maxErr = std::max(maxErr, std::fabs(y[i] - expected));
+    }
+  }
+  return maxErr;
+}
+}  // namespace dspSpectralTest
+
+using namespace dspSpectralTest;
+
+TEST_CASE("madronalib/core/spectral/fft", "[spectral]")
+{
+  constexpr int kSize = 256;
+  FFT fft(kSize);
+  Spectrum s(kSize);
+  REQUIRE(s.getBins() == kSize / 2 + 1);
+
+  // a sine at bin 4 has a negative imaginary part there and nowhere else.
+  std::vector<float> x(kSize);
+  for (int i = 0; i < kSize; ++i)
+  {
+    x[i] = static_cast<float>(std::sin(kTwoPiD * 4 * i / kSize));
+  }
+  fft.forward(x.data(), s);
+  std::vector<float> mags(s.getPaddedBins());
+  magnitudes(s, mags.data());
+  REQUIRE(fabsf(s.getImag()[4] + kSize / 2) < 1e-3f);
+  REQUIRE(fabsf(mags[4] - kSize / 2) < 1e-3f);
+  REQUIRE(fabsf(mags[5]) < 1e-3f);
+
+  // the inverse restores the input.
+  const std::vector<float> noise = makeNoise(kSize, 2);
+  std::vector<float> y(kSize);
+  fft.forward(noise.data(), s);
+  fft.inverse(s, y.data());
+  float maxErr = 0.f;
+  for (int i = 0; i < kSize; ++i)
+  {
+    maxErr = std::max(maxErr, std::fabs(y[i] - noise[i]));
+  }
+  REQUIRE(maxErr < 1e-5f);
+
+  // multiplying spectra convolves circularly: an impulse at 3 delays by 3.
+  std::vector<float> impulse(kSize);
+  impulse[3] = 1.f;
+  Spectrum delay(kSize);
+  fft.forward(impulse.data(), delay);
+  fft.forward(noise.data(), s);
+  multiply(s, delay);
+  fft.inverse(s, y.data());
+  REQUIRE(fabsf(y[10] - noise[7]) < 1e-5f);
+  REQUIRE(fabsf(y[1] - noise[kSize - 2]) < 1e-5f);
+}
+
+TEST_CASE("madronalib/core/spectral/stft", "[spectral]")
+{
+  // with nothing done to the spectra, the input is reconstructed after the
+  // latency, for different overlaps and windows.
+  STFT s1(1024, 256);
+  REQUIRE(s1.getLatency() == 1024 - std::min(256, kFloatsPerDSPVector));
+  REQUIRE(maxSTFTError(s1, [](Spectrum&) {}, 1.f) < 1e-5f);
+
+  STFT s2(512, 128, windows::blackman);
+  REQUIRE(maxSTFTError(s2, [](Spectrum&) {}, 1.f) < 1e-5f);
+
+  // hops smaller than a DSPVector make several frames per vector.
+  STFT s3(64, 8);
+  REQUIRE(maxSTFTError(s3, [](Spectrum&) {}, 1.f) < 1e-5f);
+
+  // frames shorter than a SIMD vector are windowed with scalar math.
+  STFT s5(4, 1);
+  REQUIRE(maxSTFTError(s5, [](Spectrum&) {}, 1.f) < 1e-5f);
+
+  // a gain applied to every bin scales the output.
+  STFT s4(256, 64, windows::hamming);
+  std::vector<float> gains(Spectrum(256).getPaddedBins(), 0.5f);
+  REQUIRE(maxSTFTError(s4, [&](Spectrum& s) { applyGains(s, gains.data()); }, 0.5f) < 1e-5f);
+
+  // after clear(), the output starts over from zeros.
+  s4.clear();
+  REQUIRE(maxSTFTError(s4, [](Spectrum&) {}, 1.f) < 1e-5f);
+}
@@ -0,0 +1,96 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// a unit test made using the Catch framework in catch.hpp / tests.cpp.
+
+#include <iostream>
+
+#include "catch.hpp"
+#include "madronalib.h"
+#include "mldsp.h"
+#include "tests.h"
+
+using namespace ml;
+
+namespace dspTablesTest
+{
+constexpr float sineFn(float x) { return const_math::sin(x); }
+constexpr float tanhFn(float x) { return const_math::tanh(x); }
+constexpr float rampFn(float x) { return x; }
+
+constexpr LookupTable<256> kSineTable(sineFn, 0.f, kTwoPi);
+constexpr LookupTable<128> kTanhTable(tanhFn, -4.f, 4.f);
+constexpr LookupTable<16> kRampTable(rampFn, 0.f, 16.f);
+
+// the tables are built at compile time.
+static_assert(kRampTable[-1] == -1.f, "");
+static_assert(kRampTable[18] == 18.f, "");
+static_assert(kTanhTable[64] == 0.f, "");
+
+// the largest difference between the lookup and the function, for inputs
+// over the domain.
+template <typename LOOKUP, typename FN>
+float maxError(LOOKUP lookupFn, FN fn, float lo, float hi)
+{
+  float maxErr = 0.f;
+  DSPVector x = rangeClosed(lo, hi);
+  for (int i = 0; i < 16; ++i)
+  {
+    // offset each pass to fall between the table points.
+    DSPVector xi = x + DSPVector((hi - lo) * i / (16.f * 63.f));
+    DSPVector y = lookupFn(xi);
+    for (int j = 0; j < kFloatsPerDSPVector; ++j)
+    {
+      if (xi[j] <= hi) maxErr = std::max(maxErr, std::fabs(y[j] - fn(xi[j])));
+    }
+  }
+  return maxErr;
+}
+}  // namespace dspTablesTest
+
+using namespace dspTablesTest;
+
+TEST_CASE("madronalib/core/dsp_tables/lookup", "[dsp_tables]")
+{
+  // the guard points are the function's values just outside the domain.
+  REQUIRE(fabsf(kSineTable[-1] - sinf(-kTwoPi / 256.f)) < 1e-6f);
+  REQUIRE(fabsf(kSineTable[258] - sinf(kTwoPi * 2.f / 256.f)) < 1e-6f);
+
+  // lookups of a ramp are exact.
+  DSPVector x = columnIndex() * DSPVector(16.f / kFloatsPerDSPVector);
+  REQUIRE(lookupNearest(kRampTable, x) == intToFloat(roundFloatToInt(x)));
+  REQUIRE(lookupLinear(kRampTable, x) == x);
+  REQUIRE(lookupCubic(kRampTable, x) == x);
+
+  // inputs outside the domain are clamped.
+  REQUIRE(max(lookupLinear(kRampTable, DSPVector(100.f))) == 16.f);
+  REQUIRE(min(lookupCubic(kRampTable, DSPVector(-100.f))) == 0.f);
+
+  // errors for smooth functions decrease with the order of interpolation.
+  auto sinFn = [](float x) { return sinf(x); };
+  float sinNearest = maxError([](DSPVector x) { return lookupNearest(kSineTable, x); }, sinFn, 0.f,
+                              kTwoPi);
+  float sinLinear =
+      maxError([](DSPVector x) { return lookupLinear(kSineTable, x); }, sinFn, 0.f, kTwoPi);
+  float sinCubic =
+      maxError([](DSPVector x) { return lookupCubic(kSineTable, x); }, sinFn, 0.f, kTwoPi);
+  REQUIRE(sinNearest < 0.0125f);
+  REQUIRE(sinLinear < 1e-4f);
+  REQUIRE(sinCubic < 2e-6f);
+
+  auto tanhFn = [](float x) { return tanhf(x); };
+  float tanhCubic =
+      maxError([](DSPVector x) { return lookupCubic(kTanhTable, x); }, tanhFn, -4.f, 4.f);
+  REQUIRE(tanhCubic < 1e-4f);
+
+  // integer indices wrap around the table.
+  DSPVectorInt i = columnIndexInt() + DSPVectorInt(240);
+  DSPVector y = lookup(kSineTable, i);
+  bool wrapped = true;
+  for (int j = 0; j < kFloatsPerDSPVector; ++j)
+  {
+    wrapped &= (y[j] == kSineTable[(240 + j) & 255]);
+  }
+  REQUIRE(wrapped);
+}
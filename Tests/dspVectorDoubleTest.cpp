@@ -0,0 +1,146 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// a unit test made using the Catch framework in catch.hpp / tests.cpp.
+
+#include <cmath>
+#include <iostream>
+
+#include "catch.hpp"
+#include "madronalib.h"
+#include "mldsp.h"
+#include "tests.h"
+
+using namespace ml;
+
+namespace dspVectorDoubleTest
+{
+// the original float-only Lopass, for comparison.
+class FloatLopass
+{
+  float g0{0}, g1{0}, g2{0};
+  float ic1eq{0};
+  float ic2eq{0};
+
+ public:
+  void setCoeffs(float omega, float k)
+  {
+    float piOmega = kPi * omega;
+    float s1 = sinf(piOmega);
+    float s2 = sinf(2.0f * piOmega);
+    float nrm = 1.0f / (2.f + k * s2);
+    g0 = s2 * nrm;
+    g1 = (-2.f * s1 * s1 - k * s2) * nrm;
+    g2 = (2.0f * s1 * s1) * nrm;
+  }
+
+  DSPVector operator()(const DSPVector vx)
+  {
+    DSPVector vy;
+    for (int n = 0; n < kFloatsPerDSPVector; ++n)
+    {
+      float v0 = vx[n];
+      float t0 = v0 - ic2eq;
+      float t1 = g0 * t0 + g1 * ic1eq;
+      float t2 = g2 * t0 + g0 * ic1eq;
+      float v2 = t2 + ic2eq;
+      ic1eq += 2.0f * t1;
+      ic2eq += 2.0f * t2;
+      vy[n] = v2;
+    }
+    return vy;
+  }
+};
+}  // namespace dspVectorDoubleTest
+
+using namespace dspVectorDoubleTest;
+
+TEST_CASE("madronalib/core/dsp_vector_double/ops", "[dsp_vector_double]")
+{
+  DSPVectorArrayD<2> a, b;
+  for (int i = 0; i < kFloatsPerDSPVector * 2; ++i)
+  {
+    a[i] = 1.0 + i * 0.001;
+    b[i] = 0.5 - i * 1e-7;
+  }
+
+  auto vsum = a + b;
+  auto vprod = multiply(a, b);
+  auto vquot = a / b;
+  auto vroot = sqrt(a);
+  auto vmix = lerp(a, b, DSPVectorArrayD<2>(0.25));
+  auto vclamp = clamp(a, DSPVectorArrayD<2>(1.01), DSPVectorArrayD<2>(1.02));
+
+  bool ok = true;
+  for (int i = 0; i < kFloatsPerDSPVector * 2; ++i)
+  {
+    ok &= (vsum[i] == a[i] + b[i]);
+    ok &= (vprod[i] == a[i] * b[i]);
+    ok &= (vquot[i] == a[i] / b[i]);
+    ok &= (vroot[i] == std::sqrt(a[i]));
+    ok &= (vmix[i] == a[i] + 0.25 * (b[i] - a[i]));
+    ok &= (vclamp[i] == std::min(std::max(a[i], 1.01), 1.02));
+  }
+  REQUIRE(ok);
+
+  // small differences that float would lose are kept.
+  DSPVectorD c(1.0), d(1e-12);
+  REQUIRE(sum(c + d - c) > 0.);
+  REQUIRE(sum(DSPVectorD(1.0)) == kFloatsPerDSPVector);
+}
+
+TEST_CASE("madronalib/core/dsp_vector_double/conversions", "[dsp_vector_double]")
+{
+  DSPVectorArray<3> x(columnIndex<3>());
+  x *= DSPVectorArray<3>(0.125f);
+  DSPVectorArrayD<3> xd = toDouble(x);
+  REQUIRE(toFloat(xd) == x);
+
+  bool ok = true;
+  for (int i = 0; i < kFloatsPerDSPVector * 3; ++i)
+  {
+    ok &= (xd[i] == static_cast<double>(x[i]));
+  }
+  REQUIRE(ok);
+}
+
+TEST_CASE("madronalib/core/dsp_vector_double/filters", "[dsp_vector_double]")
+{
+  // the float versions of the templated filters are unchanged.
+  FloatLopass ref;
+  Lopass lp;
+  ref.setCoeffs(0.01f, 0.5f);
+  lp.mCoeffs = Lopass::coeffs(0.01f, 0.5f);
+  DSPVector input(columnIndex());
+  bool same = true;
+  for (int i = 0; i < 8; ++i)
+  {
+    same &= (ref(input) == lp(input));
+  }
+  REQUIRE(same);
+
+  // at a very low cutoff, the double version settles to DC gain of 1 where the
+  // float version is limited by the precision of its state.
+  const float omega = 1e-5f;
+  LopassD lpd;
+  lpd.mCoeffs = LopassD::coeffs(omega, 1.f);
+  DSPVector ones(1.f);
+  DSPVector y;
+  for (int i = 0; i < 4000000 / kFloatsPerDSPVector; ++i)
+  {
+    y = lpd(ones);
+  }
+  REQUIRE(fabs(y[kFloatsPerDSPVector - 1] - 1.f) < 1e-4f);
+
+  // the other filters compile and run in double.
+  HipassD hpd;
+  hpd.mCoeffs = HipassD::coeffs(omega, 1.f);
+  BellD bd;
+  bd.mCoeffs = BellD::coeffs(0.1, 1.0, 2.0);
+  OnePoleD opd;
+  opd.mCoeffs = OnePoleD::coeffs(omega);
+  REQUIRE(hpd(DSPVector(0.f)) == DSPVector(0.f));
+  REQUIRE(bd(DSPVector(0.f)) == DSPVector(0.f));
+  REQUIRE(opd(DSPVector(0.f)) == DSPVector(0.f));
+}
@@ -3,11 +3,25 @@
 
 #include <chrono>
 #include <deque>
+#include <vector>
 #include "mldsp.h"
 
 using namespace ml;
 using namespace std::chrono;
 
+// a repeatable signal in [-1, 1], for tests that need all of their input at
+// once.
+inline std::vector<float> makeNoise(size_t length, uint32_t seed)
+{
+  std::vector<float> y(length);
+  for (auto& v : y)
+  {
+    seed = seed * 1664525 + 1013904223;
+    v = static_cast<float>(seed >> 8) / (1 << 23) - 1.f;
+  }
+  return y;
+}
+
 
 #if (__APPLE__)
   #include <pthread.h>
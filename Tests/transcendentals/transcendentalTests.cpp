@@ -0,0 +1,228 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// Accuracy and throughput of the SIMD transcendental functions.
+//
+// Each function and accuracy tier is evaluated over a range of inputs and
+// compared to the double precision standard library. The table printed shows
+// the maximum error in ULP and absolute terms, and the time per sample. The
+// program returns 1 if any function exceeds its error bound.
+//
+// A result is within bounds if it is within maxULP of the reference, or within
+// maxAbs of it. maxAbs allows for approximations that have an absolute, rather
+// than relative, error near zero crossings.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "mldsp.h"
+
+using namespace ml;
+
+namespace
+{
+constexpr int kTestVectors = 1 << 14;
+constexpr int kTestSamples = kTestVectors * kFloatsPerDSPVector;
+constexpr int kTimingPasses = 16;
+
+// the distance between float(x) and the next float away from zero.
+double ulpAt(double x)
+{
+  float fx = std::fabs(static_cast<float>(x));
+  if (std::isinf(fx)) fx = std::numeric_limits<float>::max();
+  return std::nextafter(fx, std::numeric_limits<float>::infinity()) - fx;
+}
+
+struct ErrorStats
+{
+  double maxULP{0};
+  double maxAbs{0};
+  bool withinBounds{true};
+};
+
+void accumulateError(ErrorStats& stats, float result, double ref, double maxULP, double maxAbs)
+{
+  double absError = std::fabs(result - ref);
+  double ulpError = absError / ulpAt(ref);
+  if (!(absError == absError)) ulpError = absError = std::numeric_limits<double>::infinity();
+  stats.maxULP = std::max(stats.maxULP, ulpError);
+  stats.maxAbs = std::max(stats.maxAbs, absError);
+  if ((ulpError > maxULP) && (absError > maxAbs)) stats.withinBounds = false;
+}
+
+// inputs in [lo, hi], evenly spaced or, if logSpaced, evenly spaced in log(x).
+std::vector<float> makeInputs(float lo, float hi, bool logSpaced)
+{
+  std::vector<float> x(kTestSamples);
+  for (int i = 0; i < kTestSamples; ++i)
+  {
+    double t = i / (kTestSamples - 1.0);
+    x[i] = logSpaced ? static_cast<float>(lo * std::pow(hi / static_cast<double>(lo), t))
+                     : static_cast<float>(lo + (hi - static_cast<double>(lo)) * t);
+  }
+  return x;
+}
+
+// time fn over all the test vectors, returning nanoseconds per sample.
+double timePerSample(const std::function<void(int)>& fn)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < kTimingPasses; ++pass)
+  {
+    for (int v = 0; v < kTestVectors; ++v)
+    {
+      fn(v);
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(end - start).count();
+  return ns / (static_cast<double>(kTestSamples) * kTimingPasses);
+}
+
+// keeps timed results alive.
+volatile float gSink;
+
+struct Test1
+{
+  const char* name;
+  DSPVector (*fn)(const DSPVector&);
+  double (*ref)(double);
+  float lo, hi;
+  bool logSpaced;
+  double maxULP, maxAbs;
+};
+
+struct Test2
+{
+  const char* name;
+  DSPVector (*fn)(const DSPVector&, const DSPVector&);
+  double (*ref)(double, double);
+  float lo1, hi1, lo2, hi2;
+  double maxULP, maxAbs;
+};
+
+#define FN1(f) [](const DSPVector& x) { return f(x); }
+#define FN2(f) [](const DSPVector& x, const DSPVector& y) { return f(x, y); }
+#define REF1(f) [](double x) { return std::f(x); }
+#define REF2(f) [](double x, double y) { return std::f(x, y); }
+
+const Test1 kTests1[] = {
+    {"tanh", FN1(tanh), REF1(tanh), -10.f, 10.f, false, 4, 0},
+    {"tanhApprox", FN1(tanhApprox), REF1(tanh), -10.f, 10.f, false, 64, 0},
+    {"tanhFast", FN1(tanhFast), REF1(tanh), -10.f, 10.f, false, 2048, 0},
+    {"sinh", FN1(sinh), REF1(sinh), -80.f, 80.f, false, 4, 0},
+    {"sinhApprox", FN1(sinhApprox), REF1(sinh), -80.f, 80.f, false, 256, 0},
+    {"sinhFast", FN1(sinhFast), REF1(sinh), -80.f, 80.f, false, 10000, 0},
+    {"tan", FN1(tan), REF1(tan), -1.57f, 1.57f, false, 4, 0},
+    {"tanApprox", FN1(tanApprox), REF1(tan), -1.57f, 1.57f, false, 64, 0},
+    {"tanFast", FN1(tanFast), REF1(tan), -1.57f, 1.57f, false, 5000, 0},
+    {"atan", FN1(atan), REF1(atan), -100.f, 100.f, false, 4, 0},
+    {"atanApprox", FN1(atanApprox), REF1(atan), -100.f, 100.f, false, 128, 0},
+    {"atanFast", FN1(atanFast), REF1(atan), -100.f, 100.f, false, 5000, 0},
+    {"sin", FN1(sin), REF1(sin), -100.f, 100.f, false, 4, 0},
+    {"sinApprox", FN1(sinApprox), REF1(sin), -3.1415f, 3.1415f, false, 64, 1e-5},
+    {"cos", FN1(cos), REF1(cos), -100.f, 100.f, false, 4, 0},
+    {"cosApprox", FN1(cosApprox), REF1(cos), -3.1415f, 3.1415f, false, 64, 5e-5},
+    {"exp", FN1(exp), REF1(exp), -80.f, 80.f, false, 4, 0},
+    {"expApprox", FN1(expApprox), REF1(exp), -80.f, 80.f, false, 256, 0},
+    {"log", FN1(log), REF1(log), 1e-30f, 1e30f, true, 4, 0},
+    {"logApprox", FN1(logApprox), REF1(log), 1e-30f, 1e30f, true, 64, 3e-5},
+};
+
+const Test2 kTests2[] = {
+    {"atan2", FN2(atan2), REF2(atan2), -10.f, 10.f, -10.f, 10.f, 4, 0},
+    {"atan2Approx", FN2(atan2Approx), REF2(atan2), -10.f, 10.f, -10.f, 10.f, 128, 0},
+    {"atan2Fast", FN2(atan2Fast), REF2(atan2), -10.f, 10.f, -10.f, 10.f, 5000, 0},
+    {"pow", FN2(pow), REF2(pow), 1e-3f, 10.f, -4.f, 4.f, 64, 0},
+    {"powApprox", FN2(powApprox), REF2(pow), 1e-3f, 10.f, -4.f, 4.f, 1024, 0},
+    {"powFast", FN2(powFast), REF2(pow), 1e-3f, 10.f, -4.f, 4.f, 32000, 0},
+};
+
+void printHeader()
+{
+  std::printf("%-14s %14s %12s %12s %10s\n", "function", "max ULP", "max abs", "ns/sample",
+              "bounds");
+}
+
+void printResult(const char* name, const ErrorStats& stats, double ns)
+{
+  std::printf("%-14s %14.1f %12.3g %12.3f %10s\n", name, stats.maxULP, stats.maxAbs, ns,
+              stats.withinBounds ? "ok" : "FAIL");
+}
+
+bool run(const Test1& t)
+{
+  std::vector<float> x = makeInputs(t.lo, t.hi, t.logSpaced);
+  ErrorStats stats;
+  for (int v = 0; v < kTestVectors; ++v)
+  {
+    DSPVector vx(x.data() + v * kFloatsPerDSPVector);
+    DSPVector vy = t.fn(vx);
+    for (int i = 0; i < kFloatsPerDSPVector; ++i)
+    {
+      accumulateError(stats, vy[i], t.ref(vx[i]), t.maxULP, t.maxAbs);
+    }
+  }
+
+  double ns = timePerSample([&](int v) {
+    DSPVector vx(x.data() + v * kFloatsPerDSPVector);
+    gSink = t.fn(vx)[0];
+  });
+
+  printResult(t.name, stats, ns);
+  return stats.withinBounds;
+}
+
+bool run(const Test2& t)
+{
+  // pair each first argument with a second argument from a shuffled sequence,
+  // so that the inputs cover the plane.
+  std::vector<float> x1 = makeInputs(t.lo1, t.hi1, t.lo1 > 0.f);
+  std::vector<float> x2 = makeInputs(t.lo2, t.hi2, false);
+  for (uint32_t i = 0; i < kTestSamples; ++i)
+  {
+    std::swap(x2[i], x2[(i * 7919u) & (kTestSamples - 1)]);
+  }
+
+  ErrorStats stats;
+  for (int v = 0; v < kTestVectors; ++v)
+  {
+    DSPVector vx1(x1.data() + v * kFloatsPerDSPVector);
+    DSPVector vx2(x2.data() + v * kFloatsPerDSPVector);
+    DSPVector vy = t.fn(vx1, vx2);
+    for (int i = 0; i < kFloatsPerDSPVector; ++i)
+    {
+      accumulateError(stats, vy[i], t.ref(vx1[i], vx2[i]), t.maxULP, t.maxAbs);
+    }
+  }
+
+  double ns = timePerSample([&](int v) {
+    DSPVector vx1(x1.data() + v * kFloatsPerDSPVector);
+    DSPVector vx2(x2.data() + v * kFloatsPerDSPVector);
+    gSink = t.fn(vx1, vx2)[0];
+  });
+
+  printResult(t.name, stats, ns);
+  return stats.withinBounds;
+}
+}  // namespace
+
+int main()
+{
+  bool ok = true;
+  printHeader();
+  for (const auto& t : kTests1)
+  {
+    ok &= run(t);
+  }
+  for (const auto& t : kTests2)
+  {
+    ok &= run(t);
+  }
+  return ok ? 0 : 1;
+}
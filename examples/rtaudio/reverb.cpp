@@ -30,6 +30,9 @@ PitchbendableDelay mDelayL, mDelayR;
 // feedback storage
 DSPVector mvFeedbackL, mvFeedbackR;
 
+// one block of memory for all the delays, on huge pages if possible
+DelayArena mDelayMemory(1 << 20, true);
+
 void initializeReverb()
 {
   // set fixed parameters for reverb
@@ -46,18 +49,18 @@ void initializeReverb()
   mAp9.mGain = mAp10.mGain = 0.5f;
 
   // allocate delay memory
-  mAp1.setMaxDelayInSamples(500.f);
-  mAp2.setMaxDelayInSamples(500.f);
-  mAp3.setMaxDelayInSamples(1000.f);
-  mAp4.setMaxDelayInSamples(1000.f);
-  mAp5.setMaxDelayInSamples(2600.f);
-  mAp6.setMaxDelayInSamples(2600.f);
-  mAp7.setMaxDelayInSamples(8000.f);
-  mAp8.setMaxDelayInSamples(8000.f);
-  mAp9.setMaxDelayInSamples(10000.f);
-  mAp10.setMaxDelayInSamples(10000.f);
-  mDelayL.setMaxDelayInSamples(3500.f);
-  mDelayR.setMaxDelayInSamples(3500.f);
+  mAp1.setMaxDelayInSamples(500.f, &mDelayMemory);
+  mAp2.setMaxDelayInSamples(500.f, &mDelayMemory);
+  mAp3.setMaxDelayInSamples(1000.f, &mDelayMemory);
+  mAp4.setMaxDelayInSamples(1000.f, &mDelayMemory);
+  mAp5.setMaxDelayInSamples(2600.f, &mDelayMemory);
+  mAp6.setMaxDelayInSamples(2600.f, &mDelayMemory);
+  mAp7.setMaxDelayInSamples(8000.f, &mDelayMemory);
+  mAp8.setMaxDelayInSamples(8000.f, &mDelayMemory);
+  mAp9.setMaxDelayInSamples(10000.f, &mDelayMemory);
+  mAp10.setMaxDelayInSamples(10000.f, &mDelayMemory);
+  mDelayL.setMaxDelayInSamples(3500.f, &mDelayMemory);
+  mDelayR.setMaxDelayInSamples(3500.f, &mDelayMemory);
 }
 
 // processVectors() does all of the audio processing, in DSPVector-sized chunks.
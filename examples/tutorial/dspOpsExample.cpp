@@ -60,6 +60,7 @@ int main()
 	// for filters example / test
 	FDN<4> f;
 	// NOTE: the minimum possible delay time is kFloatsPerDSPVector.
+	f.setMaxDelayInSamples(103);
 	f.setDelaysInSamples({{67, 73, 91, 103}}); 
 	f.setFilterCutoffs({{0.1f, 0.2f, 0.3f, 0.4f}});
 	f.mFeedbackGains = {{0.5f, 0.5f, 0.5f, 0.5f}};
@@ -5,12 +5,18 @@
 #pragma once
 
 #include "MLDSPOps.h"
+#include "MLDSPOpsDouble.h"
+#include "MLDSPExpressions.h"
 #include "MLDSPFilters.h"
 #include "MLDSPGens.h"
 #include "MLDSPBuffer.h"
+#include "MLDSPResample.h"
+#include "MLDSPConvolution.h"
+#include "MLDSPSpectral.h"
 #include "MLDSPFunctional.h"
 #include "MLDSPUtils.h"
 #include "MLDSPProjections.h"
+#include "MLDSPTables.h"
 #include "MLDSPRatio.h"
 #include "MLDSPRouting.h"
 
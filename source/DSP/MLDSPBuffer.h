@@ -9,6 +9,7 @@
 #include <vector>
 
 #include "MLDSPOps.h"
+#include "MLDSPSampleFormats.h"
 
 namespace ml
 {
@@ -16,26 +17,23 @@ namespace ml
 // audio. Some nice implementation details are borrowed from Portaudio's
 // pa_ringbuffer by Phil Burk and others. C++11 atomics are used to implement
 // the lockfree algorithm.
+//
+// Samples are stored as type T, one of the formats in MLDSPSampleFormats.h,
+// and converted to and from float on write and read. DSPBuffer stores floats,
+// DSPBufferHalf and DSPBufferInt16 store 16-bit samples in half the memory.
 
-class DSPBuffer
+template <typename T>
+class DSPBufferT
 {
  private:
   struct DataRegions
   {
-    float *p1;
+    T *p1;
     size_t size1;
-    float *p2;
+    T *p2;
     size_t size2;
   };
 
-  inline void addSamples(const float *pSrcStart, const float *pSrcEnd, float *pDest)
-  {
-    for (const float *p = pSrcStart; p < pSrcEnd; ++p)
-    {
-      *pDest++ += *p;
-    }
-  }
-
   inline size_t advanceDistanceIndex(size_t start, size_t samples)
   {
     return (start + samples) & mDistanceMask;
@@ -62,8 +60,8 @@ class DSPBuffer
   }
 
  public:
-  DSPBuffer() {}
-  ~DSPBuffer() {}
+  DSPBufferT() {}
+  ~DSPBufferT() {}
 
   // clear the buffer.
   void clear()
@@ -124,10 +122,10 @@ class DSPBuffer
     const auto currentWriteIndex = mWriteIndex.load(std::memory_order_acquire);
     DataRegions dr = getDataRegions(currentWriteIndex, samples);
 
-    std::copy(pSrc, pSrc + dr.size1, dr.p1);
+    packSamples(pSrc, dr.p1, dr.size1);
     if (dr.p2)
     {
-      std::copy(pSrc + dr.size1, pSrc + dr.size1 + dr.size2, dr.p2);
+      packSamples(pSrc + dr.size1, dr.p2, dr.size2);
     }
 
     mWriteIndex.store(advanceDistanceIndex(currentWriteIndex, samples), std::memory_order_release);
@@ -157,13 +155,13 @@ class DSPBuffer
       // compile time.
       mWriteIndex.store(advanceDistanceIndex(currentWriteIndex, samples),
                         std::memory_order_release);
-      store(srcVec, dr.p1);
+      packSamples(srcVec.getConstBuffer(), dr.p1, samples);
     }
     else
     {
       const float *pSrc = srcVec.getConstBuffer();
-      std::copy(pSrc, pSrc + dr.size1, dr.p1);
-      std::copy(pSrc + dr.size1, pSrc + dr.size1 + dr.size2, dr.p2);
+      packSamples(pSrc, dr.p1, dr.size1);
+      packSamples(pSrc + dr.size1, dr.p2, dr.size2);
       mWriteIndex.store(advanceDistanceIndex(currentWriteIndex, samples),
                         std::memory_order_release);
     }
@@ -185,10 +183,10 @@ class DSPBuffer
     const auto currentReadIndex = mReadIndex.load(std::memory_order_acquire);
     DataRegions dr = getDataRegions(currentReadIndex, samples);
 
-    std::copy(dr.p1, dr.p1 + dr.size1, pDest);
+    unpackSamples(dr.p1, pDest, dr.size1);
     if (dr.p2)
     {
-      std::copy(dr.p2, dr.p2 + dr.size2, pDest + dr.size1);
+      unpackSamples(dr.p2, pDest + dr.size1, dr.size2);
     }
 
     mReadIndex.store(advanceDistanceIndex(currentReadIndex, samples), std::memory_order_release);
@@ -210,13 +208,13 @@ class DSPBuffer
       // we have only one region, so we can copy a number of samples known at
       // compile time.
       mReadIndex.store(advanceDistanceIndex(currentReadIndex, samples), std::memory_order_release);
-      load(destVec, dr.p1);
+      unpackSamples(dr.p1, destVec.getBuffer(), samples);
     }
     else
     {
       float *pDest = destVec.getBuffer();
-      std::copy(dr.p1, dr.p1 + dr.size1, pDest);
-      std::copy(dr.p2, dr.p2 + dr.size2, pDest + dr.size1);
+      unpackSamples(dr.p1, pDest, dr.size1);
+      unpackSamples(dr.p2, pDest + dr.size1, dr.size2);
       mReadIndex.store(advanceDistanceIndex(currentReadIndex, samples), std::memory_order_release);
     }
   }
@@ -236,13 +234,13 @@ class DSPBuffer
       // we have only one region, so we can copy a number of samples known at
       // compile time.
       mReadIndex.store(advanceDistanceIndex(currentReadIndex, samples), std::memory_order_release);
-      load(destVec, dr.p1);
+      unpackSamples(dr.p1, destVec.getBuffer(), samples);
     }
     else
     {
       float *pDest = destVec.getBuffer();
-      std::copy(dr.p1, dr.p1 + dr.size1, pDest);
-      std::copy(dr.p2, dr.p2 + dr.size2, pDest + dr.size1);
+      unpackSamples(dr.p1, pDest, dr.size1);
+      unpackSamples(dr.p2, pDest + dr.size1, dr.size2);
       mReadIndex.store(advanceDistanceIndex(currentReadIndex, samples), std::memory_order_release);
     }
     return destVec;
@@ -272,10 +270,10 @@ class DSPBuffer
 
     // add samples to data in buffer
     DataRegions dr = getDataRegions(currentWriteIndex, samples);
-    addSamples(pSrc, pSrc + dr.size1, dr.p1);
+    addSamples(pSrc, dr.p1, dr.size1);
     if (dr.p2)
     {
-      addSamples(pSrc + dr.size1, pSrc + dr.size1 + dr.size2, dr.p2);
+      addSamples(pSrc + dr.size1, dr.p2, dr.size2);
     }
 
     // clear samples for next overlapped add
@@ -283,10 +281,10 @@ class DSPBuffer
     size_t samplesToClear = samples - overlap;
     dr = getDataRegions(currentWriteIndex, samplesToClear);
 
-    std::fill(dr.p1, dr.p1 + dr.size1, 0.f);
+    std::fill(dr.p1, dr.p1 + dr.size1, T{});
     if (dr.p2)
     {
-      std::fill(dr.p2, dr.p2 + dr.size2, 0.f);
+      std::fill(dr.p2, dr.p2 + dr.size2, T{});
     }
 
     currentWriteIndex = advanceDistanceIndex(currentWriteIndex, -overlap);
@@ -303,10 +301,10 @@ class DSPBuffer
     const auto currentReadIndex = mReadIndex.load(std::memory_order_acquire);
     DataRegions dr = getDataRegions(currentReadIndex, samples);
 
-    std::copy(dr.p1, dr.p1 + dr.size1, pDest);
+    unpackSamples(dr.p1, pDest, dr.size1);
     if (dr.p2)
     {
-      std::copy(dr.p2, dr.p2 + dr.size2, pDest + dr.size1);
+      unpackSamples(dr.p2, pDest + dr.size1, dr.size2);
     }
 
     mReadIndex.store(advanceDistanceIndex(currentReadIndex, samples - overlap),
@@ -328,16 +326,16 @@ class DSPBuffer
       // we have only one region. copy most recent samples from it.
       // mReadIndex.store(advanceDistanceIndex(currentReadIndex, samples),
       // std::memory_order_release);
-      float *pSrc = dr.p1 + dr.size1 - samples;
-      std::copy(pSrc, pSrc + samples, pDest);
+      T *pSrc = dr.p1 + dr.size1 - samples;
+      unpackSamples(pSrc, pDest, samples);
     }
     else
     {
       if (dr.size2 >= samples)
       {
         // enough samples are in region 2
-        float *pSrc = dr.p2 + dr.size2 - samples;
-        std::copy(pSrc, pSrc + samples, pDest);
+        T *pSrc = dr.p2 + dr.size2 - samples;
+        unpackSamples(pSrc, pDest, samples);
       }
       else
       {
@@ -345,20 +343,20 @@ class DSPBuffer
 
         // write r1 samples from end
         auto r1Samples = samples - dr.size2;
-        float *pSrc1 = dr.p1 + dr.size1 - r1Samples;
-        std::copy(pSrc1, pSrc1 + r1Samples, pDest);
+        T *pSrc1 = dr.p1 + dr.size1 - r1Samples;
+        unpackSamples(pSrc1, pDest, r1Samples);
 
         // write all r2 samples after r1 samples
         auto r2Samples = dr.size2;
-        float *pSrc2 = dr.p2;
-        std::copy(pSrc2, pSrc2 + r2Samples, pDest + r1Samples);
+        T *pSrc2 = dr.p2;
+        unpackSamples(pSrc2, pDest + r1Samples, r2Samples);
       }
     }
   }
 
  private:
-  std::vector<float> mData;
-  float *mDataBuffer;
+  std::vector<T> mData;
+  T *mDataBuffer;
   size_t mSize{0};
   size_t mDataMask{0};
   size_t mDistanceMask{0};
@@ -366,6 +364,10 @@ class DSPBuffer
   std::atomic<size_t> mWriteIndex{0};
   std::atomic<size_t> mReadIndex{0};
 };
+
+typedef DSPBufferT<float> DSPBuffer;
+typedef DSPBufferT<Float16> DSPBufferHalf;
+typedef DSPBufferT<int16_t> DSPBufferInt16;
 }  // namespace ml
 
 // TODO try small-local-storage optimization in a production-sized project
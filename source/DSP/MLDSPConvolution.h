@@ -0,0 +1,417 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// MLDSPConvolution.h
+// PartitionedConvolver and NonUniformConvolver: convolution with long impulse
+// responses such as cabinet and room IRs, computed in the frequency domain
+// using the FFT from external/ffft.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "FFTReal.h"
+#include "MLDSPOps.h"
+#include "MLMatrix.h"
+#include "MLQueue.h"
+
+namespace ml
+{
+// Multiply the complex spectra a and b and add the product to y. Each
+// spectrum holds the real parts of n bins followed by their imaginary parts,
+// which is the layout of the output of ffft::FFTReal, and n must be a
+// multiple of kFloatsPerSIMDVector.
+//
+// In this layout the imaginary part of bin 0 holds the real value at the
+// Nyquist frequency instead, and the result for bin 0 is not correct. The
+// caller must compute it separately.
+inline void complexMultiplyAdd(const float* pa, const float* pb, float* py, int n)
+{
+  const float* pai = pa + n;
+  const float* pbi = pb + n;
+  float* pyi = py + n;
+  for (int i = 0; i < n; i += kFloatsPerSIMDVector)
+  {
+    SIMDVectorFloat ar = vecLoadUnaligned(pa + i);
+    SIMDVectorFloat ai = vecLoadUnaligned(pai + i);
+    SIMDVectorFloat br = vecLoadUnaligned(pb + i);
+    SIMDVectorFloat bi = vecLoadUnaligned(pbi + i);
+    SIMDVectorFloat yr = vecAdd(vecLoadUnaligned(py + i), vecMul(ar, br));
+    SIMDVectorFloat yi = vecAdd(vecLoadUnaligned(pyi + i), vecMul(ar, bi));
+    vecStoreUnaligned(py + i, vecSub(yr, vecMul(ai, bi)));
+    vecStoreUnaligned(pyi + i, vecAdd(yi, vecMul(ai, br)));
+  }
+}
+
+// PartitionedConvolver: uniformly partitioned convolution.
+//
+// The impulse response is cut into partitions of partitionSize samples, and
+// the spectrum of each is computed with an FFT of twice that size. For each
+// block of input, its spectrum is computed once and stored in a frequency
+// domain delay line. The spectrum of the output block is the sum of the
+// products of each partition with the input spectrum from that many blocks
+// ago, and the output is made from it with one inverse FFT (overlap-save).
+// The work per sample grows with the length of the impulse response, but
+// much more slowly than for direct convolution in the time domain.
+//
+// partitionSize must be a power of two no smaller than kFloatsPerDSPVector.
+// DSPVectors are processed with a latency of partitionSize -
+// kFloatsPerDSPVector samples, so the default partition size has no latency.
+// Longer partitions take fewer operations per sample for long impulse
+// responses.
+
+class PartitionedConvolver
+{
+  ffft::FFTReal<float> mFFT;
+  int mPartitionSize;
+  int mPartitions;
+
+  // the spectra of the impulse response partitions, followed by the frequency
+  // domain delay line of input spectra, each of 2 * mPartitionSize floats.
+  std::vector<float> mIRSpectra;
+  std::vector<float> mInputSpectra;
+  int mCurrentSpectrum{0};
+
+  // the last two blocks of input, and buffers for computing the output.
+  std::vector<float> mInput;
+  std::vector<float> mOutputSpectrum;
+  std::vector<float> mOutput;
+
+  // input and output blocks for processing DSPVectors.
+  std::vector<float> mInputBlock;
+  std::vector<float> mOutputBlock;
+  int mBlockPosition{0};
+
+  int spectrumSize() const { return mPartitionSize * 2; }
+
+ public:
+  PartitionedConvolver(const float* pIR, size_t irLength,
+                       size_t partitionSize = kFloatsPerDSPVector)
+      : mFFT(static_cast<long>(partitionSize * 2)),
+        mPartitionSize(static_cast<int>(partitionSize)),
+        mPartitions(std::max(1, static_cast<int>((irLength + partitionSize - 1) / partitionSize)))
+  {
+    const int n = spectrumSize();
+    mIRSpectra.resize(n * mPartitions);
+    mInputSpectra.resize(n * mPartitions);
+    mInput.resize(n);
+    mOutputSpectrum.resize(n);
+    mOutput.resize(n);
+    mInputBlock.resize(mPartitionSize);
+    mOutputBlock.resize(mPartitionSize);
+
+    // compute the spectrum of each partition, padded with zeros to the FFT
+    // size. The scale of the inverse FFT is applied here.
+    const float scale = 1.f / n;
+    std::vector<float> partition(n);
+    for (int p = 0; p < mPartitions; ++p)
+    {
+      std::fill(partition.begin(), partition.end(), 0.f);
+      const size_t start = p * partitionSize;
+      const size_t end = std::min(start + partitionSize, irLength);
+      for (size_t i = start; i < end; ++i)
+      {
+        partition[i - start] = pIR[i] * scale;
+      }
+      mFFT.do_fft(mIRSpectra.data() + p * n, partition.data());
+    }
+  }
+
+  // the impulse response is the first row of the Matrix.
+  explicit PartitionedConvolver(const Matrix& ir, size_t partitionSize = kFloatsPerDSPVector)
+      : PartitionedConvolver(ir.getConstBuffer(), ir.getWidth(), partitionSize)
+  {
+  }
+
+  ~PartitionedConvolver() = default;
+
+  int getPartitionSize() const { return mPartitionSize; }
+  int getPartitions() const { return mPartitions; }
+  int getLatency() const { return mPartitionSize - kFloatsPerDSPVector; }
+
+  void clear()
+  {
+    std::fill(mInputSpectra.begin(), mInputSpectra.end(), 0.f);
+    std::fill(mInput.begin(), mInput.end(), 0.f);
+    std::fill(mInputBlock.begin(), mInputBlock.end(), 0.f);
+    std::fill(mOutputBlock.begin(), mOutputBlock.end(), 0.f);
+    mCurrentSpectrum = 0;
+    mBlockPosition = 0;
+  }
+
+  // convolve one block of partitionSize samples with no latency.
+  void processBlock(const float* px, float* py)
+  {
+    const int n = spectrumSize();
+    const int half = mPartitionSize;
+
+    // slide the input along by one block and store its spectrum in the delay
+    // line.
+    std::copy(mInput.begin() + half, mInput.end(), mInput.begin());
+    std::copy(px, px + half, mInput.begin() + half);
+    mCurrentSpectrum = (mCurrentSpectrum + 1) % mPartitions;
+    mFFT.do_fft(mInputSpectra.data() + mCurrentSpectrum * n, mInput.data());
+
+    // multiply each partition by the input spectrum from that many blocks ago.
+    // The DC and Nyquist bins are real and are summed separately.
+    std::fill(mOutputSpectrum.begin(), mOutputSpectrum.end(), 0.f);
+    float* py1 = mOutputSpectrum.data();
+    float sumDC = 0.f;
+    float sumNyquist = 0.f;
+    int spectrum = mCurrentSpectrum;
+    for (int p = 0; p < mPartitions; ++p)
+    {
+      const float* px1 = mInputSpectra.data() + spectrum * n;
+      const float* ph1 = mIRSpectra.data() + p * n;
+      complexMultiplyAdd(px1, ph1, py1, half);
+      sumDC += px1[0] * ph1[0];
+      sumNyquist += px1[half] * ph1[half];
+      spectrum = (spectrum > 0) ? spectrum - 1 : mPartitions - 1;
+    }
+    py1[0] = sumDC;
+    py1[half] = sumNyquist;
+
+    // the second half of the inverse transform is the output. The first half
+    // is wrapped around from the circular convolution and is discarded.
+    mFFT.do_ifft(py1, mOutput.data());
+    std::copy(mOutput.begin() + half, mOutput.end(), py);
+  }
+
+  // convolve a DSPVector of input, with the latency given by getLatency().
+  void process(const DSPVector& vx, DSPVector& vy)
+  {
+    std::copy(vx.getConstBuffer(), vx.getConstBuffer() + kFloatsPerDSPVector,
+              mInputBlock.begin() + mBlockPosition);
+    mBlockPosition += kFloatsPerDSPVector;
+    if (mBlockPosition == mPartitionSize)
+    {
+      processBlock(mInputBlock.data(), mOutputBlock.data());
+      mBlockPosition = 0;
+    }
+    std::copy(mOutputBlock.begin() + mBlockPosition,
+              mOutputBlock.begin() + mBlockPosition + kFloatsPerDSPVector, vy.getBuffer());
+  }
+
+  DSPVector operator()(const DSPVector& vx)
+  {
+    DSPVector vy;
+    process(vx, vy);
+    return vy;
+  }
+};
+
+// NonUniformConvolver: zero latency convolution with long impulse responses,
+// such as reverbs of several seconds.
+//
+// The start of the impulse response, the head, is convolved on the calling
+// thread by a PartitionedConvolver with partitions of one DSPVector. The rest
+// is divided into segments, or tiers, with partitions of increasing size.
+// Each tier starts at twice its partition size into the impulse response, so
+// its output for a block of input is not needed until one block after the
+// block is complete. This leaves a whole block of time in which to compute it
+// on a background thread, one for each tier. The calling thread only copies
+// input to the tiers and their output back, which bounds its work per
+// DSPVector no matter how long the impulse response is.
+//
+// Blocks of work are handed to the background threads through Queues. If a
+// thread has not finished a block by the time its output is needed, the
+// calling thread waits for it, so the output is always the same as the
+// convolution computed directly. In offline mode, no threads are started and
+// the tiers are computed on the calling thread when their blocks are
+// complete, which gives the same output without depending on timing, for
+// rendering faster than real time.
+
+class NonUniformConvolver
+{
+ public:
+  // partition sizes of the tiers, as multiples of the head partition size.
+  static constexpr int kFirstTierScale = 8;
+  static constexpr int kTierGrowth = 8;
+
+ private:
+  static constexpr int kMaxPartitionSize = 32768;
+
+  struct Tier
+  {
+    PartitionedConvolver convolver;
+    int partitionSize;
+
+    // double buffers: the calling thread writes input to one while the
+    // background thread reads the other, and the background thread writes
+    // output to one while the calling thread reads the other.
+    std::vector<float> input[2];
+    std::vector<float> output[2];
+
+    // the index of the block being written, the position in it, and the
+    // number of blocks finished by the background thread.
+    int block{0};
+    int position{0};
+    std::atomic<int> blocksDone{0};
+
+    Queue<int> work{4};
+    std::thread thread;
+
+    Tier(const float* pIR, size_t irLength, int size)
+        : convolver(pIR, irLength, size), partitionSize(size)
+    {
+      for (int i = 0; i < 2; ++i)
+      {
+        input[i].resize(size);
+        output[i].resize(size);
+      }
+    }
+
+    void processBlock(int b)
+    {
+      convolver.processBlock(input[b & 1].data(), output[b & 1].data());
+      blocksDone.store(b + 1, std::memory_order_release);
+    }
+
+    // wait until block b is finished.
+    void waitForBlock(int b)
+    {
+      while (blocksDone.load(std::memory_order_acquire) <= b)
+      {
+        std::this_thread::yield();
+      }
+    }
+  };
+
+  PartitionedConvolver mHead;
+  std::vector<std::unique_ptr<Tier>> mTiers;
+  bool mOffline;
+  std::atomic<bool> mRunning{true};
+
+  void runTier(Tier* t)
+  {
+    while (mRunning.load(std::memory_order_acquire))
+    {
+      int b;
+      if (t->work.pop(b))
+      {
+        t->processBlock(b);
+      }
+      else
+      {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+    }
+  }
+
+  static size_t headLength(size_t irLength)
+  {
+    return std::min(irLength, static_cast<size_t>(kFloatsPerDSPVector * kFirstTierScale * 2));
+  }
+
+ public:
+  NonUniformConvolver(const float* pIR, size_t irLength, bool offline = false)
+      : mHead(pIR, headLength(irLength)), mOffline(offline)
+  {
+    // each tier covers the impulse response from twice its partition size to
+    // twice the partition size of the next tier. The last one covers the rest.
+    int size = kFloatsPerDSPVector * kFirstTierScale;
+    size_t start = size * 2;
+    while (start < irLength)
+    {
+      const int nextSize = size * kTierGrowth;
+      const bool last = (nextSize > kMaxPartitionSize) || (nextSize * 2 >= irLength);
+      const size_t end = last ? irLength : nextSize * 2;
+      mTiers.emplace_back(new Tier(pIR + start, end - start, size));
+      size = nextSize;
+      start = end;
+    }
+
+    if (!mOffline)
+    {
+      for (auto& t : mTiers)
+      {
+        t->thread = std::thread(&NonUniformConvolver::runTier, this, t.get());
+      }
+    }
+  }
+
+  // the impulse response is the first row of the Matrix.
+  explicit NonUniformConvolver(const Matrix& ir, bool offline = false)
+      : NonUniformConvolver(ir.getConstBuffer(), ir.getWidth(), offline)
+  {
+  }
+
+  ~NonUniformConvolver()
+  {
+    mRunning.store(false, std::memory_order_release);
+    for (auto& t : mTiers)
+    {
+      if (t->thread.joinable()) t->thread.join();
+    }
+  }
+
+  int getTiers() const { return static_cast<int>(mTiers.size()); }
+  int getTierPartitionSize(int i) const { return mTiers[i]->partitionSize; }
+
+  void clear()
+  {
+    mHead.clear();
+    for (auto& t : mTiers)
+    {
+      // let the background thread finish its work before clearing.
+      t->waitForBlock(t->block - 1);
+      t->convolver.clear();
+      for (int i = 0; i < 2; ++i)
+      {
+        std::fill(t->input[i].begin(), t->input[i].end(), 0.f);
+        std::fill(t->output[i].begin(), t->output[i].end(), 0.f);
+      }
+      t->block = 0;
+      t->position = 0;
+      t->blocksDone.store(0, std::memory_order_release);
+    }
+  }
+
+  void process(const DSPVector& vx, DSPVector& vy)
+  {
+    mHead.process(vx, vy);
+    for (auto& t : mTiers)
+    {
+      // the output being read is from two blocks ago.
+      if (t->position == 0)
+      {
+        t->waitForBlock(t->block - 2);
+      }
+
+      const int b = t->block & 1;
+      std::copy(vx.getConstBuffer(), vx.getConstBuffer() + kFloatsPerDSPVector,
+                t->input[b].begin() + t->position);
+      vy += DSPVector(t->output[b].data() + t->position);
+
+      t->position += kFloatsPerDSPVector;
+      if (t->position == t->partitionSize)
+      {
+        if (mOffline)
+        {
+          t->processBlock(t->block);
+        }
+        else
+        {
+          t->work.push(t->block);
+        }
+        t->block++;
+        t->position = 0;
+      }
+    }
+  }
+
+  DSPVector operator()(const DSPVector& vx)
+  {
+    DSPVector vy;
+    process(vx, vy);
+    return vy;
+  }
+};
+
+}  // namespace ml
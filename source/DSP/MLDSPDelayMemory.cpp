@@ -0,0 +1,118 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "MLDSPDelayMemory.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace ml
+{
+namespace
+{
+inline size_t roundUp(size_t bytes, size_t unit) { return (bytes + unit - 1) / unit * unit; }
+}  // namespace
+
+#ifdef _WIN32
+
+DelayArena::DelayArena(size_t bytes, bool hugePages)
+{
+  if (bytes == 0) return;
+  if (hugePages)
+  {
+    const size_t largePage = GetLargePageMinimum();
+    if (largePage > 0)
+    {
+      const size_t size = roundUp(bytes, largePage);
+      mMapping =
+          VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+      if (mMapping)
+      {
+        mMappingSize = size;
+        mHugePages = true;
+      }
+    }
+  }
+  if (!mMapping)
+  {
+    mMapping = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (!mMapping) return;
+    mMappingSize = bytes;
+  }
+  mData = static_cast<uint8_t*>(mMapping);
+  mCapacity = bytes;
+  std::memset(mData, 0, mCapacity);
+}
+
+DelayArena::~DelayArena()
+{
+  if (mMapping) VirtualFree(mMapping, 0, MEM_RELEASE);
+}
+
+#else
+
+namespace
+{
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+}  // namespace
+
+DelayArena::DelayArena(size_t bytes, bool hugePages)
+{
+  if (bytes == 0) return;
+  size_t offset = 0;
+#ifdef MAP_HUGETLB
+  if (hugePages)
+  {
+    // this fails unless huge pages have been reserved, with
+    // /proc/sys/vm/nr_hugepages for example.
+    const size_t size = roundUp(bytes, kHugePageSize);
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                   -1, 0);
+    if (p != MAP_FAILED)
+    {
+      mMapping = p;
+      mMappingSize = size;
+      mHugePages = true;
+    }
+  }
+#endif
+  if (!mMapping)
+  {
+    // transparent huge pages need the block to start on a huge page, so map
+    // one extra huge page to align the start within.
+    const size_t size = hugePages ? bytes + kHugePageSize : bytes;
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return;
+    mMapping = p;
+    mMappingSize = size;
+    if (hugePages)
+    {
+      const uintptr_t start = reinterpret_cast<uintptr_t>(p);
+      offset = roundUp(start, kHugePageSize) - start;
+#ifdef MADV_HUGEPAGE
+      madvise(static_cast<uint8_t*>(p) + offset, bytes, MADV_HUGEPAGE);
+#endif
+    }
+  }
+  mData = static_cast<uint8_t*>(mMapping) + offset;
+  mCapacity = bytes;
+  std::memset(mData, 0, mCapacity);
+}
+
+DelayArena::~DelayArena()
+{
+  if (mMapping) munmap(mMapping, mMappingSize);
+}
+
+#endif
+
+}  // namespace ml
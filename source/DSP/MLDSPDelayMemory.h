@@ -0,0 +1,157 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// MLDSPDelayMemory.h
+// Memory for delay lines. Each delay object normally allocates its own buffer
+// from the heap. A DelayArena reserves one block up front, from which all the
+// delays in a graph can take their buffers, so that the delay memory for the
+// whole graph is contiguous and no more allocation is needed once the graph
+// is set up.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ml
+{
+// DelayArena: a block of memory reserved once, from which delay buffers are
+// taken in order. Each buffer starts on a cache line. Memory is only given
+// back all at once, by reset() or by destroying the arena, so delays should
+// set their maximum sizes once after the arena is made. After reset(), every
+// delay that used the arena must have its memory allocated again.
+//
+// Delays keep pointers into the arena, so the arena must outlive every
+// DelayMemory, and every delay object, that has taken memory from it.
+//
+// With hugePages true, the block is backed by huge pages if the OS allows
+// it, which saves TLB misses when many long delays are read every vector. On
+// Linux this uses hugetlbfs pages if any are reserved, and otherwise asks for
+// transparent huge pages. On Windows it uses large pages, which need the
+// "lock pages in memory" privilege. Otherwise ordinary pages are used.
+//
+// The whole block is written to when the arena is made, so that its pages are
+// resident before any audio is processed.
+
+class DelayArena
+{
+  uint8_t* mData{nullptr};
+  size_t mCapacity{0};
+  size_t mUsed{0};
+  size_t mOverflow{0};
+  bool mHugePages{false};
+
+  // the block as mapped by the OS, which may be larger than mCapacity.
+  void* mMapping{nullptr};
+  size_t mMappingSize{0};
+
+ public:
+  static constexpr size_t kAlignment = 64;
+
+  DelayArena(size_t bytes, bool hugePages = false);
+  ~DelayArena();
+  DelayArena(const DelayArena&) = delete;
+  DelayArena& operator=(const DelayArena&) = delete;
+
+  // return bytes of memory aligned to kAlignment, or nullptr if the arena does
+  // not have room for them.
+  inline void* allocate(size_t bytes)
+  {
+    const size_t start = (mUsed + kAlignment - 1) & ~(kAlignment - 1);
+    if (start + bytes > mCapacity)
+    {
+      mOverflow += bytes;
+      return nullptr;
+    }
+    mUsed = start + bytes;
+    return mData + start;
+  }
+
+  // make all the memory available again.
+  void reset()
+  {
+    mUsed = 0;
+    mOverflow = 0;
+  }
+
+  size_t getCapacity() const { return mCapacity; }
+  size_t getUsed() const { return mUsed; }
+
+  // the total size of the allocations that did not fit since the last reset.
+  // If this is nonzero, those delays are using heap memory instead.
+  size_t getOverflow() const { return mOverflow; }
+
+  // true if the block is backed by explicitly reserved huge pages.
+  bool usesHugePages() const { return mHugePages; }
+};
+
+// DelayMemory: the buffer of a delay line, taken from a DelayArena if one is
+// given and has room, and from the heap otherwise.
+//
+// Copying a DelayMemory copies its contents to the heap, because the arena
+// has no memory set aside for the copy.
+
+template <typename T>
+class DelayMemory
+{
+  std::vector<T> mHeap;
+  T* mData{nullptr};
+  size_t mSize{0};
+
+ public:
+  DelayMemory() = default;
+  DelayMemory(const DelayMemory& other) : mHeap(other.mData, other.mData + other.mSize)
+  {
+    mData = mHeap.data();
+    mSize = other.mSize;
+  }
+  DelayMemory(DelayMemory&& other) noexcept
+      : mHeap(std::move(other.mHeap)), mData(other.mData), mSize(other.mSize)
+  {
+    other.mData = nullptr;
+    other.mSize = 0;
+  }
+  DelayMemory& operator=(DelayMemory other) noexcept
+  {
+    std::swap(mHeap, other.mHeap);
+    std::swap(mData, other.mData);
+    std::swap(mSize, other.mSize);
+    return *this;
+  }
+  ~DelayMemory() = default;
+
+  // allocate space for size samples, set to zero. Any previous contents are
+  // lost.
+  void allocate(size_t size, DelayArena* pArena = nullptr)
+  {
+    T* p = pArena ? static_cast<T*>(pArena->allocate(size * sizeof(T))) : nullptr;
+    if (p)
+    {
+      std::vector<T>().swap(mHeap);
+      mData = p;
+    }
+    else
+    {
+      mHeap.assign(size, T{});
+      mData = mHeap.data();
+    }
+    mSize = size;
+    clear();
+  }
+
+  inline void clear() { std::fill(mData, mData + mSize, T{}); }
+
+  inline T* data() { return mData; }
+  inline const T* data() const { return mData; }
+  inline size_t size() const { return mSize; }
+  inline T& operator[](size_t i) { return mData[i]; }
+  inline const T& operator[](size_t i) const { return mData[i]; }
+
+  // true if the memory was taken from an arena.
+  inline bool isInArena() const { return mSize > 0 && mHeap.empty(); }
+};
+
+}  // namespace ml
@@ -0,0 +1,97 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "MLDSPDispatch.h"
+
+#ifdef ML_DSP_HAS_KERNEL_DISPATCH
+
+#ifdef _MSC_VER
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace ml
+{
+const DSPKernelTable* gDSPKernels = &kDSPKernelsSSE2;
+
+namespace
+{
+const DSPKernelTable* const kKernelTables[kNumSIMDLevels] = {&kDSPKernelsSSE2, &kDSPKernelsSSE41,
+                                                              &kDSPKernelsAVX2, &kDSPKernelsAVX512};
+
+const char* const kSIMDLevelNames[kNumSIMDLevels] = {"SSE2", "SSE4.1", "AVX2", "AVX-512"};
+
+SIMDLevel gSIMDLevel = kSSE2;
+
+#ifdef _MSC_VER
+
+SIMDLevel detectLevel()
+{
+  int info[4];
+  __cpuid(info, 1);
+  const bool sse41 = info[2] & (1 << 19);
+  const bool osxsave = info[2] & (1 << 27);
+  const bool avx = info[2] & (1 << 28);
+
+  // check that the OS saves the YMM and ZMM registers.
+  const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+  const bool ymmEnabled = (xcr0 & 0x06) == 0x06;
+  const bool zmmEnabled = (xcr0 & 0xE6) == 0xE6;
+
+  __cpuidex(info, 7, 0);
+  const bool avx2 = info[1] & (1 << 5);
+  const bool avx512f = info[1] & (1 << 16);
+
+  if (avx512f && zmmEnabled) return kAVX512;
+  if (avx && avx2 && ymmEnabled) return kAVX2;
+  if (sse41) return kSSE41;
+  return kSSE2;
+}
+
+#else
+
+SIMDLevel detectLevel()
+{
+  // __builtin_cpu_supports also checks that the OS supports the registers.
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return kAVX512;
+  if (__builtin_cpu_supports("avx2")) return kAVX2;
+  if (__builtin_cpu_supports("sse4.1")) return kSSE41;
+  return kSSE2;
+}
+
+#endif
+
+// upgrade to the best kernels before main(). Until this runs, any DSP code
+// called from other static initializers uses the SSE2 kernels.
+struct DSPKernelsInitializer
+{
+  DSPKernelsInitializer() { setSIMDLevel(detectSIMDLevel()); }
+} gDSPKernelsInitializer;
+}  // namespace
+
+SIMDLevel detectSIMDLevel()
+{
+  static const SIMDLevel level = detectLevel();
+  return level;
+}
+
+SIMDLevel getSIMDLevel() { return gSIMDLevel; }
+
+bool setSIMDLevel(SIMDLevel level)
+{
+  if ((level < kSSE2) || (level > detectSIMDLevel())) return false;
+  gSIMDLevel = level;
+  gDSPKernels = kKernelTables[level];
+  return true;
+}
+
+const char* getSIMDLevelName(SIMDLevel level)
+{
+  if ((level < kSSE2) || (level >= kNumSIMDLevels)) return "unknown";
+  return kSIMDLevelNames[level];
+}
+}  // namespace ml
+
+#endif  // ML_DSP_HAS_KERNEL_DISPATCH
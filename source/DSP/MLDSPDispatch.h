@@ -0,0 +1,230 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// MLDSPDispatch.h
+// Runtime selection of the SIMD kernels behind the DSPVectorArray operators
+// in MLDSPOps.h.
+//
+// Normally each operator inlines its kernel for the instruction set chosen
+// at compile time by MLDSPMath.h. If ML_DSP_RUNTIME_DISPATCH is defined, the
+// operators instead call through a table of kernels compiled for SSE2,
+// SSE4.1, AVX2 and AVX-512, and the best table for the running CPU is chosen
+// at startup. Results are bit-identical at every level, so one binary built
+// for SSE2 can run the wider kernels where they are available.
+//
+// The kernel tables are compiled in MLDSPKernels*.cpp, which are part of the
+// madronalib library on x86. Runtime dispatch requires linking with it.
+
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define ML_DSP_HAS_KERNEL_DISPATCH 1
+#endif
+
+#if defined(ML_DSP_RUNTIME_DISPATCH) && !defined(ML_DSP_HAS_KERNEL_DISPATCH)
+#error "ML_DSP_RUNTIME_DISPATCH is only available on x86."
+#endif
+
+// The dispatched operators, by family. These must match the DEFINE_OP*
+// definitions in MLDSPOps.h: any operator defined there must be listed here.
+
+#define ML_DSP_OP1_KERNELS(X) \
+  X(sqrt)                     \
+  X(sqrtApprox)               \
+  X(abs)                      \
+  X(sign)                     \
+  X(signBit)                  \
+  X(sin)                      \
+  X(cos)                      \
+  X(log)                      \
+  X(exp)                      \
+  X(log2)                     \
+  X(exp2)                     \
+  X(sinApprox)                \
+  X(cosApprox)                \
+  X(expApprox)                \
+  X(logApprox)                \
+  X(log2Approx)               \
+  X(exp2Approx)               \
+  X(tanh)                     \
+  X(tanhApprox)               \
+  X(tanhFast)                 \
+  X(sinh)                     \
+  X(sinhApprox)               \
+  X(sinhFast)                 \
+  X(tan)                      \
+  X(tanApprox)                \
+  X(tanFast)                  \
+  X(atan)                     \
+  X(atanApprox)               \
+  X(atanFast)                 \
+  X(fractionalPart)
+
+#define ML_DSP_OP2_KERNELS(X) \
+  X(add)                      \
+  X(subtract)                 \
+  X(multiply)                 \
+  X(divide)                   \
+  X(divideApprox)             \
+  X(pow)                      \
+  X(powApprox)                \
+  X(powFast)                  \
+  X(atan2)                    \
+  X(atan2Approx)              \
+  X(atan2Fast)                \
+  X(min)                      \
+  X(max)
+
+#define ML_DSP_OP2_INT32_KERNELS(X) \
+  X(subtractInt32)                  \
+  X(addInt32)
+
+#define ML_DSP_OP3_KERNELS(X) \
+  X(lerp)                     \
+  X(inverseLerp)              \
+  X(clamp)                    \
+  X(within)
+
+#define ML_DSP_OP1_F2I_KERNELS(X) \
+  X(roundFloatToInt)              \
+  X(truncateFloatToInt)
+
+#define ML_DSP_OP1_I2F_KERNELS(X) X(intToFloat)
+
+#define ML_DSP_OP2_FF2I_KERNELS(X) \
+  X(equal)                         \
+  X(notEqual)                      \
+  X(greaterThan)                   \
+  X(greaterThanOrEqual)            \
+  X(lessThan)                      \
+  X(lessThanOrEqual)
+
+#define ML_DSP_OP3_FFI2F_KERNELS(X) X(select)
+
+#define ML_DSP_OP3_III2I_KERNELS(X) X(select)
+
+#define ML_DSP_REDUCTION_KERNELS(X) \
+  X(sum)                            \
+  X(max)                            \
+  X(min)
+
+#define ML_DSP_LOOKUP_KERNELS(X) \
+  X(lookupNearest)               \
+  X(lookupLinear)                \
+  X(lookupCubic)
+
+namespace ml
+{
+// Kernels process n floats (or ints) from each input, where n is a multiple
+// of the widest SIMD vector size. Reductions process a single DSPVector.
+typedef void (*DSPKernel1)(const float* px1, float* py1, int n);
+typedef void (*DSPKernel2)(const float* px1, const float* px2, float* py1, int n);
+typedef void (*DSPKernel3)(const float* px1, const float* px2, const float* px3, float* py1,
+                           int n);
+typedef float (*DSPReductionKernel)(const float* px1);
+
+// Lookup kernels read from a table of tableSize + 1 points at pTable, with one
+// guard point before and two after. See MLDSPTables.h.
+typedef void (*DSPLookupKernel)(const float* pTable, int tableSize, float scale, float offset,
+                                const float* px1, float* py1, int n);
+
+#define ML_DSP_KERNEL1_FIELD(opName) DSPKernel1 opName;
+#define ML_DSP_KERNEL2_FIELD(opName) DSPKernel2 opName;
+#define ML_DSP_KERNEL3_FIELD(opName) DSPKernel3 opName;
+#define ML_DSP_REDUCTION_KERNEL_FIELD(opName) DSPReductionKernel opName;
+#define ML_DSP_LOOKUP_KERNEL_FIELD(opName) DSPLookupKernel opName;
+
+struct DSPKernelTable
+{
+  struct
+  {
+    ML_DSP_OP1_KERNELS(ML_DSP_KERNEL1_FIELD)
+  } op1;
+  struct
+  {
+    ML_DSP_OP2_KERNELS(ML_DSP_KERNEL2_FIELD)
+  } op2;
+  struct
+  {
+    ML_DSP_OP2_INT32_KERNELS(ML_DSP_KERNEL2_FIELD)
+  } op2Int32;
+  struct
+  {
+    ML_DSP_OP3_KERNELS(ML_DSP_KERNEL3_FIELD)
+  } op3;
+  struct
+  {
+    ML_DSP_OP1_F2I_KERNELS(ML_DSP_KERNEL1_FIELD)
+  } op1F2I;
+  struct
+  {
+    ML_DSP_OP1_I2F_KERNELS(ML_DSP_KERNEL1_FIELD)
+  } op1I2F;
+  struct
+  {
+    ML_DSP_OP2_FF2I_KERNELS(ML_DSP_KERNEL2_FIELD)
+  } op2FF2I;
+  struct
+  {
+    ML_DSP_OP3_FFI2F_KERNELS(ML_DSP_KERNEL3_FIELD)
+  } op3FFI2F;
+  struct
+  {
+    ML_DSP_OP3_III2I_KERNELS(ML_DSP_KERNEL3_FIELD)
+  } op3III2I;
+  struct
+  {
+    ML_DSP_REDUCTION_KERNELS(ML_DSP_REDUCTION_KERNEL_FIELD)
+  } reduction;
+  struct
+  {
+    ML_DSP_LOOKUP_KERNELS(ML_DSP_LOOKUP_KERNEL_FIELD)
+  } lookup;
+};
+
+#ifdef ML_DSP_HAS_KERNEL_DISPATCH
+
+enum SIMDLevel
+{
+  kSSE2 = 0,
+  kSSE41,
+  kAVX2,
+  kAVX512,
+  kNumSIMDLevels
+};
+
+// the kernel tables, one per level.
+extern const DSPKernelTable kDSPKernelsSSE2;
+extern const DSPKernelTable kDSPKernelsSSE41;
+extern const DSPKernelTable kDSPKernelsAVX2;
+extern const DSPKernelTable kDSPKernelsAVX512;
+
+// the table in use. Starts out as SSE2 and is upgraded to the best supported
+// level when the library is initialized.
+extern const DSPKernelTable* gDSPKernels;
+
+inline const DSPKernelTable& getDSPKernels() { return *gDSPKernels; }
+
+// get the highest level supported by this CPU and operating system.
+SIMDLevel detectSIMDLevel();
+
+// get the level currently in use.
+SIMDLevel getSIMDLevel();
+
+// force the given level, for testing. Returns false and leaves the current
+// level unchanged if the CPU does not support it. This is not thread-safe:
+// call it only when no DSP code is running.
+bool setSIMDLevel(SIMDLevel level);
+
+const char* getSIMDLevelName(SIMDLevel level);
+
+#endif  // ML_DSP_HAS_KERNEL_DISPATCH
+}  // namespace ml
+
+// ML_DSP_KERNEL(family, opName) names the kernel that an operator will run.
+#ifdef ML_DSP_RUNTIME_DISPATCH
+#define ML_DSP_KERNEL(family, opName) (ml::getDSPKernels().family.opName)
+#else
+#define ML_DSP_KERNEL(family, opName) (kernels::family::opName)
+#endif
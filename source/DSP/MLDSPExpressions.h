@@ -0,0 +1,338 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// MLDSPExpressions.h
+// Opt-in lazy evaluation of DSPVectorArray expressions.
+//
+// Each operator in MLDSPOps.h runs its own loop and returns a DSPVectorArray,
+// so an expression like a * b + c stores and reloads a temporary for every
+// operator. Wrapping one operand in lazy() instead builds a tree of the
+// operations, which is evaluated in a single SIMD loop when the expression is
+// assigned or converted to a DSPVectorArray:
+//
+//   DSPVector y = lazy(a) * b + c;                  // one loop, no temporaries
+//   DSPVectorInt m = greaterThan(lazy(a), 0.5f);    // comparisons give masks
+//   DSPVector z = select(lazy(a), b, lessThan(lazy(a), c));
+//
+// Any mix of lazy expressions, DSPVectorArrays and floats can be combined, as
+// long as at least one argument of each operation is lazy. The elementwise
+// operators +, -, *, / and the one, two and three-argument functions from
+// MLDSPOps.h are supported, with the same results as the eager versions.
+//
+// An expression refers to its DSPVectorArray arguments and does not copy
+// them. Expressions can be held in auto variables for reuse within a
+// function, but they must not outlive the vectors they refer to. In
+// particular, lazy(a + b) refers to the temporary a + b, so it must be
+// evaluated within the same statement.
+
+#pragma once
+
+#include <type_traits>
+
+#include "MLDSPOps.h"
+
+namespace ml
+{
+namespace expr
+{
+// leaf nodes.
+
+struct Load
+{
+  const float* p;
+  inline SIMDVectorFloat eval(int i) const { return vecLoad(p + i); }
+};
+
+struct Constant
+{
+  SIMDVectorFloat v;
+  inline SIMDVectorFloat eval(int) const { return v; }
+};
+
+// operation nodes, applying the Op structs defined by the DEFINE_OP* macros.
+
+template <typename Op, typename A>
+struct Unary
+{
+  A a;
+  inline SIMDVectorFloat eval(int i) const { return Op::apply(a.eval(i)); }
+};
+
+template <typename Op, typename A, typename B>
+struct Binary
+{
+  A a;
+  B b;
+  inline SIMDVectorFloat eval(int i) const { return Op::apply(a.eval(i), b.eval(i)); }
+};
+
+template <typename Op, typename A, typename B, typename C>
+struct Ternary
+{
+  A a;
+  B b;
+  C c;
+  inline SIMDVectorFloat eval(int i) const { return Op::apply(a.eval(i), b.eval(i), c.eval(i)); }
+};
+
+// like Ternary, with an int mask as the last argument.
+template <typename Op, typename A, typename B, typename M>
+struct Masked
+{
+  A a;
+  B b;
+  M m;
+  inline SIMDVectorFloat eval(int i) const
+  {
+    return Op::apply(a.eval(i), b.eval(i), VecF2I(m.eval(i)));
+  }
+};
+}  // namespace expr
+
+// a lazy float expression with the shape of a DSPVectorArray<ROWS>.
+template <size_t ROWS, typename Node>
+struct Expr
+{
+  Node node;
+
+  inline DSPVectorArray<ROWS> evaluate() const
+  {
+    DSPVectorArray<ROWS> vy;
+    float* py1 = vy.getBuffer();
+    for (int i = 0; i < kFloatsPerDSPVector * static_cast<int>(ROWS); i += kFloatsPerSIMDVector)
+    {
+      vecStore(py1 + i, node.eval(i));
+    }
+    return vy;
+  }
+
+  inline operator DSPVectorArray<ROWS>() const { return evaluate(); }
+};
+
+// a lazy int expression (mask) with the shape of a DSPVectorArrayInt<ROWS>.
+template <size_t ROWS, typename Node>
+struct ExprInt
+{
+  Node node;
+
+  inline DSPVectorArrayInt<ROWS> evaluate() const
+  {
+    DSPVectorArrayInt<ROWS> vy;
+    float* py1 = vy.getBuffer();
+    for (int i = 0; i < kFloatsPerDSPVector * static_cast<int>(ROWS); i += kFloatsPerSIMDVector)
+    {
+      vecStore(py1 + i, node.eval(i));
+    }
+    return vy;
+  }
+
+  inline operator DSPVectorArrayInt<ROWS>() const { return evaluate(); }
+};
+
+// start a lazy expression.
+template <size_t ROWS>
+inline Expr<ROWS, expr::Load> lazy(const DSPVectorArray<ROWS>& x)
+{
+  return {{x.getConstBuffer()}};
+}
+
+template <size_t ROWS>
+inline ExprInt<ROWS, expr::Load> lazy(const DSPVectorArrayInt<ROWS>& x)
+{
+  return {{x.getConstBuffer()}};
+}
+
+namespace expr
+{
+// ExprRows<Args...>::value is the size of the first lazy expression among the
+// arguments. If there is none, value is not defined, so that the lazy
+// operations drop out of overload resolution.
+template <typename... Ts>
+struct ExprRows
+{
+};
+
+template <size_t ROWS, typename N, typename... Ts>
+struct ExprRows<Expr<ROWS, N>, Ts...>
+{
+  static constexpr size_t value = ROWS;
+};
+
+template <size_t ROWS, typename N, typename... Ts>
+struct ExprRows<ExprInt<ROWS, N>, Ts...>
+{
+  static constexpr size_t value = ROWS;
+};
+
+template <typename T, typename... Ts>
+struct ExprRows<T, Ts...> : ExprRows<Ts...>
+{
+};
+
+// Operand<ROWS, T> converts a float argument of type T to a node. Arguments
+// that are not floats, float expressions or DSPVectorArray<ROWS> are refused.
+template <size_t ROWS, typename T, typename Enable = void>
+struct Operand
+{
+};
+
+template <size_t ROWS, typename N>
+struct Operand<ROWS, Expr<ROWS, N>>
+{
+  using type = N;
+  static inline N get(const Expr<ROWS, N>& x) { return x.node; }
+};
+
+template <size_t ROWS>
+struct Operand<ROWS, DSPVectorArray<ROWS>>
+{
+  using type = Load;
+  static inline Load get(const DSPVectorArray<ROWS>& x) { return {x.getConstBuffer()}; }
+};
+
+template <size_t ROWS, typename T>
+struct Operand<ROWS, T, typename std::enable_if<std::is_arithmetic<T>::value>::type>
+{
+  using type = Constant;
+  static inline Constant get(T x) { return {vecSet1(static_cast<float>(x))}; }
+};
+
+// MaskOperand<ROWS, T> does the same for int masks.
+template <size_t ROWS, typename T>
+struct MaskOperand
+{
+};
+
+template <size_t ROWS, typename N>
+struct MaskOperand<ROWS, ExprInt<ROWS, N>>
+{
+  using type = N;
+  static inline N get(const ExprInt<ROWS, N>& x) { return x.node; }
+};
+
+template <size_t ROWS>
+struct MaskOperand<ROWS, DSPVectorArrayInt<ROWS>>
+{
+  using type = Load;
+  static inline Load get(const DSPVectorArrayInt<ROWS>& x) { return {x.getConstBuffer()}; }
+};
+
+template <size_t ROWS, typename T>
+using OperandNode = typename Operand<ROWS, typename std::decay<T>::type>::type;
+
+template <size_t ROWS, typename T>
+using MaskOperandNode = typename MaskOperand<ROWS, typename std::decay<T>::type>::type;
+
+template <size_t ROWS, typename T>
+inline OperandNode<ROWS, T> operand(const T& x)
+{
+  return Operand<ROWS, typename std::decay<T>::type>::get(x);
+}
+
+template <size_t ROWS, typename T>
+inline MaskOperandNode<ROWS, T> maskOperand(const T& x)
+{
+  return MaskOperand<ROWS, typename std::decay<T>::type>::get(x);
+}
+}  // namespace expr
+
+// ----------------------------------------------------------------
+// lazy versions of the operators in MLDSPOps.h.
+
+namespace expr
+{
+template <size_t ROWS, typename Op, typename A>
+using UnaryExpr = Expr<ROWS, Unary<Op, OperandNode<ROWS, A>>>;
+
+template <size_t ROWS, typename Op, typename A, typename B>
+using BinaryExpr = Expr<ROWS, Binary<Op, OperandNode<ROWS, A>, OperandNode<ROWS, B>>>;
+
+template <size_t ROWS, typename Op, typename A, typename B>
+using BinaryExprInt = ExprInt<ROWS, Binary<Op, OperandNode<ROWS, A>, OperandNode<ROWS, B>>>;
+
+template <size_t ROWS, typename Op, typename A, typename B, typename C>
+using TernaryExpr =
+    Expr<ROWS, Ternary<Op, OperandNode<ROWS, A>, OperandNode<ROWS, B>, OperandNode<ROWS, C>>>;
+
+template <size_t ROWS, typename Op, typename A, typename B, typename M>
+using MaskedExpr =
+    Expr<ROWS, Masked<Op, OperandNode<ROWS, A>, OperandNode<ROWS, B>, MaskOperandNode<ROWS, M>>>;
+}  // namespace expr
+
+#define DEFINE_LAZY_OP1(opName)                                                              \
+  template <typename A, size_t ROWS = expr::ExprRows<A>::value>                              \
+  inline expr::UnaryExpr<ROWS, kernels::op1::opName##Op, A>(opName)(const A& a)              \
+  {                                                                                          \
+    return {{expr::operand<ROWS>(a)}};                                                       \
+  }
+
+#define DEFINE_LAZY_OP2(opName)                                                              \
+  template <typename A, typename B, size_t ROWS = expr::ExprRows<A, B>::value>               \
+  inline expr::BinaryExpr<ROWS, kernels::op2::opName##Op, A, B>(opName)(const A& a,          \
+                                                                        const B& b)          \
+  {                                                                                          \
+    return {{expr::operand<ROWS>(a), expr::operand<ROWS>(b)}};                               \
+  }
+
+#define DEFINE_LAZY_OP2_FF2I(opName)                                                         \
+  template <typename A, typename B, size_t ROWS = expr::ExprRows<A, B>::value>               \
+  inline expr::BinaryExprInt<ROWS, kernels::op2FF2I::opName##Op, A, B>(opName)(const A& a,   \
+                                                                               const B& b)   \
+  {                                                                                          \
+    return {{expr::operand<ROWS>(a), expr::operand<ROWS>(b)}};                               \
+  }
+
+#define DEFINE_LAZY_OP3(opName)                                                              \
+  template <typename A, typename B, typename C,                                              \
+            size_t ROWS = expr::ExprRows<A, B, C>::value>                                    \
+  inline expr::TernaryExpr<ROWS, kernels::op3::opName##Op, A, B, C>(opName)(                 \
+      const A& a, const B& b, const C& c)                                                    \
+  {                                                                                          \
+    return {{expr::operand<ROWS>(a), expr::operand<ROWS>(b), expr::operand<ROWS>(c)}};       \
+  }
+
+ML_DSP_OP1_KERNELS(DEFINE_LAZY_OP1)
+ML_DSP_OP2_KERNELS(DEFINE_LAZY_OP2)
+ML_DSP_OP2_FF2I_KERNELS(DEFINE_LAZY_OP2_FF2I)
+ML_DSP_OP3_KERNELS(DEFINE_LAZY_OP3)
+
+// select(resultIfTrue, resultIfFalse, conditionMask)
+template <typename A, typename B, typename M, size_t ROWS = expr::ExprRows<A, B, M>::value>
+inline expr::MaskedExpr<ROWS, kernels::op3FFI2F::selectOp, A, B, M> select(const A& a, const B& b,
+                                                                           const M& m)
+{
+  return {{expr::operand<ROWS>(a), expr::operand<ROWS>(b), expr::maskOperand<ROWS>(m)}};
+}
+
+// arithmetic operators.
+template <typename A, typename B, size_t ROWS = expr::ExprRows<A, B>::value>
+inline auto operator+(const A& a, const B& b) -> decltype(add(a, b))
+{
+  return add(a, b);
+}
+
+template <typename A, typename B, size_t ROWS = expr::ExprRows<A, B>::value>
+inline auto operator-(const A& a, const B& b) -> decltype(subtract(a, b))
+{
+  return subtract(a, b);
+}
+
+template <typename A, typename B, size_t ROWS = expr::ExprRows<A, B>::value>
+inline auto operator*(const A& a, const B& b) -> decltype(multiply(a, b))
+{
+  return multiply(a, b);
+}
+
+template <typename A, typename B, size_t ROWS = expr::ExprRows<A, B>::value>
+inline auto operator/(const A& a, const B& b) -> decltype(divide(a, b))
+{
+  return divide(a, b);
+}
+
+#undef DEFINE_LAZY_OP1
+#undef DEFINE_LAZY_OP2
+#undef DEFINE_LAZY_OP3
+#undef DEFINE_LAZY_OP2_FF2I
+
+}  // namespace ml
@@ -5,6 +5,12 @@
 // DSP filters: functor objects implementing an operator()(DSPVector input, ...).
 // All these filters have some state, otherwise they would be DSPOps.
 //
+// Each filter also has a process() method taking its inputs by reference and
+// writing to an output argument, process(const DSPVector& in, DSPVector& out),
+// and single input filters have processInPlace(DSPVector&). The input and
+// output can be the same vector, so a chain of filters can run on one buffer
+// without copying. operator() is a wrapper around process().
+//
 // These objects are for building fixed DSP graphs in a functional style. The
 // compiler should have many opportunities to optimize these graphs. For dynamic
 // graphs changeable at runtime, see MLProcs. In general MLProcs will be written
@@ -15,12 +21,21 @@
 // less code overall. For all filters, k is a damping parameter equal to 1/Q
 // where Q is the analog filter "quality." For bell and shelf filters, gain is
 // specified as an output / input ratio A.
+//
+// For modulating filters at audio rate, each SVF filter also has a static
+// vcoeffs() function that computes a DSPVectorArray of coefficients, one
+// column per sample, from DSPVectors of parameters. These are computed in SIMD
+// with an approximate tan(). process(), processInPlace() and operator() take
+// the coefficients as an extra argument.
 
 #pragma once
 
+#include <algorithm>
 #include <vector>
 
+#include "MLDSPDelayMemory.h"
 #include "MLDSPOps.h"
+#include "MLDSPSampleFormats.h"
 #include "MLDSPScalarMath.h"
 
 namespace ml
@@ -42,107 +57,381 @@ DSPVectorArray<COEFFS_SIZE> interpolateCoeffsLinear(const std::array<float, COEF
   return vy;
 }
 
+// --------------------------------------------------------------------------------
+// filter recurrences
+
+template <typename T>
+class LopassT;
+template <typename T>
+class HipassT;
+class Bandpass;
+class LoShelf;
+class HiShelf;
+template <typename T>
+class BellT;
+template <typename T>
+class OnePoleT;
+
+// The recurrence of each filter, as a function of its coefficients c, state s
+// and input sample v0. The filters below run it on scalars, SIMDBank on SIMD
+// vectors and StateSpaceFilter on doubles. unpack() makes the array c from the
+// filter's mCoeffs. It is a template because the filters are declared later.
+template <typename FILTER>
+struct SIMDBankKernel;
+
+template <typename T>
+struct SIMDBankKernel<LopassT<T>>
+{
+  static constexpr int kCoeffs = 3;
+  static constexpr int kState = 2;
+  template <typename C>
+  static std::array<T, kCoeffs> unpack(const C& c)
+  {
+    return {{c.g0, c.g1, c.g2}};
+  }
+  template <typename V>
+  static V tick(const V* c, V* s, V v0)
+  {
+    V t0 = v0 - s[1];
+    V t1 = c[0] * t0 + c[1] * s[0];
+    V t2 = c[2] * t0 + c[0] * s[0];
+    V v2 = t2 + s[1];
+    s[0] += V(2.f) * t1;
+    s[1] += V(2.f) * t2;
+    return v2;
+  }
+};
+
+template <typename T>
+struct SIMDBankKernel<HipassT<T>>
+{
+  static constexpr int kCoeffs = 4;
+  static constexpr int kState = 2;
+  template <typename C>
+  static std::array<T, kCoeffs> unpack(const C& c)
+  {
+    return {{c.g0, c.g1, c.g2, c.k}};
+  }
+  template <typename V>
+  static V tick(const V* c, V* s, V v0)
+  {
+    V t0 = v0 - s[1];
+    V t1 = c[0] * t0 + c[1] * s[0];
+    V t2 = c[2] * t0 + c[0] * s[0];
+    V v1 = t1 + s[0];
+    V v2 = t2 + s[1];
+    s[0] += V(2.f) * t1;
+    s[1] += V(2.f) * t2;
+    return v0 - c[3] * v1 - v2;
+  }
+};
+
+template <>
+struct SIMDBankKernel<Bandpass>
+{
+  static constexpr int kCoeffs = 3;
+  static constexpr int kState = 2;
+  template <typename C>
+  static std::array<float, kCoeffs> unpack(const C& c)
+  {
+    return {{c.g0, c.g1, c.g2}};
+  }
+  template <typename V>
+  static V tick(const V* c, V* s, V v0)
+  {
+    V t0 = v0 - s[1];
+    V t1 = c[0] * t0 + c[1] * s[0];
+    V t2 = c[2] * t0 + c[0] * s[0];
+    V v1 = t1 + s[0];
+    s[0] += V(2.f) * t1;
+    s[1] += V(2.f) * t2;
+    return v1;
+  }
+};
+
+template <typename T>
+struct SIMDBankKernel<BellT<T>>
+{
+  static constexpr int kCoeffs = 4;
+  static constexpr int kState = 2;
+  template <typename C>
+  static std::array<T, kCoeffs> unpack(const C& c)
+  {
+    return {{c.a1, c.a2, c.a3, c.m1}};
+  }
+  template <typename V>
+  static V tick(const V* c, V* s, V v0)
+  {
+    V v3 = v0 - s[1];
+    V v1 = c[0] * s[0] + c[1] * v3;
+    V v2 = s[1] + c[1] * s[0] + c[2] * v3;
+    s[0] = V(2.f) * v1 - s[0];
+    s[1] = V(2.f) * v2 - s[1];
+    return v0 + c[3] * v1;
+  }
+};
+
+template <>
+struct SIMDBankKernel<LoShelf>
+{
+  static constexpr int kCoeffs = 5;
+  static constexpr int kState = 2;
+  template <typename C>
+  static std::array<float, kCoeffs> unpack(const C& c) { return c; }
+  template <typename V>
+  static V tick(const V* c, V* s, V v0)
+  {
+    V v3 = v0 - s[1];
+    V v1 = c[0] * s[0] + c[1] * v3;
+    V v2 = s[1] + c[1] * s[0] + c[2] * v3;
+    s[0] = V(2.f) * v1 - s[0];
+    s[1] = V(2.f) * v2 - s[1];
+    return v0 + c[3] * v1 + c[4] * v2;
+  }
+};
+
+template <>
+struct SIMDBankKernel<HiShelf>
+{
+  static constexpr int kCoeffs = 6;
+  static constexpr int kState = 2;
+  template <typename C>
+  static std::array<float, kCoeffs> unpack(const C& c) { return c; }
+  template <typename V>
+  static V tick(const V* c, V* s, V v0)
+  {
+    V v3 = v0 - s[1];
+    V v1 = c[0] * s[0] + c[1] * v3;
+    V v2 = s[1] + c[1] * s[0] + c[2] * v3;
+    s[0] = V(2.f) * v1 - s[0];
+    s[1] = V(2.f) * v2 - s[1];
+    return c[3] * v0 + c[4] * v1 + c[5] * v2;
+  }
+};
+
+template <typename T>
+struct SIMDBankKernel<OnePoleT<T>>
+{
+  static constexpr int kCoeffs = 2;
+  static constexpr int kState = 1;
+  template <typename C>
+  static std::array<T, kCoeffs> unpack(const C& c)
+  {
+    return {{c.a0, c.b1}};
+  }
+  template <typename V>
+  static V tick(const V* c, V* s, V v0)
+  {
+    s[0] = c[0] * v0 + c[1] * s[0];
+    return s[0];
+  }
+};
+
+// run the recurrence of FILTER over a DSPVector, with coefficients c and state
+// s of type T. The input and output can be the same vector.
+template <typename FILTER, typename T>
+inline void processWithKernel(const T* c, T* s, const DSPVector& vx, DSPVector& vy)
+{
+  using Kernel = SIMDBankKernel<FILTER>;
+
+  // copy the state element by element, so that it stays in float registers.
+  T state[Kernel::kState];
+  for (int k = 0; k < Kernel::kState; ++k) state[k] = s[k];
+  const float* px = vx.getConstBuffer();
+  float* py = vy.getBuffer();
+  for (int n = 0; n < kFloatsPerDSPVector; ++n)
+  {
+    py[n] = static_cast<float>(Kernel::tick(c, state, static_cast<T>(px[n])));
+  }
+  for (int k = 0; k < Kernel::kState; ++k) s[k] = state[k];
+}
+
+// the same, with the coefficients for each sample in the columns of vc.
+template <typename FILTER, typename T, size_t COEFFS>
+inline void processWithKernel(const DSPVectorArray<COEFFS>& vc, T* s, const DSPVector& vx,
+                              DSPVector& vy)
+{
+  using Kernel = SIMDBankKernel<FILTER>;
+  static_assert(COEFFS == Kernel::kCoeffs, "wrong number of coefficient rows");
+
+  T state[Kernel::kState];
+  for (int k = 0; k < Kernel::kState; ++k) state[k] = s[k];
+  const float* pc = vc.getConstBuffer();
+  const float* px = vx.getConstBuffer();
+  float* py = vy.getBuffer();
+  for (int n = 0; n < kFloatsPerDSPVector; ++n)
+  {
+    T c[Kernel::kCoeffs];
+    for (int k = 0; k < Kernel::kCoeffs; ++k) c[k] = pc[k * kFloatsPerDSPVector + n];
+    py[n] = static_cast<float>(Kernel::tick(c, state, static_cast<T>(px[n])));
+  }
+  for (int k = 0; k < Kernel::kState; ++k) s[k] = state[k];
+}
+
 // --------------------------------------------------------------------------------
 // utility filters implemented as SVF variations
 // Thanks to Andrew Simper [www.cytomic.com] for sharing his work over the
 // years.
-
-class Lopass
+//
+// Lopass, Hipass, Bell and OnePole are templates on the type T of their
+// coefficients and state. Input and output are always DSPVectors. The
+// default float versions are named as before, and the double versions, with
+// a D suffix, are for low cutoffs and high Q where float state loses
+// precision.
+
+template <typename T>
+class LopassT
 {
   struct _coeffs
   {
-    float g0, g1, g2;
+    T g0, g1, g2;
   };
+  typedef DSPVectorArray<3> _vcoeffs;
 
-  float ic1eq{0};
-  float ic2eq{0};
+  std::array<T, 2> mState{};
 
  public:
   _coeffs mCoeffs{0};
 
-  static _coeffs coeffs(float omega, float k)
+  static _coeffs coeffs(T omega, T k)
   {
-    float piOmega = kPi * omega;
-    float s1 = sinf(piOmega);
-    float s2 = sinf(2.0f * piOmega);
-    float nrm = 1.0f / (2.f + k * s2);
-    float g0 = s2 * nrm;
-    float g1 = (-2.f * s1 * s1 - k * s2) * nrm;
-    float g2 = (2.0f * s1 * s1) * nrm;
+    T piOmega = static_cast<T>(kPiD) * omega;
+    T s1 = std::sin(piOmega);
+    T s2 = std::sin(T(2) * piOmega);
+    T nrm = T(1) / (T(2) + k * s2);
+    T g0 = s2 * nrm;
+    T g1 = (T(-2) * s1 * s1 - k * s2) * nrm;
+    T g2 = (T(2) * s1 * s1) * nrm;
     return {g0, g1, g2};
   }
 
+  // the coefficients for each sample, with rows g0, g1 and g2. With
+  // g = tan(pi * omega) these are the same as from coeffs().
+  static _vcoeffs vcoeffs(const DSPVector& omega, const DSPVector& k)
+  {
+    _vcoeffs vc;
+    DSPVector g = tanApprox(omega * DSPVector(kPi));
+    DSPVector a1 = DSPVector(1.f) / (DSPVector(1.f) + g * (g + k));
+    vc.row(0) = g * a1;
+    vc.row(1) = a1 - DSPVector(1.f);
+    vc.row(2) = g * g * a1;
+    return vc;
+  }
+
+  inline void process(const DSPVector& vx, DSPVector& vy)
+  {
+    const auto c = SIMDBankKernel<LopassT>::unpack(mCoeffs);
+    processWithKernel<LopassT>(c.data(), mState.data(), vx, vy);
+  }
+
+  inline void processInPlace(DSPVector& v) { process(v, v); }
+
   inline DSPVector operator()(const DSPVector vx)
   {
     DSPVector vy;
-    for (int n = 0; n < kFloatsPerDSPVector; ++n)
-    {
-      float v0 = vx[n];
-      float t0 = v0 - ic2eq;
-      float t1 = mCoeffs.g0 * t0 + mCoeffs.g1 * ic1eq;
-      float t2 = mCoeffs.g2 * t0 + mCoeffs.g0 * ic1eq;
-      float v2 = t2 + ic2eq;
-      ic1eq += 2.0f * t1;
-      ic2eq += 2.0f * t2;
-      vy[n] = v2;
-    }
+    process(vx, vy);
+    return vy;
+  }
+
+  inline void process(const DSPVector& vx, const _vcoeffs& vc, DSPVector& vy)
+  {
+    processWithKernel<LopassT>(vc, mState.data(), vx, vy);
+  }
+
+  inline void processInPlace(DSPVector& v, const _vcoeffs& vc) { process(v, vc, v); }
+
+  inline DSPVector operator()(const DSPVector vx, const _vcoeffs vc)
+  {
+    DSPVector vy;
+    process(vx, vc, vy);
     return vy;
   }
 };
 
-class Hipass
+typedef LopassT<float> Lopass;
+typedef LopassT<double> LopassD;
+
+template <typename T>
+class HipassT
 {
   struct _coeffs
   {
-    float g0, g1, g2, k;
+    T g0, g1, g2, k;
   };
+  typedef DSPVectorArray<4> _vcoeffs;
 
-  float ic1eq{0};
-  float ic2eq{0};
+  std::array<T, 2> mState{};
 
  public:
   _coeffs mCoeffs{0};
 
-  static _coeffs coeffs(float omega, float k)
+  static _coeffs coeffs(T omega, T k)
   {
-    float piOmega = kPi * omega;
-    float s1 = sinf(piOmega);
-    float s2 = sinf(2.0f * piOmega);
-    float nrm = 1.0f / (2.f + k * s2);
-    float g0 = s2 * nrm;
-    float g1 = (-2.f * s1 * s1 - k * s2) * nrm;
-    float g2 = (2.0f * s1 * s1) * nrm;
+    T piOmega = static_cast<T>(kPiD) * omega;
+    T s1 = std::sin(piOmega);
+    T s2 = std::sin(T(2) * piOmega);
+    T nrm = T(1) / (T(2) + k * s2);
+    T g0 = s2 * nrm;
+    T g1 = (T(-2) * s1 * s1 - k * s2) * nrm;
+    T g2 = (T(2) * s1 * s1) * nrm;
     return {g0, g1, g2, k};
   }
 
+  // the coefficients for each sample, with rows g0, g1, g2 and k.
+  static _vcoeffs vcoeffs(const DSPVector& omega, const DSPVector& k)
+  {
+    _vcoeffs vc;
+    DSPVector g = tanApprox(omega * DSPVector(kPi));
+    DSPVector a1 = DSPVector(1.f) / (DSPVector(1.f) + g * (g + k));
+    vc.row(0) = g * a1;
+    vc.row(1) = a1 - DSPVector(1.f);
+    vc.row(2) = g * g * a1;
+    vc.row(3) = k;
+    return vc;
+  }
+
+  inline void process(const DSPVector& vx, DSPVector& vy)
+  {
+    const auto c = SIMDBankKernel<HipassT>::unpack(mCoeffs);
+    processWithKernel<HipassT>(c.data(), mState.data(), vx, vy);
+  }
+
+  inline void processInPlace(DSPVector& v) { process(v, v); }
+
   inline DSPVector operator()(const DSPVector vx)
   {
     DSPVector vy;
-    for (int n = 0; n < kFloatsPerDSPVector; ++n)
-    {
-      float v0 = vx[n];
-      float t0 = v0 - ic2eq;
-      float t1 = mCoeffs.g0 * t0 + mCoeffs.g1 * ic1eq;
-      float t2 = mCoeffs.g2 * t0 + mCoeffs.g0 * ic1eq;
-      float v1 = t1 + ic1eq;
-      float v2 = t2 + ic2eq;
-      ic1eq += 2.0f * t1;
-      ic2eq += 2.0f * t2;
-      vy[n] = v0 - mCoeffs.k * v1 - v2;
-    }
+    process(vx, vy);
+    return vy;
+  }
+
+  inline void process(const DSPVector& vx, const _vcoeffs& vc, DSPVector& vy)
+  {
+    processWithKernel<HipassT>(vc, mState.data(), vx, vy);
+  }
+
+  inline void processInPlace(DSPVector& v, const _vcoeffs& vc) { process(v, vc, v); }
+
+  inline DSPVector operator()(const DSPVector vx, const _vcoeffs vc)
+  {
+    DSPVector vy;
+    process(vx, vc, vy);
     return vy;
   }
 };
 
+typedef HipassT<float> Hipass;
+typedef HipassT<double> HipassD;
+
 class Bandpass
 {
   struct _coeffs
   {
     float g0, g1, g2;
   };
+  typedef DSPVectorArray<3> _vcoeffs;
 
-  float ic1eq{0};
-  float ic2eq{0};
+  std::array<float, 2> mState{};
 
  public:
   _coeffs mCoeffs{0};
@@ -159,20 +448,44 @@ class Bandpass
     return {g0, g1, g2};
   }
 
+  // the coefficients for each sample, with rows g0, g1 and g2.
+  static _vcoeffs vcoeffs(const DSPVector& omega, const DSPVector& k)
+  {
+    _vcoeffs vc;
+    DSPVector g = tanApprox(omega * DSPVector(kPi));
+    DSPVector a1 = DSPVector(1.f) / (DSPVector(1.f) + g * (g + k));
+    vc.row(0) = g * a1;
+    vc.row(1) = a1 - DSPVector(1.f);
+    vc.row(2) = g * g * a1;
+    return vc;
+  }
+
+  inline void process(const DSPVector& vx, DSPVector& vy)
+  {
+    const auto c = SIMDBankKernel<Bandpass>::unpack(mCoeffs);
+    processWithKernel<Bandpass>(c.data(), mState.data(), vx, vy);
+  }
+
+  inline void processInPlace(DSPVector& v) { process(v, v); }
+
   inline DSPVector operator()(const DSPVector vx)
   {
     DSPVector vy;
-    for (int n = 0; n < kFloatsPerDSPVector; ++n)
-    {
-      float v0 = vx[n];
-      float t0 = v0 - ic2eq;
-      float t1 = mCoeffs.g0 * t0 + mCoeffs.g1 * ic1eq;
-      float t2 = mCoeffs.g2 * t0 + mCoeffs.g0 * ic1eq;
-      float v1 = t1 + ic1eq;
-      ic1eq += 2.0f * t1;
-      ic2eq += 2.0f * t2;
-      vy[n] = v1;
-    }
+    process(vx, vy);
+    return vy;
+  }
+
+  inline void process(const DSPVector& vx, const _vcoeffs& vc, DSPVector& vy)
+  {
+    processWithKernel<Bandpass>(vc, mState.data(), vx, vy);
+  }
+
+  inline void processInPlace(DSPVector& v, const _vcoeffs& vc) { process(v, vc, v); }
+
+  inline DSPVector operator()(const DSPVector vx, const _vcoeffs vc)
+  {
+    DSPVector vy;
+    process(vx, vc, vy);
     return vy;
   }
 };
@@ -191,8 +504,7 @@ class LoShelf
   typedef std::array<float, COEFFS_SIZE> _coeffs;
   typedef DSPVectorArray<COEFFS_SIZE> _vcoeffs;
 
-  float ic1eq{0};
-  float ic2eq{0};
+  std::array<float, 2> mState{};
 
  public:
   enum paramNames
@@ -223,35 +535,45 @@ class LoShelf
     return interpolateCoeffsLinear(coeffs(p0), coeffs(p1));
   }
 
+  // the coefficients for each sample, from parameters for each sample.
+  static _vcoeffs vcoeffs(const DSPVector& omega, const DSPVector& k, const DSPVector& A)
+  {
+    _vcoeffs vc;
+    DSPVector g = tanApprox(omega * DSPVector(kPi)) / sqrt(A);
+    vc.row(a1) = DSPVector(1.f) / (DSPVector(1.f) + g * (g + k));
+    vc.row(a2) = g * vc.constRow(a1);
+    vc.row(a3) = g * vc.constRow(a2);
+    vc.row(m1) = k * (A - DSPVector(1.f));
+    vc.row(m2) = A * A - DSPVector(1.f);
+    return vc;
+  }
+
+  inline void process(const DSPVector& vx, DSPVector& vy)
+  {
+    const auto c = SIMDBankKernel<LoShelf>::unpack(mCoeffs);
+    processWithKernel<LoShelf>(c.data(), mState.data(), vx, vy);
+  }
+
+  inline void processInPlace(DSPVector& v) { process(v, v); }
+
   inline DSPVector operator()(const DSPVector vx)
   {
     DSPVector vy;
-    for (int n = 0; n < kFloatsPerDSPVector; ++n)
-    {
-      float v0 = vx[n];
-      float v3 = v0 - ic2eq;
-      float v1 = mCoeffs[a1] * ic1eq + mCoeffs[a2] * v3;
-      float v2 = ic2eq + mCoeffs[a2] * ic1eq + mCoeffs[a3] * v3;
-      ic1eq = 2 * v1 - ic1eq;
-      ic2eq = 2 * v2 - ic2eq;
-      vy[n] = v0 + mCoeffs[m1] * v1 + mCoeffs[m2] * v2;
-    }
+    process(vx, vy);
     return vy;
   }
 
+  inline void process(const DSPVector& vx, const _vcoeffs& vc, DSPVector& vy)
+  {
+    processWithKernel<LoShelf>(vc, mState.data(), vx, vy);
+  }
+
+  inline void processInPlace(DSPVector& v, const _vcoeffs& vc) { process(v, vc, v); }
+
   inline DSPVector operator()(const DSPVector vx, const _vcoeffs vc)
   {
     DSPVector vy;
-    for (int n = 0; n < kFloatsPerDSPVector; ++n)
-    {
-      float v0 = vx[n];
-      float v3 = v0 - ic2eq;
-      float v1 = vc.constRow(a1)[n] * ic1eq + vc.constRow(a2)[n] * v3;
-      float v2 = ic2eq + vc.constRow(a2)[n] * ic1eq + vc.constRow(a3)[n] * v3;
-      ic1eq = 2 * v1 - ic1eq;
-      ic2eq = 2 * v2 - ic2eq;
-      vy[n] = v0 + vc.constRow(m1)[n] * v1 + vc.constRow(m2)[n] * v2;
-    }
+    process(vx, vc, vy);
     return vy;
   }
 };
@@ -271,8 +593,7 @@ class HiShelf
   typedef std::array<float, COEFFS_SIZE> _coeffs;
   typedef DSPVectorArray<COEFFS_SIZE> _vcoeffs;
 
-  float ic1eq{0};
-  float ic2eq{0};
+  std::array<float, 2> mState{};
 
  public:
   enum paramnames
@@ -304,188 +625,586 @@ class HiShelf
     return interpolateCoeffsLinear(coeffs(p0), coeffs(p1));
   }
 
+  // the coefficients for each sample, from parameters for each sample.
+  static _vcoeffs vcoeffs(const DSPVector& omega, const DSPVector& k, const DSPVector& A)
+  {
+    _vcoeffs vc;
+    DSPVector g = tanApprox(omega * DSPVector(kPi)) * sqrt(A);
+    vc.row(a1) = DSPVector(1.f) / (DSPVector(1.f) + g * (g + k));
+    vc.row(a2) = g * vc.constRow(a1);
+    vc.row(a3) = g * vc.constRow(a2);
+    vc.row(m0) = A * A;
+    vc.row(m1) = k * (DSPVector(1.f) - A) * A;
+    vc.row(m2) = DSPVector(1.f) - A * A;
+    return vc;
+  }
+
+  inline void process(const DSPVector& vx, DSPVector& vy)
+  {
+    const auto c = SIMDBankKernel<HiShelf>::unpack(mCoeffs);
+    processWithKernel<HiShelf>(c.data(), mState.data(), vx, vy);
+  }
+
+  inline void processInPlace(DSPVector& v) { process(v, v); }
+
   inline DSPVector operator()(const DSPVector vx)
   {
     DSPVector vy;
-    for (int n = 0; n < kFloatsPerDSPVector; ++n)
-    {
-      float v0 = vx[n];
-      float v3 = v0 - ic2eq;
-      float v1 = mCoeffs[a1] * ic1eq + mCoeffs[a2] * v3;
-      float v2 = ic2eq + mCoeffs[a2] * ic1eq + mCoeffs[a3] * v3;
-      ic1eq = 2 * v1 - ic1eq;
-      ic2eq = 2 * v2 - ic2eq;
-      vy[n] = mCoeffs[m0] * v0 + mCoeffs[m1] * v1 + mCoeffs[m2] * v2;
-    }
+    process(vx, vy);
     return vy;
   }
 
+  inline void process(const DSPVector& vx, const _vcoeffs& vc, DSPVector& vy)
+  {
+    processWithKernel<HiShelf>(vc, mState.data(), vx, vy);
+  }
+
+  inline void processInPlace(DSPVector& v, const _vcoeffs& vc) { process(v, vc, v); }
+
   inline DSPVector operator()(const DSPVector vx, const _vcoeffs vc)
   {
     DSPVector vy;
-    for (int n = 0; n < kFloatsPerDSPVector; ++n)
-    {
-      float v0 = vx[n];
-      float v3 = v0 - ic2eq;
-      float v1 = vc.constRow(a1)[n] * ic1eq + vc.constRow(a2)[n] * v3;
-      float v2 = ic2eq + vc.constRow(a2)[n] * ic1eq + vc.constRow(a3)[n] * v3;
-      ic1eq = 2 * v1 - ic1eq;
-      ic2eq = 2 * v2 - ic2eq;
-      vy[n] = vc.constRow(m0)[n] * v0 + vc.constRow(m1)[n] * v1 + vc.constRow(m2)[n] * v2;
-    }
+    process(vx, vc, vy);
     return vy;
   }
 };
 
-class Bell
+template <typename T>
+class BellT
 {
   struct _coeffs
   {
-    float a1, a2, a3, m1;
+    T a1, a2, a3, m1;
   };
+  typedef DSPVectorArray<4> _vcoeffs;
 
-  float ic1eq{0};
-  float ic2eq{0};
+  std::array<T, 2> mState{};
 
  public:
   _coeffs mCoeffs{0};
 
-  static _coeffs coeffs(float omega, float k, float A)
+  static _coeffs coeffs(T omega, T k, T A)
   {
-    float kc = k / A;  // correct k
-    float piOmega = kPi * omega;
-    float g = tanf(piOmega);
-    float a1 = 1.f / (1.f + g * (g + kc));
-    float a2 = g * a1;
-    float a3 = g * a2;
-    float m1 = kc * (A * A - 1.f);
+    T kc = k / A;  // correct k
+    T piOmega = static_cast<T>(kPiD) * omega;
+    T g = std::tan(piOmega);
+    T a1 = T(1) / (T(1) + g * (g + kc));
+    T a2 = g * a1;
+    T a3 = g * a2;
+    T m1 = kc * (A * A - T(1));
     return {a1, a2, a3, m1};
   }
 
+  // the coefficients for each sample, with rows a1, a2, a3 and m1.
+  static _vcoeffs vcoeffs(const DSPVector& omega, const DSPVector& k, const DSPVector& A)
+  {
+    _vcoeffs vc;
+    DSPVector kc = k / A;
+    DSPVector g = tanApprox(omega * DSPVector(kPi));
+    vc.row(0) = DSPVector(1.f) / (DSPVector(1.f) + g * (g + kc));
+    vc.row(1) = g * vc.constRow(0);
+    vc.row(2) = g * vc.constRow(1);
+    vc.row(3) = kc * (A * A - DSPVector(1.f));
+    return vc;
+  }
+
+  inline void process(const DSPVector& vx, DSPVector& vy)
+  {
+    const auto c = SIMDBankKernel<BellT>::unpack(mCoeffs);
+    processWithKernel<BellT>(c.data(), mState.data(), vx, vy);
+  }
+
+  inline void processInPlace(DSPVector& v) { process(v, v); }
+
   inline DSPVector operator()(const DSPVector vx)
   {
     DSPVector vy;
-    for (int n = 0; n < kFloatsPerDSPVector; ++n)
-    {
-      float v0 = vx[n];
-      float v3 = v0 - ic2eq;
-      float v1 = mCoeffs.a1 * ic1eq + mCoeffs.a2 * v3;
-      float v2 = ic2eq + mCoeffs.a2 * ic1eq + mCoeffs.a3 * v3;
-      ic1eq = 2 * v1 - ic1eq;
-      ic2eq = 2 * v2 - ic2eq;
-      vy[n] = v0 + mCoeffs.m1 * v1;
-    }
+    process(vx, vy);
+    return vy;
+  }
+
+  inline void process(const DSPVector& vx, const _vcoeffs& vc, DSPVector& vy)
+  {
+    processWithKernel<BellT>(vc, mState.data(), vx, vy);
+  }
+
+  inline void processInPlace(DSPVector& v, const _vcoeffs& vc) { process(v, vc, v); }
+
+  inline DSPVector operator()(const DSPVector vx, const _vcoeffs vc)
+  {
+    DSPVector vy;
+    process(vx, vc, vy);
     return vy;
   }
 };
 
+typedef BellT<float> Bell;
+typedef BellT<double> BellD;
+
 // A one pole filter. see https://ccrma.stanford.edu/~jos/fp/One_Pole.html
 
-class OnePole
+template <typename T>
+class OnePoleT
 {
   struct _coeffs
   {
-    float a0, b1;
+    T a0, b1;
   };
 
-  float y1{0};
+  T y1{0};
 
  public:
   _coeffs mCoeffs{0};
 
-  static _coeffs coeffs(float omega)
+  static _coeffs coeffs(T omega)
   {
-    float x = expf(-omega * kTwoPi);
-    return {1.f - x, x};
+    T x = std::exp(-omega * static_cast<T>(kTwoPiD));
+    return {T(1) - x, x};
   }
 
-  static _coeffs passthru() { return {1.f, 0.f}; }
+  static _coeffs passthru() { return {T(1), T(0)}; }
+
+  inline void process(const DSPVector& vx, DSPVector& vy)
+  {
+    const auto c = SIMDBankKernel<OnePoleT>::unpack(mCoeffs);
+    processWithKernel<OnePoleT>(c.data(), &y1, vx, vy);
+  }
+
+  inline void processInPlace(DSPVector& v) { process(v, v); }
 
   inline DSPVector operator()(const DSPVector vx)
   {
     DSPVector vy;
-    for (int n = 0; n < kFloatsPerDSPVector; ++n)
-    {
-      y1 = mCoeffs.a0 * vx[n] + mCoeffs.b1 * y1;
-      vy[n] = y1;
-    }
+    process(vx, vy);
     return vy;
   }
 };
 
-// A one-pole, one-zero filter to attenuate DC.
-// Works well, but beware of its effects on bass sounds.
-// A "cutoff" of around 2kHz (omega = 0.045 at sr=44100) is a
-// good starting point. see https://ccrma.stanford.edu/~jos/fp/DC_Blocker.html
-// for more.
+typedef OnePoleT<float> OnePole;
+typedef OnePoleT<double> OnePoleD;
 
-class DCBlocker
+// --------------------------------------------------------------------------------
+// SIMDBank<FILTER, ROWS>: a bank of ROWS filters that runs kFloatsPerSIMDVector
+// channels at once, one in each lane of a SIMD vector.
+//
+// Each filter above runs a scalar recurrence over the samples of a DSPVector.
+// SIMDBank keeps the coefficients and state of each group of channels
+// interleaved, and runs the same recurrence on SIMD vectors holding one sample
+// from each channel. Blocks of the input rows are transposed for this, and the
+// results transposed back. Results are the same as from a Bank of the
+// filters. ROWS need not be a multiple of the SIMD vector size.
+//
+// Lopass, Hipass, Bandpass, LoShelf, HiShelf, Bell and OnePole are supported.
+// Set the coefficients of each channel with
+// setCoeffs(row, Lopass::coeffs(omega, k)) and so on.
+
+// One sample from each channel of a group: a SIMD vector with the arithmetic
+// operators used by the filter recurrences, so that the recurrences in
+// SIMDBankKernel can run on SIMDLanes and on scalars.
+struct SIMDLanes
 {
-  typedef float _coeffs;
-  float x1{0};
-  float y1{0};
-
- public:
-  _coeffs mCoeffs{};
+  SIMDVectorFloat v;
+  SIMDLanes() = default;
+  SIMDLanes(SIMDVectorFloat x) : v(x) {}
+  SIMDLanes(float f) : v(vecSet1(f)) {}
+};
 
-  static _coeffs coeffs(float omega) { return cosf(omega); }
+inline SIMDLanes operator+(SIMDLanes a, SIMDLanes b) { return vecAdd(a.v, b.v); }
+inline SIMDLanes operator-(SIMDLanes a, SIMDLanes b) { return vecSub(a.v, b.v); }
+inline SIMDLanes operator*(SIMDLanes a, SIMDLanes b) { return vecMul(a.v, b.v); }
+inline SIMDLanes& operator+=(SIMDLanes& a, SIMDLanes b) { return a = a + b; }
 
-  inline DSPVector operator()(const DSPVector vx)
+// Transpose kFloatsPerDSPVector samples from each of up to kFloatsPerSIMDVector
+// rows starting at px into SIMDLanes, one for each sample. Lanes past the
+// last row are zero.
+inline void transposeRowsToLanes(const float* px, int rows, SIMDLanes* py)
+{
+  constexpr int kLanes = kFloatsPerSIMDVector;
+  SIMDVectorFloat block[kLanes];
+  for (int n = 0; n < kFloatsPerDSPVector; n += kLanes)
   {
-    DSPVector vy;
-    for (int n = 0; n < kFloatsPerDSPVector; ++n)
+    for (int l = 0; l < kLanes; ++l)
     {
-      const float x0 = vx[n];
-      const float y0 = x0 - x1 + mCoeffs * y1;
-      y1 = y0;
-      x1 = x0;
-      vy[n] = y0;
+      block[l] = (l < rows) ? vecLoad(px + l * kFloatsPerDSPVector + n) : vecZeros();
+    }
+    vecTranspose(block);
+    for (int l = 0; l < kLanes; ++l)
+    {
+      py[n + l].v = block[l];
     }
-    return vy;
   }
-};
-
-// Differentiator
+}
 
-class Differentiator
+// the inverse of transposeRowsToLanes, storing only the given rows.
+inline void transposeLanesToRows(const SIMDLanes* px, int rows, float* py)
 {
-  float _x1{0};
-
- public:
-  inline DSPVector operator()(const DSPVector vx)
+  constexpr int kLanes = kFloatsPerSIMDVector;
+  SIMDVectorFloat block[kLanes];
+  for (int n = 0; n < kFloatsPerDSPVector; n += kLanes)
   {
-    DSPVector vy;
-    vy[0] = vx[0] - _x1;
-
-    // TODO SIMD
-    for (int n = 1; n < kFloatsPerDSPVector; ++n)
+    for (int l = 0; l < kLanes; ++l)
     {
-      vy[n] = vx[n] - vx[n - 1];
+      block[l] = px[n + l].v;
+    }
+    vecTranspose(block);
+    for (int l = 0; l < rows; ++l)
+    {
+      vecStore(py + l * kFloatsPerDSPVector + n, block[l]);
     }
-    _x1 = vx[kFloatsPerDSPVector - 1];
-    return vy;
   }
-};
-
-// Integrator
+}
 
-class Integrator
+template <typename FILTER, size_t ROWS>
+class SIMDBank
 {
-  float y1{0};
+  using Kernel = SIMDBankKernel<FILTER>;
+  static constexpr int kLanes = kFloatsPerSIMDVector;
+  static constexpr int kGroups = (ROWS + kLanes - 1) / kLanes;
+
+  std::array<std::array<SIMDLanes, Kernel::kCoeffs>, kGroups> mCoeffs{};
+  std::array<std::array<SIMDLanes, Kernel::kState>, kGroups> mState{};
+
+  static float& lane(SIMDLanes& x, int i) { return reinterpret_cast<float*>(&x.v)[i]; }
+
+  // the number of rows in group g.
+  static int groupRows(int g)
+  {
+    return ((g + 1) * kLanes <= ROWS) ? kLanes : static_cast<int>(ROWS) - g * kLanes;
+  }
 
  public:
-  // set leak to a value such as 0.001 for stability
-  float mLeak{0};
+  SIMDBank() { clear(); }
 
-  inline DSPVector operator()(const DSPVector vx)
+  // set the coefficients of one channel, from the coeffs() of the filter.
+  void setCoeffs(int row, const decltype(FILTER::mCoeffs)& c)
+  {
+    auto unpacked = Kernel::unpack(c);
+    for (int k = 0; k < Kernel::kCoeffs; ++k)
+    {
+      lane(mCoeffs[row / kLanes][k], row % kLanes) = unpacked[k];
+    }
+  }
+
+  inline void process(const DSPVectorArray<ROWS>& vx, DSPVectorArray<ROWS>& vy)
+  {
+    // the samples of each group of channels, interleaved.
+    SIMDLanes buf[kGroups][kFloatsPerDSPVector];
+    for (int g = 0; g < kGroups; ++g)
+    {
+      const float* px = vx.getConstBuffer() + g * kLanes * kFloatsPerDSPVector;
+      transposeRowsToLanes(px, groupRows(g), buf[g]);
+    }
+
+    // run all the groups at each sample, so that their recurrences can
+    // overlap in the pipeline.
+    for (int n = 0; n < kFloatsPerDSPVector; ++n)
+    {
+      for (int g = 0; g < kGroups; ++g)
+      {
+        buf[g][n] = Kernel::tick(mCoeffs[g].data(), mState[g].data(), buf[g][n]);
+      }
+    }
+
+    for (int g = 0; g < kGroups; ++g)
+    {
+      float* py = vy.getBuffer() + g * kLanes * kFloatsPerDSPVector;
+      transposeLanesToRows(buf[g], groupRows(g), py);
+    }
+  }
+
+  inline void processInPlace(DSPVectorArray<ROWS>& v) { process(v, v); }
+
+  inline DSPVectorArray<ROWS> operator()(const DSPVectorArray<ROWS>& vx)
+  {
+    DSPVectorArray<ROWS> vy;
+    process(vx, vy);
+    return vy;
+  }
+
+  inline void clear()
+  {
+    for (auto& group : mState)
+    {
+      group.fill(SIMDLanes(0.f));
+    }
+  }
+};
+
+// --------------------------------------------------------------------------------
+// StateSpaceFilter<FILTER>: a single channel of one of the filters above that
+// computes kFloatsPerSIMDVector outputs at each step with SIMD math.
+//
+// The filters are linear systems with a state s of one or two values:
+// s[n+1] = A s[n] + B x[n], and y[n] = C s[n] + D x[n]. Looking ahead L steps,
+// the next L outputs are a matrix times s[n], plus the lower triangular
+// Toeplitz matrix of the impulse response times the next L inputs. The state
+// after them is A^L s[n] plus a weighted sum of the inputs. These matrices are
+// computed from the filter's coefficients, so that the recurrence runs only
+// once every L samples, and the rest of the work is SIMD multiply-adds.
+//
+// Any FILTER supported by SIMDBank can be used, and the results are the same
+// as from the FILTER to within rounding. setCoeffs() does some matrix math, so
+// this is best for filters with fixed coefficients such as the sections of an
+// EQ. A cascade of sections is a chain of processInPlace() calls.
+
+template <typename FILTER>
+class StateSpaceFilter
+{
+  using Kernel = SIMDBankKernel<FILTER>;
+  static constexpr int kLanes = kFloatsPerSIMDVector;
+  static constexpr int kState = Kernel::kState;
+
+  // lane i of the outputs for each step is the sum of the state values times
+  // mStateToOutput and the inputs times the columns of mInputToOutput.
+  SIMDVectorFloat mStateToOutput[kState];
+  SIMDVectorFloat mInputToOutput[kLanes];
+
+  // the state after each step: A^L s, plus the inputs times mInputToState.
+  float mStateToState[kState][kState];
+  SIMDVectorFloat mInputToState[kState];
+
+  float mState[kState];
+
+ public:
+  StateSpaceFilter()
+  {
+    setCoeffs(decltype(FILTER::mCoeffs){});
+    clear();
+  }
+
+  // set the coefficients, from the coeffs() of the filter.
+  void setCoeffs(const decltype(FILTER::mCoeffs)& coeffs)
+  {
+    auto unpacked = Kernel::unpack(coeffs);
+    double c[Kernel::kCoeffs];
+    std::copy(unpacked.begin(), unpacked.end(), c);
+
+    // find A, B, C and D by running the recurrence from unit states and inputs.
+    double a[kState][kState], b[kState], cs[kState], d;
+    for (int j = 0; j < kState; ++j)
+    {
+      double s[kState]{};
+      s[j] = 1.0;
+      cs[j] = Kernel::tick(c, s, 0.0);
+      for (int i = 0; i < kState; ++i)
+      {
+        a[i][j] = s[i];
+      }
+    }
+    double s[kState]{};
+    d = Kernel::tick(c, s, 1.0);
+    std::copy(s, s + kState, b);
+
+    // with p = A^i: lane i of the state to output rows is C A^i, the impulse
+    // response at i + 1 is C A^i B, and input L - 1 - i adds A^i B to the
+    // next state.
+    float stateToOutput[kState][kLanes];
+    float inputToState[kState][kLanes];
+    float impulse[kLanes + 1];
+    double p[kState][kState]{};
+    for (int r = 0; r < kState; ++r)
+    {
+      p[r][r] = 1.0;
+    }
+    impulse[0] = static_cast<float>(d);
+    for (int i = 0; i < kLanes; ++i)
+    {
+      double h = 0.0;
+      for (int r = 0; r < kState; ++r)
+      {
+        double cp = 0.0, pb = 0.0;
+        for (int k = 0; k < kState; ++k)
+        {
+          cp += cs[k] * p[k][r];
+          pb += p[r][k] * b[k];
+        }
+        stateToOutput[r][i] = static_cast<float>(cp);
+        inputToState[r][kLanes - 1 - i] = static_cast<float>(pb);
+        h += cp * b[r];
+      }
+      impulse[i + 1] = static_cast<float>(h);
+
+      double q[kState][kState]{};
+      for (int r = 0; r < kState; ++r)
+      {
+        for (int k = 0; k < kState; ++k)
+        {
+          for (int j = 0; j < kState; ++j)
+          {
+            q[r][j] += p[r][k] * a[k][j];
+          }
+        }
+      }
+      std::copy(&q[0][0], &q[0][0] + kState * kState, &p[0][0]);
+    }
+
+    for (int r = 0; r < kState; ++r)
+    {
+      mStateToOutput[r] = vecLoadUnaligned(stateToOutput[r]);
+      mInputToState[r] = vecLoadUnaligned(inputToState[r]);
+      for (int j = 0; j < kState; ++j)
+      {
+        mStateToState[r][j] = static_cast<float>(p[r][j]);
+      }
+    }
+    for (int j = 0; j < kLanes; ++j)
+    {
+      float column[kLanes];
+      for (int i = 0; i < kLanes; ++i)
+      {
+        column[i] = (i >= j) ? impulse[i - j] : 0.f;
+      }
+      mInputToOutput[j] = vecLoadUnaligned(column);
+    }
+  }
+
+  inline void process(const DSPVector& vx, DSPVector& vy)
+  {
+    const float* px = vx.getConstBuffer();
+    float* py = vy.getBuffer();
+    float state[kState];
+    std::copy(mState, mState + kState, state);
+    for (int n = 0; n < kSIMDVectorsPerDSPVector; ++n)
+    {
+      // sum the inputs' terms in two chains to shorten the dependencies.
+      SIMDVectorFloat x = vecLoad(px);
+      SIMDVectorFloat y0 = vecMul(vecSet1(px[0]), mInputToOutput[0]);
+      SIMDVectorFloat y1 = vecMul(vecSet1(px[1]), mInputToOutput[1]);
+      for (int j = 2; j < kLanes; j += 2)
+      {
+        y0 = vecAdd(y0, vecMul(vecSet1(px[j]), mInputToOutput[j]));
+        y1 = vecAdd(y1, vecMul(vecSet1(px[j + 1]), mInputToOutput[j + 1]));
+      }
+      SIMDVectorFloat y = vecAdd(y0, y1);
+      for (int r = 0; r < kState; ++r)
+      {
+        y = vecAdd(y, vecMul(vecSet1(state[r]), mStateToOutput[r]));
+      }
+
+      float next[kState];
+      for (int r = 0; r < kState; ++r)
+      {
+        next[r] = vecSumH(vecMul(x, mInputToState[r]));
+        for (int j = 0; j < kState; ++j)
+        {
+          next[r] += mStateToState[r][j] * state[j];
+        }
+      }
+      std::copy(next, next + kState, state);
+
+      vecStore(py, y);
+      px += kLanes;
+      py += kLanes;
+    }
+    std::copy(state, state + kState, mState);
+  }
+
+  inline void processInPlace(DSPVector& v) { process(v, v); }
+
+  inline DSPVector operator()(const DSPVector vx)
   {
     DSPVector vy;
+    process(vx, vy);
+    return vy;
+  }
+
+  inline void clear() { std::fill(mState, mState + kState, 0.f); }
+};
+
+// A one-pole, one-zero filter to attenuate DC.
+// Works well, but beware of its effects on bass sounds.
+// A "cutoff" of around 2kHz (omega = 0.045 at sr=44100) is a
+// good starting point. see https://ccrma.stanford.edu/~jos/fp/DC_Blocker.html
+// for more.
+
+class DCBlocker
+{
+  typedef float _coeffs;
+  float x1{0};
+  float y1{0};
+
+ public:
+  _coeffs mCoeffs{};
+
+  static _coeffs coeffs(float omega) { return cosf(omega); }
+
+  inline void process(const DSPVector& vx, DSPVector& vy)
+  {
+    for (int n = 0; n < kFloatsPerDSPVector; ++n)
+    {
+      const float x0 = vx[n];
+      const float y0 = x0 - x1 + mCoeffs * y1;
+      y1 = y0;
+      x1 = x0;
+      vy[n] = y0;
+    }
+  }
+
+  inline void processInPlace(DSPVector& v) { process(v, v); }
+
+  inline DSPVector operator()(const DSPVector vx)
+  {
+    DSPVector vy;
+    process(vx, vy);
+    return vy;
+  }
+};
+
+// Differentiator
+
+class Differentiator
+{
+  float _x1{0};
+
+ public:
+  inline void process(const DSPVector& vx, DSPVector& vy)
+  {
+    // keep the previous input in _x1, so that vx and vy can be the same.
+    // TODO SIMD
+    for (int n = 0; n < kFloatsPerDSPVector; ++n)
+    {
+      const float x0 = vx[n];
+      vy[n] = x0 - _x1;
+      _x1 = x0;
+    }
+  }
+
+  inline void processInPlace(DSPVector& v) { process(v, v); }
+
+  inline DSPVector operator()(const DSPVector vx)
+  {
+    DSPVector vy;
+    process(vx, vy);
+    return vy;
+  }
+};
+
+// Integrator
+
+class Integrator
+{
+  float y1{0};
+
+ public:
+  // set leak to a value such as 0.001 for stability
+  float mLeak{0};
+
+  inline void process(const DSPVector& vx, DSPVector& vy)
+  {
     for (int n = 0; n < kFloatsPerDSPVector; ++n)
     {
       y1 -= y1 * mLeak;
       y1 += vx[n];
       vy[n] = y1;
     }
+  }
+
+  inline void processInPlace(DSPVector& v) { process(v, v); }
+
+  inline DSPVector operator()(const DSPVector vx)
+  {
+    DSPVector vy;
+    process(vx, vy);
     return vy;
   }
 };
@@ -514,9 +1233,8 @@ class Peak
 
   static _coeffs passthru() { return {1.f, 0.f}; }
 
-  inline DSPVector operator()(const DSPVector vx)
+  inline void process(const DSPVector& vx, DSPVector& vy)
   {
-    DSPVector vy;
     DSPVector vxSquared = vx * vx;
     for (int n = 0; n < kFloatsPerDSPVector; ++n)
     {
@@ -541,10 +1259,18 @@ class Peak
     {
       peakHoldCounter -= kFloatsPerDSPVector;
     }
-    
+
     // use sqrt approximation. Return 0 for inputs near 0.
-    return select(sqrtApprox(vy), DSPVector{0.f}, greaterThan(vy, DSPVector{float(1e-20)}));
+    vy = select(sqrtApprox(vy), DSPVector{0.f}, greaterThan(vy, DSPVector{float(1e-20)}));
+  }
+
+  inline void processInPlace(DSPVector& v) { process(v, v); }
 
+  inline DSPVector operator()(const DSPVector vx)
+  {
+    DSPVector vy;
+    process(vx, vy);
+    return vy;
   }
 };
 
@@ -570,9 +1296,8 @@ class RMS
 
   static _coeffs passthru() { return {1.f, 0.f}; }
 
-  inline DSPVector operator()(const DSPVector vx)
+  inline void process(const DSPVector& vx, DSPVector& vy)
   {
-    DSPVector vy;
     DSPVector vxSquared = vx * vx;
 
     for (int n = 0; n < kFloatsPerDSPVector; ++n)
@@ -582,106 +1307,235 @@ class RMS
     }
 
     // use sqrt approximation. Return 0 for inputs near 0.
-    return select(sqrtApprox(vy), DSPVector{0.f}, greaterThan(vy, DSPVector{float(1e-20)}));
+    vy = select(sqrtApprox(vy), DSPVector{0.f}, greaterThan(vy, DSPVector{float(1e-20)}));
+  }
+
+  inline void processInPlace(DSPVector& v) { process(v, v); }
+
+  inline DSPVector operator()(const DSPVector vx)
+  {
+    DSPVector vy;
+    process(vx, vy);
+    return vy;
+  }
+};
+
+// SilenceDetector: returns true once its input has stayed below a threshold
+// for a hold time. A voice whose output is silent can be made inactive in a
+// RowMask, so that a masked Bank stops running its processors.
+
+class SilenceDetector
+{
+  int silentSamples{0};
+
+ public:
+  // -100 dB.
+  float threshold{1e-5f};
+  int holdSamples{4410};
+
+  inline bool process(const DSPVector& vx)
+  {
+    if (max(abs(vx)) > threshold)
+    {
+      silentSamples = 0;
+    }
+    else if (silentSamples < holdSamples)
+    {
+      silentSamples += kFloatsPerDSPVector;
+    }
+    return silentSamples >= holdSamples;
   }
+
+  inline bool operator()(const DSPVector& vx) { return process(vx); }
+
+  inline void clear() { silentSamples = 0; }
 };
 
+// the index of each lane of a SIMD vector.
+inline SIMDVectorInt vecLaneIndex()
+{
+  return vecFloatToIntTruncate(vecLoad(DSPVector(columnIndex()).getConstBuffer()));
+}
+
+// write a DSPVector to the delay ring buffer pBuf of length lengthMask + 1,
+// starting at writeIndex and wrapping around the end of the buffer. The
+// samples are stored as type T.
+template <typename T>
+inline void writeToRingBuffer(const DSPVector& vx, T* pBuf, uintptr_t writeIndex,
+                              uintptr_t lengthMask)
+{
+  const float* px = vx.getConstBuffer();
+  uintptr_t writeEnd = writeIndex + kFloatsPerDSPVector;
+  if (writeEnd <= lengthMask + 1)
+  {
+    packSamples(px, pBuf + writeIndex, kFloatsPerDSPVector);
+  }
+  else
+  {
+    uintptr_t excess = writeEnd - lengthMask - 1;
+    packSamples(px, pBuf + writeIndex, kFloatsPerDSPVector - excess);
+    packSamples(px + kFloatsPerDSPVector - excess, pBuf, excess);
+  }
+}
+
+// read a DSPVector from the ring buffer pBuf of length lengthMask + 1, with a
+// delay from writeIndex for each sample, interpolating linearly between
+// neighboring samples and scaling by the gain. Delays must not be negative.
+inline void readFromRingBufferLinear(const float* pBuf, uintptr_t writeIndex,
+                                     uintptr_t lengthMask, const float* pDelay, float gain,
+                                     float* py)
+{
+  constexpr int kLanes = kFloatsPerSIMDVector;
+  const SIMDVectorInt vMask = vecSet1Int(static_cast<int>(lengthMask));
+  const SIMDVectorInt vOne = vecSet1Int(1);
+  const SIMDVectorFloat vGain = vecSet1(gain);
+  SIMDVectorInt vIndex = vecAddInt(vecSet1Int(static_cast<int>(writeIndex)), vecLaneIndex());
+  const SIMDVectorInt vStep = vecSet1Int(kLanes);
+  for (int n = 0; n < kFloatsPerDSPVector; n += kLanes)
+  {
+    // delays are not negative, so truncating gives the whole part.
+    SIMDVectorFloat d = vecLoad(pDelay + n);
+    SIMDVectorInt dInt = vecFloatToIntTruncate(d);
+    SIMDVectorFloat a = vecSub(d, vecIntToFloat(dInt));
+    SIMDVectorInt i0 = vecAndInt(vecSubInt(vIndex, dInt), vMask);
+    SIMDVectorInt i1 = vecAndInt(vecSubInt(i0, vOne), vMask);
+    SIMDVectorFloat x0 = vecGather(pBuf, i0);
+    SIMDVectorFloat x1 = vecGather(pBuf, i1);
+    vecStore(py + n, vecMul(vGain, vecAdd(x0, vecMul(a, vecSub(x1, x0)))));
+    vIndex = vecAddInt(vIndex, vStep);
+  }
+}
+
 // IntegerDelay delays a signal a whole number of samples.
+//
+// The delay memory stores samples as type T, one of the formats in
+// MLDSPSampleFormats.h. IntegerDelay stores floats, IntegerDelayHalf and
+// IntegerDelayInt16 store 16-bit samples, halving the memory and bandwidth
+// used by long delays at the cost of precision.
 
-class IntegerDelay
+template <typename T>
+class IntegerDelayT
 {
-  std::vector<float> mBuffer;
+  DelayMemory<T> mBuffer;
   int mIntDelayInSamples{0};
   uintptr_t mWriteIndex{0};
   uintptr_t mLengthMask{0};
 
+  // write a vector at the write index, without updating it.
+  inline void write(const DSPVector& vx)
+  {
+    writeToRingBuffer(vx, mBuffer.data(), mWriteIndex, mLengthMask);
+  }
+
+  // read each sample at its own delay. Float samples are read with SIMD
+  // gathers, other formats one at a time.
+  inline void readModulated(const float* pBuf, const DSPVector& delay, DSPVector& y)
+  {
+    const SIMDVectorInt vMask = vecSet1Int(static_cast<int>(mLengthMask));
+    const SIMDVectorInt vStep = vecSet1Int(kFloatsPerSIMDVector);
+    SIMDVectorInt vIndex = vecAddInt(vecSet1Int(static_cast<int>(mWriteIndex)), vecLaneIndex());
+    const float* pDelay = delay.getConstBuffer();
+    float* py = y.getBuffer();
+    for (int n = 0; n < kFloatsPerDSPVector; n += kFloatsPerSIMDVector)
+    {
+      SIMDVectorInt dInt = vecFloatToIntTruncate(vecLoad(pDelay + n));
+      SIMDVectorInt i = vecAndInt(vecSubInt(vIndex, dInt), vMask);
+      vecStore(py + n, vecGather(pBuf, i));
+      vIndex = vecAddInt(vIndex, vStep);
+    }
+  }
+
+  template <typename U>
+  inline void readModulated(const U* pBuf, const DSPVector& delay, DSPVector& y)
+  {
+    const DSPVectorInt vDelayInt = truncateFloatToInt(delay);
+    for (int n = 0; n < kFloatsPerDSPVector; ++n)
+    {
+      uintptr_t readIndex = (mWriteIndex + n - vDelayInt[n]) & mLengthMask;
+      y[n] = unpackSample(pBuf[readIndex]);
+    }
+  }
+
  public:
-  IntegerDelay() = default;
-  IntegerDelay(int d)
+  IntegerDelayT() = default;
+  IntegerDelayT(int d)
   {
     setMaxDelayInSamples(static_cast<float>(d));
     setDelayInSamples(d);
   }
-  ~IntegerDelay() = default;
+  ~IntegerDelayT() = default;
 
   // for efficiency, no bounds checking is done. Because mLengthMask is used to
   // constrain all reads, bad values here may make bad sounds (buffer wraps) but
   // will not attempt to read from outside the buffer.
   inline void setDelayInSamples(int d) { mIntDelayInSamples = d; }
 
-  void setMaxDelayInSamples(float d)
+  // allocate memory for delays up to d samples, from the arena if one is given.
+  void setMaxDelayInSamples(float d, DelayArena* pArena = nullptr)
   {
     int dMax = static_cast<int>(floorf(d));
     int newSize = 1 << bitsToContain(dMax + kFloatsPerDSPVector);
-    mBuffer.resize(newSize);
+    mBuffer.allocate(newSize, pArena);
     mLengthMask = newSize - 1;
     mWriteIndex = 0;
     clear();
   }
 
-  inline void clear() { std::fill(mBuffer.begin(), mBuffer.end(), 0.f); }
+  inline void clear() { mBuffer.clear(); }
 
-  inline DSPVector operator()(const DSPVector vx)
+  // the input is written to the delay before the output is read, so vx and vy
+  // can be the same.
+  inline void process(const DSPVector& vx, DSPVector& vy)
   {
-    // write
-    uintptr_t writeEnd = mWriteIndex + kFloatsPerDSPVector;
-    if (writeEnd <= mLengthMask + 1)
-    {
-      const float* srcStart = vx.getConstBuffer();
-      std::copy(srcStart, srcStart + kFloatsPerDSPVector, mBuffer.data() + mWriteIndex);
-    }
-    else
-    {
-      uintptr_t excess = writeEnd - mLengthMask - 1;
-      const float* srcStart = vx.getConstBuffer();
-      const float* srcSplice = srcStart + kFloatsPerDSPVector - excess;
-      const float* srcEnd = srcStart + kFloatsPerDSPVector;
-      std::copy(srcStart, srcSplice, mBuffer.data() + mWriteIndex);
-      std::copy(srcSplice, srcEnd, mBuffer.data());
-    }
+    write(vx);
 
     // read
-    DSPVector vy;
     uintptr_t readStart = (mWriteIndex - mIntDelayInSamples) & mLengthMask;
     uintptr_t readEnd = readStart + kFloatsPerDSPVector;
-    float* srcBuf = mBuffer.data();
+    const T* srcBuf = mBuffer.data();
     if (readEnd <= mLengthMask + 1)
     {
-      std::copy(srcBuf + readStart, srcBuf + readEnd, vy.getBuffer());
+      unpackSamples(srcBuf + readStart, vy.getBuffer(), kFloatsPerDSPVector);
     }
     else
     {
       uintptr_t excess = readEnd - mLengthMask - 1;
-      uintptr_t readSplice = readStart + kFloatsPerDSPVector - excess;
       float* pDest = vy.getBuffer();
-      std::copy(srcBuf + readStart, srcBuf + readSplice, pDest);
-      std::copy(srcBuf, srcBuf + excess, pDest + (kFloatsPerDSPVector - excess));
+      unpackSamples(srcBuf + readStart, pDest, kFloatsPerDSPVector - excess);
+      unpackSamples(srcBuf, pDest + (kFloatsPerDSPVector - excess), excess);
     }
 
     // update index
     mWriteIndex += kFloatsPerDSPVector;
     mWriteIndex &= mLengthMask;
-    return vy;
   }
 
-  inline DSPVector operator()(const DSPVector x, const DSPVector delay)
-  {
-    DSPVector y;
+  inline void processInPlace(DSPVector& v) { process(v, v); }
 
-    for (int n = 0; n < kFloatsPerDSPVector; ++n)
-    {
-      // write
-      mBuffer[mWriteIndex] = x[n];
+  inline DSPVector operator()(const DSPVector vx)
+  {
+    DSPVector vy;
+    process(vx, vy);
+    return vy;
+  }
 
-      // read
-      mIntDelayInSamples = static_cast<int>(delay[n]);
-      uintptr_t readIndex = (mWriteIndex - mIntDelayInSamples) & mLengthMask;
+  // read each sample at its own delay. The whole vector is written first, so
+  // the delays must not be negative.
+  inline void process(const DSPVector& x, const DSPVector& delay, DSPVector& y)
+  {
+    write(x);
+    const int lastDelay = static_cast<int>(delay[kFloatsPerDSPVector - 1]);
+    readModulated(mBuffer.data(), delay, y);
+    mIntDelayInSamples = lastDelay;
 
-      y[n] = mBuffer[readIndex];
-      mWriteIndex++;
-      mWriteIndex &= mLengthMask;
-    }
+    mWriteIndex += kFloatsPerDSPVector;
+    mWriteIndex &= mLengthMask;
+  }
 
+  inline DSPVector operator()(const DSPVector x, const DSPVector delay)
+  {
+    DSPVector y;
+    process(x, delay, y);
     return y;
   }
 
@@ -690,11 +1544,11 @@ class IntegerDelay
     // write
     // note that, for performance, there is no bounds checking. If you crash
     // here, you probably didn't allocate enough delay memory.
-    mBuffer[mWriteIndex] = x;
+    packSample(x, mBuffer[mWriteIndex]);
 
     // read
     uintptr_t readIndex = (mWriteIndex - mIntDelayInSamples) & mLengthMask;
-    float y = mBuffer[readIndex];
+    float y = unpackSample(mBuffer[readIndex]);
 
     // update index
     mWriteIndex++;
@@ -703,6 +1557,144 @@ class IntegerDelay
   }
 };
 
+typedef IntegerDelayT<float> IntegerDelay;
+typedef IntegerDelayT<Float16> IntegerDelayHalf;
+typedef IntegerDelayT<int16_t> IntegerDelayInt16;
+
+// MultiTapDelay<TAPS>: a delay line read by TAPS taps. The input is written
+// once to a ring buffer that all the taps share, so the memory used depends
+// only on the longest delay and not on the number of taps. Each tap has a
+// delay time in samples, which may be fractional, and a gain, and the taps are
+// returned as the rows of a DSPVectorArray.
+//
+// Taps with fractional delays are read with linear interpolation. With
+// constant delays set by setDelaysInSamples(), each tap is read as a block. The
+// process() methods with a DSPVectorArray of delays take a delay for each tap
+// and sample, and read the taps with SIMD gathers. As with IntegerDelay, the
+// input is written before the taps are read, so the minimum delay is 0.
+
+template <size_t TAPS>
+class MultiTapDelay
+{
+  static constexpr int kLanes = kFloatsPerSIMDVector;
+
+  DelayMemory<float> mBuffer;
+  std::array<float, TAPS> mDelays{};
+  uintptr_t mWriteIndex{0};
+  uintptr_t mLengthMask{0};
+
+  inline void write(const DSPVector& vx)
+  {
+    writeToRingBuffer(vx, mBuffer.data(), mWriteIndex, mLengthMask);
+  }
+
+  // read one tap with a constant delay d, scaled by the gain.
+  inline void readConstant(float d, float gain, float* py)
+  {
+    // copy the samples at delay d and the one before the first, then
+    // interpolate between neighbors.
+    const int dInt = static_cast<int>(d);
+    const float a = d - dInt;
+    float x[kFloatsPerDSPVector + kLanes];
+    uintptr_t readStart = (mWriteIndex - dInt - 1) & mLengthMask;
+    uintptr_t readEnd = readStart + kFloatsPerDSPVector + 1;
+    if (readEnd <= mLengthMask + 1)
+    {
+      std::copy(mBuffer.data() + readStart, mBuffer.data() + readEnd, x);
+    }
+    else
+    {
+      uintptr_t excess = readEnd - mLengthMask - 1;
+      std::copy(mBuffer.data() + readStart, mBuffer.data() + mLengthMask + 1, x);
+      std::copy(mBuffer.data(), mBuffer.data() + excess, x + kFloatsPerDSPVector + 1 - excess);
+    }
+
+    const SIMDVectorFloat vA = vecSet1(a);
+    const SIMDVectorFloat vGain = vecSet1(gain);
+    for (int n = 0; n < kFloatsPerDSPVector; n += kLanes)
+    {
+      SIMDVectorFloat x1 = vecLoadUnaligned(x + n);
+      SIMDVectorFloat x0 = vecLoadUnaligned(x + n + 1);
+      vecStore(py + n, vecMul(vGain, vecAdd(x0, vecMul(vA, vecSub(x1, x0)))));
+    }
+  }
+
+  // read one tap with a delay for each sample, scaled by the gain.
+  inline void readModulated(const float* pDelay, float gain, float* py)
+  {
+    readFromRingBufferLinear(mBuffer.data(), mWriteIndex, mLengthMask, pDelay, gain, py);
+  }
+
+ public:
+  // tap gains are public—just copy values to set.
+  std::array<float, TAPS> mGains;
+
+  MultiTapDelay()
+  {
+    mGains.fill(1.f);
+    setMaxDelayInSamples(0.f);
+  }
+  MultiTapDelay(float maxDelay)
+  {
+    mGains.fill(1.f);
+    setMaxDelayInSamples(maxDelay);
+  }
+  ~MultiTapDelay() = default;
+
+  void setMaxDelayInSamples(float d, DelayArena* pArena = nullptr)
+  {
+    int dMax = static_cast<int>(ceilf(d));
+    int newSize = 1 << bitsToContain(dMax + kFloatsPerDSPVector + 1);
+    mBuffer.allocate(newSize, pArena);
+    mLengthMask = newSize - 1;
+    mWriteIndex = 0;
+    clear();
+  }
+
+  // for efficiency, no bounds checking is done: delays must be in the range
+  // [0, max delay].
+  void setDelaysInSamples(const std::array<float, TAPS>& delays) { mDelays = delays; }
+
+  inline void clear() { mBuffer.clear(); }
+
+  // read the taps at the delays from setDelaysInSamples().
+  inline void process(const DSPVector& vx, DSPVectorArray<TAPS>& vy)
+  {
+    write(vx);
+    for (size_t t = 0; t < TAPS; ++t)
+    {
+      readConstant(mDelays[t], mGains[t], vy.row(t).getBuffer());
+    }
+    mWriteIndex = (mWriteIndex + kFloatsPerDSPVector) & mLengthMask;
+  }
+
+  inline DSPVectorArray<TAPS> operator()(const DSPVector vx)
+  {
+    DSPVectorArray<TAPS> vy;
+    process(vx, vy);
+    return vy;
+  }
+
+  // read each tap at the delays in the corresponding row of vDelays.
+  inline void process(const DSPVector& vx, const DSPVectorArray<TAPS>& vDelays,
+                      DSPVectorArray<TAPS>& vy)
+  {
+    write(vx);
+    for (size_t t = 0; t < TAPS; ++t)
+    {
+      readModulated(vDelays.constRow(t).getConstBuffer(), mGains[t], vy.row(t).getBuffer());
+    }
+    mWriteIndex = (mWriteIndex + kFloatsPerDSPVector) & mLengthMask;
+  }
+
+  inline DSPVectorArray<TAPS> operator()(const DSPVector vx, const DSPVectorArray<TAPS>& vDelays)
+  {
+    DSPVectorArray<TAPS> vy;
+    process(vx, vDelays, vy);
+    return vy;
+  }
+};
+
 // First order allpass section with a single sample of delay.
 
 class Allpass1
@@ -732,6 +1724,23 @@ class Allpass1
     return -0.53f * xm1 + 0.24f * xm1 * xm1;
   }
 
+  // split a delay time d into a whole number of samples, which is returned,
+  // and a fraction, which sets the allpass coefficient a. The fraction is
+  // kept in [0.618 - 1.618] if possible.
+  static int splitDelay(float d, float& a)
+  {
+    float fDelayInt = floorf(d);
+    int delayInt = static_cast<int>(fDelayInt);
+    float delayFrac = d - fDelayInt;
+    if ((delayFrac < 0.618f) && (delayInt > 0))
+    {
+      delayFrac += 1.f;
+      delayInt -= 1;
+    }
+    a = coeffs(delayFrac);
+    return delayInt;
+  }
+
   inline float processSample(const float x)
   {
     // one-multiply form. see
@@ -742,13 +1751,20 @@ class Allpass1
     return y;
   }
 
-  inline DSPVector operator()(const DSPVector vx)
+  inline void process(const DSPVector& vx, DSPVector& vy)
   {
-    DSPVector vy;
     for (int n = 0; n < kFloatsPerDSPVector; ++n)
     {
       vy[n] = processSample(vx[n]);
     }
+  }
+
+  inline void processInPlace(DSPVector& v) { process(v, v); }
+
+  inline DSPVector operator()(const DSPVector vx)
+  {
+    DSPVector vy;
+    process(vx, vy);
     return vy;
   }
 };
@@ -782,57 +1798,385 @@ class FractionalDelay
   inline void setDelayInSamples(float d)
   {
     mDelayInSamples = d;
-    float fDelayInt = floorf(d);
-    int delayInt = static_cast<int>(fDelayInt);
-    float delayFrac = d - fDelayInt;
-
-    // constrain D to [0.618 - 1.618] if possible
-    if ((delayFrac < 0.618f) && (delayInt > 0))
-    {
-      delayFrac += 1.f;
-      delayInt -= 1;
-    }
-    mIntegerDelay.setDelayInSamples(delayInt);
-    mAllpassSection.mCoeffs = Allpass1::coeffs(delayFrac);
+    mIntegerDelay.setDelayInSamples(Allpass1::splitDelay(d, mAllpassSection.mCoeffs));
   }
 
-  inline void setMaxDelayInSamples(float d) { mIntegerDelay.setMaxDelayInSamples(floorf(d)); }
+  inline void setMaxDelayInSamples(float d, DelayArena* pArena = nullptr)
+  {
+    mIntegerDelay.setMaxDelayInSamples(floorf(d), pArena);
+  }
 
-  // return the input signal, delayed by the constant delay time
+  // output the input signal, delayed by the constant delay time
   // mDelayInSamples.
-  inline DSPVector operator()(const DSPVector vx) { return mAllpassSection(mIntegerDelay(vx)); }
+  inline void process(const DSPVector& vx, DSPVector& vy)
+  {
+    mIntegerDelay.process(vx, vy);
+    mAllpassSection.processInPlace(vy);
+  }
 
-  // return the input signal, delayed by the varying delay time vDelayInSamples.
-  inline DSPVector operator()(const DSPVector vx, const DSPVector vDelayInSamples)
+  inline void processInPlace(DSPVector& v) { process(v, v); }
+
+  inline DSPVector operator()(const DSPVector vx)
   {
     DSPVector vy;
+    process(vx, vy);
+    return vy;
+  }
+
+  // output the input signal, delayed by the varying delay time vDelayInSamples.
+  inline void process(const DSPVector& vx, const DSPVector& vDelayInSamples, DSPVector& vy)
+  {
     for (int n = 0; n < kFloatsPerDSPVector; ++n)
     {
       setDelayInSamples(vDelayInSamples[n]);
       vy[n] = mAllpassSection.processSample(mIntegerDelay.processSample(vx[n]));
     }
+  }
+
+  inline DSPVector operator()(const DSPVector vx, const DSPVector vDelayInSamples)
+  {
+    DSPVector vy;
+    process(vx, vDelayInSamples, vy);
+    return vy;
+  }
+
+  // output the input signal, delayed by the varying delay time vDelayInSamples,
+  // but only allow changes to the delay time when vChangeTicks is nonzero.
+  inline void process(const DSPVector& vx, const DSPVector& vDelayInSamples,
+                      const DSPVectorInt& vChangeTicks, DSPVector& vy)
+  {
+    for (int n = 0; n < kFloatsPerDSPVector; ++n)
+    {
+      if (vChangeTicks[n] != 0)
+      {
+        setDelayInSamples(vDelayInSamples[n]);
+      }
+
+      vy[n] = mAllpassSection.processSample(mIntegerDelay.processSample(vx[n]));
+    }
+  }
+
+  inline DSPVector operator()(const DSPVector vx, const DSPVector vDelayInSamples,
+                              const DSPVectorInt vChangeTicks)
+  {
+    DSPVector vy;
+    process(vx, vDelayInSamples, vChangeTicks, vy);
+    return vy;
+  }
+};
+
+// FractionalDelayT<INTERPOLATION>: a delay line with a fractional delay time
+// that can change every sample, read with one of the interpolations below.
+//
+// The FIR interpolations, LinearInterpolation, LagrangeInterpolation and
+// SincInterpolation, are not recursive, so the delay can be modulated freely.
+// They compute a whole DSPVector of read positions with SIMD math and read
+// the delay memory with SIMD gathers. ThiranInterpolation is a 4th order
+// allpass filter with maximally flat group delay, which is more accurate than
+// Lagrange interpolation at high frequencies with constant delays, but like
+// Allpass1 it is recursive: changing the delay makes transients, and a large
+// one each time the delay crosses a whole number of samples. It is best used
+// with constant delays.
+//
+// Each interpolation reads samples a little newer than the delay time, so it
+// has a minimum delay kMinDelay. Shorter delays are clamped to it.
+
+// FIRInterpolation<KERNEL>: reads a DSPVector of delayed samples from a ring
+// buffer. For each SIMD vector of delays, KERNEL::read() is given the indices
+// i0 of the samples at the whole parts of the delays and the fractional parts
+// a, and returns the interpolated samples.
+template <typename KERNEL>
+struct FIRInterpolation
+{
+  void clear() {}
+
+  inline void process(const float* pBuf, uintptr_t lengthMask, uintptr_t writeIndex,
+                      const float* pDelay, float* py)
+  {
+    const SIMDVectorInt vMask = vecSet1Int(static_cast<int>(lengthMask));
+    const SIMDVectorFloat vMinDelay = vecSet1(KERNEL::kMinDelay);
+    const SIMDVectorInt vStep = vecSet1Int(kFloatsPerSIMDVector);
+    SIMDVectorInt vIndex = vecAddInt(vecSet1Int(static_cast<int>(writeIndex)), vecLaneIndex());
+    for (int n = 0; n < kFloatsPerDSPVector; n += kFloatsPerSIMDVector)
+    {
+      SIMDVectorFloat d = vecMax(vecLoad(pDelay + n), vMinDelay);
+      SIMDVectorInt dInt = vecFloatToIntTruncate(d);
+      SIMDVectorFloat a = vecSub(d, vecIntToFloat(dInt));
+      SIMDVectorInt i0 = vecAndInt(vecSubInt(vIndex, dInt), vMask);
+      vecStore(py + n, KERNEL::read(pBuf, i0, vMask, a));
+      vIndex = vecAddInt(vIndex, vStep);
+    }
+  }
+
+  // the sample k steps newer than i0.
+  static inline SIMDVectorFloat tap(const float* pBuf, SIMDVectorInt i0, SIMDVectorInt mask,
+                                    int k)
+  {
+    return vecGather(pBuf, vecAndInt(vecAddInt(i0, vecSet1Int(k)), mask));
+  }
+};
+
+// linear interpolation between the two samples around the delay.
+struct LinearInterpolation : FIRInterpolation<LinearInterpolation>
+{
+  static constexpr float kMinDelay{0.f};
+
+  static inline SIMDVectorFloat read(const float* pBuf, SIMDVectorInt i0, SIMDVectorInt mask,
+                                     SIMDVectorFloat a)
+  {
+    SIMDVectorFloat x0 = vecGather(pBuf, i0);
+    SIMDVectorFloat x1 = tap(pBuf, i0, mask, -1);
+    return vecAdd(x0, vecMul(a, vecSub(x1, x0)));
+  }
+};
+
+// third order Lagrange interpolation over four samples, with the delay
+// between the middle two.
+struct LagrangeInterpolation : FIRInterpolation<LagrangeInterpolation>
+{
+  static constexpr float kMinDelay{1.f};
+
+  static inline SIMDVectorFloat read(const float* pBuf, SIMDVectorInt i0, SIMDVectorInt mask,
+                                     SIMDVectorFloat a)
+  {
+    SIMDVectorFloat xm1 = tap(pBuf, i0, mask, 1);
+    SIMDVectorFloat x0 = vecGather(pBuf, i0);
+    SIMDVectorFloat x1 = tap(pBuf, i0, mask, -1);
+    SIMDVectorFloat x2 = tap(pBuf, i0, mask, -2);
+
+    // the coefficients for a delay of 1 + a from the newest sample.
+    const SIMDVectorFloat one = vecSet1(1.f);
+    SIMDVectorFloat ap1 = vecAdd(a, one);
+    SIMDVectorFloat am1 = vecSub(a, one);
+    SIMDVectorFloat am2 = vecSub(am1, one);
+    SIMDVectorFloat aam1 = vecMul(a, am1);
+    SIMDVectorFloat ap1am2 = vecMul(ap1, am2);
+    SIMDVectorFloat hm1 = vecMul(vecSet1(-1.f / 6.f), vecMul(aam1, am2));
+    SIMDVectorFloat h0 = vecMul(vecSet1(0.5f), vecMul(ap1am2, am1));
+    SIMDVectorFloat h1 = vecMul(vecSet1(-0.5f), vecMul(ap1am2, a));
+    SIMDVectorFloat h2 = vecMul(vecSet1(1.f / 6.f), vecMul(aam1, ap1));
+    return vecAdd(vecAdd(vecMul(hm1, xm1), vecMul(h0, x0)),
+                  vecAdd(vecMul(h1, x1), vecMul(h2, x2)));
+  }
+};
+
+// an 8 point windowed sinc interpolator, with its coefficients looked up in a
+// table of kPhases fractional delays and interpolated linearly.
+struct SincInterpolation : FIRInterpolation<SincInterpolation>
+{
+  static constexpr float kMinDelay{3.f};
+  static constexpr int kTapsBits = 3;
+  static constexpr int kTaps = 1 << kTapsBits;
+  static constexpr int kPhases = 256;
+
+  // the table has a row of kTaps coefficients for each phase from 0 to
+  // kPhases inclusive, for taps 3 samples newer to 4 samples older than i0.
+  static const float* table()
+  {
+    static const std::vector<float> t = [] {
+      std::vector<float> rows((kPhases + 1) * kTaps);
+      for (int p = 0; p <= kPhases; ++p)
+      {
+        float* row = rows.data() + p * kTaps;
+        double sum = 0.;
+        for (int k = 0; k < kTaps; ++k)
+        {
+          // a Blackman window over the 8 points.
+          const double x = k - 3 - static_cast<double>(p) / kPhases;
+          const double w = 0.42 + 0.5 * std::cos(kPiD * x / 4.) + 0.08 * std::cos(kTwoPiD * x / 4.);
+          const double sinc = (x == 0.) ? 1. : std::sin(kPiD * x) / (kPiD * x);
+          row[k] = static_cast<float>(sinc * w);
+          sum += row[k];
+        }
+
+        // normalize each phase to unity gain at DC.
+        for (int k = 0; k < kTaps; ++k)
+        {
+          row[k] = static_cast<float>(row[k] / sum);
+        }
+      }
+      return rows;
+    }();
+    return t.data();
+  }
+
+  static inline SIMDVectorFloat read(const float* pBuf, SIMDVectorInt i0, SIMDVectorInt mask,
+                                     SIMDVectorFloat a)
+  {
+    // a is less than 1, so the phase is less than kPhases.
+    SIMDVectorFloat phase = vecMul(a, vecSet1(static_cast<float>(kPhases)));
+    SIMDVectorInt p = vecFloatToIntTruncate(phase);
+    SIMDVectorFloat f = vecSub(phase, vecIntToFloat(p));
+    SIMDVectorInt rowIndex = vecShiftLeftInt(p, kTapsBits);
+    const float* pTable = table();
+
+    SIMDVectorFloat sum = vecZeros();
+    for (int k = 0; k < kTaps; ++k)
+    {
+      SIMDVectorFloat c0 = vecGather(pTable + k, rowIndex);
+      SIMDVectorFloat c1 = vecGather(pTable + kTaps + k, rowIndex);
+      SIMDVectorFloat c = vecAdd(c0, vecMul(f, vecSub(c1, c0)));
+      sum = vecAdd(sum, vecMul(c, tap(pBuf, i0, mask, 3 - k)));
+    }
+    return sum;
+  }
+};
+
+// a 4th order Thiran allpass interpolator. The delay is split into a whole
+// number of samples read from the delay memory and a delay D in [3.5, 4.5)
+// made by the allpass, which keeps it stable and close to flat. Coefficients
+// are computed again whenever the delay changes.
+class ThiranInterpolation
+{
+  static constexpr int kOrder = 4;
+  std::array<float, kOrder + 1> mCoeffs{{1.f, 0.f, 0.f, 0.f, 0.f}};
+  std::array<float, kOrder> mX{}, mY{};
+  float mD{4.f};
+
+  void setAllpassDelay(float D)
+  {
+    mD = D;
+    for (int k = 1; k <= kOrder; ++k)
+    {
+      // a_k = (-1)^k C(N, k) prod_{i=0}^{N} (D - N + i) / (D - N + k + i)
+      double binomial = 1.;
+      for (int i = 0; i < k; ++i)
+      {
+        binomial = binomial * (kOrder - i) / (i + 1);
+      }
+      double a = (k & 1) ? -binomial : binomial;
+      for (int i = 0; i <= kOrder; ++i)
+      {
+        a *= (D - kOrder + i) / (D - kOrder + k + i);
+      }
+      mCoeffs[k] = static_cast<float>(a);
+    }
+  }
+
+ public:
+  static constexpr float kMinDelay{3.5f};
+
+  void clear()
+  {
+    mX.fill(0.f);
+    mY.fill(0.f);
+  }
+
+  inline void process(const float* pBuf, uintptr_t lengthMask, uintptr_t writeIndex,
+                      const float* pDelay, float* py)
+  {
+    float x1 = mX[0], x2 = mX[1], x3 = mX[2], x4 = mX[3];
+    float y1 = mY[0], y2 = mY[1], y3 = mY[2], y4 = mY[3];
+    for (int n = 0; n < kFloatsPerDSPVector; ++n)
+    {
+      const float d = std::max(pDelay[n], kMinDelay + 0.f) - kMinDelay;
+      const int m = static_cast<int>(d);
+      const float D = kMinDelay + (d - m);
+      if (D != mD) setAllpassDelay(D);
+
+      const auto& a = mCoeffs;
+      const float x = pBuf[(writeIndex + n - m) & lengthMask];
+      // subtract the most recent output last, to shorten the recurrence.
+      const float ff = a[4] * x + a[3] * x1 + a[2] * x2 + a[1] * x3 + x4;
+      const float y = ff - a[4] * y4 - a[3] * y3 - a[2] * y2 - a[1] * y1;
+      x4 = x3;
+      x3 = x2;
+      x2 = x1;
+      x1 = x;
+      y4 = y3;
+      y3 = y2;
+      y2 = y1;
+      y1 = y;
+      py[n] = y;
+    }
+    mX = {{x1, x2, x3, x4}};
+    mY = {{y1, y2, y3, y4}};
+  }
+};
+
+template <typename INTERPOLATION>
+class FractionalDelayT
+{
+  DelayMemory<float> mBuffer;
+  uintptr_t mWriteIndex{0};
+  uintptr_t mLengthMask{0};
+  float mDelayInSamples{0.f};
+  INTERPOLATION mInterpolation;
+
+  inline void write(const DSPVector& vx)
+  {
+    writeToRingBuffer(vx, mBuffer.data(), mWriteIndex, mLengthMask);
+  }
+
+ public:
+  FractionalDelayT() { setMaxDelayInSamples(0.f); }
+  FractionalDelayT(float d)
+  {
+    setMaxDelayInSamples(d);
+    setDelayInSamples(d);
+  }
+  ~FractionalDelayT() = default;
+
+  inline void clear()
+  {
+    mBuffer.clear();
+    mInterpolation.clear();
+  }
+
+  // set the constant delay time used by process(vx, vy).
+  inline void setDelayInSamples(float d) { mDelayInSamples = d; }
+
+  void setMaxDelayInSamples(float d, DelayArena* pArena = nullptr)
+  {
+    // room for the oldest sample any interpolation reads.
+    int dMax = static_cast<int>(ceilf(d));
+    int newSize = 1 << bitsToContain(dMax + kFloatsPerDSPVector + 8);
+    mBuffer.allocate(newSize, pArena);
+    mLengthMask = newSize - 1;
+    mWriteIndex = 0;
+    clear();
+  }
+
+  // output the input signal, delayed by the constant delay time
+  // mDelayInSamples.
+  inline void process(const DSPVector& vx, DSPVector& vy)
+  {
+    process(vx, DSPVector(mDelayInSamples), vy);
+  }
+
+  inline void processInPlace(DSPVector& v) { process(v, v); }
+
+  inline DSPVector operator()(const DSPVector vx)
+  {
+    DSPVector vy;
+    process(vx, vy);
     return vy;
   }
 
-  // return the input signal, delayed by the varying delay time vDelayInSamples,
-  // but only allow changes to the delay time when vChangeTicks is nonzero.
-  inline DSPVector operator()(const DSPVector vx, const DSPVector vDelayInSamples,
-                              const DSPVectorInt vChangeTicks)
+  // output the input signal, delayed by the varying delay time vDelayInSamples.
+  // The input is written before the output is read, so vx and vy can be the
+  // same.
+  inline void process(const DSPVector& vx, const DSPVector& vDelayInSamples, DSPVector& vy)
   {
-    DSPVector vy;
-    for (int n = 0; n < kFloatsPerDSPVector; ++n)
-    {
-      if (vChangeTicks[n] != 0)
-      {
-        setDelayInSamples(vDelayInSamples[n]);
-      }
+    write(vx);
+    mInterpolation.process(mBuffer.data(), mLengthMask, mWriteIndex,
+                           vDelayInSamples.getConstBuffer(), vy.getBuffer());
+    mWriteIndex = (mWriteIndex + kFloatsPerDSPVector) & mLengthMask;
+  }
 
-      vy[n] = mAllpassSection.processSample(mIntegerDelay.processSample(vx[n]));
-    }
+  inline DSPVector operator()(const DSPVector vx, const DSPVector vDelayInSamples)
+  {
+    DSPVector vy;
+    process(vx, vDelayInSamples, vy);
     return vy;
   }
 };
 
+typedef FractionalDelayT<LinearInterpolation> FractionalDelayLinear;
+typedef FractionalDelayT<LagrangeInterpolation> FractionalDelayLagrange;
+typedef FractionalDelayT<SincInterpolation> FractionalDelaySinc;
+typedef FractionalDelayT<ThiranInterpolation> FractionalDelayThiran;
+
 // Crossfading two allpass-interpolated delays allows modulating the delay
 // time without clicks. See "A Lossless, Click-free, Pitchbend-able Delay Line
 // Loop Interpolation Scheme", Van Duyne, Jaffe, Scandalis, Stilson, ICMC 1997.
@@ -841,7 +2185,7 @@ namespace PitchbendableDelayConsts
 {
 // period in samples of allpass fade cycle. must be a power of 2 less than or
 // equal to kFloatsPerDSPVector. 32 sounds good.
-constexpr int kFadePeriod{32};
+constexpr int kFadePeriod{kFloatsPerDSPVector < 32 ? kFloatsPerDSPVector : 32};
 constexpr int fadeRamp(int n) { return n % kFadePeriod; }
 constexpr int ticks1(int n) { return fadeRamp(n) == kFadePeriod / 2; }
 constexpr int ticks2(int n) { return fadeRamp(n) == 0; }
@@ -866,32 +2210,79 @@ constexpr DSPVectorInt kvDelay2Changes(ticks2);
 constexpr DSPVector kvFade(fadeFn);
 };  // namespace PitchbendableDelayConsts
 
+// The two allpass-interpolated delays share one delay memory, which is written
+// once and read at two positions. Each read head has its own delay time and
+// Allpass1 section.
+
 class PitchbendableDelay
 {
-  FractionalDelay mDelay1, mDelay2;
+  struct ReadHead
+  {
+    int mDelayInt{0};
+    Allpass1 mAllpass;
+
+    // set the delay as FractionalDelay does.
+    inline void setDelayInSamples(float d)
+    {
+      mDelayInt = Allpass1::splitDelay(d, mAllpass.mCoeffs);
+    }
+  };
+
+  DelayMemory<float> mBuffer;
+  uintptr_t mWriteIndex{0};
+  uintptr_t mLengthMask{0};
+  ReadHead mHead1, mHead2;
 
  public:
-  PitchbendableDelay() = default;
+  PitchbendableDelay() { setMaxDelayInSamples(0.f); }
 
-  inline void setMaxDelayInSamples(float d)
+  inline void setMaxDelayInSamples(float d, DelayArena* pArena = nullptr)
   {
-    mDelay1.setMaxDelayInSamples(d);
-    mDelay2.setMaxDelayInSamples(d);
+    int dMax = static_cast<int>(floorf(d));
+    int newSize = 1 << bitsToContain(dMax + kFloatsPerDSPVector);
+    mBuffer.allocate(newSize, pArena);
+    mLengthMask = newSize - 1;
+    mWriteIndex = 0;
+    clear();
   }
 
   inline void clear()
   {
-    mDelay1.clear();
-    mDelay2.clear();
+    mBuffer.clear();
+    mHead1.mAllpass.clear();
+    mHead2.mAllpass.clear();
   }
 
-  inline DSPVector operator()(const DSPVector vInput, const DSPVector vDelayInSamples)
+  inline void process(const DSPVector& vInput, const DSPVector& vDelayInSamples,
+                      DSPVector& vOutput)
   {
     using namespace PitchbendableDelayConsts;
 
-    // run the fractional delays and crossfade the results.
-    return lerp(mDelay1(vInput, vDelayInSamples, kvDelay1Changes),
-                mDelay2(vInput, vDelayInSamples, kvDelay2Changes), kvFade);
+    // write the input once.
+    writeToRingBuffer(vInput, mBuffer.data(), mWriteIndex, mLengthMask);
+
+    // run the two read heads, each changing its delay only while it is faded
+    // out, and crossfade the results.
+    DSPVector vy1, vy2;
+    const float* pBuf = mBuffer.data();
+    for (int n = 0; n < kFloatsPerDSPVector; ++n)
+    {
+      if (kvDelay1Changes[n] != 0) mHead1.setDelayInSamples(vDelayInSamples[n]);
+      if (kvDelay2Changes[n] != 0) mHead2.setDelayInSamples(vDelayInSamples[n]);
+      uintptr_t readIndex = mWriteIndex + n;
+      vy1[n] = mHead1.mAllpass.processSample(pBuf[(readIndex - mHead1.mDelayInt) & mLengthMask]);
+      vy2[n] = mHead2.mAllpass.processSample(pBuf[(readIndex - mHead2.mDelayInt) & mLengthMask]);
+    }
+    vOutput = lerp(vy1, vy2, kvFade);
+
+    mWriteIndex = (mWriteIndex + kFloatsPerDSPVector) & mLengthMask;
+  }
+
+  inline DSPVector operator()(const DSPVector vInput, const DSPVector vDelayInSamples)
+  {
+    DSPVector vOutput;
+    process(vInput, vDelayInSamples, vOutput);
+    return vOutput;
   }
 };
 
@@ -911,9 +2302,9 @@ class Allpass
   // IntegerDelay or FractionalDelay.
   inline void setDelayInSamples(float d) { mDelay.setDelayInSamples(d - kFloatsPerDSPVector); }
 
-  inline void setMaxDelayInSamples(float d)
+  inline void setMaxDelayInSamples(float d, DelayArena* pArena = nullptr)
   {
-    mDelay.setMaxDelayInSamples(d - kFloatsPerDSPVector);
+    mDelay.setMaxDelayInSamples(d - kFloatsPerDSPVector, pArena);
   }
 
   inline void clear()
@@ -923,108 +2314,334 @@ class Allpass
   }
 
   // use with constant delay time.
-  inline DSPVector operator()(const DSPVector vInput)
+  inline void process(const DSPVector& vInput, DSPVector& vOutput)
   {
     DSPVector vGain(-mGain);
     DSPVector vDelayInput = vInput - vy1 * vGain;
-    DSPVector y = vDelayInput * vGain + vy1;
-    vy1 = mDelay(vDelayInput);
-    return y;
+    vOutput = vDelayInput * vGain + vy1;
+    mDelay.process(vDelayInput, vy1);
+  }
+
+  inline void processInPlace(DSPVector& v) { process(v, v); }
+
+  inline DSPVector operator()(const DSPVector vInput)
+  {
+    DSPVector vOutput;
+    process(vInput, vOutput);
+    return vOutput;
   }
 
   // use vDelayInSamples parameter to set a varying delay time with DELAY_TYPE =
   // PitchbendableDelay.
-  inline DSPVector operator()(const DSPVector vInput, const DSPVector vDelayInSamples)
+  inline void process(const DSPVector& vInput, const DSPVector& vDelayInSamples,
+                      DSPVector& vOutput)
   {
     DSPVector vGain(-mGain);
     DSPVector vDelayInput = vInput - vy1 * vGain;
-    DSPVector y = vDelayInput * vGain + vy1;
-    vy1 = mDelay(vDelayInput, vDelayInSamples - DSPVector(kFloatsPerDSPVector));
-    return y;
+    vOutput = vDelayInput * vGain + vy1;
+    mDelay.process(vDelayInput, vDelayInSamples - DSPVector(kFloatsPerDSPVector), vy1);
+  }
+
+  inline DSPVector operator()(const DSPVector vInput, const DSPVector vDelayInSamples)
+  {
+    DSPVector vOutput;
+    process(vInput, vDelayInSamples, vOutput);
+    return vOutput;
   }
 };
 
 // FDN
-// A general Feedback Delay Network with N delay lines connected in an NxN
-// matrix.
-// TODO DELAY_TYPE parameter for modulation?
+// A Feedback Delay Network with SIZE delay lines. The outputs of the lines are
+// mixed by a SIZE x SIZE feedback matrix, lowpass filtered, scaled by the
+// feedback gains and added to the input to make the next inputs of the lines.
+//
+// The feedback matrix is set with setFeedbackMatrix(). It can be a Householder
+// reflection, which is the default, a Walsh-Hadamard matrix applied with the
+// fast transform in SIZE log2(SIZE) operations, or any matrix given with
+// setUserMatrix(). The Hadamard matrix needs SIZE to be a power of two, and
+// the Householder matrix is used in its place otherwise. Both are unitary, so
+// the network will not decay with feedback gains of 1.
+//
+// The outputs of the lines are mixed to OUTPUTS rows by mOutputGains. By
+// default line n is sent to row (n + 1) % OUTPUTS, so that for two outputs the
+// odd lines make up the left channel and the even lines the right.
+//
+// The lines share one block of memory and one write index and are processed a
+// DSPVector at a time, so that the matrix and the gains are operations on
+// whole vectors, and the filters run across the lines in a SIMDBank. The
+// network has one DSPVector of feedback latency that is made up for in the
+// delay times, so the minimum delay time is kFloatsPerDSPVector.
+//
+// The memory for the lines is allocated by setMaxDelayInSamples(), which
+// should be called once when the network is set up. Delays and modulation set
+// afterwards are limited to fit in that memory, so changing them never
+// allocates or clears the lines.
+//
+// The delay of each line can be modulated by a sine wave with setModulation().
+// Modulated lines are read with linear interpolation.
 
-template <int SIZE>
+template <int SIZE, size_t OUTPUTS = 2>
 class FDN
 {
-  std::array<IntegerDelay, SIZE> mDelays;
-  std::array<OnePole, SIZE> mFilters;
-  std::array<DSPVector, SIZE> mDelayInputVectors{{{DSPVector(0.f)}}};
-
  public:
-  // feedback gains array is public—just copy values to set.
-  std::array<float, SIZE> mFeedbackGains{{0}};
+  enum matrixType
+  {
+    kHouseholder,
+    kHadamard,
+    kUser
+  };
 
-  void setDelaysInSamples(std::array<float, SIZE> times)
+ private:
+  // the lines, each mLength samples long.
+  DelayMemory<float> mBuffer;
+  int mLength{0};
+  uintptr_t mLengthMask{0};
+  uintptr_t mWriteIndex{0};
+  float mMaxDelay{0.f};
+
+  std::array<float, SIZE> mDelays{};
+  std::array<float, SIZE> mModOmegas{};
+  std::array<float, SIZE> mModDepths{};
+  std::array<float, SIZE> mModPhases{};
+  std::array<float, SIZE> mModDelays{};
+
+  SIMDBank<OnePole, SIZE> mFilters;
+  matrixType mMatrixType{kHouseholder};
+  std::array<std::array<float, SIZE>, SIZE> mUserMatrix{};
+
+  // limit the delays, and the delays plus the modulation depths, to the
+  // maximum delay.
+  void clampToMaxDelay()
   {
+    const float minDelay = kFloatsPerDSPVector;
     for (int n = 0; n < SIZE; ++n)
     {
-      // we have one DSPVector feedback latency, so compensate delay times for
-      // that.
-      int len = times[n] - kFloatsPerDSPVector;
-      len = max(1, len);
-      mDelays[n].setDelayInSamples(len);
+      mDelays[n] = std::min(std::max(mDelays[n], minDelay), mMaxDelay);
+      mModDepths[n] = std::min(fabsf(mModDepths[n]), mMaxDelay - mDelays[n]);
     }
   }
 
-  void setFilterCutoffs(std::array<float, SIZE> omegas)
+  void readLine(int n, float* py)
   {
-    for (int n = 0; n < SIZE; ++n)
+    const float* pLine = mBuffer.data() + n * mLength;
+    if (mModDepths[n] == 0.f)
     {
-      mFilters[n].mCoeffs = ml::OnePole::coeffs(omegas[n]);
+      uintptr_t readStart = (mWriteIndex - static_cast<int>(mDelays[n])) & mLengthMask;
+      uintptr_t readEnd = readStart + kFloatsPerDSPVector;
+      if (readEnd <= mLengthMask + 1)
+      {
+        std::copy(pLine + readStart, pLine + readEnd, py);
+      }
+      else
+      {
+        uintptr_t excess = readEnd - mLengthMask - 1;
+        std::copy(pLine + readStart, pLine + mLength, py);
+        std::copy(pLine, pLine + excess, py + kFloatsPerDSPVector - excess);
+      }
+      return;
     }
+
+    // ramp from the delay at the end of the last vector to the delay at the
+    // end of this one. Reads must not reach the vector being written.
+    mModPhases[n] += mModOmegas[n] * kFloatsPerDSPVector;
+    mModPhases[n] -= floorf(mModPhases[n]);
+    const float d0 = mModDelays[n];
+    const float d1 = std::max(mDelays[n] + mModDepths[n] * sinf(kTwoPi * mModPhases[n]),
+                              kFloatsPerDSPVector + 1.f);
+    const float dStep = (d1 - d0) / kFloatsPerDSPVector;
+    const DSPVector delay = DSPVector(d0 + dStep) + columnIndex() * DSPVector(dStep);
+    readFromRingBufferLinear(pLine, mWriteIndex, mLengthMask, delay.getConstBuffer(), 1.f, py);
+    mModDelays[n] = d1;
   }
 
-  // stereo output function
-  // TODO generalize n-channel output function somehow
-  DSPVectorArray<2> operator()(const DSPVector x)
+  void writeLine(int n, const float* px)
   {
-    // run delays, getting DSPVector for each delay
-    for (int n = 0; n < SIZE; ++n)
-    {
-      mDelayInputVectors[n] = mDelays[n](mDelayInputVectors[n]);
-    }
+    // the write index is a multiple of the vector size and the length is a
+    // larger power of two, so writes never wrap.
+    std::copy(px, px + kFloatsPerDSPVector, mBuffer.data() + n * mLength + mWriteIndex);
+  }
 
-    // get output sum
-    DSPVector sumR, sumL;
-    for (int n = 0; n < (SIZE & (~1)); ++n)
+  // multiply the vectors by the feedback matrix, leaving out any scale that is
+  // returned.
+  float applyMatrix(DSPVectorArray<SIZE>& v)
+  {
+    switch (mMatrixType)
     {
-      if (n & 1)
+      case kHouseholder:
+      default:
+      {
+        // the identity matrix minus 2/SIZE.
+        DSPVector sum;
+        for (int n = 0; n < SIZE; ++n)
+        {
+          sum += v.constRow(n);
+        }
+        sum *= DSPVector(2.0f / SIZE);
+        for (int n = 0; n < SIZE; ++n)
+        {
+          v.row(n) -= sum;
+        }
+        return 1.f;
+      }
+      case kHadamard:
       {
-        sumL += mDelayInputVectors[n];
+        for (int h = 1; h < SIZE; h *= 2)
+        {
+          for (int i = 0; i < SIZE; i += h * 2)
+          {
+            for (int j = i; j < i + h; ++j)
+            {
+              float* pa = v.row(j).getBuffer();
+              float* pb = v.row(j + h).getBuffer();
+              for (int k = 0; k < kFloatsPerDSPVector; k += kFloatsPerSIMDVector)
+              {
+                SIMDVectorFloat a = vecLoad(pa + k);
+                SIMDVectorFloat b = vecLoad(pb + k);
+                vecStore(pa + k, vecAdd(a, b));
+                vecStore(pb + k, vecSub(a, b));
+              }
+            }
+          }
+        }
+        return 1.f / sqrtf(static_cast<float>(SIZE));
       }
-      else
+      case kUser:
       {
-        sumR += mDelayInputVectors[n];
+        const DSPVectorArray<SIZE> x = v;
+        for (int i = 0; i < SIZE; ++i)
+        {
+          DSPVector sum;
+          for (int j = 0; j < SIZE; ++j)
+          {
+            sum += x.constRow(j) * DSPVector(mUserMatrix[i][j]);
+          }
+          v.row(i) = sum;
+        }
+        return 1.f;
       }
     }
+  }
+
+ public:
+  // gains are public—just copy values to set.
+  std::array<float, SIZE> mFeedbackGains{{0}};
+  std::array<float, SIZE> mInputGains;
+  std::array<std::array<float, SIZE>, OUTPUTS> mOutputGains{};
+
+  FDN()
+  {
+    mInputGains.fill(1.f);
+    for (int n = 0; n < SIZE; ++n)
+    {
+      mOutputGains[(n + 1) % OUTPUTS][n] = 1.f;
+      mFilters.setCoeffs(n, OnePole::passthru());
+    }
+    mDelays.fill(static_cast<float>(kFloatsPerDSPVector));
+    mModDelays = mDelays;
+    setMaxDelayInSamples(kFloatsPerDSPVector);
+  }
+  ~FDN() = default;
+
+  // allocate memory for delays up to d samples, including any modulation, from
+  // the arena if one is given. Longer delays set later are clamped to d.
+  void setMaxDelayInSamples(float d, DelayArena* pArena = nullptr)
+  {
+    mMaxDelay = std::max(d, static_cast<float>(kFloatsPerDSPVector));
+    int dMax = static_cast<int>(ceilf(mMaxDelay));
+    mLength = 1 << bitsToContain(dMax + kFloatsPerDSPVector + 2);
+    mLengthMask = mLength - 1;
+    mBuffer.allocate(mLength * SIZE, pArena);
+    mWriteIndex = 0;
+    clampToMaxDelay();
+    clear();
+  }
+
+  void setDelaysInSamples(std::array<float, SIZE> times)
+  {
+    mDelays = times;
+    clampToMaxDelay();
+    mModDelays = mDelays;
+  }
+
+  void setFilterCutoffs(std::array<float, SIZE> omegas)
+  {
+    for (int n = 0; n < SIZE; ++n)
+    {
+      mFilters.setCoeffs(n, OnePole::coeffs(omegas[n]));
+    }
+  }
+
+  // modulate the delay of each line by a sine wave with frequency omega and
+  // the given depth in samples. A depth of 0 turns modulation off. Depths are
+  // limited so that the delays stay within the maximum.
+  void setModulation(std::array<float, SIZE> omegas, std::array<float, SIZE> depths)
+  {
+    mModOmegas = omegas;
+    mModDepths = depths;
+    clampToMaxDelay();
+  }
+
+  void setFeedbackMatrix(matrixType type)
+  {
+    const bool powerOfTwo = (SIZE & (SIZE - 1)) == 0;
+    mMatrixType = (type == kHadamard && !powerOfTwo) ? kHouseholder : type;
+  }
+
+  // use the given matrix for feedback, with rows indexed by destination line.
+  void setUserMatrix(const std::array<std::array<float, SIZE>, SIZE>& m)
+  {
+    mUserMatrix = m;
+    mMatrixType = kUser;
+  }
 
-    // inputs = input gains*input sample + filters(M*delay outputs)
-    // The feedback matrix M is a unit-gain Householder matrix, which is just
-    // the identity matrix minus a constant k, where k = 2/size. Since
-    // multiplying this can be simplified so much, you just see a few operations
-    // here, not a general matrix multiply.
+  void clear()
+  {
+    mBuffer.clear();
+    mFilters.clear();
+    mModPhases.fill(0.f);
+    mModDelays = mDelays;
+  }
 
-    DSPVector sumOfDelays;
+  inline void process(const DSPVector& x, DSPVectorArray<OUTPUTS>& y)
+  {
+    // read the outputs of the lines
+    DSPVectorArray<SIZE> v;
     for (int n = 0; n < SIZE; ++n)
     {
-      sumOfDelays += mDelayInputVectors[n];
+      readLine(n, v.row(n).getBuffer());
     }
-    sumOfDelays *= DSPVector(2.0f / SIZE);
 
+    // mix them to the outputs
+    for (size_t j = 0; j < OUTPUTS; ++j)
+    {
+      DSPVector sum;
+      for (int n = 0; n < SIZE; ++n)
+      {
+        if (mOutputGains[j][n] != 0.f)
+        {
+          sum += v.constRow(n) * DSPVector(mOutputGains[j][n]);
+        }
+      }
+      y.row(j) = sum;
+    }
+
+    // inputs = input gains * input + feedback gains * filters(M * outputs)
+    const float scale = applyMatrix(v);
+    mFilters.processInPlace(v);
     for (int n = 0; n < SIZE; ++n)
     {
-      mDelayInputVectors[n] -= (sumOfDelays);
-      mDelayInputVectors[n] = mFilters[n](mDelayInputVectors[n]) * DSPVector(mFeedbackGains[n]);
-      mDelayInputVectors[n] += x;
+      const DSPVector feedback = v.constRow(n) * DSPVector(mFeedbackGains[n] * scale);
+      v.row(n) = feedback + x * DSPVector(mInputGains[n]);
+      writeLine(n, v.constRow(n).getConstBuffer());
     }
+    mWriteIndex = (mWriteIndex + kFloatsPerDSPVector) & mLengthMask;
+  }
 
-    return concatRows(sumL, sumR);
+  inline DSPVectorArray<OUTPUTS> operator()(const DSPVector x)
+  {
+    DSPVectorArray<OUTPUTS> y;
+    process(x, y);
+    return y;
   }
 };
 
@@ -1090,6 +2707,192 @@ class HalfBandFilter
   float b1{0};
 };
 
+// SIMDHalfBandFilter<CHANNELS>: the same half band filter for CHANNELS
+// channels, running kFloatsPerSIMDVector channels at once in SIMD lanes.
+//
+// Each branch of the polyphase filter is run as its own recurrence, so the two
+// branches can overlap in the pipeline. The allpass sections are computed as
+// y = (x1 + c * x) - c * y1, which leaves only one multiply and one subtract
+// in each recurrence. A single channel is run with scalar math, because
+// transposing it into SIMD lanes would cost more than it saves. The results
+// match HalfBandFilter to within rounding. The inputs and outputs can be the
+// same arrays.
+
+template <size_t CHANNELS>
+class SIMDHalfBandFilter
+{
+  static constexpr int kLanes = kFloatsPerSIMDVector;
+  static constexpr bool kScalar = (CHANNELS == 1);
+  using V = typename std::conditional<kScalar, float, SIMDLanes>::type;
+
+  // with no channels, one empty group.
+  static constexpr int kGroups = CHANNELS ? (CHANNELS + kLanes - 1) / kLanes : 1;
+
+  // the state of one allpass section.
+  struct Section
+  {
+    V x1, y1;
+
+    inline V process(V x, V c)
+    {
+      V y = (x1 + c * x) - c * y1;
+      x1 = x;
+      y1 = y;
+      return y;
+    }
+  };
+
+  // the state of the branches a and b, and the last output of b for
+  // downsampling.
+  struct State
+  {
+    Section a0, a1, b0, b1;
+    V bPrev;
+  };
+  std::array<State, kGroups> mState;
+
+  // the coefficients of HalfBandFilter.
+  static V ca0() { return V(0.07986642623635751f); }
+  static V ca1() { return V(0.5453536510711322f); }
+  static V cb0() { return V(0.28382934487410993f); }
+  static V cb1() { return V(0.8344118914807379f); }
+
+  static int groupRows(int g)
+  {
+    return ((g + 1) * kLanes <= CHANNELS) ? kLanes : static_cast<int>(CHANNELS) - g * kLanes;
+  }
+
+  // upsample the samples x to 2n samples y.
+  static inline void upsampleSamples(State& s, const V* x, V* y, int n)
+  {
+    const V a0 = ca0(), a1 = ca1(), b0 = cb0(), b1 = cb1();
+    for (int i = 0; i < n; ++i)
+    {
+      y[2 * i] = s.a1.process(s.a0.process(x[i], a0), a1);
+      y[2 * i + 1] = s.b1.process(s.b0.process(x[i], b0), b1);
+    }
+  }
+
+  // downsample the samples x to n / 2 samples y.
+  static inline void downsampleSamples(State& s, const V* x, V* y, int n)
+  {
+    const V a0 = ca0(), a1 = ca1(), b0 = cb0(), b1 = cb1();
+    const V half(0.5f);
+    for (int i = 0; i < n / 2; ++i)
+    {
+      V a = s.a1.process(s.a0.process(x[2 * i], a0), a1);
+      V b = s.b1.process(s.b0.process(x[2 * i + 1], b0), b1);
+      y[i] = (a + s.bPrev) * half;
+      s.bPrev = b;
+    }
+  }
+
+  inline void upsample(const float* px, float* py1, float* py2, std::true_type)
+  {
+    float x[kFloatsPerDSPVector];
+    float y[kFloatsPerDSPVector * 2];
+    std::copy(px, px + kFloatsPerDSPVector, x);
+    upsampleSamples(mState[0], x, y, kFloatsPerDSPVector);
+    std::copy(y, y + kFloatsPerDSPVector, py1);
+    std::copy(y + kFloatsPerDSPVector, y + kFloatsPerDSPVector * 2, py2);
+  }
+
+  inline void upsample(const float* px, float* py1, float* py2, std::false_type)
+  {
+    SIMDLanes x[kGroups][kFloatsPerDSPVector];
+    SIMDLanes y[kGroups][kFloatsPerDSPVector * 2];
+    for (int g = 0; g < kGroups; ++g)
+    {
+      transposeRowsToLanes(px + g * kLanes * kFloatsPerDSPVector, groupRows(g), x[g]);
+    }
+
+    // run all the groups at each sample, so that their recurrences can
+    // overlap in the pipeline.
+    for (int n = 0; n < kFloatsPerDSPVector; ++n)
+    {
+      for (int g = 0; g < kGroups; ++g)
+      {
+        upsampleSamples(mState[g], x[g] + n, y[g] + 2 * n, 1);
+      }
+    }
+
+    for (int g = 0; g < kGroups; ++g)
+    {
+      const int offset = g * kLanes * kFloatsPerDSPVector;
+      transposeLanesToRows(y[g], groupRows(g), py1 + offset);
+      transposeLanesToRows(y[g] + kFloatsPerDSPVector, groupRows(g), py2 + offset);
+    }
+  }
+
+  inline void downsample(const float* px1, const float* px2, float* py, std::true_type)
+  {
+    float x[kFloatsPerDSPVector * 2];
+    std::copy(px1, px1 + kFloatsPerDSPVector, x);
+    std::copy(px2, px2 + kFloatsPerDSPVector, x + kFloatsPerDSPVector);
+    downsampleSamples(mState[0], x, py, kFloatsPerDSPVector * 2);
+  }
+
+  inline void downsample(const float* px1, const float* px2, float* py, std::false_type)
+  {
+    SIMDLanes x[kGroups][kFloatsPerDSPVector * 2];
+    SIMDLanes y[kGroups][kFloatsPerDSPVector];
+    for (int g = 0; g < kGroups; ++g)
+    {
+      const int offset = g * kLanes * kFloatsPerDSPVector;
+      transposeRowsToLanes(px1 + offset, groupRows(g), x[g]);
+      transposeRowsToLanes(px2 + offset, groupRows(g), x[g] + kFloatsPerDSPVector);
+    }
+
+    for (int n = 0; n < kFloatsPerDSPVector; ++n)
+    {
+      for (int g = 0; g < kGroups; ++g)
+      {
+        downsampleSamples(mState[g], x[g] + 2 * n, y[g] + n, 2);
+      }
+    }
+
+    for (int g = 0; g < kGroups; ++g)
+    {
+      transposeLanesToRows(y[g], groupRows(g), py + g * kLanes * kFloatsPerDSPVector);
+    }
+  }
+
+ public:
+  SIMDHalfBandFilter() { clear(); }
+
+  // upsample vx by 2, writing the first half of the output to vy1 and the
+  // second half to vy2.
+  inline void upsample(const DSPVectorArray<CHANNELS>& vx, DSPVectorArray<CHANNELS>& vy1,
+                       DSPVectorArray<CHANNELS>& vy2)
+  {
+    upsample(vx.getConstBuffer(), vy1.getBuffer(), vy2.getBuffer(),
+             std::integral_constant<bool, kScalar>());
+  }
+
+  // downsample two consecutive vectors vx1 and vx2 by 2, writing the output
+  // to vy.
+  inline void downsample(const DSPVectorArray<CHANNELS>& vx1, const DSPVectorArray<CHANNELS>& vx2,
+                         DSPVectorArray<CHANNELS>& vy)
+  {
+    downsample(vx1.getConstBuffer(), vx2.getConstBuffer(), vy.getBuffer(),
+               std::integral_constant<bool, kScalar>());
+  }
+
+  inline DSPVectorArray<CHANNELS> downsample(const DSPVectorArray<CHANNELS>& vx1,
+                                             const DSPVectorArray<CHANNELS>& vx2)
+  {
+    DSPVectorArray<CHANNELS> vy;
+    downsample(vx1, vx2, vy);
+    return vy;
+  }
+
+  inline void clear()
+  {
+    const V zero(0.f);
+    mState.fill({{zero, zero}, {zero, zero}, {zero, zero}, {zero, zero}, zero});
+  }
+};
+
 // Downsampler
 // a cascade of half band filters, one for each octave.
 
@@ -1182,6 +2985,63 @@ class Downsampler
   }
 };
 
+// Upsampler
+// the counterpart of Downsampler: a cascade of SIMD half band filters, one for
+// each octave. Each vector written makes 2^octaves vectors of output, which
+// are then read in order.
+
+template <size_t CHANNELS>
+class Upsampler
+{
+  std::vector<SIMDHalfBandFilter<CHANNELS>> _filters;
+  std::vector<float> _buffer;
+  int _octaves;
+  int _readIndex{0};
+
+  static constexpr int kArraySizeInFloats = kFloatsPerDSPVector * CHANNELS;
+
+  // the buffer has two halves, each with room for 2^octaves vectors.
+  float* bufferPtr(int half, int idx)
+  {
+    return _buffer.data() + ((half << _octaves) + idx) * kArraySizeInFloats;
+  }
+
+ public:
+  Upsampler(int octavesUp) : _filters(octavesUp), _octaves(octavesUp)
+  {
+    _buffer.resize((kArraySizeInFloats << _octaves) * 2);
+  }
+  ~Upsampler() = default;
+
+  // write a vector of samples to the filter chain and run the filters. Each
+  // octave reads its input from one half of the buffer and writes twice as
+  // many vectors of output to the other half.
+  void write(const DSPVectorArray<CHANNELS>& v)
+  {
+    store(v, bufferPtr(0, 0));
+    DSPVectorArray<CHANNELS> vy1, vy2;
+    for (int h = 0; h < _octaves; ++h)
+    {
+      for (int i = 0; i < (1 << h); ++i)
+      {
+        _filters[h].upsample(DSPVectorArray<CHANNELS>(bufferPtr(h & 1, i)), vy1, vy2);
+        store(vy1, bufferPtr(~h & 1, 2 * i));
+        store(vy2, bufferPtr(~h & 1, 2 * i + 1));
+      }
+    }
+    _readIndex = 0;
+  }
+
+  // read the next vector of upsampled output. This is called 2^octaves
+  // times after each write.
+  DSPVectorArray<CHANNELS> read()
+  {
+    const int i = _readIndex;
+    _readIndex = (_readIndex + 1) & ((1 << _octaves) - 1);
+    return DSPVectorArray<CHANNELS>(bufferPtr(_octaves & 1, i));
+  }
+};
+
 // PLL: Phase Locked Loop for synching an output phasor to an input phasor at some ratio.
 
 class PLL
@@ -1199,10 +3059,9 @@ class PLL
   // dydx: the ratio to the input at which to lock the output phasor
   // feedback: amount of feedback to apply in PLL loop.
   // 1.0/sampleRate is a good amount of feedback to start with.
-  DSPVector operator()(DSPVector x, DSPVector dydx, DSPVector feedback)
+  void process(const DSPVector& x, const DSPVector& dydx, const DSPVector& feedback,
+               DSPVector& y)
   {
-    DSPVector y;
-
     // if input phasor is inactive, reset and bail.
     // (inactive / active switch is only done every vector)
     if (x[0] < 0.f)
@@ -1263,6 +3122,12 @@ class PLL
         y[n] = _omega;
       }
     }
+  }
+
+  DSPVector operator()(DSPVector x, DSPVector dydx, DSPVector feedback)
+  {
+    DSPVector y;
+    process(x, dydx, feedback, y);
     return y;
   }
 };
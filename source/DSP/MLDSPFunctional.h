@@ -11,7 +11,7 @@
 
 #pragma once
 
-#include <functional>
+#include <type_traits>
 
 #include "MLDSPFilters.h"
 
@@ -19,12 +19,26 @@ namespace ml
 {
 // ----------------------------------------------------------------
 // basic higher-order functions
+//
+// map() is a template on the type of the function f, so that lambdas and other
+// function objects can be inlined into the loop over samples, and the loop
+// vectorized where possible. A std::function can still be passed, at the cost
+// of an indirect call for each sample. The kind of map is chosen by the
+// arguments f can be called with and the type it returns.
+
+namespace detail
+{
+// R if From converts to To, otherwise no type, removing the overload.
+template <typename From, typename To, typename R>
+using enableIfConvertible = typename std::enable_if<std::is_convertible<From, To>::value, R>::type;
+}  // namespace detail
 
 // Evaluate a function (void)->(float), store at each element of the
 // DSPVectorArray and return the result. x is a dummy argument just used to
 // infer the vector size.
-template <size_t ROWS>
-inline DSPVectorArray<ROWS> map(std::function<float()> f, const DSPVectorArray<ROWS> x)
+template <typename F, size_t ROWS>
+inline auto map(F&& f, const DSPVectorArray<ROWS>&)
+    -> detail::enableIfConvertible<decltype(f()), float, DSPVectorArray<ROWS>>
 {
   DSPVectorArray<ROWS> y;
   for (int n = 0; n < kFloatsPerDSPVector * ROWS; ++n)
@@ -36,8 +50,9 @@ inline DSPVectorArray<ROWS> map(std::function<float()> f, const DSPVectorArray<R
 
 // Apply a function (float)->(float) to each element of the DSPVectorArray x and
 // return the result.
-template <size_t ROWS>
-inline DSPVectorArray<ROWS> map(std::function<float(float)> f, const DSPVectorArray<ROWS> x)
+template <typename F, size_t ROWS>
+inline auto map(F&& f, const DSPVectorArray<ROWS>& x)
+    -> detail::enableIfConvertible<decltype(f(x[0])), float, DSPVectorArray<ROWS>>
 {
   DSPVectorArray<ROWS> y;
   for (int n = 0; n < kFloatsPerDSPVector * ROWS; ++n)
@@ -49,8 +64,9 @@ inline DSPVectorArray<ROWS> map(std::function<float(float)> f, const DSPVectorAr
 
 // Apply a function (int)->(float) to each element of the DSPVectorArrayInt x
 // and return the result.
-template <size_t ROWS>
-inline DSPVectorArray<ROWS> map(std::function<float(int)> f, const DSPVectorArrayInt<ROWS> x)
+template <typename F, size_t ROWS>
+inline auto map(F&& f, const DSPVectorArrayInt<ROWS>& x)
+    -> detail::enableIfConvertible<decltype(f(x[0])), float, DSPVectorArray<ROWS>>
 {
   DSPVectorArray<ROWS> y;
   for (int n = 0; n < kFloatsPerDSPVector * ROWS; ++n)
@@ -62,28 +78,33 @@ inline DSPVectorArray<ROWS> map(std::function<float(int)> f, const DSPVectorArra
 
 // Apply a function (DSPVector)->(DSPVector) to each row of the DSPVectorArray x
 // and return the result.
-template <size_t ROWS>
-inline DSPVectorArray<ROWS> map(std::function<DSPVector(const DSPVector)> f,
-                                const DSPVectorArray<ROWS> x)
+template <typename F, size_t ROWS>
+inline auto map(F&& f, const DSPVectorArray<ROWS>& x)
+    -> detail::enableIfConvertible<decltype(f(x.getRowVectorUnchecked(0))), DSPVector,
+                                   DSPVectorArray<ROWS>>
 {
+  // rows are copied in and out by value. Referring to them with row() and
+  // constRow() would alias the float data as DSPVectors, which the optimizer
+  // can reorder once f is inlined.
   DSPVectorArray<ROWS> y;
   for (int j = 0; j < ROWS; ++j)
   {
-    y.row(j) = f(x.constRow(j));
+    y.setRowVectorUnchecked(j, f(x.getRowVectorUnchecked(j)));
   }
   return y;
 }
 
 // Apply a function (DSPVector, int row)->(DSPVector) to each row of the
 // DSPVectorArray x and return the result.
-template <size_t ROWS>
-inline DSPVectorArray<ROWS> map(std::function<DSPVector(const DSPVector, int)> f,
-                                const DSPVectorArray<ROWS> x)
+template <typename F, size_t ROWS>
+inline auto map(F&& f, const DSPVectorArray<ROWS>& x)
+    -> detail::enableIfConvertible<decltype(f(x.getRowVectorUnchecked(0), 0)), DSPVector,
+                                   DSPVectorArray<ROWS>>
 {
   DSPVectorArray<ROWS> y;
   for (int j = 0; j < ROWS; ++j)
   {
-    y.row(j) = f(x.constRow(j), j);
+    y.setRowVectorUnchecked(j, f(x.getRowVectorUnchecked(j), j));
   }
   return y;
 }
@@ -91,145 +112,159 @@ inline DSPVectorArray<ROWS> map(std::function<DSPVector(const DSPVector, int)> f
 // ----------------------------------------------------------------
 // higher-order functions with DSP
 
-// Upsample2xFunction is a function object that given a process function f,
-// upsamples the input x by 2, applies f, downsamples and returns the result.
-// the total delay from the resampling filters used is about 3 samples.
+// UpsampleFunction is a function object that given a process function f,
+// upsamples the input x by 2^OCTAVES, applies f, downsamples and returns the
+// result. Each octave of resampling uses a SIMDHalfBandFilter, which filters
+// all the input rows at once. The total delay from the resampling filters
+// used is about 3 samples for 2x.
+//
+// Upsample2xFunction, Upsample4xFunction and Upsample8xFunction are the
+// usual cases.
 
 // NOTE: all these templates were written with separate in and out rows
 // template<int IN_ROWS, int OUT_ROWS>
 // but a compiler bug is preventing it from working on Windows.
 // TODO revisit
 
-template <int IN_ROWS>
-class Upsample2xFunction
+template <int IN_ROWS, int OCTAVES>
+class UpsampleFunction
 {
   static constexpr int OUT_ROWS = 1;  // see above
+  static constexpr int kFactor = 1 << OCTAVES;
 
   using inputType = const DSPVectorArray<IN_ROWS>;
   using outputType = DSPVectorArray<1>;  // OUT_ROWS
-  using ProcessFn = std::function<outputType(inputType)>;
 
  public:
   // operator() takes two arguments: a process function and an input
-  // DSPVectorArray.
-  inline outputType operator()(ProcessFn fn, inputType vx)
+  // DSPVectorArray. The process function can be any callable object taking
+  // a DSPVectorArray<IN_ROWS> and returning a DSPVector.
+  template <typename FN>
+  inline outputType operator()(FN&& fn, inputType& vx)
   {
-    // upsample each row of input to 2x buffers
-    for (int j = 0; j < IN_ROWS; ++j)
+    // upsample the input one octave at a time. Each octave reads from one
+    // buffer and writes twice as many vectors to the other.
+    mUpsampledInput[0][0] = vx;
+    for (int h = 0; h < OCTAVES; ++h)
     {
-      DSPVector x1a = mUppers[j].upsampleFirstHalf(vx.constRow(j));
-      DSPVector x1b = mUppers[j].upsampleSecondHalf(vx.constRow(j));
-      mUpsampledInput1.row(j) = x1a;
-      mUpsampledInput2.row(j) = x1b;
+      auto& src = mUpsampledInput[h & 1];
+      auto& dest = mUpsampledInput[~h & 1];
+      for (int i = 0; i < (1 << h); ++i)
+      {
+        mUppers[h].upsample(src[i], dest[2 * i], dest[2 * i + 1]);
+      }
     }
 
     // process upsampled input
-    mUpsampledOutput1 = fn(mUpsampledInput1);
-    mUpsampledOutput2 = fn(mUpsampledInput2);
+    for (int i = 0; i < kFactor; ++i)
+    {
+      mUpsampledOutput[i] = fn(mUpsampledInput[OCTAVES & 1][i]);
+    }
 
-    // downsample each processed row to 1x output
-    outputType vy;
-    for (int j = 0; j < OUT_ROWS; ++j)
+    // downsample the processed output in place, one octave at a time.
+    for (int h = OCTAVES - 1; h >= 0; --h)
     {
-      vy.row(j) =
-          mDowners[j].downsample(mUpsampledOutput1.constRow(j), mUpsampledOutput2.constRow(j));
+      for (int i = 0; i < (1 << h); ++i)
+      {
+        mDowners[h].downsample(mUpsampledOutput[2 * i], mUpsampledOutput[2 * i + 1],
+                               mUpsampledOutput[i]);
+      }
     }
-    return vy;
+    return mUpsampledOutput[0];
   }
 
  private:
-  std::array<HalfBandFilter, IN_ROWS> mUppers;
-  std::array<HalfBandFilter, OUT_ROWS> mDowners;
-  DSPVectorArray<IN_ROWS> mUpsampledInput1, mUpsampledInput2;
-  DSPVectorArray<OUT_ROWS> mUpsampledOutput1, mUpsampledOutput2;
+  std::array<SIMDHalfBandFilter<IN_ROWS>, OCTAVES> mUppers;
+  std::array<SIMDHalfBandFilter<OUT_ROWS>, OCTAVES> mDowners;
+  std::array<std::array<DSPVectorArray<IN_ROWS>, kFactor>, 2> mUpsampledInput;
+  std::array<DSPVectorArray<OUT_ROWS>, kFactor> mUpsampledOutput;
 };
 
-// Downsample2xFunction is a function object that given a process function f,
-// downsamples the input x by 2, applies f, upsamples and returns the result.
-// Since two DSPVectors of input are needed to create a single vector of
-// downsampled input to the wrapped function, this function has an entire
-// DSPVector of delay in addition to the group delay of the allpass
-// interpolation (about 6 samples).
+template <int IN_ROWS>
+using Upsample2xFunction = UpsampleFunction<IN_ROWS, 1>;
+template <int IN_ROWS>
+using Upsample4xFunction = UpsampleFunction<IN_ROWS, 2>;
+template <int IN_ROWS>
+using Upsample8xFunction = UpsampleFunction<IN_ROWS, 3>;
+
+// DownsampleFunction is a function object that given a process function f,
+// downsamples the input x by 2^OCTAVES, applies f, upsamples and returns the
+// result. Since 2^OCTAVES DSPVectors of input are needed to create a single
+// vector of downsampled input to the wrapped function, this function has
+// 2^OCTAVES - 1 DSPVectors of delay in addition to the group delay of the
+// allpass interpolation (about 6 samples for 2x).
+//
+// Downsample2xFunction, Downsample4xFunction and Downsample8xFunction are the
+// usual cases.
 
 // template<int IN_ROWS, int OUT_ROWS>
-template <int IN_ROWS>
-class Downsample2xFunction
+template <int IN_ROWS, int OCTAVES>
+class DownsampleFunction
 {
   static constexpr int OUT_ROWS = 1;  // see above
-
-  using inputType = const DSPVectorArray<IN_ROWS>;
-  using outputType = DSPVectorArray<1>;  // OUT_ROWS
-  using ProcessFn = std::function<outputType(inputType)>;
+  static constexpr int kFactor = 1 << OCTAVES;
 
  public:
   // operator() takes two arguments: a process function and an input
   // DSPVectorArray. The optional argument DSPVectorArray<0>() allows passing
   // only one argument in the case of a generator with 0 input rows.
-  inline DSPVectorArray<OUT_ROWS> operator()(ProcessFn fn,
+  template <typename FN>
+  inline DSPVectorArray<OUT_ROWS> operator()(FN&& fn,
                                              const DSPVectorArray<IN_ROWS> vx = DSPVectorArray<0>())
   {
-    DSPVectorArray<OUT_ROWS> vy;
-    if (mPhase)
+    // store input
+    mInputBuffer[mPhase] = vx;
+
+    if (mPhase == kFactor - 1)
     {
-      // downsample each row of input to 1/2x buffers
-      for (int j = 0; j < IN_ROWS; ++j)
+      // downsample the stored input in place, one octave at a time.
+      for (int h = 0; h < OCTAVES; ++h)
       {
-        mDownsampledInput.row(j) = mDowners[j].downsample(mInputBuffer.constRow(j), vx.constRow(j));
+        for (int i = 0; i < (kFactor >> (h + 1)); ++i)
+        {
+          mDowners[h].downsample(mInputBuffer[2 * i], mInputBuffer[2 * i + 1], mInputBuffer[i]);
+        }
       }
 
       // process downsampled input
-      mDownsampledOutput = fn(mDownsampledInput);
+      mOutputBuffer[0][0] = fn(mInputBuffer[0]);
 
-      // upsample each processed row to output
-      for (int j = 0; j < OUT_ROWS; ++j)
+      // upsample the processed output one octave at a time. Each octave
+      // reads from one buffer and writes twice as many vectors to the other.
+      for (int h = 0; h < OCTAVES; ++h)
       {
-        // first half is returned
-        vy.row(j) = mUppers[j].upsampleFirstHalf(mDownsampledOutput.constRow(j));
-
-        // second half is buffered
-        mOutputBuffer.row(j) = mUppers[j].upsampleSecondHalf(mDownsampledOutput.constRow(j));
+        auto& src = mOutputBuffer[h & 1];
+        auto& dest = mOutputBuffer[~h & 1];
+        for (int i = 0; i < (1 << h); ++i)
+        {
+          mUppers[h].upsample(src[i], dest[2 * i], dest[2 * i + 1]);
+        }
       }
     }
-    else
-    {
-      // store input
-      mInputBuffer = vx;
-      // return buffer
-      vy = mOutputBuffer;
-    }
-    mPhase = !mPhase;
-    return vy;
+
+    // the first vector of new output is returned now, and the rest are
+    // buffered for the following calls.
+    mPhase = (mPhase + 1) & (kFactor - 1);
+    return mOutputBuffer[OCTAVES & 1][mPhase];
   }
 
  private:
-  std::array<HalfBandFilter, IN_ROWS> mDowners;
-  std::array<HalfBandFilter, OUT_ROWS> mUppers;
-  DSPVectorArray<IN_ROWS> mInputBuffer;
-  DSPVectorArray<OUT_ROWS> mOutputBuffer;
-  DSPVectorArray<IN_ROWS> mDownsampledInput;
-  DSPVectorArray<OUT_ROWS> mDownsampledOutput;
-  bool mPhase{false};
+  std::array<SIMDHalfBandFilter<IN_ROWS>, OCTAVES> mDowners;
+  std::array<SIMDHalfBandFilter<OUT_ROWS>, OCTAVES> mUppers;
+  std::array<DSPVectorArray<IN_ROWS>, kFactor> mInputBuffer;
+  std::array<std::array<DSPVectorArray<OUT_ROWS>, kFactor>, 2> mOutputBuffer;
+  int mPhase{0};
 };
 
-// OverlapAddFunction TODO
-/*
-template<int LENGTH, int DIVISIONS, int IN_ROWS, int OUT_ROWS>
-class OverlapAddFunction
-{
-        typedef std::function<DSPVectorArray<OUT_ROWS>(const
-DSPVectorArray<IN_ROWS>)> ProcessFn;
-
-public:
-        inline DSPVectorArray<OUT_ROWS> operator()(ProcessFn fn, const
-DSPVectorArray<IN_ROWS> vx)
-        {
-        }
+template <int IN_ROWS>
+using Downsample2xFunction = DownsampleFunction<IN_ROWS, 1>;
+template <int IN_ROWS>
+using Downsample4xFunction = DownsampleFunction<IN_ROWS, 2>;
+template <int IN_ROWS>
+using Downsample8xFunction = DownsampleFunction<IN_ROWS, 3>;
 
-private:
-        //Matrix mHistory;
-        const DSPVector& mWindow;
-};
-*/
+// for overlap-add processing in the frequency domain, see STFT in
+// MLDSPSpectral.h.
 
 // FeedbackDelayFunction
 // Wraps a function in a pitchbendable delay with feedback per row.
@@ -240,22 +275,21 @@ private:
 class FeedbackDelayFunction
 {
   static constexpr int ROWS = 1;  // see above
-  using inputType = const DSPVectorArray<ROWS>;
-  using outputType = DSPVectorArray<1>;  // ROWS
-  using ProcessFn = std::function<outputType(inputType)>;
 
  public:
   float feedbackGain{1.f};
 
-  inline DSPVectorArray<ROWS> operator()(const DSPVectorArray<ROWS> vx, ProcessFn fn,
-                                         const DSPVector vDelayTime)
+  template <typename FN>
+  inline DSPVectorArray<ROWS> operator()(const DSPVectorArray<ROWS>& vx, FN&& fn,
+                                         const DSPVector& vDelayTime)
   {
     DSPVectorArray<ROWS> vFnOutput;
     vFnOutput = fn(vx + vy1 * DSPVectorArray<ROWS>(feedbackGain));
 
     for (int j = 0; j < ROWS; ++j)
     {
-      vy1.row(j) = mDelays[j](vFnOutput.row(j), vDelayTime - DSPVector(kFloatsPerDSPVector));
+      mDelays[j].process(vFnOutput.row(j), vDelayTime - DSPVector(kFloatsPerDSPVector),
+                         vy1.row(j));
     }
     return vFnOutput;
   }
@@ -275,16 +309,13 @@ class FeedbackDelayFunction
 class FeedbackDelayFunctionWithTap
 {
   static constexpr int ROWS = 1;  // see above
-  using inputType = const DSPVectorArray<ROWS>;
-  using tapType = DSPVectorArray<ROWS>&;
-  using outputType = DSPVectorArray<1>;  // ROWS
-  using ProcessFn = std::function<outputType(inputType, tapType)>;
 
  public:
   float feedbackGain{1.f};
 
-  inline DSPVectorArray<ROWS> operator()(const DSPVectorArray<ROWS> vx, ProcessFn fn,
-                                         const DSPVector vDelayTime)
+  template <typename FN>
+  inline DSPVectorArray<ROWS> operator()(const DSPVectorArray<ROWS>& vx, FN&& fn,
+                                         const DSPVector& vDelayTime)
   {
     DSPVectorArray<ROWS> vFeedback;
     DSPVectorArray<ROWS> vOutputTap;
@@ -292,7 +323,8 @@ class FeedbackDelayFunctionWithTap
 
     for (int j = 0; j < ROWS; ++j)
     {
-      vy1.row(j) = mDelays[j](vFeedback.row(j), vDelayTime - DSPVector(kFloatsPerDSPVector));
+      mDelays[j].process(vFeedback.row(j), vDelayTime - DSPVector(kFloatsPerDSPVector),
+                         vy1.row(j));
     }
     return vOutputTap;
   }
@@ -303,7 +335,13 @@ class FeedbackDelayFunctionWithTap
 };
 
 // Bank: a bank of processors. The processor type T must have a process() method
-// that outputs a single DSPVector and has only DSPVectors as arguments.
+// that takes only DSPVectors as inputs and writes a single DSPVector output. Row
+// i of each argument is an input to processor i, which writes directly to row i
+// of the output.
+//
+// Each method can also take a RowMask. Then only the processors of active rows
+// are run, and the inactive rows of the output are zero. The inactive
+// processors keep their state until they are run again.
 
 template <typename T, int ROWS>
 class Bank
@@ -312,16 +350,72 @@ class Bank
 
  public:
   template <typename... Args>
-  inline DSPVectorArray<ROWS> operator()(Args... args)
+  inline DSPVectorArray<ROWS> operator()(const Args&... args)
   {
     DSPVectorArray<ROWS> output;
     for (int i = 0; i < ROWS; ++i)
     {
-      output.row(i) = _processors[i](args.constRow(i)...);
+      _processors[i].process(args.constRow(i)..., output.row(i));
+    }
+    return output;
+  }
+
+  // for processors with a single input.
+  inline void process(const DSPVectorArray<ROWS>& input, DSPVectorArray<ROWS>& output)
+  {
+    for (int i = 0; i < ROWS; ++i)
+    {
+      _processors[i].process(input.constRow(i), output.row(i));
+    }
+  }
+
+  inline void processInPlace(DSPVectorArray<ROWS>& v)
+  {
+    for (int i = 0; i < ROWS; ++i)
+    {
+      _processors[i].processInPlace(v.row(i));
+    }
+  }
+
+  template <typename... Args>
+  inline DSPVectorArray<ROWS> operator()(const RowMask<ROWS>& mask, const Args&... args)
+  {
+    DSPVectorArray<ROWS> output{0.f};
+    for (int i : mask)
+    {
+      _processors[i].process(args.constRow(i)..., output.row(i));
     }
     return output;
   }
 
+  inline void process(const RowMask<ROWS>& mask, const DSPVectorArray<ROWS>& input,
+                      DSPVectorArray<ROWS>& output)
+  {
+    output = 0.f;
+    for (int i : mask)
+    {
+      _processors[i].process(input.constRow(i), output.row(i));
+    }
+  }
+
+  inline void processInPlace(const RowMask<ROWS>& mask, DSPVectorArray<ROWS>& v)
+  {
+    int j = 0;
+    for (int i : mask)
+    {
+      for (; j < i; ++j)
+      {
+        v.row(j) = 0.f;
+      }
+      _processors[i].processInPlace(v.row(i));
+      j = i + 1;
+    }
+    for (; j < ROWS; ++j)
+    {
+      v.row(j) = 0.f;
+    }
+  }
+
   inline void clear()
   {
     for (int i = 0; i < ROWS; ++i)
@@ -333,4 +427,23 @@ class Bank
   T& operator[](size_t n) { return _processors[n]; }
 };
 
+// Make the active rows of the mask inactive once the detector for each row has
+// found its row of x silent. When a row is activated again, its detector
+// should be cleared.
+template <size_t ROWS>
+inline void deactivateSilentRows(const DSPVectorArray<ROWS>& x,
+                                 std::array<SilenceDetector, ROWS>& detectors,
+                                 RowMask<ROWS>& mask)
+{
+  // copy the active list, which changes as rows are deactivated.
+  const RowMask<ROWS> active = mask;
+  for (int i : active)
+  {
+    if (detectors[i](x.constRow(i)))
+    {
+      mask.set(i, false);
+    }
+  }
+}
+
 }  // namespace ml
@@ -7,6 +7,10 @@
 // example the frequency of an oscillator or the seed in a noise generator.
 // Otherwise they would be DSPOps.
 //
+// Like the filters in MLDSPFilters.h, each generator also has a process()
+// method that takes its inputs by reference and writes its output to the
+// last argument.
+//
 // These objects are for building fixed DSP graphs in a functional style. The
 // compiler should have many opportunities to optimize these graphs. For dynamic
 // graphs changeable at runtime, see MLProcs. In general MLProcs will be written
@@ -14,6 +18,7 @@
 
 #pragma once
 
+#include "MLDSPExpressions.h"
 #include "MLDSPFunctional.h"
 #include "MLDSPOps.h"
 #include "MLDSPUtils.h"
@@ -26,22 +31,26 @@ class TickGen
   float mOmega{0};
 
  public:
-  inline DSPVector operator()(const DSPVector cyclesPerSample)
+  inline void process(const DSPVector& cyclesPerSample, DSPVector& vy)
   {
-    // calculate counter delta per sample
-    DSPVector stepsPerSampleV = cyclesPerSample;
-
     // accumulate phase and wrap to generate ticks
-    DSPVector vy{0.f};
     for (int n = 0; n < kFloatsPerDSPVector; ++n)
     {
-      mOmega += stepsPerSampleV[n];
+      mOmega += cyclesPerSample[n];
+      float tick{0.f};
       if (mOmega > 1.0f)
       {
         mOmega -= 1.0f;
-        vy[n] = 1.0f;
+        tick = 1.0f;
       }
+      vy[n] = tick;
     }
+  }
+
+  inline DSPVector operator()(const DSPVector cyclesPerSample)
+  {
+    DSPVector vy;
+    process(cyclesPerSample, vy);
     return vy;
   }
 };
@@ -53,12 +62,12 @@ class TickGen
 class ImpulseGen
 {
   // pick odd table size to get sample-centered sinc and window
-  static constexpr int kTableSize{17};
+  static constexpr int kTableSize{kFloatsPerDSPVector > 17 ? 17 : kFloatsPerDSPVector - 1};
   DSPVector _table;
   static_assert(kTableSize < kFloatsPerDSPVector,
                 "ImpulseGen: table size must be < the DSP vector size.");
 
-  int _outputCounter;
+  int _outputCounter{kTableSize};
   float _omega{0.f};
 
  public:
@@ -77,10 +86,9 @@ class ImpulseGen
   }
   ~ImpulseGen() {}
 
-  inline DSPVector operator()(const DSPVector cyclesPerSample)
+  inline void process(const DSPVector& cyclesPerSample, DSPVector& vy)
   {
     // accumulate phase and wrap to generate ticks
-    DSPVector vy{0.f};
     for (int n = 0; n < kFloatsPerDSPVector; ++n)
     {
       _omega += cyclesPerSample[n];
@@ -92,12 +100,20 @@ class ImpulseGen
         _outputCounter = 0;
       }
 
+      float y{0.f};
       if (_outputCounter < kTableSize)
       {
-        vy[n] = _table[_outputCounter];
+        y = _table[_outputCounter];
         _outputCounter++;
       }
+      vy[n] = y;
     }
+  }
+
+  inline DSPVector operator()(const DSPVector cyclesPerSample)
+  {
+    DSPVector vy;
+    process(cyclesPerSample, vy);
     return vy;
   }
 };
@@ -126,15 +142,20 @@ class NoiseGen
   }
 
   // TODO SIMD
-  inline DSPVector operator()()
+  inline void process(DSPVector& y)
   {
-    DSPVector y;
     for (int i = 0; i < kFloatsPerDSPVector; ++i)
     {
       step();
       uint32_t temp = ((mSeed >> 9) & 0x007FFFFF) | 0x3F800000;
       y[i] = (*reinterpret_cast<float*>(&temp)) * 2.f - 3.f;
     }
+  }
+
+  inline DSPVector operator()()
+  {
+    DSPVector y;
+    process(y);
     return y;
   }
 
@@ -152,10 +173,8 @@ class TestSineGen
  public:
   void clear() { mOmega = 0; }
 
-  DSPVector operator()(const DSPVector freq)
+  void process(const DSPVector& freq, DSPVector& vy)
   {
-    DSPVector vy;
-
     for (int i = 0; i < kFloatsPerDSPVector; ++i)
     {
       float step = ml::kTwoPi * freq[i];
@@ -163,6 +182,12 @@ class TestSineGen
       if (mOmega > ml::kTwoPi) mOmega -= ml::kTwoPi;
       vy[i] = sinf(mOmega);
     }
+  }
+
+  DSPVector operator()(const DSPVector freq)
+  {
+    DSPVector vy;
+    process(freq, vy);
     return vy;
   }
 };
@@ -178,7 +203,7 @@ class PhasorGen
  public:
   void clear(int32_t omega = 0) { mOmega32 = omega; }
 
-  DSPVector operator()(const DSPVector cyclesPerSample)
+  void process(const DSPVector& cyclesPerSample, DSPVector& omegaV)
   {
     constexpr float range(1.0f);
     constexpr float offset(0.5f);
@@ -199,7 +224,13 @@ class PhasorGen
     }
 
     // convert counter to float output range
-    DSPVector omegaV = intToFloat(omega32V) * outputScaleV + DSPVector(offset);
+    omegaV = intToFloat(omega32V) * outputScaleV + DSPVector(offset);
+  }
+
+  DSPVector operator()(const DSPVector cyclesPerSample)
+  {
+    DSPVector omegaV;
+    process(cyclesPerSample, omegaV);
     return omegaV;
   }
 };
@@ -240,24 +271,23 @@ inline DSPVector phasorToSine(DSPVector phasorV)
 {
   constexpr float sqrt2(static_cast<float>(const_math::sqrt(2.0f)));
   constexpr float domain(sqrt2 * 4.f);
-  DSPVector domainScaleV(domain);
-  DSPVector domainOffsetV(-sqrt2);
   constexpr float range(sqrt2 - sqrt2 * sqrt2 * sqrt2 / 6.f);
-  DSPVector scaleV(1.0f / range);
-  DSPVector flipOffsetV(sqrt2 * 2.f);
-  DSPVector zeroV(0.f);
-  DSPVector oneV(1.f);
-  DSPVector oneSixthV(1.0f / 6.f);
+  constexpr float scale(1.0f / range);
+  constexpr float flipOffset(sqrt2 * 2.f);
+  constexpr float oneSixth(1.0f / 6.f);
+
+  // the expressions below are lazy, and evaluated together in one loop when
+  // the result is returned. See MLDSPExpressions.h.
 
   // scale and offset input phasor on (0, 1) to sine approx domain (-sqrt(2), 3*sqrt(2))
-  DSPVector omegaV = phasorV * (domainScaleV) + (domainOffsetV);
+  auto omegaV = lazy(phasorV) * domain + (-sqrt2);
 
   // reverse upper half of phasor to get triangle
   // equivalent to: if (phasor > 0) x = flipOffset - fOmega; else x = fOmega;
-  DSPVector triangleV = select(flipOffsetV - omegaV, omegaV, greaterThan(omegaV, DSPVector(sqrt2)));
+  auto triangleV = select(flipOffset - omegaV, omegaV, greaterThan(omegaV, sqrt2));
 
   // convert triangle to sine approx.
-  return scaleV * triangleV * (oneV - triangleV * triangleV * oneSixthV);
+  return scale * triangleV * (1.f - triangleV * triangleV * oneSixth);
 }
 
 // input: phasor on (0, 1), normalized freq, pulse width
@@ -300,7 +330,19 @@ class SineGen
 
  public:
   void clear() { _phasor.clear(kZeroPhase); }
-  DSPVector operator()(const DSPVector freq) { return phasorToSine(_phasor(freq)); }
+
+  void process(const DSPVector& freq, DSPVector& vy)
+  {
+    _phasor.process(freq, vy);
+    vy = phasorToSine(vy);
+  }
+
+  DSPVector operator()(const DSPVector freq)
+  {
+    DSPVector vy;
+    process(freq, vy);
+    return vy;
+  }
 };
 
 class PulseGen
@@ -309,9 +351,19 @@ class PulseGen
 
  public:
   void clear() { _phasor.clear(0); }
+
+  void process(const DSPVector& freq, const DSPVector& width, DSPVector& vy)
+  {
+    DSPVector omega;
+    _phasor.process(freq, omega);
+    vy = phasorToPulse(omega, freq, width);
+  }
+
   DSPVector operator()(const DSPVector freq, const DSPVector width)
   {
-    return phasorToPulse(_phasor(freq), freq, width);
+    DSPVector vy;
+    process(freq, width, vy);
+    return vy;
   }
 };
 
@@ -321,7 +373,20 @@ class SawGen
 
  public:
   void clear() { _phasor.clear(0); }
-  DSPVector operator()(const DSPVector freq) { return phasorToSaw(_phasor(freq), freq); }
+
+  void process(const DSPVector& freq, DSPVector& vy)
+  {
+    DSPVector omega;
+    _phasor.process(freq, omega);
+    vy = phasorToSaw(omega, freq);
+  }
+
+  DSPVector operator()(const DSPVector freq)
+  {
+    DSPVector vy;
+    process(freq, vy);
+    return vy;
+  }
 };
 
 // ----------------------------------------------------------------
@@ -359,7 +424,7 @@ class LinearGlide
     mVectorsRemaining = 0;
   }
 
-  DSPVector operator()(float f)
+  void process(float f, DSPVector& vy)
   {
     // set target value if different from current value.
     // const float currentValue = mCurrVec[kFloatsPerDSPVector - 1];
@@ -403,7 +468,14 @@ class LinearGlide
       mVectorsRemaining--;
     }
 
-    return mCurrVec;
+    vy = mCurrVec;
+  }
+
+  DSPVector operator()(float f)
+  {
+    DSPVector vy;
+    process(f, vy);
+    return vy;
   }
 };
 
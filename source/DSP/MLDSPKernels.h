@@ -0,0 +1,79 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// MLDSPKernels.h
+// Builds the DSPKernelTable for one instruction set. This is included only by
+// the MLDSPKernels*.cpp files, each of which is compiled with different
+// instruction set flags.
+//
+// Before including, define ML_DSP_KERNEL_NAMESPACE as a namespace unique to
+// the instruction set and ML_DSP_KERNEL_TABLE as the name of the table.
+//
+// MLDSPOps.h is compiled here inside ML_DSP_KERNEL_NAMESPACE, so that its
+// inline functions, built for a wider instruction set, can never be merged by
+// the linker with the ones used by the rest of the program. For the same
+// reason, the kernels must not call into the standard library. The standard
+// headers are included first, outside of the namespace.
+
+#pragma once
+
+#include "MLDSPDispatch.h"
+
+#ifdef ML_DSP_HAS_KERNEL_DISPATCH
+
+#include <float.h>
+#include <immintrin.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <type_traits>
+
+// the kernels in the tables always run directly.
+#undef ML_DSP_KERNEL
+#define ML_DSP_KERNEL(family, opName) (kernels::family::opName)
+
+namespace ML_DSP_KERNEL_NAMESPACE
+{
+#include "MLDSPOps.h"
+}  // namespace ML_DSP_KERNEL_NAMESPACE
+
+#define ML_DSP_KERNEL_ENTRY(family, opName) &ML_DSP_KERNEL_NAMESPACE::ml::kernels::family::opName,
+
+#define ML_DSP_OP1_ENTRY(opName) ML_DSP_KERNEL_ENTRY(op1, opName)
+#define ML_DSP_OP2_ENTRY(opName) ML_DSP_KERNEL_ENTRY(op2, opName)
+#define ML_DSP_OP2_INT32_ENTRY(opName) ML_DSP_KERNEL_ENTRY(op2Int32, opName)
+#define ML_DSP_OP3_ENTRY(opName) ML_DSP_KERNEL_ENTRY(op3, opName)
+#define ML_DSP_OP1_F2I_ENTRY(opName) ML_DSP_KERNEL_ENTRY(op1F2I, opName)
+#define ML_DSP_OP1_I2F_ENTRY(opName) ML_DSP_KERNEL_ENTRY(op1I2F, opName)
+#define ML_DSP_OP2_FF2I_ENTRY(opName) ML_DSP_KERNEL_ENTRY(op2FF2I, opName)
+#define ML_DSP_OP3_FFI2F_ENTRY(opName) ML_DSP_KERNEL_ENTRY(op3FFI2F, opName)
+#define ML_DSP_OP3_III2I_ENTRY(opName) ML_DSP_KERNEL_ENTRY(op3III2I, opName)
+#define ML_DSP_REDUCTION_ENTRY(opName) ML_DSP_KERNEL_ENTRY(reduction, opName)
+#define ML_DSP_LOOKUP_ENTRY(opName) ML_DSP_KERNEL_ENTRY(lookup, opName)
+
+namespace ml
+{
+extern const DSPKernelTable ML_DSP_KERNEL_TABLE = {
+    {ML_DSP_OP1_KERNELS(ML_DSP_OP1_ENTRY)},
+    {ML_DSP_OP2_KERNELS(ML_DSP_OP2_ENTRY)},
+    {ML_DSP_OP2_INT32_KERNELS(ML_DSP_OP2_INT32_ENTRY)},
+    {ML_DSP_OP3_KERNELS(ML_DSP_OP3_ENTRY)},
+    {ML_DSP_OP1_F2I_KERNELS(ML_DSP_OP1_F2I_ENTRY)},
+    {ML_DSP_OP1_I2F_KERNELS(ML_DSP_OP1_I2F_ENTRY)},
+    {ML_DSP_OP2_FF2I_KERNELS(ML_DSP_OP2_FF2I_ENTRY)},
+    {ML_DSP_OP3_FFI2F_KERNELS(ML_DSP_OP3_FFI2F_ENTRY)},
+    {ML_DSP_OP3_III2I_KERNELS(ML_DSP_OP3_III2I_ENTRY)},
+    {ML_DSP_REDUCTION_KERNELS(ML_DSP_REDUCTION_ENTRY)},
+    {ML_DSP_LOOKUP_KERNELS(ML_DSP_LOOKUP_ENTRY)}};
+}  // namespace ml
+
+#endif  // ML_DSP_HAS_KERNEL_DISPATCH
@@ -0,0 +1,11 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// DSPVectorArray operator kernels for AVX-512.
+// Compiled with -mavx512f, see CMakeLists.txt.
+
+#define ML_DSP_KERNEL_NAMESPACE ml_kernels_avx512
+#define ML_DSP_KERNEL_TABLE kDSPKernelsAVX512
+
+#include "MLDSPKernels.h"
@@ -0,0 +1,11 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// DSPVectorArray operator kernels for SSE4.1.
+// Compiled with -msse4.1, see CMakeLists.txt.
+
+#define ML_DSP_KERNEL_NAMESPACE ml_kernels_sse41
+#define ML_DSP_KERNEL_TABLE kDSPKernelsSSE41
+
+#include "MLDSPKernels.h"
@@ -4,13 +4,25 @@
 
 #pragma once
 
-// Here is the DSP vector size, an important constant.
-constexpr int kFloatsPerDSPVector = 64;
+// Here is the DSP vector size, an important constant. It can be changed at
+// build time by defining ML_DSP_VECTOR_SIZE, for example with
+// cmake -DML_VECTOR_SIZE=32. Smaller vectors lower the latency of feedback
+// loops and of VectorProcessBuffer; larger ones lower the per-vector overhead.
+// All code linked into one program must be built with the same size.
+#ifndef ML_DSP_VECTOR_SIZE
+#define ML_DSP_VECTOR_SIZE 64
+#endif
+
+constexpr int kFloatsPerDSPVector = ML_DSP_VECTOR_SIZE;
+
+static_assert((kFloatsPerDSPVector >= 16) && (kFloatsPerDSPVector <= 256) &&
+                  ((kFloatsPerDSPVector & (kFloatsPerDSPVector - 1)) == 0),
+              "ML_DSP_VECTOR_SIZE must be a power of two from 16 to 256.");
 
 // Load definitions for low-level SIMD math.
 // These must define SIMDVectorFloat, SIMDVectorInt, their sizes, and a bunch of
-// operations on them. We are currently only using 4-element vectors on both SSE
-// and NEON.
+// operations on them. SSE and NEON use 4-element vectors. When compiling with
+// AVX2 or AVX-512F enabled, 8- or 16-element vectors are used.
 
 #if (defined __ARM_NEON) || (defined __ARM_NEON__)
 
@@ -19,6 +31,12 @@ constexpr int kFloatsPerDSPVector = 64;
 #define ML_SSE_TO_NEON
 #include "MLDSPMathNEON.h"
 
+#elif (defined __AVX512F__) || (defined __AVX2__)
+
+// AVX2 / AVX-512
+
+#include "MLDSPMathAVX.h"
+
 #else
 
 // SSE2
@@ -27,6 +45,9 @@ constexpr int kFloatsPerDSPVector = 64;
 
 #endif
 
+// tiered transcendental functions, built on the primitives above.
+#include "MLDSPMathTranscendental.h"
+
 // A C++11 implementation of std::integer_sequence from C++14
 // Copyright Jonathan Wakely 2012-2013
 // Distributed under the Boost Software License, Version 1.0.
@@ -80,26 +101,44 @@ using ml_index_sequence = ml_integer_sequence<std::size_t, I...>;
 
 namespace detail
 {
-// Metafunction that generates an ml_integer_sequence of T containing [0, N)
-template <typename T, T Nt, std::size_t N>
+// Joins two sequences of [0, N1) and [0, N2) into one of [0, N1 + N2).
+template <typename S1, typename S2>
+struct concat;
+
+template <typename T, T... I1, T... I2>
+struct concat<ml_integer_sequence<T, I1...>, ml_integer_sequence<T, I2...>>
+{
+  using type = ml_integer_sequence<T, I1..., (sizeof...(I1) + I2)...>;
+};
+
+// Metafunction that generates an ml_integer_sequence of T containing [0, N).
+// Splitting the sequence in halves keeps the recursion depth to log2(N), so
+// long sequences can be made without hitting the template depth limit.
+template <typename T, std::size_t N>
 struct iota
 {
-  static_assert(Nt >= 0, "N cannot be negative");
-  using type = typename iota<T, Nt - 1, N - 1>::type::next;
+  using type =
+      typename concat<typename iota<T, N / 2>::type, typename iota<T, N - N / 2>::type>::type;
 };
 
-// Terminal case of the recursive metafunction.
-template <typename T, T Nt>
-struct iota<T, Nt, 0ul>
+// Terminal cases of the recursive metafunction.
+template <typename T>
+struct iota<T, 0ul>
 {
   using type = ml_integer_sequence<T>;
 };
+
+template <typename T>
+struct iota<T, 1ul>
+{
+  using type = ml_integer_sequence<T, 0>;
+};
 }  // namespace detail
 
 // ml_make_integer_sequence<T, N> is an alias for ml_integer_sequence<T,
 // 0,...N-1>
 template <typename T, T N>
-using ml_make_integer_sequence = typename detail::iota<T, N, N>::type;
+using ml_make_integer_sequence = typename detail::iota<T, N>::type;
 
 template <int N>
 using ml_make_index_sequence = ml_make_integer_sequence<std::size_t, N>;
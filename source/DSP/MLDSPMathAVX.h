@@ -0,0 +1,856 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// MLDSPMathAVX.h
+// AVX2 and AVX-512 implementations of madronalib SIMD primitives.
+// 8-float vectors are used when compiling with AVX2, 16-float vectors when
+// compiling with AVX-512F.
+
+// cephes-derived approximate math functions adapted from code by Julien
+// Pommier, licensed as follows:
+/*
+ Copyright (C) 2007  Julien Pommier
+
+ This software is provided 'as-is', without any express or implied
+ warranty.  In no event will the authors be held liable for any damages
+ arising from the use of this software.
+
+ Permission is granted to anyone to use this software for any purpose,
+ including commercial applications, and to alter it and redistribute it
+ freely, subject to the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not
+ claim that you wrote the original software. If you use this software
+ in a product, an acknowledgment in the product documentation would be
+ appreciated but is not required.
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+ 3. This notice may not be removed or altered from any source distribution.
+
+ (this is the zlib license)
+ */
+
+#include <immintrin.h>
+#include <float.h>
+#include <stdint.h>
+
+#pragma once
+
+#if defined(__AVX512F__)
+
+// ----------------------------------------------------------------
+// AVX-512 types and primitives
+
+typedef __m512 SIMDVectorFloat;
+typedef __m512i SIMDVectorInt;
+
+#define VecF2I _mm512_castps_si512
+#define VecI2F _mm512_castsi512_ps
+
+constexpr int kFloatsPerSIMDVectorBits = 4;
+constexpr int kIntsPerSIMDVectorBits = 4;
+
+#define STATIC_SIMD_CONST(name, val)                                                         \
+  static constexpr SIMDVectorFloat name = {val, val, val, val, val, val, val, val, val, val, \
+                                           val, val, val, val, val, val};
+
+// AVX-512 comparisons produce bit masks. To keep the same interface as the
+// other targets, we expand them to full vectors of all ones or all zeros.
+inline SIMDVectorFloat vecMaskToFloat(__mmask16 m)
+{
+  return _mm512_castsi512_ps(_mm512_maskz_set1_epi32(m, -1));
+}
+
+#define vecAnd(x1, x2) VecI2F(_mm512_and_si512(VecF2I(x1), VecF2I(x2)))
+#define vecAndNot(x1, x2) VecI2F(_mm512_andnot_si512(VecF2I(x1), VecF2I(x2)))
+#define vecOr(x1, x2) VecI2F(_mm512_or_si512(VecF2I(x1), VecF2I(x2)))
+#define vecXor(x1, x2) VecI2F(_mm512_xor_si512(VecF2I(x1), VecF2I(x2)))
+
+// the approximate reciprocal and rsqrt are done on 256-bit halves so that the
+// results match the SSE and AVX2 targets exactly.
+inline SIMDVectorFloat vecRcp(SIMDVectorFloat x)
+{
+  __m256 lo = _mm256_rcp_ps(_mm512_castps512_ps256(x));
+  __m256 hi = _mm256_rcp_ps(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(x), 1)));
+  return _mm512_castpd_ps(
+      _mm512_insertf64x4(_mm512_castps_pd(_mm512_castps256_ps512(lo)), _mm256_castps_pd(hi), 1));
+}
+
+inline SIMDVectorFloat vecRSqrt(SIMDVectorFloat x)
+{
+  __m256 lo = _mm256_rsqrt_ps(_mm512_castps512_ps256(x));
+  __m256 hi = _mm256_rsqrt_ps(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(x), 1)));
+  return _mm512_castpd_ps(
+      _mm512_insertf64x4(_mm512_castps_pd(_mm512_castps256_ps512(lo)), _mm256_castps_pd(hi), 1));
+}
+
+#define vecAdd _mm512_add_ps
+#define vecSub _mm512_sub_ps
+#define vecMul _mm512_mul_ps
+#define vecDiv _mm512_div_ps
+#define vecMin _mm512_min_ps
+#define vecMax _mm512_max_ps
+#define vecSqrt _mm512_sqrt_ps
+
+#define vecEqual(x1, x2) vecMaskToFloat(_mm512_cmp_ps_mask(x1, x2, _CMP_EQ_OQ))
+#define vecNotEqual(x1, x2) vecMaskToFloat(_mm512_cmp_ps_mask(x1, x2, _CMP_NEQ_UQ))
+#define vecGreaterThan(x1, x2) vecMaskToFloat(_mm512_cmp_ps_mask(x1, x2, _CMP_GT_OS))
+#define vecGreaterThanOrEqual(x1, x2) vecMaskToFloat(_mm512_cmp_ps_mask(x1, x2, _CMP_GE_OS))
+#define vecLessThan(x1, x2) vecMaskToFloat(_mm512_cmp_ps_mask(x1, x2, _CMP_LT_OS))
+#define vecLessThanOrEqual(x1, x2) vecMaskToFloat(_mm512_cmp_ps_mask(x1, x2, _CMP_LE_OS))
+
+#define vecSet1 _mm512_set1_ps
+#define vecZeros _mm512_setzero_ps
+
+#define vecStore _mm512_storeu_ps
+#define vecLoad _mm512_loadu_ps
+#define vecStoreUnaligned _mm512_storeu_ps
+#define vecLoadUnaligned _mm512_loadu_ps
+
+#define vecFloor(x) _mm512_roundscale_ps(x, _MM_FROUND_TO_NEG_INF)
+#define vecFloatToIntRound _mm512_cvtps_epi32
+#define vecFloatToIntTruncate _mm512_cvttps_epi32
+#define vecIntToFloat _mm512_cvtepi32_ps
+
+#define vecAddInt _mm512_add_epi32
+#define vecSubInt _mm512_sub_epi32
+#define vecSet1Int _mm512_set1_epi32
+#define vecZerosInt _mm512_setzero_si512
+#define vecAndInt _mm512_and_si512
+#define vecAndNotInt _mm512_andnot_si512
+#define vecShiftLeftInt _mm512_slli_epi32
+#define vecShiftRightInt _mm512_srli_epi32
+#define vecEqualInt(x1, x2) _mm512_maskz_set1_epi32(_mm512_cmpeq_epi32_mask(x1, x2), -1)
+
+// double precision primitives, for DSPVectorArrayD. Each SIMDVectorFloat
+// converts to a low and a high SIMDVectorDouble.
+typedef __m512d SIMDVectorDouble;
+constexpr int kDoublesPerSIMDVector = 8;
+
+#define vecAddD _mm512_add_pd
+#define vecSubD _mm512_sub_pd
+#define vecMulD _mm512_mul_pd
+#define vecDivD _mm512_div_pd
+#define vecMinD _mm512_min_pd
+#define vecMaxD _mm512_max_pd
+#define vecSqrtD _mm512_sqrt_pd
+#define vecAbsD(x) \
+  _mm512_castsi512_pd(_mm512_andnot_si512(_mm512_set1_epi64(1LL << 63), _mm512_castpd_si512(x)))
+#define vecClampD(x1, x2, x3) _mm512_min_pd(_mm512_max_pd(x1, x2), x3)
+#define vecSet1D _mm512_set1_pd
+#define vecZerosD _mm512_setzero_pd
+#define vecStoreD _mm512_storeu_pd
+#define vecLoadD _mm512_loadu_pd
+
+#define vecFloatToDoubleLow(x) _mm512_cvtps_pd(_mm512_castps512_ps256(x))
+#define vecFloatToDoubleHigh(x) \
+  _mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(x), 1)))
+#define vecDoubleToFloat(lo, hi)                                     \
+  _mm512_castpd_ps(_mm512_insertf64x4(                               \
+      _mm512_castps_pd(_mm512_castps256_ps512(_mm512_cvtpd_ps(lo))), \
+      _mm256_castps_pd(_mm512_cvtpd_ps(hi)), 1))
+
+inline SIMDVectorFloat vecSelect(SIMDVectorFloat a, SIMDVectorFloat b, SIMDVectorInt conditionMask)
+{
+  // 0xCA: bitwise (mask ? a : b)
+  return VecI2F(_mm512_ternarylogic_epi32(conditionMask, VecF2I(a), VecF2I(b), 0xCA));
+}
+
+inline SIMDVectorInt vecSelect(SIMDVectorInt a, SIMDVectorInt b, SIMDVectorInt conditionMask)
+{
+  return _mm512_ternarylogic_epi32(conditionMask, a, b, 0xCA);
+}
+
+// load p[i] for each element i of the index vector.
+#define vecGather(p, i) _mm512_i32gather_ps(i, p, 4)
+
+// transpose the square matrix of floats whose rows are v[0] ... v[15].
+inline void vecTranspose(SIMDVectorFloat* v)
+{
+  __m512 t[16];
+
+  // interleave pairs of rows, then pairs of pairs, giving a 4x4 block of the
+  // result in each 128-bit lane.
+  for (int i = 0; i < 16; i += 2)
+  {
+    t[i] = _mm512_unpacklo_ps(v[i], v[i + 1]);
+    t[i + 1] = _mm512_unpackhi_ps(v[i], v[i + 1]);
+  }
+  for (int i = 0; i < 16; i += 4)
+  {
+    v[i] = _mm512_shuffle_ps(t[i], t[i + 2], 0x44);
+    v[i + 1] = _mm512_shuffle_ps(t[i], t[i + 2], 0xEE);
+    v[i + 2] = _mm512_shuffle_ps(t[i + 1], t[i + 3], 0x44);
+    v[i + 3] = _mm512_shuffle_ps(t[i + 1], t[i + 3], 0xEE);
+  }
+
+  // then move the 4x4 blocks into place.
+  for (int i = 0; i < 4; ++i)
+  {
+    t[i] = _mm512_shuffle_f32x4(v[i], v[i + 4], 0x88);
+    t[i + 4] = _mm512_shuffle_f32x4(v[i], v[i + 4], 0xDD);
+    t[i + 8] = _mm512_shuffle_f32x4(v[i + 8], v[i + 12], 0x88);
+    t[i + 12] = _mm512_shuffle_f32x4(v[i + 8], v[i + 12], 0xDD);
+  }
+  for (int i = 0; i < 8; ++i)
+  {
+    v[i] = _mm512_shuffle_f32x4(t[i], t[i + 8], 0x88);
+    v[i + 8] = _mm512_shuffle_f32x4(t[i], t[i + 8], 0xDD);
+  }
+}
+
+// horizontal operations combine halves of the vector at each step, like the
+// SSE versions, so that sums are bit-identical across vector sizes.
+#define ML_AVX512_HORIZONTAL_OP(op256, op128)                                           \
+  __m256 x8 = op256(_mm512_castps512_ps256(v),                                           \
+                    _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(v), 1))); \
+  __m128 x = op128(_mm256_castps256_ps128(x8), _mm256_extractf128_ps(x8, 1));           \
+  __m128 tmp0 = op128(x, _mm_movehl_ps(x, x));                                           \
+  return _mm_cvtss_f32(op128(tmp0, _mm_shuffle_ps(tmp0, tmp0, 1)));
+
+inline float vecSumH(SIMDVectorFloat v) { ML_AVX512_HORIZONTAL_OP(_mm256_add_ps, _mm_add_ps) }
+inline float vecMaxH(SIMDVectorFloat v) { ML_AVX512_HORIZONTAL_OP(_mm256_max_ps, _mm_max_ps) }
+inline float vecMinH(SIMDVectorFloat v) { ML_AVX512_HORIZONTAL_OP(_mm256_min_ps, _mm_min_ps) }
+
+// Given vectors [ ?, ..., ?, 15 ], [ 16, 17, ..., 31 ]
+// Returns [ 15, 16, ..., 30 ]
+inline SIMDVectorFloat vecShuffleRight(SIMDVectorFloat v1, SIMDVectorFloat v2)
+{
+  return VecI2F(_mm512_alignr_epi32(VecF2I(v2), VecF2I(v1), 15));
+}
+
+// Given vectors [ 0, 1, ..., 15 ], [ 16, ?, ..., ? ]
+// Returns [ 1, 2, ..., 16 ]
+inline SIMDVectorFloat vecShuffleLeft(SIMDVectorFloat v1, SIMDVectorFloat v2)
+{
+  return VecI2F(_mm512_alignr_epi32(VecF2I(v2), VecF2I(v1), 1));
+}
+
+#else
+
+// ----------------------------------------------------------------
+// AVX2 types and primitives
+
+typedef __m256 SIMDVectorFloat;
+typedef __m256i SIMDVectorInt;
+
+#define VecF2I _mm256_castps_si256
+#define VecI2F _mm256_castsi256_ps
+
+constexpr int kFloatsPerSIMDVectorBits = 3;
+constexpr int kIntsPerSIMDVectorBits = 3;
+
+#define STATIC_SIMD_CONST(name, val) \
+  static constexpr SIMDVectorFloat name = {val, val, val, val, val, val, val, val};
+
+#define vecAnd _mm256_and_ps
+#define vecAndNot _mm256_andnot_ps
+#define vecOr _mm256_or_ps
+#define vecXor _mm256_xor_ps
+
+#define vecRcp _mm256_rcp_ps
+#define vecRSqrt _mm256_rsqrt_ps
+
+#define vecAdd _mm256_add_ps
+#define vecSub _mm256_sub_ps
+#define vecMul _mm256_mul_ps
+#define vecDiv _mm256_div_ps
+#define vecMin _mm256_min_ps
+#define vecMax _mm256_max_ps
+#define vecSqrt _mm256_sqrt_ps
+
+// predicates are chosen to match the SSE comparisons, including for NaNs.
+#define vecEqual(x1, x2) _mm256_cmp_ps(x1, x2, _CMP_EQ_OQ)
+#define vecNotEqual(x1, x2) _mm256_cmp_ps(x1, x2, _CMP_NEQ_UQ)
+#define vecGreaterThan(x1, x2) _mm256_cmp_ps(x1, x2, _CMP_GT_OS)
+#define vecGreaterThanOrEqual(x1, x2) _mm256_cmp_ps(x1, x2, _CMP_GE_OS)
+#define vecLessThan(x1, x2) _mm256_cmp_ps(x1, x2, _CMP_LT_OS)
+#define vecLessThanOrEqual(x1, x2) _mm256_cmp_ps(x1, x2, _CMP_LE_OS)
+
+#define vecSet1 _mm256_set1_ps
+#define vecZeros _mm256_setzero_ps
+
+#define vecStore _mm256_storeu_ps
+#define vecLoad _mm256_loadu_ps
+#define vecStoreUnaligned _mm256_storeu_ps
+#define vecLoadUnaligned _mm256_loadu_ps
+
+#define vecFloor _mm256_floor_ps
+#define vecFloatToIntRound _mm256_cvtps_epi32
+#define vecFloatToIntTruncate _mm256_cvttps_epi32
+#define vecIntToFloat _mm256_cvtepi32_ps
+
+#define vecAddInt _mm256_add_epi32
+#define vecSubInt _mm256_sub_epi32
+#define vecSet1Int _mm256_set1_epi32
+#define vecZerosInt _mm256_setzero_si256
+#define vecAndInt _mm256_and_si256
+#define vecAndNotInt _mm256_andnot_si256
+#define vecShiftLeftInt _mm256_slli_epi32
+#define vecShiftRightInt _mm256_srli_epi32
+#define vecEqualInt _mm256_cmpeq_epi32
+
+// double precision primitives, for DSPVectorArrayD. Each SIMDVectorFloat
+// converts to a low and a high SIMDVectorDouble.
+typedef __m256d SIMDVectorDouble;
+constexpr int kDoublesPerSIMDVector = 4;
+
+#define vecAddD _mm256_add_pd
+#define vecSubD _mm256_sub_pd
+#define vecMulD _mm256_mul_pd
+#define vecDivD _mm256_div_pd
+#define vecMinD _mm256_min_pd
+#define vecMaxD _mm256_max_pd
+#define vecSqrtD _mm256_sqrt_pd
+#define vecAbsD(x) (_mm256_andnot_pd(_mm256_set1_pd(-0.0), x))
+#define vecClampD(x1, x2, x3) _mm256_min_pd(_mm256_max_pd(x1, x2), x3)
+#define vecSet1D _mm256_set1_pd
+#define vecZerosD _mm256_setzero_pd
+#define vecStoreD _mm256_storeu_pd
+#define vecLoadD _mm256_loadu_pd
+
+#define vecFloatToDoubleLow(x) _mm256_cvtps_pd(_mm256_castps256_ps128(x))
+#define vecFloatToDoubleHigh(x) _mm256_cvtps_pd(_mm256_extractf128_ps(x, 1))
+#define vecDoubleToFloat(lo, hi) \
+  _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(lo)), _mm256_cvtpd_ps(hi), 1)
+
+// select is bitwise, as on the other targets. blendv would only look at the
+// sign bit of each mask element.
+inline SIMDVectorFloat vecSelect(SIMDVectorFloat a, SIMDVectorFloat b, SIMDVectorInt conditionMask)
+{
+  SIMDVectorFloat m = VecI2F(conditionMask);
+  return _mm256_or_ps(_mm256_and_ps(m, a), _mm256_andnot_ps(m, b));
+}
+
+inline SIMDVectorInt vecSelect(SIMDVectorInt a, SIMDVectorInt b, SIMDVectorInt conditionMask)
+{
+  return _mm256_or_si256(_mm256_and_si256(conditionMask, a), _mm256_andnot_si256(conditionMask, b));
+}
+
+// load p[i] for each element i of the index vector.
+#define vecGather(p, i) _mm256_i32gather_ps(p, i, 4)
+
+// transpose the square matrix of floats whose rows are v[0] ... v[7].
+inline void vecTranspose(SIMDVectorFloat* v)
+{
+  __m256 t[8];
+  for (int i = 0; i < 8; i += 2)
+  {
+    t[i] = _mm256_unpacklo_ps(v[i], v[i + 1]);
+    t[i + 1] = _mm256_unpackhi_ps(v[i], v[i + 1]);
+  }
+  for (int i = 0; i < 8; i += 4)
+  {
+    v[i] = _mm256_shuffle_ps(t[i], t[i + 2], 0x44);
+    v[i + 1] = _mm256_shuffle_ps(t[i], t[i + 2], 0xEE);
+    v[i + 2] = _mm256_shuffle_ps(t[i + 1], t[i + 3], 0x44);
+    v[i + 3] = _mm256_shuffle_ps(t[i + 1], t[i + 3], 0xEE);
+  }
+  for (int i = 0; i < 4; ++i)
+  {
+    t[i] = _mm256_permute2f128_ps(v[i], v[i + 4], 0x20);
+    t[i + 4] = _mm256_permute2f128_ps(v[i], v[i + 4], 0x31);
+  }
+  for (int i = 0; i < 8; ++i)
+  {
+    v[i] = t[i];
+  }
+}
+
+// horizontal operations combine halves of the vector at each step, like the
+// SSE versions, so that sums are bit-identical across vector sizes.
+inline float vecSumH(SIMDVectorFloat v)
+{
+  __m128 x = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  __m128 tmp0 = _mm_add_ps(x, _mm_movehl_ps(x, x));
+  __m128 tmp1 = _mm_add_ss(tmp0, _mm_shuffle_ps(tmp0, tmp0, 1));
+  return _mm_cvtss_f32(tmp1);
+}
+
+inline float vecMaxH(SIMDVectorFloat v)
+{
+  __m128 x = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  __m128 tmp0 = _mm_max_ps(x, _mm_movehl_ps(x, x));
+  __m128 tmp1 = _mm_max_ss(tmp0, _mm_shuffle_ps(tmp0, tmp0, 1));
+  return _mm_cvtss_f32(tmp1);
+}
+
+inline float vecMinH(SIMDVectorFloat v)
+{
+  __m128 x = _mm_min_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  __m128 tmp0 = _mm_min_ps(x, _mm_movehl_ps(x, x));
+  __m128 tmp1 = _mm_min_ss(tmp0, _mm_shuffle_ps(tmp0, tmp0, 1));
+  return _mm_cvtss_f32(tmp1);
+}
+
+// Given vectors [ ?, ..., ?, 7 ], [ 8, 9, ..., 15 ]
+// Returns [ 7, 8, ..., 14 ]
+inline SIMDVectorFloat vecShuffleRight(SIMDVectorFloat v1, SIMDVectorFloat v2)
+{
+  // t = [ v1 high half, v2 low half ]
+  SIMDVectorInt t = VecF2I(_mm256_permute2f128_ps(v1, v2, 0x21));
+  return VecI2F(_mm256_alignr_epi8(VecF2I(v2), t, 12));
+}
+
+// Given vectors [ 0, 1, ..., 7 ], [ 8, ?, ..., ? ]
+// Returns [ 1, 2, ..., 8 ]
+inline SIMDVectorFloat vecShuffleLeft(SIMDVectorFloat v1, SIMDVectorFloat v2)
+{
+  SIMDVectorInt t = VecF2I(_mm256_permute2f128_ps(v1, v2, 0x21));
+  return VecI2F(_mm256_alignr_epi8(t, VecF2I(v1), 4));
+}
+
+#endif  // __AVX512F__
+
+// ----------------------------------------------------------------
+// primitives common to both widths, defined in terms of the above
+
+constexpr int kFloatsPerSIMDVector = 1 << kFloatsPerSIMDVectorBits;
+constexpr int kSIMDVectorsPerDSPVector = kFloatsPerDSPVector / kFloatsPerSIMDVector;
+constexpr int kBytesPerSIMDVector = kFloatsPerSIMDVector * sizeof(float);
+constexpr int kSIMDVectorMask = ~(kBytesPerSIMDVector - 1);
+constexpr int kIntsPerSIMDVector = 1 << kIntsPerSIMDVectorBits;
+
+inline bool isSIMDAligned(float* p)
+{
+  uintptr_t pM = (uintptr_t)p;
+  return ((pM & kSIMDVectorMask) == 0);
+}
+
+// With AVX, the unaligned load and store instructions are as fast as the
+// aligned ones when the data is aligned. We use them everywhere so that
+// DSPVectors in memory allocated without over-alignment still work.
+
+#define vecDivApprox(x1, x2) (vecMul(x1, vecRcp(x2)))
+#define vecSqrtApprox(x) (vecMul(x, vecRSqrt(x)))
+#define vecAbs(x) (vecAndNot(vecSet1(-0.0f), x))
+
+#define vecSign(x) \
+  (vecAnd(vecOr(vecAnd(vecSet1(-0.0f), x), vecSet1(1.0f)), vecNotEqual(vecSet1(-0.0f), x)))
+
+#define vecSignBit(x) (vecOr(vecAnd(vecSet1(-0.0f), x), vecSet1(1.0f)))
+#define vecClamp(x1, x2, x3) vecMin(vecMax(x1, x2), x3)
+#define vecWithin(x1, x2, x3) vecAnd(vecGreaterThanOrEqual(x1, x2), vecLessThan(x1, x3))
+
+#define vecOnes() vecEqual(vecZeros(), vecZeros())
+
+typedef union
+{
+  SIMDVectorFloat v;
+  float f[kFloatsPerSIMDVector];
+} SIMDVectorFloatUnion;
+
+typedef union
+{
+  SIMDVectorInt v;
+  uint32_t i[kIntsPerSIMDVector];
+} SIMDVectorIntUnion;
+
+inline SIMDVectorInt vecSetInt1(uint32_t a) { return vecSet1Int(a); }
+
+inline std::ostream& operator<<(std::ostream& out, SIMDVectorFloat v)
+{
+  SIMDVectorFloatUnion u;
+  u.v = v;
+  out << "[";
+  for (int i = 0; i < kFloatsPerSIMDVector; ++i)
+  {
+    out << u.f[i];
+    if (i < kFloatsPerSIMDVector - 1) out << ", ";
+  }
+  out << "]";
+  return out;
+}
+
+inline std::ostream& operator<<(std::ostream& out, SIMDVectorInt v)
+{
+  SIMDVectorIntUnion u;
+  u.v = v;
+  out << "[";
+  for (int i = 0; i < kIntsPerSIMDVector; ++i)
+  {
+    out << u.i[i];
+    if (i < kIntsPerSIMDVector - 1) out << ", ";
+  }
+  out << "]";
+  return out;
+}
+
+// ----------------------------------------------------------------
+// cephes-derived functions. These follow the SSE versions step by step.
+
+/* natural logarithm computed for 8 or 16 simultaneous floats
+ return NaN for x <= 0
+ */
+inline SIMDVectorFloat vecLog(SIMDVectorFloat x)
+{
+  SIMDVectorInt emm0;
+  SIMDVectorFloat one = vecSet1(1.0f);
+  SIMDVectorFloat invalid_mask = vecLessThanOrEqual(x, vecZeros());
+
+  x = vecMax(x, VecI2F(vecSet1Int(0x00800000))); /* cut off denormalized stuff */
+
+  emm0 = vecShiftRightInt(VecF2I(x), 23);
+
+  /* keep only the fractional part */
+  x = vecAnd(x, VecI2F(vecSet1Int(~0x7f800000)));
+  x = vecOr(x, vecSet1(0.5f));
+
+  emm0 = vecSubInt(emm0, vecSet1Int(0x7f));
+  SIMDVectorFloat e = vecIntToFloat(emm0);
+
+  e = vecAdd(e, one);
+
+  SIMDVectorFloat mask = vecLessThan(x, vecSet1(0.707106781186547524f));
+  SIMDVectorFloat tmp = vecAnd(x, mask);
+  x = vecSub(x, one);
+  e = vecSub(e, vecAnd(one, mask));
+  x = vecAdd(x, tmp);
+
+  SIMDVectorFloat z = vecMul(x, x);
+
+  SIMDVectorFloat y = vecSet1(7.0376836292E-2f);
+  y = vecMul(y, x);
+  y = vecAdd(y, vecSet1(-1.1514610310E-1f));
+  y = vecMul(y, x);
+  y = vecAdd(y, vecSet1(1.1676998740E-1f));
+  y = vecMul(y, x);
+  y = vecAdd(y, vecSet1(-1.2420140846E-1f));
+  y = vecMul(y, x);
+  y = vecAdd(y, vecSet1(+1.4249322787E-1f));
+  y = vecMul(y, x);
+  y = vecAdd(y, vecSet1(-1.6668057665E-1f));
+  y = vecMul(y, x);
+  y = vecAdd(y, vecSet1(+2.0000714765E-1f));
+  y = vecMul(y, x);
+  y = vecAdd(y, vecSet1(-2.4999993993E-1f));
+  y = vecMul(y, x);
+  y = vecAdd(y, vecSet1(+3.3333331174E-1f));
+  y = vecMul(y, x);
+
+  y = vecMul(y, z);
+
+  tmp = vecMul(e, vecSet1(-2.12194440e-4f));
+  y = vecAdd(y, tmp);
+
+  tmp = vecMul(z, vecSet1(0.5f));
+  y = vecSub(y, tmp);
+
+  tmp = vecMul(e, vecSet1(0.693359375f));
+  x = vecAdd(x, y);
+  x = vecAdd(x, tmp);
+  x = vecOr(x, invalid_mask);  // negative arg will be NAN
+  return x;
+}
+
+inline SIMDVectorFloat vecExp(SIMDVectorFloat x)
+{
+  SIMDVectorFloat tmp, fx;
+  SIMDVectorInt emm0;
+  SIMDVectorFloat one = vecSet1(1.0f);
+
+  x = vecMin(x, vecSet1(88.3762626647949f));
+  x = vecMax(x, vecSet1(-88.3762626647949f));
+
+  /* express exp(x) as exp(g + n*log(2)) */
+  fx = vecMul(x, vecSet1(1.44269504088896341f));
+  fx = vecAdd(fx, vecSet1(0.5f));
+
+  fx = vecFloor(fx);
+
+  tmp = vecMul(fx, vecSet1(0.693359375f));
+  SIMDVectorFloat z = vecMul(fx, vecSet1(-2.12194440e-4f));
+  x = vecSub(x, tmp);
+  x = vecSub(x, z);
+  z = vecMul(x, x);
+
+  SIMDVectorFloat y = vecSet1(1.9875691500E-4f);
+  y = vecMul(y, x);
+  y = vecAdd(y, vecSet1(1.3981999507E-3f));
+  y = vecMul(y, x);
+  y = vecAdd(y, vecSet1(8.3334519073E-3f));
+  y = vecMul(y, x);
+  y = vecAdd(y, vecSet1(4.1665795894E-2f));
+  y = vecMul(y, x);
+  y = vecAdd(y, vecSet1(1.6666665459E-1f));
+  y = vecMul(y, x);
+  y = vecAdd(y, vecSet1(5.0000001201E-1f));
+  y = vecMul(y, z);
+  y = vecAdd(y, x);
+  y = vecAdd(y, one);
+
+  /* build 2^n */
+  emm0 = vecFloatToIntTruncate(fx);
+  emm0 = vecAddInt(emm0, vecSet1Int(0x7f));
+  emm0 = vecShiftLeftInt(emm0, 23);
+  SIMDVectorFloat pow2n = VecI2F(emm0);
+
+  y = vecMul(y, pow2n);
+  return y;
+}
+
+// shared range reduction for sin and cos.
+// x: abs(input), returns reduced x and sets j to the octant.
+inline SIMDVectorFloat vecTrigReduce(SIMDVectorFloat x, SIMDVectorInt& j)
+{
+  /* scale by 4/Pi */
+  SIMDVectorFloat y = vecMul(x, vecSet1(1.27323954473516f));
+
+  /* j=(j+1) & (~1) (see the cephes sources) */
+  j = vecFloatToIntTruncate(y);
+  j = vecAddInt(j, vecSet1Int(1));
+  j = vecAndInt(j, vecSet1Int(~1));
+  y = vecIntToFloat(j);
+
+  /* The magic pass: "Extended precision modular arithmetic"
+   x = ((x - y * DP1) - y * DP2) - y * DP3; */
+  x = vecAdd(x, vecMul(y, vecSet1(-0.78515625f)));
+  x = vecAdd(x, vecMul(y, vecSet1(-2.4187564849853515625e-4f)));
+  x = vecAdd(x, vecMul(y, vecSet1(-3.77489497744594108e-8f)));
+  return x;
+}
+
+/* Evaluate the first polynom  (0 <= x <= Pi/4) */
+inline SIMDVectorFloat vecTrigCosPoly(SIMDVectorFloat z)
+{
+  SIMDVectorFloat y = vecSet1(2.443315711809948E-005f);
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(-1.388731625493765E-003f));
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(4.166664568298827E-002f));
+  y = vecMul(y, z);
+  y = vecMul(y, z);
+  SIMDVectorFloat tmp = vecMul(z, vecSet1(0.5f));
+  y = vecSub(y, tmp);
+  y = vecAdd(y, vecSet1(1.0f));
+  return y;
+}
+
+/* Evaluate the second polynom  (Pi/4 <= x <= 0) */
+inline SIMDVectorFloat vecTrigSinPoly(SIMDVectorFloat x, SIMDVectorFloat z)
+{
+  SIMDVectorFloat y2 = vecSet1(-1.9515295891E-4f);
+  y2 = vecMul(y2, z);
+  y2 = vecAdd(y2, vecSet1(8.3321608736E-3f));
+  y2 = vecMul(y2, z);
+  y2 = vecAdd(y2, vecSet1(-1.6666654611E-1f));
+  y2 = vecMul(y2, z);
+  y2 = vecMul(y2, x);
+  y2 = vecAdd(y2, x);
+  return y2;
+}
+
+inline SIMDVectorFloat vecSin(SIMDVectorFloat x)
+{
+  SIMDVectorInt emm0, emm2;
+
+  /* extract the sign bit (upper one) */
+  SIMDVectorFloat sign_bit = vecAnd(x, vecSet1(-0.0f));
+  /* take the absolute value */
+  x = vecAbs(x);
+  x = vecTrigReduce(x, emm2);
+
+  /* get the swap sign flag */
+  emm0 = vecAndInt(emm2, vecSet1Int(4));
+  emm0 = vecShiftLeftInt(emm0, 29);
+
+  /* get the polynom selection mask */
+  emm2 = vecAndInt(emm2, vecSet1Int(2));
+  emm2 = vecEqualInt(emm2, vecZerosInt());
+
+  SIMDVectorFloat swap_sign_bit = VecI2F(emm0);
+  SIMDVectorFloat poly_mask = VecI2F(emm2);
+  sign_bit = vecXor(sign_bit, swap_sign_bit);
+
+  SIMDVectorFloat z = vecMul(x, x);
+  SIMDVectorFloat y = vecTrigCosPoly(z);
+  SIMDVectorFloat y2 = vecTrigSinPoly(x, z);
+
+  /* select the correct result from the two polynoms */
+  y2 = vecAnd(poly_mask, y2);
+  y = vecAndNot(poly_mask, y);
+  y = vecAdd(y, y2);
+  /* update the sign */
+  return vecXor(y, sign_bit);
+}
+
+inline SIMDVectorFloat vecCos(SIMDVectorFloat x)
+{
+  SIMDVectorInt emm0, emm2;
+
+  x = vecAbs(x);
+  x = vecTrigReduce(x, emm2);
+  emm2 = vecSubInt(emm2, vecSet1Int(2));
+
+  /* get the swap sign flag */
+  emm0 = vecAndNotInt(emm2, vecSet1Int(4));
+  emm0 = vecShiftLeftInt(emm0, 29);
+
+  /* get the polynom selection mask */
+  emm2 = vecAndInt(emm2, vecSet1Int(2));
+  emm2 = vecEqualInt(emm2, vecZerosInt());
+
+  SIMDVectorFloat sign_bit = VecI2F(emm0);
+  SIMDVectorFloat poly_mask = VecI2F(emm2);
+
+  SIMDVectorFloat z = vecMul(x, x);
+  SIMDVectorFloat y = vecTrigCosPoly(z);
+  SIMDVectorFloat y2 = vecTrigSinPoly(x, z);
+
+  /* select the correct result from the two polynoms */
+  y2 = vecAnd(poly_mask, y2);
+  y = vecAndNot(poly_mask, y);
+  y = vecAdd(y, y2);
+  /* update the sign */
+  return vecXor(y, sign_bit);
+}
+
+inline void vecSinCos(SIMDVectorFloat x, SIMDVectorFloat* s, SIMDVectorFloat* c)
+{
+  SIMDVectorInt emm0, emm2, emm4;
+
+  SIMDVectorFloat sign_bit_sin = vecAnd(x, vecSet1(-0.0f));
+  x = vecAbs(x);
+  x = vecTrigReduce(x, emm2);
+  emm4 = emm2;
+
+  /* get the swap sign flag for the sine */
+  emm0 = vecAndInt(emm2, vecSet1Int(4));
+  emm0 = vecShiftLeftInt(emm0, 29);
+  SIMDVectorFloat swap_sign_bit_sin = VecI2F(emm0);
+
+  /* get the polynom selection mask for the sine*/
+  emm2 = vecAndInt(emm2, vecSet1Int(2));
+  emm2 = vecEqualInt(emm2, vecZerosInt());
+  SIMDVectorFloat poly_mask = VecI2F(emm2);
+
+  emm4 = vecSubInt(emm4, vecSet1Int(2));
+  emm4 = vecAndNotInt(emm4, vecSet1Int(4));
+  emm4 = vecShiftLeftInt(emm4, 29);
+  SIMDVectorFloat sign_bit_cos = VecI2F(emm4);
+
+  sign_bit_sin = vecXor(sign_bit_sin, swap_sign_bit_sin);
+
+  SIMDVectorFloat z = vecMul(x, x);
+  SIMDVectorFloat y = vecTrigCosPoly(z);
+  SIMDVectorFloat y2 = vecTrigSinPoly(x, z);
+
+  /* select the correct result from the two polynoms */
+  SIMDVectorFloat ysin2 = vecAnd(poly_mask, y2);
+  SIMDVectorFloat ysin1 = vecAndNot(poly_mask, y);
+  y2 = vecSub(y2, ysin2);
+  y = vecSub(y, ysin1);
+
+  /* update the sign */
+  *s = vecXor(vecAdd(ysin1, ysin2), sign_bit_sin);
+  *c = vecXor(vecAdd(y, y2), sign_bit_cos);
+}
+
+// ----------------------------------------------------------------
+// fast polynomial approximations, see MLDSPMathSSE.h for details.
+
+STATIC_SIMD_CONST(kSinC1Vec, 0.99997937679290771484375f);
+STATIC_SIMD_CONST(kSinC2Vec, -0.166624367237091064453125f);
+STATIC_SIMD_CONST(kSinC3Vec, 8.30897875130176544189453125e-3f);
+STATIC_SIMD_CONST(kSinC4Vec, -1.92649182281456887722015380859375e-4f);
+STATIC_SIMD_CONST(kSinC5Vec, 2.147840177713078446686267852783203125e-6f);
+
+inline SIMDVectorFloat vecSinApprox(SIMDVectorFloat x)
+{
+  SIMDVectorFloat x2 = vecMul(x, x);
+  return vecMul(
+      x, vecAdd(kSinC1Vec,
+                vecMul(x2, vecAdd(kSinC2Vec,
+                                  vecMul(x2, vecAdd(kSinC3Vec,
+                                                    vecMul(x2, vecAdd(kSinC4Vec,
+                                                                      vecMul(x2, kSinC5Vec)))))))));
+}
+
+STATIC_SIMD_CONST(kCosC1Vec, 0.999959766864776611328125f);
+STATIC_SIMD_CONST(kCosC2Vec, -0.4997930824756622314453125f);
+STATIC_SIMD_CONST(kCosC3Vec, 4.1496001183986663818359375e-2f);
+STATIC_SIMD_CONST(kCosC4Vec, -1.33926304988563060760498046875e-3f);
+STATIC_SIMD_CONST(kCosC5Vec, 1.8791708498611114919185638427734375e-5f);
+
+inline SIMDVectorFloat vecCosApprox(SIMDVectorFloat x)
+{
+  SIMDVectorFloat x2 = vecMul(x, x);
+  return vecAdd(
+      kCosC1Vec,
+      vecMul(x2, vecAdd(kCosC2Vec,
+                        vecMul(x2, vecAdd(kCosC3Vec,
+                                          vecMul(x2, vecAdd(kCosC4Vec, vecMul(x2, kCosC5Vec))))))));
+}
+
+STATIC_SIMD_CONST(kExpC1Vec, 2139095040.f);
+STATIC_SIMD_CONST(kExpC2Vec, 12102203.1615614f);
+STATIC_SIMD_CONST(kExpC3Vec, 1065353216.f);
+STATIC_SIMD_CONST(kExpC4Vec, 0.510397365625862338668154f);
+STATIC_SIMD_CONST(kExpC5Vec, 0.310670891004095530771135f);
+STATIC_SIMD_CONST(kExpC6Vec, 0.168143436463395944830000f);
+STATIC_SIMD_CONST(kExpC7Vec, -2.88093587581985443087955e-3f);
+STATIC_SIMD_CONST(kExpC8Vec, 1.3671023382430374383648148e-2f);
+
+inline SIMDVectorFloat vecExpApprox(SIMDVectorFloat x)
+{
+  SIMDVectorFloat val2, val3, val4;
+  SIMDVectorInt val4i;
+
+  val2 = vecAdd(vecMul(x, kExpC2Vec), kExpC3Vec);
+  val3 = vecMin(val2, kExpC1Vec);
+  val4 = vecMax(val3, vecZeros());
+  val4i = vecFloatToIntTruncate(val4);
+
+  SIMDVectorFloat xu = vecAnd(VecI2F(val4i), VecI2F(vecSet1Int(0x7F800000)));
+  SIMDVectorFloat b =
+      vecOr(vecAnd(VecI2F(val4i), VecI2F(vecSet1Int(0x7FFFFF))), VecI2F(vecSet1Int(0x3F800000)));
+
+  return vecMul(
+      xu, (vecAdd(kExpC4Vec,
+                  vecMul(b, vecAdd(kExpC5Vec,
+                                   vecMul(b, vecAdd(kExpC6Vec,
+                                                    vecMul(b, vecAdd(kExpC7Vec,
+                                                                     vecMul(b, kExpC8Vec))))))))));
+}
+
+STATIC_SIMD_CONST(kLogC1Vec, -89.970756366f);
+STATIC_SIMD_CONST(kLogC2Vec, 3.529304993f);
+STATIC_SIMD_CONST(kLogC3Vec, -2.461222105f);
+STATIC_SIMD_CONST(kLogC4Vec, 1.130626167f);
+STATIC_SIMD_CONST(kLogC5Vec, -0.288739945f);
+STATIC_SIMD_CONST(kLogC6Vec, 3.110401639e-2f);
+STATIC_SIMD_CONST(kLogC7Vec, 0.69314718055995f);
+
+inline SIMDVectorFloat vecLogApprox(SIMDVectorFloat val)
+{
+  SIMDVectorInt valAsInt = VecF2I(val);
+  SIMDVectorInt expi = vecShiftRightInt(valAsInt, 23);
+  SIMDVectorFloat addcst =
+      vecSelect(kLogC1Vec, vecSet1(FLT_MIN), VecF2I(vecGreaterThan(val, vecZeros())));
+  SIMDVectorFloat x =
+      vecOr(vecAnd(val, VecI2F(vecSet1Int(0x7FFFFF))), VecI2F(vecSet1Int(0x3F800000)));
+
+  SIMDVectorFloat poly = vecMul(
+      x, vecAdd(kLogC2Vec,
+                vecMul(x, vecAdd(kLogC3Vec,
+                                 vecMul(x, vecAdd(kLogC4Vec,
+                                                  vecMul(x, vecAdd(kLogC5Vec,
+                                                                   vecMul(x, kLogC6Vec)))))))));
+
+  SIMDVectorFloat addCstResult = vecAdd(addcst, vecMul(kLogC7Vec, vecIntToFloat(expi)));
+  return vecAdd(poly, addCstResult);
+}
+
+inline SIMDVectorFloat vecIntPart(SIMDVectorFloat val)
+{
+  SIMDVectorInt vi = vecFloatToIntTruncate(val);  // convert with truncate
+  return (vecIntToFloat(vi));
+}
+
+inline SIMDVectorFloat vecFracPart(SIMDVectorFloat val)
+{
+  SIMDVectorInt vi = vecFloatToIntTruncate(val);  // convert with truncate
+  SIMDVectorFloat intPart = vecIntToFloat(vi);
+  return vecSub(val, intPart);
+}
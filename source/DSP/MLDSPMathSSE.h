@@ -31,6 +31,9 @@
 
 #ifndef ML_SSE_TO_NEON
 #include <emmintrin.h>
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
 #endif
 
 #include <float.h>
@@ -74,6 +77,7 @@ inline bool isSIMDAligned(float* p)
 #define vecSub _mm_sub_ps
 #define vecMul _mm_mul_ps
 #define vecDiv _mm_div_ps
+#define vecRcp _mm_rcp_ps
 #define vecDivApprox(x1, x2) (_mm_mul_ps(x1, _mm_rcp_ps(x2)))
 #define vecMin _mm_min_ps
 #define vecMax _mm_max_ps
@@ -111,10 +115,12 @@ inline bool isSIMDAligned(float* p)
 #define vecLoadUnaligned _mm_loadu_ps
 
 #define vecAnd _mm_and_ps
+#define vecAndNot _mm_andnot_ps
 #define vecOr _mm_or_ps
+#define vecXor _mm_xor_ps
 
 #define vecZeros _mm_setzero_ps
-#define vecOnes vecEqual(vecZeros, vecZeros)
+#define vecOnes() vecEqual(vecZeros(), vecZeros())
 
 #define vecShiftLeft _mm_slli_si128
 #define vecShiftRight _mm_srli_si128
@@ -126,6 +132,35 @@ inline bool isSIMDAligned(float* p)
 #define vecAddInt _mm_add_epi32
 #define vecSubInt _mm_sub_epi32
 #define vecSet1Int _mm_set1_epi32
+#define vecZerosInt _mm_setzero_si128
+#define vecAndInt _mm_and_si128
+#define vecAndNotInt _mm_andnot_si128
+#define vecShiftLeftInt _mm_slli_epi32
+#define vecShiftRightInt _mm_srli_epi32
+#define vecEqualInt _mm_cmpeq_epi32
+
+// double precision primitives, for DSPVectorArrayD. Each SIMDVectorFloat
+// converts to a low and a high SIMDVectorDouble.
+typedef __m128d SIMDVectorDouble;
+constexpr int kDoublesPerSIMDVector = 2;
+
+#define vecAddD _mm_add_pd
+#define vecSubD _mm_sub_pd
+#define vecMulD _mm_mul_pd
+#define vecDivD _mm_div_pd
+#define vecMinD _mm_min_pd
+#define vecMaxD _mm_max_pd
+#define vecSqrtD _mm_sqrt_pd
+#define vecAbsD(x) (_mm_andnot_pd(_mm_set1_pd(-0.0), x))
+#define vecClampD(x1, x2, x3) _mm_min_pd(_mm_max_pd(x1, x2), x3)
+#define vecSet1D _mm_set1_pd
+#define vecZerosD _mm_setzero_pd
+#define vecStoreD _mm_store_pd
+#define vecLoadD _mm_load_pd
+
+#define vecFloatToDoubleLow(x) _mm_cvtps_pd(x)
+#define vecFloatToDoubleHigh(x) _mm_cvtps_pd(_mm_movehl_ps(x, x))
+#define vecDoubleToFloat(lo, hi) _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi))
 
 typedef union
 {
@@ -221,8 +256,35 @@ inline SIMDVectorInt vecSelect(SIMDVectorInt a, SIMDVectorInt b, SIMDVectorInt c
                       _mm_and_si128(_mm_xor_si128(conditionMask, ones), b));
 }
 
+// ----------------------------------------------------------------
+#pragma mark gather
+
+// load p[i] for each element i of the index vector. There is no gather
+// instruction before AVX2, so the elements are loaded one at a time.
+inline SIMDVectorFloat vecGather(const float* p, SIMDVectorInt idx)
+{
+  alignas(16) int32_t i[4];
+  _mm_store_si128(reinterpret_cast<__m128i*>(i), idx);
+  return _mm_setr_ps(p[i[0]], p[i[1]], p[i[2]], p[i[3]]);
+}
+
+// transpose the square matrix of floats whose rows are v[0] ... v[3].
+inline void vecTranspose(SIMDVectorFloat* v)
+{
+  __m128 t0 = _mm_unpacklo_ps(v[0], v[1]);
+  __m128 t1 = _mm_unpacklo_ps(v[2], v[3]);
+  __m128 t2 = _mm_unpackhi_ps(v[0], v[1]);
+  __m128 t3 = _mm_unpackhi_ps(v[2], v[3]);
+  v[0] = _mm_movelh_ps(t0, t1);
+  v[1] = _mm_movehl_ps(t1, t0);
+  v[2] = _mm_movelh_ps(t2, t3);
+  v[3] = _mm_movehl_ps(t3, t2);
+}
+
 // ----------------------------------------------------------------
 // horizontal operations returning float
+// these combine halves of the vector at each step. Wider targets do the
+// same, so that sums are bit-identical across vector sizes.
 
 inline float vecSumH(SIMDVectorFloat v)
 {
@@ -380,6 +442,9 @@ inline SIMDVectorFloat vecExp(SIMDVectorFloat x)
   fx = _mm_mul_ps(x, *(SIMDVectorFloat*)_ps_cephes_LOG2EF);
   fx = _mm_add_ps(fx, *(SIMDVectorFloat*)_ps_0p5);
 
+#if defined(__SSE4_1__) && !defined(ML_SSE_TO_NEON)
+  fx = _mm_floor_ps(fx);
+#else
   /* how to perform a floorf with SSE: just below */
   emm0 = _mm_cvttps_epi32(fx);
   tmp = _mm_cvtepi32_ps(emm0);
@@ -388,6 +453,7 @@ inline SIMDVectorFloat vecExp(SIMDVectorFloat x)
   SIMDVectorFloat mask = _mm_cmpgt_ps(tmp, fx);
   mask = _mm_and_ps(mask, one);
   fx = _mm_sub_ps(tmp, mask);
+#endif
 
   tmp = _mm_mul_ps(fx, *(SIMDVectorFloat*)_ps_cephes_exp_C1);
   SIMDVectorFloat z = _mm_mul_ps(fx, *(SIMDVectorFloat*)_ps_cephes_exp_C2);
@@ -711,6 +777,7 @@ inline void vecSinCos(SIMDVectorFloat x, SIMDVectorFloat* s, SIMDVectorFloat* c)
 }
 
 #define STATIC_M128_CONST(name, val) static constexpr __m128 name = {val, val, val, val};
+#define STATIC_SIMD_CONST(name, val) STATIC_M128_CONST(name, val)
 
 // fast polynomial approximations
 // from scalar code by Jacques-Henri Jourdan <jourgun@gmail.com>
@@ -0,0 +1,419 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// MLDSPMathTranscendental.h
+// SIMD tanh, atan, atan2, sinh, tan and pow in three accuracy tiers.
+//
+// These are written in terms of the vec* primitives, so they are the same on
+// every target and give the same results with any SIMD vector width. Each
+// function comes in three versions:
+//
+//   vecAtan()        precise: within a few ULP of the correctly rounded result,
+//                    using cephes-derived polynomials and range reduction.
+//   vecAtanApprox()  medium: relative error around 1e-5 or better, a good
+//                    choice for filter coefficients.
+//   vecAtanFast()    fast: relative error around 1e-3 or better, for
+//                    saturators and control signals. vecPowFast() is less
+//                    accurate, see below.
+//
+// The measured errors of every tier are printed by the transcendentalTests
+// target, see Tests/transcendentals. Tiers that are accurate only to an
+// absolute error near zero crossings say so below.
+
+#pragma once
+
+// ----------------------------------------------------------------
+// utilities
+
+constexpr float kPiF = 3.14159265358979323846f;
+constexpr float kHalfPiF = 1.57079632679489661923f;
+constexpr float kQuarterPiF = 0.78539816339744830962f;
+
+// copy the sign of s to the non-negative value x.
+inline SIMDVectorFloat vecCopySign(SIMDVectorFloat x, SIMDVectorFloat s)
+{
+  return vecOr(x, vecAnd(s, vecSet1(-0.0f)));
+}
+
+// floor(x) as ints, for x within the int range.
+inline SIMDVectorInt vecFloorToInt(SIMDVectorFloat x)
+{
+  SIMDVectorInt i = vecFloatToIntTruncate(x);
+
+  // subtract one where truncation rounded up. The comparison mask is -1 there.
+  return vecAddInt(i, VecF2I(vecLessThan(x, vecIntToFloat(i))));
+}
+
+// 2^i for int i in [-126, 127].
+inline SIMDVectorFloat vecPow2Int(SIMDVectorInt i)
+{
+  return VecI2F(vecShiftLeftInt(vecAddInt(i, vecSet1Int(0x7f)), 23));
+}
+
+// ----------------------------------------------------------------
+// tanh
+
+// cephes tanhf, given ax = |x| and e = exp(2 ax). 1 - 2/(e + 1) above 0.625,
+// a polynomial below.
+inline SIMDVectorFloat vecTanhFromExp(SIMDVectorFloat x, SIMDVectorFloat ax, SIMDVectorFloat e)
+{
+  SIMDVectorFloat large = vecSub(vecSet1(1.f), vecDiv(vecSet1(2.f), vecAdd(e, vecSet1(1.f))));
+
+  SIMDVectorFloat z = vecMul(ax, ax);
+  SIMDVectorFloat y = vecSet1(-5.70498872745E-3f);
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(2.06390887954E-2f));
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(-5.37397155531E-2f));
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(1.33314422036E-1f));
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(-3.33332819422E-1f));
+  y = vecMul(y, z);
+  y = vecMul(y, ax);
+  SIMDVectorFloat small = vecAdd(y, ax);
+
+  SIMDVectorFloat r = vecSelect(small, large, VecF2I(vecLessThan(ax, vecSet1(0.625f))));
+  return vecCopySign(r, x);
+}
+
+// precise: cephes tanhf.
+inline SIMDVectorFloat vecTanh(SIMDVectorFloat x)
+{
+  SIMDVectorFloat ax = vecAbs(x);
+  return vecTanhFromExp(x, ax, vecExp(vecAdd(ax, ax)));
+}
+
+// medium: the same, with the approximate exp above 0.625.
+inline SIMDVectorFloat vecTanhApprox(SIMDVectorFloat x)
+{
+  SIMDVectorFloat ax = vecMin(vecAbs(x), vecSet1(9.f));
+  return vecTanhFromExp(x, ax, vecExpApprox(vecAdd(ax, ax)));
+}
+
+// fast: a [7/6] Pade approximant, clipped to 1 where it crosses 1.
+inline SIMDVectorFloat vecTanhFast(SIMDVectorFloat x)
+{
+  SIMDVectorFloat ax = vecMin(vecAbs(x), vecSet1(4.97f));
+  SIMDVectorFloat z = vecMul(ax, ax);
+
+  SIMDVectorFloat p = vecAdd(z, vecSet1(378.f));
+  p = vecMul(p, z);
+  p = vecAdd(p, vecSet1(17325.f));
+  p = vecMul(p, z);
+  p = vecAdd(p, vecSet1(135135.f));
+  p = vecMul(p, ax);
+
+  SIMDVectorFloat q = vecMul(z, vecSet1(28.f));
+  q = vecAdd(q, vecSet1(3150.f));
+  q = vecMul(q, z);
+  q = vecAdd(q, vecSet1(62370.f));
+  q = vecMul(q, z);
+  q = vecAdd(q, vecSet1(135135.f));
+
+  SIMDVectorFloat r = vecMin(vecDiv(p, q), vecSet1(1.f));
+  return vecCopySign(r, x);
+}
+
+// ----------------------------------------------------------------
+// atan
+
+// precise: cephes atanf. Reduces x to [-tan(pi/8), tan(pi/8)] with one
+// division.
+inline SIMDVectorFloat vecAtan(SIMDVectorFloat x)
+{
+  SIMDVectorFloat ax = vecAbs(x);
+  SIMDVectorInt big = VecF2I(vecGreaterThan(ax, vecSet1(2.414213562373095f)));
+  SIMDVectorInt mid = VecF2I(vecGreaterThan(ax, vecSet1(0.4142135623730950f)));
+
+  // big: -1/x + pi/2, mid: (x - 1)/(x + 1) + pi/4, small: x.
+  SIMDVectorFloat one = vecSet1(1.f);
+  SIMDVectorFloat num = vecSelect(vecSet1(-1.f), vecSelect(vecSub(ax, one), ax, mid), big);
+  SIMDVectorFloat den = vecSelect(ax, vecSelect(vecAdd(ax, one), one, mid), big);
+  SIMDVectorFloat offset =
+      vecSelect(vecSet1(kHalfPiF), vecSelect(vecSet1(kQuarterPiF), vecZeros(), mid), big);
+  SIMDVectorFloat xr = vecDiv(num, den);
+
+  SIMDVectorFloat z = vecMul(xr, xr);
+  SIMDVectorFloat y = vecSet1(8.05374449538e-2f);
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(-1.38776856032E-1f));
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(1.99777106478E-1f));
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(-3.33329491539E-1f));
+  y = vecMul(y, z);
+  y = vecMul(y, xr);
+  y = vecAdd(y, xr);
+
+  return vecCopySign(vecAdd(offset, y), x);
+}
+
+// medium: reduces x to [0, 1] with one division, then an odd polynomial of
+// degree 11 with minimax relative error.
+inline SIMDVectorFloat vecAtanApprox(SIMDVectorFloat x)
+{
+  SIMDVectorFloat ax = vecAbs(x);
+  SIMDVectorFloat one = vecSet1(1.f);
+  SIMDVectorInt big = VecF2I(vecGreaterThan(ax, one));
+  SIMDVectorFloat r = vecDiv(vecMin(ax, one), vecMax(ax, one));
+
+  SIMDVectorFloat z = vecMul(r, r);
+  SIMDVectorFloat y = vecSet1(-0.0134897899f);
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(0.057498218f));
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(-0.121255264f));
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(0.195640958f));
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(-0.332995132f));
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(0.999995638f));
+  y = vecMul(y, r);
+
+  y = vecSelect(vecSub(vecSet1(kHalfPiF), y), y, big);
+  return vecCopySign(y, x);
+}
+
+// fast: the same with a polynomial of degree 7.
+inline SIMDVectorFloat vecAtanFast(SIMDVectorFloat x)
+{
+  SIMDVectorFloat ax = vecAbs(x);
+  SIMDVectorFloat one = vecSet1(1.f);
+  SIMDVectorInt big = VecF2I(vecGreaterThan(ax, one));
+  SIMDVectorFloat r = vecDiv(vecMin(ax, one), vecMax(ax, one));
+
+  SIMDVectorFloat z = vecMul(r, r);
+  SIMDVectorFloat y = vecSet1(-0.0443436664f);
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(0.155600003f));
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(-0.325814788f));
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(0.999788109f));
+  y = vecMul(y, r);
+
+  y = vecSelect(vecSub(vecSet1(kHalfPiF), y), y, big);
+  return vecCopySign(y, x);
+}
+
+// ----------------------------------------------------------------
+// atan2
+
+// atan(y/x), moved to the left half plane where the sign bit of x is set.
+// Signed zeros give the same results as std::atan2.
+#define ML_VEC_ATAN2(atanFn)                                                     \
+  SIMDVectorInt bothZero =                                                       \
+      VecF2I(vecAnd(vecEqual(x, vecZeros()), vecEqual(y, vecZeros())));          \
+  SIMDVectorFloat q = vecSelect(y, vecDiv(y, x), bothZero);                      \
+  SIMDVectorFloat a = atanFn(q);                                                 \
+  SIMDVectorInt signBit = VecF2I(vecSet1(-0.0f));                                \
+  SIMDVectorInt xNegative = vecEqualInt(vecAndInt(VecF2I(x), signBit), signBit); \
+  return vecSelect(vecAdd(a, vecCopySign(vecSet1(kPiF), y)), a, xNegative);
+
+inline SIMDVectorFloat vecAtan2(SIMDVectorFloat y, SIMDVectorFloat x) { ML_VEC_ATAN2(vecAtan) }
+
+inline SIMDVectorFloat vecAtan2Approx(SIMDVectorFloat y, SIMDVectorFloat x)
+{
+  ML_VEC_ATAN2(vecAtanApprox)
+}
+
+inline SIMDVectorFloat vecAtan2Fast(SIMDVectorFloat y, SIMDVectorFloat x)
+{
+  ML_VEC_ATAN2(vecAtanFast)
+}
+
+#undef ML_VEC_ATAN2
+
+// ----------------------------------------------------------------
+// sinh
+
+// cephes sinhf, given ax = |x| and e = exp(ax). (e - 1/e) / 2 above 1, a
+// polynomial below.
+inline SIMDVectorFloat vecSinhFromExp(SIMDVectorFloat x, SIMDVectorFloat ax, SIMDVectorFloat e)
+{
+  SIMDVectorFloat half = vecSet1(0.5f);
+  SIMDVectorFloat large = vecSub(vecMul(e, half), vecDiv(half, e));
+
+  SIMDVectorFloat z = vecMul(ax, ax);
+  SIMDVectorFloat y = vecSet1(2.03721912945E-4f);
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(8.33028376239E-3f));
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(1.66667160211E-1f));
+  y = vecMul(y, z);
+  y = vecMul(y, ax);
+  SIMDVectorFloat small = vecAdd(y, ax);
+
+  SIMDVectorFloat r = vecSelect(small, large, VecF2I(vecLessThanOrEqual(ax, vecSet1(1.f))));
+  return vecCopySign(r, x);
+}
+
+// precise: cephes sinhf.
+inline SIMDVectorFloat vecSinh(SIMDVectorFloat x)
+{
+  SIMDVectorFloat ax = vecAbs(x);
+  return vecSinhFromExp(x, ax, vecExp(ax));
+}
+
+// medium: the same, with the approximate exp above 1.
+inline SIMDVectorFloat vecSinhApprox(SIMDVectorFloat x)
+{
+  SIMDVectorFloat ax = vecAbs(x);
+  return vecSinhFromExp(x, ax, vecExpApprox(ax));
+}
+
+// fast: the approximate exp above 0.5, x + x^3/6 below.
+inline SIMDVectorFloat vecSinhFast(SIMDVectorFloat x)
+{
+  SIMDVectorFloat ax = vecAbs(x);
+
+  SIMDVectorFloat e = vecExpApprox(ax);
+  SIMDVectorFloat half = vecSet1(0.5f);
+  SIMDVectorFloat large = vecSub(vecMul(e, half), vecDiv(half, e));
+
+  SIMDVectorFloat z = vecMul(ax, ax);
+  SIMDVectorFloat small = vecAdd(ax, vecMul(vecMul(z, ax), vecSet1(1.f / 6.f)));
+
+  SIMDVectorFloat r = vecSelect(small, large, VecF2I(vecLessThanOrEqual(ax, half)));
+  return vecCopySign(r, x);
+}
+
+// ----------------------------------------------------------------
+// tan
+
+// reduce x >= 0 to [-pi/4, pi/4] like vecSin(), returning the octant in j.
+// extraPrecision adds the third term of cephes' extended precision
+// reduction.
+inline SIMDVectorFloat vecTanReduce(SIMDVectorFloat x, SIMDVectorInt& j, bool extraPrecision)
+{
+  SIMDVectorFloat y = vecMul(x, vecSet1(1.27323954473516f));
+  j = vecFloatToIntTruncate(y);
+  j = vecAddInt(j, vecSet1Int(1));
+  j = vecAndInt(j, vecSet1Int(~1));
+  y = vecIntToFloat(j);
+
+  x = vecAdd(x, vecMul(y, vecSet1(-0.78515625f)));
+  x = vecAdd(x, vecMul(y, vecSet1(-2.4187564849853515625e-4f)));
+  if (extraPrecision)
+  {
+    x = vecAdd(x, vecMul(y, vecSet1(-3.77489497744594108e-8f)));
+  }
+  return x;
+}
+
+// where bit 1 of the octant is set, tan(x) = -1/tan(x - pi/2).
+inline SIMDVectorFloat vecTanFinish(SIMDVectorFloat y, SIMDVectorInt j, SIMDVectorFloat x)
+{
+  SIMDVectorInt swap = vecEqualInt(vecAndInt(j, vecSet1Int(2)), vecSet1Int(2));
+  y = vecSelect(vecDiv(vecSet1(-1.f), y), y, swap);
+  return vecXor(y, vecAnd(x, vecSet1(-0.0f)));
+}
+
+// precise: cephes tanf.
+inline SIMDVectorFloat vecTan(SIMDVectorFloat x)
+{
+  SIMDVectorInt j;
+  SIMDVectorFloat r = vecTanReduce(vecAbs(x), j, true);
+
+  SIMDVectorFloat z = vecMul(r, r);
+  SIMDVectorFloat y = vecSet1(9.38540185543E-3f);
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(3.11992232697E-3f));
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(2.44301354525E-2f));
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(5.34112807005E-2f));
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(1.33387994085E-1f));
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(3.33331568548E-1f));
+  y = vecMul(y, z);
+  y = vecMul(y, r);
+  y = vecAdd(y, r);
+
+  return vecTanFinish(y, j, x);
+}
+
+// medium: an odd polynomial of degree 9 with minimax relative error.
+inline SIMDVectorFloat vecTanApprox(SIMDVectorFloat x)
+{
+  SIMDVectorInt j;
+  SIMDVectorFloat r = vecTanReduce(vecAbs(x), j, true);
+
+  SIMDVectorFloat z = vecMul(r, r);
+  SIMDVectorFloat y = vecSet1(0.0438052072f);
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(0.0404149656f));
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(0.136511799f));
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(0.333080357f));
+  y = vecMul(y, z);
+  y = vecAdd(y, vecSet1(1.00000316f));
+  y = vecMul(y, r);
+
+  return vecTanFinish(y, j, x);
+}
+
+// fast: a shorter range reduction and a [3/2] Pade approximant. Near the poles
+// the shorter reduction limits the accuracy.
+inline SIMDVectorFloat vecTanFast(SIMDVectorFloat x)
+{
+  SIMDVectorInt j;
+  SIMDVectorFloat r = vecTanReduce(vecAbs(x), j, false);
+
+  // r (15 - r^2) / (15 - 6 r^2)
+  SIMDVectorFloat z = vecMul(r, r);
+  SIMDVectorFloat fifteen = vecSet1(15.f);
+  SIMDVectorFloat p = vecMul(r, vecSub(fifteen, z));
+  SIMDVectorFloat q = vecSub(fifteen, vecMul(z, vecSet1(6.f)));
+  SIMDVectorFloat y = vecDiv(p, q);
+
+  return vecTanFinish(y, j, x);
+}
+
+// ----------------------------------------------------------------
+// fast pow
+
+// log2(x) for x > 0: the exponent plus a cubic in the mantissa.
+inline SIMDVectorFloat vecLog2Fast(SIMDVectorFloat x)
+{
+  SIMDVectorInt xi = VecF2I(x);
+  SIMDVectorInt e = vecSubInt(vecShiftRightInt(xi, 23), vecSet1Int(127));
+  SIMDVectorFloat m =
+      vecOr(vecAnd(x, VecI2F(vecSet1Int(0x007FFFFF))), VecI2F(vecSet1Int(0x3F800000)));
+
+  SIMDVectorFloat p = vecMul(m, vecSet1(0.158234471f));
+  p = vecAdd(p, vecSet1(-1.05179484f));
+  p = vecMul(p, m);
+  p = vecAdd(p, vecSet1(3.04774203f));
+  p = vecMul(p, m);
+  p = vecAdd(p, vecSet1(-2.15354094f));
+  return vecAdd(p, vecIntToFloat(e));
+}
+
+// 2^x: the integer part sets the exponent, a cubic the fractional part.
+inline SIMDVectorFloat vecExp2Fast(SIMDVectorFloat x)
+{
+  x = vecClamp(x, vecSet1(-126.f), vecSet1(126.f));
+  SIMDVectorInt i = vecFloorToInt(x);
+  SIMDVectorFloat f = vecSub(x, vecIntToFloat(i));
+
+  SIMDVectorFloat p = vecMul(f, vecSet1(0.0780249159f));
+  p = vecAdd(p, vecSet1(0.226063949f));
+  p = vecMul(p, f);
+  p = vecAdd(p, vecSet1(0.695836199f));
+  p = vecMul(p, f);
+  p = vecAdd(p, vecSet1(0.999924799f));
+  return vecMul(p, vecPow2Int(i));
+}
+
+// fast: x^y for x > 0 as 2^(y log2(x)). The relative error grows with
+// |y log2(x)|, to about 4e-3 for x in [1e-3, 10] and y in [-4, 4].
+inline SIMDVectorFloat vecPowFast(SIMDVectorFloat x, SIMDVectorFloat y)
+{
+  return vecExp2Fast(vecMul(y, vecLog2Fast(x)));
+}
@@ -34,6 +34,7 @@
 #include <iterator>
 #include <type_traits>
 
+#include "MLDSPDispatch.h"
 #include "MLDSPMath.h"
 #include "MLDSPScalarMath.h"
 
@@ -60,19 +61,22 @@ constexpr auto make_array(Function f)
 // ----------------------------------------------------------------
 // alignment definitions
 
+// DSPVectors are aligned to the native SIMD vector size: 16 bytes for SSE and
+// NEON, 32 for AVX2 and 64 for AVX-512.
+const uintptr_t kDSPVectorAlignBytes = kBytesPerSIMDVector;
+
 #ifdef MANUAL_ALIGN_DSPVECTOR
 
-const uintptr_t kDSPVectorAlignBytes = 16;
 const uintptr_t kDSPVectorAlignFloats = kDSPVectorAlignBytes / sizeof(float);
 const uintptr_t kDSPVectorAlignInts = kDSPVectorAlignBytes / sizeof(int);
 const uintptr_t kDSPVectorBytesAlignMask = ~(kDSPVectorAlignBytes - 1);
 
-template <type T>
+template <typename T>
 inline T* DSPVectorAlignPointer(const T* p)
 {
   uintptr_t pM = (uintptr_t)p;
-  pM += (uintptr_t)(ml::kDSPVectorAlignBytes - 1);
-  pM &= ml::kDSPVectorBytesAlignMask;
+  pM += (uintptr_t)(kDSPVectorAlignBytes - 1);
+  pM &= kDSPVectorBytesAlignMask;
   return reinterpret_cast<T*>(pM);
 }
 
@@ -531,24 +535,49 @@ inline void storeAligned(const DSPVectorArray<ROWS>& vecSrc, float* pDest)
   }
 }
 
+// ----------------------------------------------------------------
+// vector operator definitions
+//
+// Each DEFINE_OP* macro below defines a kernel in ml::kernels::<family> that
+// runs the computation over n floats, and the DSPVectorArray operator that
+// calls it. The float-valued families also define an opName##Op struct that
+// applies the computation to single SIMD vectors, for the kernel and for the
+// lazy expressions in MLDSPExpressions.h. The kernel is called through
+// ML_DSP_KERNEL, which chooses the kernel at runtime if
+// ML_DSP_RUNTIME_DISPATCH is defined (see MLDSPDispatch.h). New operators
+// must also be added to the lists there.
+
 // ----------------------------------------------------------------
 // unary vector operators
 
-#define DEFINE_OP1(opName, opComputation)                              \
-  template <size_t ROWS>                                               \
-  inline DSPVectorArray<ROWS>(opName)(const DSPVectorArray<ROWS>& vx1) \
-  {                                                                    \
-    DSPVectorArray<ROWS> vy;                                           \
-    const float* px1 = vx1.getConstBuffer();                           \
-    float* py1 = vy.getBuffer();                                       \
-    for (int n = 0; n < kSIMDVectorsPerDSPVector * ROWS; ++n)          \
-    {                                                                  \
-      SIMDVectorFloat x = vecLoad(px1);                                \
-      vecStore(py1, (opComputation));                                  \
-      px1 += kFloatsPerSIMDVector;                                     \
-      py1 += kFloatsPerSIMDVector;                                     \
-    }                                                                  \
-    return vy;                                                         \
+#define DEFINE_OP1(opName, opComputation)                                              \
+  namespace kernels                                                                    \
+  {                                                                                    \
+  namespace op1                                                                        \
+  {                                                                                    \
+  struct opName##Op                                                                    \
+  {                                                                                    \
+    static inline SIMDVectorFloat apply(SIMDVectorFloat x) { return (opComputation); } \
+  };                                                                                   \
+  inline void(opName)(const float* px1, float* py1, int n)                             \
+  {                                                                                    \
+    for (int i = 0; i < n; i += kFloatsPerSIMDVector)                                  \
+    {                                                                                  \
+      SIMDVectorFloat x = vecLoad(px1);                                                \
+      vecStore(py1, opName##Op::apply(x));                                             \
+      px1 += kFloatsPerSIMDVector;                                                     \
+      py1 += kFloatsPerSIMDVector;                                                     \
+    }                                                                                  \
+  }                                                                                    \
+  }                                                                                    \
+  }                                                                                    \
+  template <size_t ROWS>                                                               \
+  inline DSPVectorArray<ROWS>(opName)(const DSPVectorArray<ROWS>& vx1)                 \
+  {                                                                                    \
+    DSPVectorArray<ROWS> vy;                                                           \
+    const int n = kFloatsPerDSPVector * ROWS;                                          \
+    (ML_DSP_KERNEL(op1, opName))(vx1.getConstBuffer(), vy.getBuffer(), n);             \
+    return vy;                                                                         \
   }
 
 DEFINE_OP1(sqrt, (vecSqrt(x)));
@@ -568,8 +597,8 @@ DEFINE_OP1(log, (vecLog(x)));
 DEFINE_OP1(exp, (vecExp(x)));
 
 // lazy log2 and exp2 from natural log / exp
-STATIC_M128_CONST(kLogTwoVec, 0.69314718055994529f);
-STATIC_M128_CONST(kLogTwoRVec, 1.4426950408889634f);
+STATIC_SIMD_CONST(kLogTwoVec, 0.69314718055994529f);
+STATIC_SIMD_CONST(kLogTwoRVec, 1.4426950408889634f);
 DEFINE_OP1(log2, (vecMul(vecLog(x), kLogTwoRVec)));
 DEFINE_OP1(exp2, (vecExp(vecMul(kLogTwoVec, x))));
 
@@ -583,28 +612,58 @@ DEFINE_OP1(logApprox, (vecLogApprox(x)));
 DEFINE_OP1(log2Approx, (vecMul(vecLogApprox(x), kLogTwoRVec)));
 DEFINE_OP1(exp2Approx, (vecExpApprox(vecMul(kLogTwoVec, x))));
 
+// hyperbolic and inverse trig functions in three accuracy tiers: precise,
+// Approx and Fast. See MLDSPMathTranscendental.h.
+DEFINE_OP1(tanh, (vecTanh(x)));
+DEFINE_OP1(tanhApprox, (vecTanhApprox(x)));
+DEFINE_OP1(tanhFast, (vecTanhFast(x)));
+DEFINE_OP1(sinh, (vecSinh(x)));
+DEFINE_OP1(sinhApprox, (vecSinhApprox(x)));
+DEFINE_OP1(sinhFast, (vecSinhFast(x)));
+DEFINE_OP1(tan, (vecTan(x)));
+DEFINE_OP1(tanApprox, (vecTanApprox(x)));
+DEFINE_OP1(tanFast, (vecTanFast(x)));
+DEFINE_OP1(atan, (vecAtan(x)));
+DEFINE_OP1(atanApprox, (vecAtanApprox(x)));
+DEFINE_OP1(atanFast, (vecAtanFast(x)));
+
 // ----------------------------------------------------------------
 // binary vector operators (float)
 
-#define DEFINE_OP2(opName, opComputation)                              \
-  template <size_t ROWS>                                               \
-  inline DSPVectorArray<ROWS>(opName)(const DSPVectorArray<ROWS>& vx1, \
-                                      const DSPVectorArray<ROWS>& vx2) \
-  {                                                                    \
-    DSPVectorArray<ROWS> vy;                                           \
-    const float* px1 = vx1.getConstBuffer();                           \
-    const float* px2 = vx2.getConstBuffer();                           \
-    float* py1 = vy.getBuffer();                                       \
-    for (int n = 0; n < kSIMDVectorsPerDSPVector * ROWS; ++n)          \
-    {                                                                  \
-      SIMDVectorFloat x1 = vecLoad(px1);                               \
-      SIMDVectorFloat x2 = vecLoad(px2);                               \
-      vecStore(py1, (opComputation));                                  \
-      px1 += kFloatsPerSIMDVector;                                     \
-      px2 += kFloatsPerSIMDVector;                                     \
-      py1 += kFloatsPerSIMDVector;                                     \
-    }                                                                  \
-    return vy;                                                         \
+#define DEFINE_OP2(opName, opComputation)                                                        \
+  namespace kernels                                                                              \
+  {                                                                                              \
+  namespace op2                                                                                  \
+  {                                                                                              \
+  struct opName##Op                                                                              \
+  {                                                                                              \
+    static inline SIMDVectorFloat apply(SIMDVectorFloat x1, SIMDVectorFloat x2)                  \
+    {                                                                                            \
+      return (opComputation);                                                                    \
+    }                                                                                            \
+  };                                                                                             \
+  inline void(opName)(const float* px1, const float* px2, float* py1, int n)                     \
+  {                                                                                              \
+    for (int i = 0; i < n; i += kFloatsPerSIMDVector)                                            \
+    {                                                                                            \
+      SIMDVectorFloat x1 = vecLoad(px1);                                                         \
+      SIMDVectorFloat x2 = vecLoad(px2);                                                         \
+      vecStore(py1, opName##Op::apply(x1, x2));                                                  \
+      px1 += kFloatsPerSIMDVector;                                                               \
+      px2 += kFloatsPerSIMDVector;                                                               \
+      py1 += kFloatsPerSIMDVector;                                                               \
+    }                                                                                            \
+  }                                                                                              \
+  }                                                                                              \
+  }                                                                                              \
+  template <size_t ROWS>                                                                         \
+  inline DSPVectorArray<ROWS>(opName)(const DSPVectorArray<ROWS>& vx1,                           \
+                                      const DSPVectorArray<ROWS>& vx2)                           \
+  {                                                                                              \
+    DSPVectorArray<ROWS> vy;                                                                     \
+    const int n = kFloatsPerDSPVector * ROWS;                                                    \
+    (ML_DSP_KERNEL(op2, opName))(vx1.getConstBuffer(), vx2.getConstBuffer(), vy.getBuffer(), n); \
+    return vy;                                                                                   \
   }
 
 DEFINE_OP2(add, (vecAdd(x1, x2)));
@@ -615,31 +674,46 @@ DEFINE_OP2(divide, (vecDiv(x1, x2)));
 DEFINE_OP2(divideApprox, vecDivApprox(x1, x2));
 DEFINE_OP2(pow, (vecExp(vecMul(vecLog(x1), x2))));
 DEFINE_OP2(powApprox, (vecExpApprox(vecMul(vecLogApprox(x1), x2))));
+DEFINE_OP2(powFast, (vecPowFast(x1, x2)));
+
+// atan2(y, x)
+DEFINE_OP2(atan2, (vecAtan2(x1, x2)));
+DEFINE_OP2(atan2Approx, (vecAtan2Approx(x1, x2)));
+DEFINE_OP2(atan2Fast, (vecAtan2Fast(x1, x2)));
 DEFINE_OP2(min, (vecMin(x1, x2)));
 DEFINE_OP2(max, (vecMax(x1, x2)));
 
 // ----------------------------------------------------------------
 // binary vector operators (int32)
 
-#define DEFINE_OP2_INT32(opName, opComputation)                              \
-  template <size_t ROWS>                                                     \
-  inline DSPVectorArrayInt<ROWS>(opName)(const DSPVectorArrayInt<ROWS>& vx1, \
-                                         const DSPVectorArrayInt<ROWS>& vx2) \
-  {                                                                          \
-    DSPVectorArrayInt<ROWS> vy;                                              \
-    const float* px1 = vx1.getConstBuffer();                                 \
-    const float* px2 = vx2.getConstBuffer();                                 \
-    float* py1 = vy.getBuffer();                                             \
-    for (int n = 0; n < kSIMDVectorsPerDSPVector * ROWS; ++n)                \
-    {                                                                        \
-      SIMDVectorInt x1 = VecF2I(vecLoad(px1));                               \
-      SIMDVectorInt x2 = VecF2I(vecLoad(px2));                               \
-      vecStore(py1, VecI2F(opComputation));                                  \
-      px1 += kIntsPerSIMDVector;                                             \
-      px2 += kIntsPerSIMDVector;                                             \
-      py1 += kIntsPerSIMDVector;                                             \
-    }                                                                        \
-    return vy;                                                               \
+#define DEFINE_OP2_INT32(opName, opComputation)                                                   \
+  namespace kernels                                                                               \
+  {                                                                                               \
+  namespace op2Int32                                                                              \
+  {                                                                                               \
+  inline void(opName)(const float* px1, const float* px2, float* py1, int n)                      \
+  {                                                                                               \
+    for (int i = 0; i < n; i += kFloatsPerSIMDVector)                                             \
+    {                                                                                             \
+      SIMDVectorInt x1 = VecF2I(vecLoad(px1));                                                    \
+      SIMDVectorInt x2 = VecF2I(vecLoad(px2));                                                    \
+      vecStore(py1, VecI2F(opComputation));                                                       \
+      px1 += kIntsPerSIMDVector;                                                                  \
+      px2 += kIntsPerSIMDVector;                                                                  \
+      py1 += kIntsPerSIMDVector;                                                                  \
+    }                                                                                             \
+  }                                                                                               \
+  }                                                                                               \
+  }                                                                                               \
+  template <size_t ROWS>                                                                          \
+  inline DSPVectorArrayInt<ROWS>(opName)(const DSPVectorArrayInt<ROWS>& vx1,                      \
+                                         const DSPVectorArrayInt<ROWS>& vx2)                      \
+  {                                                                                               \
+    DSPVectorArrayInt<ROWS> vy;                                                                   \
+    const int n = kFloatsPerDSPVector * ROWS;                                                     \
+    (ML_DSP_KERNEL(op2Int32, opName))(vx1.getConstBuffer(), vx2.getConstBuffer(), vy.getBuffer(), \
+                                      n);                                                         \
+    return vy;                                                                                    \
   }
 
 DEFINE_OP2_INT32(subtractInt32, (vecSubInt(x1, x2)));
@@ -648,29 +722,45 @@ DEFINE_OP2_INT32(addInt32, (vecAddInt(x1, x2)));
 // ----------------------------------------------------------------
 // ternary vector operators
 
-#define DEFINE_OP3(opName, opComputation)                              \
-  template <size_t ROWS>                                               \
-  inline DSPVectorArray<ROWS>(opName)(const DSPVectorArray<ROWS>& vx1, \
-                                      const DSPVectorArray<ROWS>& vx2, \
-                                      const DSPVectorArray<ROWS>& vx3) \
-  {                                                                    \
-    DSPVectorArray<ROWS> vy;                                           \
-    const float* px1 = vx1.getConstBuffer();                           \
-    const float* px2 = vx2.getConstBuffer();                           \
-    const float* px3 = vx3.getConstBuffer();                           \
-    float* py1 = vy.getBuffer();                                       \
-    for (int n = 0; n < kSIMDVectorsPerDSPVector * ROWS; ++n)          \
-    {                                                                  \
-      SIMDVectorFloat x1 = vecLoad(px1);                               \
-      SIMDVectorFloat x2 = vecLoad(px2);                               \
-      SIMDVectorFloat x3 = vecLoad(px3);                               \
-      vecStore(py1, (opComputation));                                  \
-      px1 += kFloatsPerSIMDVector;                                     \
-      px2 += kFloatsPerSIMDVector;                                     \
-      px3 += kFloatsPerSIMDVector;                                     \
-      py1 += kFloatsPerSIMDVector;                                     \
-    }                                                                  \
-    return vy;                                                         \
+#define DEFINE_OP3(opName, opComputation)                                                      \
+  namespace kernels                                                                            \
+  {                                                                                            \
+  namespace op3                                                                                \
+  {                                                                                            \
+  struct opName##Op                                                                            \
+  {                                                                                            \
+    static inline SIMDVectorFloat apply(SIMDVectorFloat x1, SIMDVectorFloat x2,                \
+                                        SIMDVectorFloat x3)                                    \
+    {                                                                                          \
+      return (opComputation);                                                                  \
+    }                                                                                          \
+  };                                                                                           \
+  inline void(opName)(const float* px1, const float* px2, const float* px3, float* py1, int n) \
+  {                                                                                            \
+    for (int i = 0; i < n; i += kFloatsPerSIMDVector)                                          \
+    {                                                                                          \
+      SIMDVectorFloat x1 = vecLoad(px1);                                                       \
+      SIMDVectorFloat x2 = vecLoad(px2);                                                       \
+      SIMDVectorFloat x3 = vecLoad(px3);                                                       \
+      vecStore(py1, opName##Op::apply(x1, x2, x3));                                            \
+      px1 += kFloatsPerSIMDVector;                                                             \
+      px2 += kFloatsPerSIMDVector;                                                             \
+      px3 += kFloatsPerSIMDVector;                                                             \
+      py1 += kFloatsPerSIMDVector;                                                             \
+    }                                                                                          \
+  }                                                                                            \
+  }                                                                                            \
+  }                                                                                            \
+  template <size_t ROWS>                                                                       \
+  inline DSPVectorArray<ROWS>(opName)(const DSPVectorArray<ROWS>& vx1,                         \
+                                      const DSPVectorArray<ROWS>& vx2,                         \
+                                      const DSPVectorArray<ROWS>& vx3)                         \
+  {                                                                                            \
+    DSPVectorArray<ROWS> vy;                                                                   \
+    const int n = kFloatsPerDSPVector * ROWS;                                                  \
+    (ML_DSP_KERNEL(op3, opName))(vx1.getConstBuffer(), vx2.getConstBuffer(),                   \
+                                 vx3.getConstBuffer(), vy.getBuffer(), n);                     \
+    return vy;                                                                                 \
   }
 
 DEFINE_OP3(lerp, vecAdd(x1, (vecMul(x3, vecSub(x2, x1)))));       // x = lerp(a, b, mix)
@@ -708,21 +798,30 @@ inline DSPVectorArray<ROWS> lerp(const DSPVectorArray<ROWS>& vx1, const DSPVecto
 // ----------------------------------------------------------------
 // unary float vector -> int vector operators
 
-#define DEFINE_OP1_F2I(opName, opComputation)                             \
-  template <size_t ROWS>                                                  \
-  inline DSPVectorArrayInt<ROWS>(opName)(const DSPVectorArray<ROWS>& vx1) \
-  {                                                                       \
-    DSPVectorArrayInt<ROWS> vy;                                           \
-    const float* px1 = vx1.getConstBuffer();                              \
-    float* py1 = vy.getBuffer();                                          \
-    for (int n = 0; n < kSIMDVectorsPerDSPVector * ROWS; ++n)             \
-    {                                                                     \
-      SIMDVectorFloat x = vecLoad(px1);                                   \
-      vecStore((py1), (opComputation));                                   \
-      px1 += kFloatsPerSIMDVector;                                        \
-      py1 += kIntsPerSIMDVector;                                          \
-    }                                                                     \
-    return vy;                                                            \
+#define DEFINE_OP1_F2I(opName, opComputation)                                 \
+  namespace kernels                                                           \
+  {                                                                           \
+  namespace op1F2I                                                            \
+  {                                                                           \
+  inline void(opName)(const float* px1, float* py1, int n)                    \
+  {                                                                           \
+    for (int i = 0; i < n; i += kFloatsPerSIMDVector)                         \
+    {                                                                         \
+      SIMDVectorFloat x = vecLoad(px1);                                       \
+      vecStore(py1, (opComputation));                                         \
+      px1 += kFloatsPerSIMDVector;                                            \
+      py1 += kIntsPerSIMDVector;                                              \
+    }                                                                         \
+  }                                                                           \
+  }                                                                           \
+  }                                                                           \
+  template <size_t ROWS>                                                      \
+  inline DSPVectorArrayInt<ROWS>(opName)(const DSPVectorArray<ROWS>& vx1)     \
+  {                                                                           \
+    DSPVectorArrayInt<ROWS> vy;                                               \
+    const int n = kFloatsPerDSPVector * ROWS;                                 \
+    (ML_DSP_KERNEL(op1F2I, opName))(vx1.getConstBuffer(), vy.getBuffer(), n); \
+    return vy;                                                                \
   }
 
 DEFINE_OP1_F2I(roundFloatToInt, (VecI2F(vecFloatToIntRound(x))));
@@ -731,21 +830,30 @@ DEFINE_OP1_F2I(truncateFloatToInt, (VecI2F(vecFloatToIntTruncate(x))));
 // ----------------------------------------------------------------
 // unary int vector -> float vector operators
 
-#define DEFINE_OP1_I2F(opName, opComputation)                             \
-  template <size_t ROWS>                                                  \
-  inline DSPVectorArray<ROWS>(opName)(const DSPVectorArrayInt<ROWS>& vx1) \
-  {                                                                       \
-    DSPVectorArray<ROWS> vy;                                              \
-    const float* px1 = vx1.getConstBuffer();                              \
-    float* py1 = vy.getBuffer();                                          \
-    for (int n = 0; n < kSIMDVectorsPerDSPVector * ROWS; ++n)             \
-    {                                                                     \
-      SIMDVectorInt x = VecF2I(vecLoad(px1));                             \
-      vecStore((py1), (opComputation));                                   \
-      px1 += kIntsPerSIMDVector;                                          \
-      py1 += kFloatsPerSIMDVector;                                        \
-    }                                                                     \
-    return vy;                                                            \
+#define DEFINE_OP1_I2F(opName, opComputation)                                 \
+  namespace kernels                                                           \
+  {                                                                           \
+  namespace op1I2F                                                            \
+  {                                                                           \
+  inline void(opName)(const float* px1, float* py1, int n)                    \
+  {                                                                           \
+    for (int i = 0; i < n; i += kFloatsPerSIMDVector)                         \
+    {                                                                         \
+      SIMDVectorInt x = VecF2I(vecLoad(px1));                                 \
+      vecStore(py1, (opComputation));                                         \
+      px1 += kIntsPerSIMDVector;                                              \
+      py1 += kFloatsPerSIMDVector;                                            \
+    }                                                                         \
+  }                                                                           \
+  }                                                                           \
+  }                                                                           \
+  template <size_t ROWS>                                                      \
+  inline DSPVectorArray<ROWS>(opName)(const DSPVectorArrayInt<ROWS>& vx1)     \
+  {                                                                           \
+    DSPVectorArray<ROWS> vy;                                                  \
+    const int n = kFloatsPerDSPVector * ROWS;                                 \
+    (ML_DSP_KERNEL(op1I2F, opName))(vx1.getConstBuffer(), vy.getBuffer(), n); \
+    return vy;                                                                \
   }
 
 DEFINE_OP1_I2F(intToFloat, (vecIntToFloat(x)));
@@ -758,25 +866,41 @@ DEFINE_OP1(fractionalPart, (vecSub(x, vecIntToFloat(vecFloatToIntTruncate(x)))))
 // ----------------------------------------------------------------
 // binary float vector, float vector -> int vector operators
 
-#define DEFINE_OP2_FF2I(opName, opComputation)                            \
-  template <size_t ROWS>                                                  \
-  inline DSPVectorArrayInt<ROWS>(opName)(const DSPVectorArray<ROWS>& vx1, \
-                                         const DSPVectorArray<ROWS>& vx2) \
-  {                                                                       \
-    DSPVectorArrayInt<ROWS> vy;                                           \
-    const float* px1 = vx1.getConstBuffer();                              \
-    const float* px2 = vx2.getConstBuffer();                              \
-    float* py1 = vy.getBuffer();                                          \
-    for (int n = 0; n < kSIMDVectorsPerDSPVector * ROWS; ++n)             \
-    {                                                                     \
-      SIMDVectorFloat x1 = vecLoad(px1);                                  \
-      SIMDVectorFloat x2 = vecLoad(px2);                                  \
-      vecStore((py1), (opComputation));                                   \
-      px1 += kFloatsPerSIMDVector;                                        \
-      px2 += kFloatsPerSIMDVector;                                        \
-      py1 += kIntsPerSIMDVector;                                          \
-    }                                                                     \
-    return vy;                                                            \
+#define DEFINE_OP2_FF2I(opName, opComputation)                                                   \
+  namespace kernels                                                                              \
+  {                                                                                              \
+  namespace op2FF2I                                                                              \
+  {                                                                                              \
+  struct opName##Op                                                                              \
+  {                                                                                              \
+    static inline SIMDVectorFloat apply(SIMDVectorFloat x1, SIMDVectorFloat x2)                  \
+    {                                                                                            \
+      return (opComputation);                                                                    \
+    }                                                                                            \
+  };                                                                                             \
+  inline void(opName)(const float* px1, const float* px2, float* py1, int n)                     \
+  {                                                                                              \
+    for (int i = 0; i < n; i += kFloatsPerSIMDVector)                                            \
+    {                                                                                            \
+      SIMDVectorFloat x1 = vecLoad(px1);                                                         \
+      SIMDVectorFloat x2 = vecLoad(px2);                                                         \
+      vecStore(py1, opName##Op::apply(x1, x2));                                                  \
+      px1 += kFloatsPerSIMDVector;                                                               \
+      px2 += kFloatsPerSIMDVector;                                                               \
+      py1 += kIntsPerSIMDVector;                                                                 \
+    }                                                                                            \
+  }                                                                                              \
+  }                                                                                              \
+  }                                                                                              \
+  template <size_t ROWS>                                                                         \
+  inline DSPVectorArrayInt<ROWS>(opName)(const DSPVectorArray<ROWS>& vx1,                        \
+                                         const DSPVectorArray<ROWS>& vx2)                        \
+  {                                                                                              \
+    DSPVectorArrayInt<ROWS> vy;                                                                  \
+    const int n = kFloatsPerDSPVector * ROWS;                                                    \
+    (ML_DSP_KERNEL(op2FF2I, opName))(vx1.getConstBuffer(), vx2.getConstBuffer(), vy.getBuffer(), \
+                                     n);                                                         \
+    return vy;                                                                                   \
   }
 
 DEFINE_OP2_FF2I(equal, (vecEqual(x1, x2)));
@@ -789,29 +913,45 @@ DEFINE_OP2_FF2I(lessThanOrEqual, (vecLessThanOrEqual(x1, x2)));
 // ----------------------------------------------------------------
 // ternary operators float vector, float vector, int vector -> float vector
 
-#define DEFINE_OP3_FFI2F(opName, opComputation)                           \
-  template <size_t ROWS>                                                  \
-  inline DSPVectorArray<ROWS>(opName)(const DSPVectorArray<ROWS>& vx1,    \
-                                      const DSPVectorArray<ROWS>& vx2,    \
-                                      const DSPVectorArrayInt<ROWS>& vx3) \
-  {                                                                       \
-    DSPVectorArray<ROWS> vy;                                              \
-    const float* px1 = vx1.getConstBuffer();                              \
-    const float* px2 = vx2.getConstBuffer();                              \
-    const float* px3 = vx3.getConstBuffer();                              \
-    float* py1 = vy.getBuffer();                                          \
-    for (int n = 0; n < kSIMDVectorsPerDSPVector * ROWS; ++n)             \
-    {                                                                     \
-      SIMDVectorFloat x1 = vecLoad(px1);                                  \
-      SIMDVectorFloat x2 = vecLoad(px2);                                  \
-      SIMDVectorInt x3 = VecF2I(vecLoad(px3));                            \
-      vecStore(py1, (opComputation));                                     \
-      px1 += kFloatsPerSIMDVector;                                        \
-      px2 += kFloatsPerSIMDVector;                                        \
-      px3 += kFloatsPerSIMDVector;                                        \
-      py1 += kFloatsPerSIMDVector;                                        \
-    }                                                                     \
-    return vy;                                                            \
+#define DEFINE_OP3_FFI2F(opName, opComputation)                                                \
+  namespace kernels                                                                            \
+  {                                                                                            \
+  namespace op3FFI2F                                                                           \
+  {                                                                                            \
+  struct opName##Op                                                                            \
+  {                                                                                            \
+    static inline SIMDVectorFloat apply(SIMDVectorFloat x1, SIMDVectorFloat x2,                \
+                                        SIMDVectorInt x3)                                      \
+    {                                                                                          \
+      return (opComputation);                                                                  \
+    }                                                                                          \
+  };                                                                                           \
+  inline void(opName)(const float* px1, const float* px2, const float* px3, float* py1, int n) \
+  {                                                                                            \
+    for (int i = 0; i < n; i += kFloatsPerSIMDVector)                                          \
+    {                                                                                          \
+      SIMDVectorFloat x1 = vecLoad(px1);                                                       \
+      SIMDVectorFloat x2 = vecLoad(px2);                                                       \
+      SIMDVectorInt x3 = VecF2I(vecLoad(px3));                                                 \
+      vecStore(py1, opName##Op::apply(x1, x2, x3));                                            \
+      px1 += kFloatsPerSIMDVector;                                                             \
+      px2 += kFloatsPerSIMDVector;                                                             \
+      px3 += kFloatsPerSIMDVector;                                                             \
+      py1 += kFloatsPerSIMDVector;                                                             \
+    }                                                                                          \
+  }                                                                                            \
+  }                                                                                            \
+  }                                                                                            \
+  template <size_t ROWS>                                                                       \
+  inline DSPVectorArray<ROWS>(opName)(const DSPVectorArray<ROWS>& vx1,                         \
+                                      const DSPVectorArray<ROWS>& vx2,                         \
+                                      const DSPVectorArrayInt<ROWS>& vx3)                      \
+  {                                                                                            \
+    DSPVectorArray<ROWS> vy;                                                                   \
+    const int n = kFloatsPerDSPVector * ROWS;                                                  \
+    (ML_DSP_KERNEL(op3FFI2F, opName))(vx1.getConstBuffer(), vx2.getConstBuffer(),              \
+                                      vx3.getConstBuffer(), vy.getBuffer(), n);                \
+    return vy;                                                                                 \
   }
 
 DEFINE_OP3_FFI2F(select, vecSelect(x1, x2, x3));  // bitwise select(resultIfTrue,
@@ -819,34 +959,111 @@ DEFINE_OP3_FFI2F(select, vecSelect(x1, x2, x3));  // bitwise select(resultIfTrue
 
 // ternary operators int vector, int vector, int vector -> int vector
 
-#define DEFINE_OP3_III2I(opName, opComputation)                              \
-  template <size_t ROWS>                                                     \
-  inline DSPVectorArrayInt<ROWS>(opName)(const DSPVectorArrayInt<ROWS>& vx1, \
-                                         const DSPVectorArrayInt<ROWS>& vx2, \
-                                         const DSPVectorArrayInt<ROWS>& vx3) \
-  {                                                                          \
-    DSPVectorArrayInt<ROWS> vy;                                              \
-    const float* px1 = vx1.getConstBuffer();                                 \
-    const float* px2 = vx2.getConstBuffer();                                 \
-    const float* px3 = vx3.getConstBuffer();                                 \
-    float* py1 = vy.getBuffer();                                             \
-    for (int n = 0; n < kSIMDVectorsPerDSPVector * ROWS; ++n)                \
-    {                                                                        \
-      SIMDVectorInt x1 = VecF2I(vecLoad(px1));                               \
-      SIMDVectorInt x2 = VecF2I(vecLoad(px2));                               \
-      SIMDVectorInt x3 = VecF2I(vecLoad(px3));                               \
-      vecStore(py1, VecI2F(opComputation));                                  \
-      px1 += kIntsPerSIMDVector;                                             \
-      px2 += kIntsPerSIMDVector;                                             \
-      px3 += kIntsPerSIMDVector;                                             \
-      py1 += kIntsPerSIMDVector;                                             \
-    }                                                                        \
-    return vy;                                                               \
+#define DEFINE_OP3_III2I(opName, opComputation)                                                \
+  namespace kernels                                                                            \
+  {                                                                                            \
+  namespace op3III2I                                                                           \
+  {                                                                                            \
+  inline void(opName)(const float* px1, const float* px2, const float* px3, float* py1, int n) \
+  {                                                                                            \
+    for (int i = 0; i < n; i += kFloatsPerSIMDVector)                                          \
+    {                                                                                          \
+      SIMDVectorInt x1 = VecF2I(vecLoad(px1));                                                 \
+      SIMDVectorInt x2 = VecF2I(vecLoad(px2));                                                 \
+      SIMDVectorInt x3 = VecF2I(vecLoad(px3));                                                 \
+      vecStore(py1, VecI2F(opComputation));                                                    \
+      px1 += kIntsPerSIMDVector;                                                               \
+      px2 += kIntsPerSIMDVector;                                                               \
+      px3 += kIntsPerSIMDVector;                                                               \
+      py1 += kIntsPerSIMDVector;                                                               \
+    }                                                                                          \
+  }                                                                                            \
+  }                                                                                            \
+  }                                                                                            \
+  template <size_t ROWS>                                                                       \
+  inline DSPVectorArrayInt<ROWS>(opName)(const DSPVectorArrayInt<ROWS>& vx1,                   \
+                                         const DSPVectorArrayInt<ROWS>& vx2,                   \
+                                         const DSPVectorArrayInt<ROWS>& vx3)                   \
+  {                                                                                            \
+    DSPVectorArrayInt<ROWS> vy;                                                                \
+    const int n = kFloatsPerDSPVector * ROWS;                                                  \
+    (ML_DSP_KERNEL(op3III2I, opName))(vx1.getConstBuffer(), vx2.getConstBuffer(),              \
+                                      vx3.getConstBuffer(), vy.getBuffer(), n);                \
+    return vy;                                                                                 \
   }
 
 DEFINE_OP3_III2I(select, vecSelect(x1, x2, x3));  // bitwise select(resultIfTrue,
                                                   // resultIfFalse, conditionMask)
 
+// ----------------------------------------------------------------
+// table lookup kernels
+//
+// These read from a table of tableSize + 1 points at pTable, with one guard
+// point before and two after it. Each input x is mapped to the position
+// x * scale + offset in the table, which is clamped to [0, tableSize]. The
+// operators that call them are defined with LookupTable in MLDSPTables.h.
+
+#define DEFINE_OP_LOOKUP(opName, opComputation)                                                  \
+  namespace kernels                                                                              \
+  {                                                                                              \
+  namespace lookup                                                                               \
+  {                                                                                              \
+  inline void(opName)(const float* pTable, int tableSize, float scale, float offset,             \
+                      const float* px1, float* py1, int n)                                       \
+  {                                                                                              \
+    const SIMDVectorFloat vScale = vecSet1(scale);                                               \
+    const SIMDVectorFloat vOffset = vecSet1(offset);                                             \
+    const SIMDVectorFloat vMaxPosition = vecSet1(static_cast<float>(tableSize));                 \
+    for (int i = 0; i < n; i += kFloatsPerSIMDVector)                                            \
+    {                                                                                            \
+      SIMDVectorFloat x = vecAdd(vecMul(vecLoad(px1), vScale), vOffset);                         \
+      SIMDVectorFloat pos = vecClamp(x, vecZeros(), vMaxPosition);                               \
+      vecStore(py1, (opComputation));                                                            \
+      px1 += kFloatsPerSIMDVector;                                                               \
+      py1 += kFloatsPerSIMDVector;                                                               \
+    }                                                                                            \
+  }                                                                                              \
+  }                                                                                              \
+  }
+
+namespace kernels
+{
+namespace lookup
+{
+inline SIMDVectorFloat lookupLinearSIMD(const float* pTable, SIMDVectorFloat pos)
+{
+  // pos is not negative, so truncating gives the floor.
+  SIMDVectorInt i = vecFloatToIntTruncate(pos);
+  SIMDVectorFloat f = vecSub(pos, vecIntToFloat(i));
+  SIMDVectorFloat y0 = vecGather(pTable, i);
+  SIMDVectorFloat y1 = vecGather(pTable + 1, i);
+  return vecAdd(y0, vecMul(f, vecSub(y1, y0)));
+}
+
+// 4-point, 3rd-order Hermite (Catmull-Rom) interpolation.
+inline SIMDVectorFloat lookupCubicSIMD(const float* pTable, SIMDVectorFloat pos)
+{
+  SIMDVectorInt i = vecFloatToIntTruncate(pos);
+  SIMDVectorFloat f = vecSub(pos, vecIntToFloat(i));
+  SIMDVectorFloat ym1 = vecGather(pTable - 1, i);
+  SIMDVectorFloat y0 = vecGather(pTable, i);
+  SIMDVectorFloat y1 = vecGather(pTable + 1, i);
+  SIMDVectorFloat y2 = vecGather(pTable + 2, i);
+  SIMDVectorFloat half = vecSet1(0.5f);
+  SIMDVectorFloat c1 = vecMul(half, vecSub(y1, ym1));
+  SIMDVectorFloat c2 = vecSub(vecAdd(ym1, vecAdd(y1, y1)),
+                              vecAdd(vecMul(vecSet1(2.5f), y0), vecMul(half, y2)));
+  SIMDVectorFloat c3 =
+      vecAdd(vecMul(half, vecSub(y2, ym1)), vecMul(vecSet1(1.5f), vecSub(y0, y1)));
+  return vecAdd(vecMul(vecAdd(vecMul(vecAdd(vecMul(c3, f), c2), f), c1), f), y0);
+}
+}  // namespace lookup
+}  // namespace kernels
+
+DEFINE_OP_LOOKUP(lookupNearest, vecGather(pTable, vecFloatToIntRound(pos)));
+DEFINE_OP_LOOKUP(lookupLinear, lookupLinearSIMD(pTable, pos));
+DEFINE_OP_LOOKUP(lookupCubic, lookupCubicSIMD(pTable, pos));
+
 // ----------------------------------------------------------------
 // n-ary operators
 
@@ -922,47 +1139,66 @@ inline DSPVector interpolateDSPVectorLinear(float start, float end)
 // ----------------------------------------------------------------
 // single-vector horizontal operators returning float
 
-inline float sum(const DSPVector& x)
+namespace kernels
+{
+namespace reduction
 {
-  const float* px1 = x.getConstBuffer();
-  float sum = 0;
+// pairwise sum. Adding halves of the vector at each step gives the same order
+// of additions for any SIMD vector size, so the result does not depend on the
+// instruction set.
+inline float sum(const float* px1)
+{
+  SIMDVectorFloat v[kSIMDVectorsPerDSPVector];
   for (int n = 0; n < kSIMDVectorsPerDSPVector; ++n)
   {
-    sum += vecSumH(vecLoad(px1));
+    v[n] = vecLoad(px1);
     px1 += kFloatsPerSIMDVector;
   }
-  return sum;
-}
-
-inline float mean(const DSPVector& x)
-{
-  constexpr float kGain = 1.0f / kFloatsPerDSPVector;
-  return sum(x) * kGain;
+  for (int h = kSIMDVectorsPerDSPVector / 2; h > 0; h /= 2)
+  {
+    for (int n = 0; n < h; ++n)
+    {
+      v[n] = vecAdd(v[n], v[n + h]);
+    }
+  }
+  return vecSumH(v[0]);
 }
 
-inline float max(const DSPVector& x)
+inline float(max)(const float* px1)
 {
-  const float* px1 = x.getConstBuffer();
-  float fmax = FLT_MIN;
+  SIMDVectorFloat vmax = vecSet1(FLT_MIN);
   for (int n = 0; n < kSIMDVectorsPerDSPVector; ++n)
   {
-    fmax = ml::max(fmax, vecMaxH(vecLoad(px1)));
+    vmax = vecMax(vmax, vecLoad(px1));
     px1 += kFloatsPerSIMDVector;
   }
-  return fmax;
+  return vecMaxH(vmax);
 }
 
-inline float min(const DSPVector& x)
+inline float(min)(const float* px1)
 {
-  const float* px1 = x.getConstBuffer();
-  float fmin = FLT_MAX;
+  SIMDVectorFloat vmin = vecSet1(FLT_MAX);
   for (int n = 0; n < kSIMDVectorsPerDSPVector; ++n)
   {
-    fmin = ml::min(fmin, vecMinH(vecLoad(px1)));
+    vmin = vecMin(vmin, vecLoad(px1));
     px1 += kFloatsPerSIMDVector;
   }
-  return fmin;
+  return vecMinH(vmin);
 }
+}  // namespace reduction
+}  // namespace kernels
+
+inline float sum(const DSPVector& x) { return (ML_DSP_KERNEL(reduction, sum))(x.getConstBuffer()); }
+
+inline float mean(const DSPVector& x)
+{
+  constexpr float kGain = 1.0f / kFloatsPerDSPVector;
+  return sum(x) * kGain;
+}
+
+inline float max(const DSPVector& x) { return (ML_DSP_KERNEL(reduction, max))(x.getConstBuffer()); }
+
+inline float min(const DSPVector& x) { return (ML_DSP_KERNEL(reduction, min))(x.getConstBuffer()); }
 
 // ----------------------------------------------------------------
 // normalize
@@ -1288,6 +1524,108 @@ inline DSPVector addRows(const DSPVectorArray<ROWS>& x)
   return vy;
 }
 
+// ----------------------------------------------------------------
+// RowMask: a set of active rows in a DSPVectorArray<ROWS>, for example the
+// sounding voices of a synthesizer. The indices of the active rows are kept
+// in order in a compact list, so that loops over them cost nothing for the
+// inactive rows.
+
+template <size_t ROWS>
+class RowMask
+{
+  std::array<bool, ROWS> mFlags{};
+  std::array<int, ROWS> mIndices{};
+  int mCount{0};
+
+  void updateIndices()
+  {
+    mCount = 0;
+    for (int j = 0; j < ROWS; ++j)
+    {
+      if (mFlags[j]) mIndices[mCount++] = j;
+    }
+  }
+
+ public:
+  RowMask() = default;
+  explicit RowMask(bool allActive)
+  {
+    mFlags.fill(allActive);
+    updateIndices();
+  }
+
+  void set(int row, bool active)
+  {
+    if (mFlags[row] != active)
+    {
+      mFlags[row] = active;
+      updateIndices();
+    }
+  }
+
+  bool operator[](int row) const { return mFlags[row]; }
+
+  // the number of active rows.
+  int size() const { return mCount; }
+  bool any() const { return mCount > 0; }
+
+  // the indices of the active rows, in increasing order.
+  const int* begin() const { return mIndices.data(); }
+  const int* end() const { return mIndices.data() + mCount; }
+};
+
+// sum only the active rows.
+template <size_t ROWS>
+inline DSPVector addRows(const DSPVectorArray<ROWS>& x, const RowMask<ROWS>& mask)
+{
+  DSPVector vy{0.f};
+  for (int j : mask)
+  {
+    vy = add(vy, x.getRowVectorUnchecked(j));
+  }
+  return vy;
+}
+
+// return the input with its inactive rows set to zero.
+template <size_t ROWS>
+inline DSPVectorArray<ROWS> maskRows(const DSPVectorArray<ROWS>& x, const RowMask<ROWS>& mask)
+{
+  DSPVectorArray<ROWS> vy{0.f};
+  for (int j : mask)
+  {
+    vy.setRowVectorUnchecked(j, x.getRowVectorUnchecked(j));
+  }
+  return vy;
+}
+
+// move the active rows to the start of the array, in order, so that they can
+// be processed together. The rows after mask.size() are zeroed.
+template <size_t ROWS>
+inline DSPVectorArray<ROWS> packRows(const DSPVectorArray<ROWS>& x, const RowMask<ROWS>& mask)
+{
+  DSPVectorArray<ROWS> vy{0.f};
+  int k = 0;
+  for (int j : mask)
+  {
+    vy.setRowVectorUnchecked(k++, x.getRowVectorUnchecked(j));
+  }
+  return vy;
+}
+
+// the inverse of packRows: move the first mask.size() rows back to the active
+// rows of the mask. The inactive rows are zeroed.
+template <size_t ROWS>
+inline DSPVectorArray<ROWS> unpackRows(const DSPVectorArray<ROWS>& x, const RowMask<ROWS>& mask)
+{
+  DSPVectorArray<ROWS> vy{0.f};
+  int k = 0;
+  for (int j : mask)
+  {
+    vy.setRowVectorUnchecked(j, x.getRowVectorUnchecked(k++));
+  }
+  return vy;
+}
+
 // ----------------------------------------------------------------
 // rowIndex - returns a DSPVector of j rows, each row filled
 // with the index of its row
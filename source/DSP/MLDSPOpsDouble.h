@@ -0,0 +1,335 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// MLDSPOpsDouble.h
+// DSPVectorArrayD: a double-precision DSPVectorArray, for long accumulators
+// and other state that needs more precision than float. It has the same
+// number of samples as a DSPVectorArray, and converts to and from one with
+// toDouble() and toFloat(). The arithmetic operators and the functions
+// defined below run on the native SIMD double vectors, which hold half as
+// many samples as the float vectors.
+
+#pragma once
+
+#include "MLDSPOps.h"
+
+constexpr int kDoublesPerDSPVector = kFloatsPerDSPVector;
+constexpr int kDoubleSIMDVectorsPerDSPVector = kDoublesPerDSPVector / kDoublesPerSIMDVector;
+
+namespace ml
+{
+template <size_t ROWS>
+class DSPVectorArrayD
+{
+#ifdef MANUAL_ALIGN_DSPVECTOR
+  union _Data
+  {
+    double asDouble[kDoublesPerDSPVector * ROWS + kDSPVectorAlignBytes / sizeof(double)];
+    _Data() {}
+  };
+#else
+  union _Data
+  {
+    // unused except to force alignment
+    SIMDVectorDouble _align[kDoubleSIMDVectorsPerDSPVector * ROWS];
+    double asDouble[kDoublesPerDSPVector * ROWS];
+    _Data() {}
+  };
+#endif
+
+  _Data mData;
+
+ public:
+  // getBuffer, getConstBuffer
+#ifdef MANUAL_ALIGN_DSPVECTOR
+  inline double* getBuffer() const { return DSPVectorAlignPointer<double>(mData.asDouble); }
+  inline const double* getConstBuffer() const
+  {
+    return DSPVectorAlignPointer<double>(mData.asDouble);
+  }
+#else
+  inline double* getBuffer() { return mData.asDouble; }
+  inline const double* getConstBuffer() const { return mData.asDouble; }
+#endif  // MANUAL_ALIGN_DSPVECTOR
+
+  // default constructor: zeroes the data.
+  DSPVectorArrayD() { operator=(0.); }
+
+  // conversion constructor to double, as with DSPVectorArray.
+  DSPVectorArrayD(double k) { operator=(k); }
+
+  // unaligned data * ctor
+  explicit DSPVectorArrayD(const double* pData)
+  {
+    std::copy(pData, pData + kDoublesPerDSPVector * ROWS, getBuffer());
+  }
+
+  DSPVectorArrayD(const DSPVectorArrayD& x1) noexcept = default;
+  DSPVectorArrayD& operator=(const DSPVectorArrayD& x1) noexcept = default;
+
+  inline double& operator[](int i) { return getBuffer()[i]; }
+  inline const double operator[](int i) const { return getConstBuffer()[i]; }
+
+  // = double: set each element of the DSPVectorArrayD to the value k.
+  inline DSPVectorArrayD operator=(double k)
+  {
+    const SIMDVectorDouble vk = vecSet1D(k);
+    double* py1 = getBuffer();
+
+    for (int n = 0; n < kDoubleSIMDVectorsPerDSPVector * ROWS; ++n)
+    {
+      vecStoreD(py1, vk);
+      py1 += kDoublesPerSIMDVector;
+    }
+    return *this;
+  }
+
+  // equality by value
+  bool operator==(const DSPVectorArrayD& x1) const
+  {
+    const double* px1 = x1.getConstBuffer();
+    const double* py1 = getConstBuffer();
+
+    for (int n = 0; n < kDoublesPerDSPVector * ROWS; ++n)
+    {
+      if (py1[n] != px1[n]) return false;
+    }
+    return true;
+  }
+
+  bool operator!=(const DSPVectorArrayD& x1) const { return !operator==(x1); }
+
+  // return a reference to a row of this DSPVectorArrayD.
+  inline DSPVectorArrayD<1>& row(int j)
+  {
+    double* py1 = getBuffer() + kDoublesPerDSPVector * j;
+    return *reinterpret_cast<DSPVectorArrayD<1>*>(py1);
+  }
+
+  // return a const reference to a row of this DSPVectorArrayD.
+  inline const DSPVectorArrayD<1>& constRow(int j) const
+  {
+    const double* py1 = getConstBuffer() + kDoublesPerDSPVector * j;
+    return *reinterpret_cast<const DSPVectorArrayD<1>*>(py1);
+  }
+
+  inline DSPVectorArrayD& operator+=(const DSPVectorArrayD& x1)
+  {
+    *this = add(*this, x1);
+    return *this;
+  }
+  inline DSPVectorArrayD& operator-=(const DSPVectorArrayD& x1)
+  {
+    *this = subtract(*this, x1);
+    return *this;
+  }
+  inline DSPVectorArrayD& operator*=(const DSPVectorArrayD& x1)
+  {
+    *this = multiply(*this, x1);
+    return *this;
+  }
+  inline DSPVectorArrayD& operator/=(const DSPVectorArrayD& x1)
+  {
+    *this = divide(*this, x1);
+    return *this;
+  }
+
+  // binary operators, defined as friends to allow implicit conversions from
+  // double on either side.
+  friend inline DSPVectorArrayD operator+(const DSPVectorArrayD& x1, const DSPVectorArrayD& x2)
+  {
+    return add(x1, x2);
+  }
+  friend inline DSPVectorArrayD operator-(const DSPVectorArrayD& x1, const DSPVectorArrayD& x2)
+  {
+    return subtract(x1, x2);
+  }
+  friend inline DSPVectorArrayD operator*(const DSPVectorArrayD& x1, const DSPVectorArrayD& x2)
+  {
+    return multiply(x1, x2);
+  }
+  friend inline DSPVectorArrayD operator/(const DSPVectorArrayD& x1, const DSPVectorArrayD& x2)
+  {
+    return divide(x1, x2);
+  }
+};  // class DSPVectorArrayD
+
+typedef DSPVectorArrayD<1> DSPVectorD;
+
+template <size_t ROWS>
+inline std::ostream& operator<<(std::ostream& out, const DSPVectorArrayD<ROWS>& vecArray)
+{
+  for (int j = 0; j < ROWS; ++j)
+  {
+    out << "[";
+    for (int i = 0; i < kDoublesPerDSPVector; ++i)
+    {
+      out << vecArray.constRow(j)[i] << " ";
+    }
+    out << "]\n";
+  }
+  return out;
+}
+
+// ----------------------------------------------------------------
+// load and store
+
+template <size_t ROWS>
+inline void load(DSPVectorArrayD<ROWS>& vecDest, const double* pSrc)
+{
+  std::copy(pSrc, pSrc + kDoublesPerDSPVector * ROWS, vecDest.getBuffer());
+}
+
+template <size_t ROWS>
+inline void store(const DSPVectorArrayD<ROWS>& vecSrc, double* pDest)
+{
+  std::copy(vecSrc.getConstBuffer(), vecSrc.getConstBuffer() + kDoublesPerDSPVector * ROWS,
+            pDest);
+}
+
+// ----------------------------------------------------------------
+// conversions between float and double
+
+template <size_t ROWS>
+inline DSPVectorArrayD<ROWS> toDouble(const DSPVectorArray<ROWS>& vx1)
+{
+  DSPVectorArrayD<ROWS> vy;
+  const float* px1 = vx1.getConstBuffer();
+  double* py1 = vy.getBuffer();
+
+  for (int n = 0; n < kSIMDVectorsPerDSPVector * ROWS; ++n)
+  {
+    SIMDVectorFloat x = vecLoad(px1);
+    vecStoreD(py1, vecFloatToDoubleLow(x));
+    vecStoreD(py1 + kDoublesPerSIMDVector, vecFloatToDoubleHigh(x));
+    px1 += kFloatsPerSIMDVector;
+    py1 += kFloatsPerSIMDVector;
+  }
+  return vy;
+}
+
+template <size_t ROWS>
+inline DSPVectorArray<ROWS> toFloat(const DSPVectorArrayD<ROWS>& vx1)
+{
+  DSPVectorArray<ROWS> vy;
+  const double* px1 = vx1.getConstBuffer();
+  float* py1 = vy.getBuffer();
+
+  for (int n = 0; n < kSIMDVectorsPerDSPVector * ROWS; ++n)
+  {
+    SIMDVectorDouble lo = vecLoadD(px1);
+    SIMDVectorDouble hi = vecLoadD(px1 + kDoublesPerSIMDVector);
+    vecStore(py1, vecDoubleToFloat(lo, hi));
+    px1 += kFloatsPerSIMDVector;
+    py1 += kFloatsPerSIMDVector;
+  }
+  return vy;
+}
+
+// ----------------------------------------------------------------
+// double vector operators. These are inlined, without runtime dispatch.
+
+#define DEFINE_OP1_D(opName, opComputation)                              \
+  template <size_t ROWS>                                                 \
+  inline DSPVectorArrayD<ROWS>(opName)(const DSPVectorArrayD<ROWS>& vx1) \
+  {                                                                      \
+    DSPVectorArrayD<ROWS> vy;                                            \
+    const double* px1 = vx1.getConstBuffer();                            \
+    double* py1 = vy.getBuffer();                                        \
+    for (int n = 0; n < kDoubleSIMDVectorsPerDSPVector * ROWS; ++n)      \
+    {                                                                    \
+      SIMDVectorDouble x = vecLoadD(px1);                                \
+      vecStoreD(py1, (opComputation));                                   \
+      px1 += kDoublesPerSIMDVector;                                      \
+      py1 += kDoublesPerSIMDVector;                                      \
+    }                                                                    \
+    return vy;                                                           \
+  }
+
+#define DEFINE_OP2_D(opName, opComputation)                              \
+  template <size_t ROWS>                                                 \
+  inline DSPVectorArrayD<ROWS>(opName)(const DSPVectorArrayD<ROWS>& vx1, \
+                                       const DSPVectorArrayD<ROWS>& vx2) \
+  {                                                                      \
+    DSPVectorArrayD<ROWS> vy;                                            \
+    const double* px1 = vx1.getConstBuffer();                            \
+    const double* px2 = vx2.getConstBuffer();                            \
+    double* py1 = vy.getBuffer();                                        \
+    for (int n = 0; n < kDoubleSIMDVectorsPerDSPVector * ROWS; ++n)      \
+    {                                                                    \
+      SIMDVectorDouble x1 = vecLoadD(px1);                               \
+      SIMDVectorDouble x2 = vecLoadD(px2);                               \
+      vecStoreD(py1, (opComputation));                                   \
+      px1 += kDoublesPerSIMDVector;                                      \
+      px2 += kDoublesPerSIMDVector;                                      \
+      py1 += kDoublesPerSIMDVector;                                      \
+    }                                                                    \
+    return vy;                                                           \
+  }
+
+#define DEFINE_OP3_D(opName, opComputation)                              \
+  template <size_t ROWS>                                                 \
+  inline DSPVectorArrayD<ROWS>(opName)(const DSPVectorArrayD<ROWS>& vx1, \
+                                       const DSPVectorArrayD<ROWS>& vx2, \
+                                       const DSPVectorArrayD<ROWS>& vx3) \
+  {                                                                      \
+    DSPVectorArrayD<ROWS> vy;                                            \
+    const double* px1 = vx1.getConstBuffer();                            \
+    const double* px2 = vx2.getConstBuffer();                            \
+    const double* px3 = vx3.getConstBuffer();                            \
+    double* py1 = vy.getBuffer();                                        \
+    for (int n = 0; n < kDoubleSIMDVectorsPerDSPVector * ROWS; ++n)      \
+    {                                                                    \
+      SIMDVectorDouble x1 = vecLoadD(px1);                               \
+      SIMDVectorDouble x2 = vecLoadD(px2);                               \
+      SIMDVectorDouble x3 = vecLoadD(px3);                               \
+      vecStoreD(py1, (opComputation));                                   \
+      px1 += kDoublesPerSIMDVector;                                      \
+      px2 += kDoublesPerSIMDVector;                                      \
+      px3 += kDoublesPerSIMDVector;                                      \
+      py1 += kDoublesPerSIMDVector;                                      \
+    }                                                                    \
+    return vy;                                                           \
+  }
+
+DEFINE_OP1_D(sqrt, (vecSqrtD(x)));
+DEFINE_OP1_D(abs, vecAbsD(x));
+
+DEFINE_OP2_D(add, (vecAddD(x1, x2)));
+DEFINE_OP2_D(subtract, (vecSubD(x1, x2)));
+DEFINE_OP2_D(multiply, (vecMulD(x1, x2)));
+DEFINE_OP2_D(divide, (vecDivD(x1, x2)));
+DEFINE_OP2_D(min, (vecMinD(x1, x2)));
+DEFINE_OP2_D(max, (vecMaxD(x1, x2)));
+
+DEFINE_OP3_D(lerp, vecAddD(x1, (vecMulD(x3, vecSubD(x2, x1)))));  // x = lerp(a, b, mix)
+DEFINE_OP3_D(clamp, vecClampD(x1, x2, x3));                       // clamp(x, minBound, maxBound)
+
+// ----------------------------------------------------------------
+// reductions
+
+inline double sum(const DSPVectorD& x)
+{
+  const double* px1 = x.getConstBuffer();
+  SIMDVectorDouble vSum = vecZerosD();
+  for (int n = 0; n < kDoubleSIMDVectorsPerDSPVector; ++n)
+  {
+    vSum = vecAddD(vSum, vecLoadD(px1));
+    px1 += kDoublesPerSIMDVector;
+  }
+  union
+  {
+    SIMDVectorDouble v;
+    double d[kDoublesPerSIMDVector];
+  } u;
+  u.v = vSum;
+  double r = 0.;
+  for (int i = 0; i < kDoublesPerSIMDVector; ++i)
+  {
+    r += u.d[i];
+  }
+  return r;
+}
+
+}  // namespace ml
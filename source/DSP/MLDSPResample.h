@@ -0,0 +1,332 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// MLDSPResample.h
+// Resampler: converts a stream of DSPVectors from one sample rate to another
+// at an arbitrary ratio. Unlike the half band filters in MLDSPFilters.h, which
+// resample by powers of two, the ratio can be any number and can change over
+// time, which makes the Resampler suitable for connecting two audio devices
+// with drifting clocks.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "MLDSPBuffer.h"
+#include "MLDSPOps.h"
+
+namespace ml
+{
+// The quality of a Resampler is set by the length of its interpolating
+// filter. taps is the length of the windowed sinc filter in input samples,
+// or 0 for 4-point cubic interpolation. phases is the number of fractional
+// positions at which the filter is tabulated; positions in between are
+// interpolated linearly. cutoff is the -6dB point of the filter as a fraction
+// of the Nyquist frequency, and beta is the shape of its Kaiser window, which
+// trades the width of the transition band for stopband rejection.
+
+struct ResamplerQuality
+{
+  int taps;
+  int phases;
+  float cutoff;
+  float beta;
+};
+
+// Quality presets, in order of increasing cost. Cubic interpolation does not
+// filter, so it will alias when downsampling. The others reject aliases by
+// about 60, 80 and 100 dB.
+constexpr ResamplerQuality kResampleCubic{0, 0, 1.f, 0.f};
+constexpr ResamplerQuality kResampleLow{16, 128, 0.8f, 6.f};
+constexpr ResamplerQuality kResampleMedium{32, 256, 0.9f, 8.f};
+constexpr ResamplerQuality kResampleHigh{64, 512, 0.95f, 10.f};
+
+// Resampler: write() DSPVectors of input at one rate, and read() DSPVectors of
+// output at the rate times the ratio once getReadAvailable() says they are
+// ready. Output samples are made as soon as there is enough input for them, and
+// wait in a DSPBuffer until they are read, so that any ratio of reads to writes
+// can be served.
+//
+// The windowed sinc filter is stored as a polyphase table. For each output
+// sample, the filter for its position between input samples is interpolated
+// from the table and applied to the input using SIMD operations across the
+// taps.
+//
+// The ratio can be changed with setRatio() while running, for instance to
+// keep the fill level of a buffer constant when correcting for clock drift.
+// The cutoff of the filter is set for the ratio given to the constructor and
+// is not changed, so setRatio() is meant for small changes.
+
+template <size_t CHANNELS = 1>
+class Resampler
+{
+  static constexpr int kLanes = kFloatsPerSIMDVector;
+
+  // the filter table: for each phase, taps coefficients followed by taps
+  // differences to the next phase.
+  std::vector<float> mTable;
+  int mTaps;
+  int mPhases;
+
+  // the input history for each channel. The filter window for the next output
+  // sample starts at sample int(mTime), and the sample at mTime + mTaps/2 - 1
+  // is its center.
+  std::vector<float> mHistory;
+  int mHistoryCapacity;
+  int mHistorySize{0};
+  double mTime{0};
+  double mStep;
+
+  // output samples are collected here before they are written to the buffers.
+  DSPVectorArray<CHANNELS> mOutputVector;
+  int mOutputCount{0};
+  std::array<DSPBuffer, CHANNELS> mOutputs;
+
+  static double besselI0(double x)
+  {
+    // power series for the zeroth order modified Bessel function of the first
+    // kind, which converges quickly for the values used in Kaiser windows.
+    double sum = 1.0;
+    double term = 1.0;
+    const double q = x * x * 0.25;
+    for (int k = 1; k < 64; ++k)
+    {
+      term *= q / (k * k);
+      sum += term;
+      if (term < sum * 1e-12) break;
+    }
+    return sum;
+  }
+
+  void makeTable(const ResamplerQuality& q, double ratio)
+  {
+    // when downsampling, lower the cutoff to the output Nyquist frequency and
+    // lengthen the filter to keep the same transition band at the output rate.
+    const double scale = std::min(ratio, 1.0);
+    const int taps = static_cast<int>(std::ceil(q.taps / scale));
+    mTaps = (taps + kLanes - 1) / kLanes * kLanes;
+    mPhases = q.phases;
+
+    const double fc = 0.5 * q.cutoff * scale;
+    const double halfWidth = mTaps * 0.5;
+    const double windowScale = 1.0 / besselI0(q.beta);
+
+    // compute phases + 1 rows so that the last phase has a neighbor.
+    std::vector<double> rows((mPhases + 1) * mTaps);
+    for (int p = 0; p <= mPhases; ++p)
+    {
+      double* row = rows.data() + p * mTaps;
+      double sum = 0.;
+      for (int k = 0; k < mTaps; ++k)
+      {
+        const double x = k - (mTaps / 2 - 1) - static_cast<double>(p) / mPhases;
+        const double w = x / halfWidth;
+        const double window = (std::fabs(w) < 1.0)
+                                  ? besselI0(q.beta * std::sqrt(1.0 - w * w)) * windowScale
+                                  : 0.;
+        const double sinc = (x == 0.) ? 1. : std::sin(kTwoPiD * fc * x) / (kTwoPiD * fc * x);
+        row[k] = 2. * fc * sinc * window;
+        sum += row[k];
+      }
+
+      // normalize each phase to unity gain at DC.
+      for (int k = 0; k < mTaps; ++k)
+      {
+        row[k] /= sum;
+      }
+    }
+
+    mTable.resize(mPhases * mTaps * 2);
+    for (int p = 0; p < mPhases; ++p)
+    {
+      const double* row = rows.data() + p * mTaps;
+      float* pc = mTable.data() + p * mTaps * 2;
+      for (int k = 0; k < mTaps; ++k)
+      {
+        pc[k] = static_cast<float>(row[k]);
+        pc[mTaps + k] = static_cast<float>(row[mTaps + k] - row[k]);
+      }
+    }
+  }
+
+  float* historyPtr(size_t c) { return mHistory.data() + c * mHistoryCapacity; }
+
+  void flushOutputs()
+  {
+    for (size_t c = 0; c < CHANNELS; ++c)
+    {
+      mOutputs[c].write(mOutputVector.getConstBuffer() + c * kFloatsPerDSPVector, mOutputCount);
+    }
+    mOutputCount = 0;
+  }
+
+  // make the output samples for which there is input, using the polyphase
+  // table.
+  void processSinc()
+  {
+    const double lastStart = mHistorySize - mTaps;
+    float* py = mOutputVector.getBuffer();
+    double time = mTime;
+    while (time <= lastStart)
+    {
+      const int start = static_cast<int>(time);
+      const double phase = (time - start) * mPhases;
+      const int p = static_cast<int>(phase);
+      const SIMDVectorFloat vFrac = vecSet1(static_cast<float>(phase - p));
+      const float* pTable = mTable.data() + p * mTaps * 2;
+
+      for (size_t c = 0; c < CHANNELS; ++c)
+      {
+        const float* px = historyPtr(c) + start;
+        const float* pc = pTable;
+        SIMDVectorFloat sum = vecZeros();
+        for (int k = 0; k < mTaps; k += kLanes)
+        {
+          SIMDVectorFloat coeffs =
+              vecAdd(vecLoadUnaligned(pc), vecMul(vFrac, vecLoadUnaligned(pc + mTaps)));
+          sum = vecAdd(sum, vecMul(vecLoadUnaligned(px), coeffs));
+          px += kLanes;
+          pc += kLanes;
+        }
+        py[c * kFloatsPerDSPVector + mOutputCount] = vecSumH(sum);
+      }
+      time += mStep;
+      if (++mOutputCount == kFloatsPerDSPVector) flushOutputs();
+    }
+    mTime = time;
+  }
+
+  // make the output samples for which there is input, using 4-point Hermite
+  // interpolation.
+  void processCubic()
+  {
+    const double lastStart = mHistorySize - mTaps;
+    float* py = mOutputVector.getBuffer();
+    double time = mTime;
+    while (time <= lastStart)
+    {
+      const int start = static_cast<int>(time);
+      const float t = static_cast<float>(time - start);
+      for (size_t c = 0; c < CHANNELS; ++c)
+      {
+        const float* px = historyPtr(c) + start;
+        const float c1 = 0.5f * (px[2] - px[0]);
+        const float c2 = px[0] - 2.5f * px[1] + 2.f * px[2] - 0.5f * px[3];
+        const float c3 = 0.5f * (px[3] - px[0]) + 1.5f * (px[1] - px[2]);
+        py[c * kFloatsPerDSPVector + mOutputCount] = ((c3 * t + c2) * t + c1) * t + px[1];
+      }
+      time += mStep;
+      if (++mOutputCount == kFloatsPerDSPVector) flushOutputs();
+    }
+    mTime = time;
+  }
+
+ public:
+  // ratio is the output sample rate divided by the input sample rate.
+  Resampler(double ratio, const ResamplerQuality& quality = kResampleMedium) : mStep(1.0 / ratio)
+  {
+    if (quality.taps > 0)
+    {
+      makeTable(quality, ratio);
+    }
+    else
+    {
+      mTaps = 4;
+      mPhases = 0;
+    }
+
+    // after the samples consumed by a write are removed, less than one window
+    // of input is left in the history.
+    mHistoryCapacity = mTaps + kFloatsPerDSPVector;
+    mHistory.resize(mHistoryCapacity * CHANNELS);
+
+    // make room for the output of a few writes.
+    const int outputSize = static_cast<int>(std::ceil(ratio * 4)) * kFloatsPerDSPVector;
+    for (auto& b : mOutputs)
+    {
+      b.resize(std::max(outputSize, kFloatsPerDSPVector * 8));
+    }
+    clear();
+  }
+  ~Resampler() = default;
+
+  // set the ratio of output to input sample rates.
+  void setRatio(double ratio) { mStep = 1.0 / ratio; }
+  double getRatio() const { return 1.0 / mStep; }
+
+  // the length of the interpolating filter in input samples.
+  int getTaps() const { return mTaps; }
+
+  void clear()
+  {
+    // start with zeros before the first input sample, so that the first
+    // output sample is centered on it.
+    std::fill(mHistory.begin(), mHistory.end(), 0.f);
+    mHistorySize = mTaps / 2 - 1;
+    mTime = 0.;
+    mOutputCount = 0;
+    for (auto& b : mOutputs)
+    {
+      b.clear();
+    }
+  }
+
+  // write a vector of input and make all the output samples that it allows.
+  void write(const DSPVectorArray<CHANNELS>& vx)
+  {
+    for (size_t c = 0; c < CHANNELS; ++c)
+    {
+      std::copy(vx.getConstBuffer() + c * kFloatsPerDSPVector,
+                vx.getConstBuffer() + (c + 1) * kFloatsPerDSPVector, historyPtr(c) + mHistorySize);
+    }
+    mHistorySize += kFloatsPerDSPVector;
+
+    if (mPhases > 0)
+    {
+      processSinc();
+    }
+    else
+    {
+      processCubic();
+    }
+    if (mOutputCount > 0)
+    {
+      flushOutputs();
+    }
+
+    // remove the input that no more output samples will need.
+    const int consumed = std::min(static_cast<int>(mTime), mHistorySize);
+    for (size_t c = 0; c < CHANNELS; ++c)
+    {
+      float* px = historyPtr(c);
+      std::memmove(px, px + consumed, (mHistorySize - consumed) * sizeof(float));
+    }
+    mHistorySize -= consumed;
+    mTime -= consumed;
+  }
+
+  // return the number of output samples ready to read.
+  size_t getReadAvailable() const { return mOutputs[0].getReadAvailable(); }
+
+  // read a vector of output. If fewer than kFloatsPerDSPVector samples are
+  // available, zeros are returned and nothing is read.
+  DSPVectorArray<CHANNELS> read()
+  {
+    DSPVectorArray<CHANNELS> vy;
+    if (getReadAvailable() >= kFloatsPerDSPVector)
+    {
+      for (size_t c = 0; c < CHANNELS; ++c)
+      {
+        mOutputs[c].read(vy.getBuffer() + c * kFloatsPerDSPVector, kFloatsPerDSPVector);
+      }
+    }
+    return vy;
+  }
+};
+
+}  // namespace ml
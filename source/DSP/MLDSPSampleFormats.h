@@ -0,0 +1,277 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// MLDSPSampleFormats.h
+// Storage formats for samples in long buffers and delay lines.
+//
+// DSP is always done in float, but memory-bound buffers can store samples in
+// 16 bits to halve their size and memory bandwidth:
+//
+//   float    32-bit float, stored unchanged.
+//   Float16  IEEE half float. 11 bits of precision over a wide range, so
+//            quiet signals keep their relative accuracy.
+//   int16_t  fixed point, with [-1, 1] mapped to [-32767, 32767]. 16 bits
+//            of absolute precision. Samples outside [-1, 1] are clipped.
+//
+// packSamples() converts floats to a storage format and unpackSamples()
+// converts back. Float16 conversions use the F16C instructions if they are
+// enabled at compile time (-mf16c, implied by ML_SIMD=AVX2 or AVX512) and a
+// portable implementation otherwise. Both round to nearest even and give the
+// same results.
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "MLDSPMath.h"
+
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
+namespace ml
+{
+// IEEE 754 half precision float, as stored bits.
+struct Float16
+{
+  uint16_t bits;
+};
+
+// ----------------------------------------------------------------
+// scalar conversions. Thanks to Fabian Giesen for the branch-light half
+// conversion methods.
+
+inline Float16 floatToFloat16(float x)
+{
+  constexpr uint32_t kF32Infinity = 255 << 23;
+  constexpr uint32_t kF16Max = (127 + 16) << 23;
+  constexpr uint32_t kDenormMagic = ((127 - 15) + (23 - 10) + 1) << 23;
+
+  uint32_t u;
+  memcpy(&u, &x, sizeof(u));
+  const uint32_t sign = u & 0x80000000u;
+  u ^= sign;
+
+  uint32_t h;
+  if (u >= kF16Max)
+  {
+    // infinity or NaN
+    h = (u > kF32Infinity) ? 0x7e00 : 0x7c00;
+  }
+  else if (u < (113 << 23))
+  {
+    // denormal or zero: line the mantissa up at the bottom of the float with an
+    // addition, which rounds to nearest even.
+    float f, magic;
+    memcpy(&f, &u, sizeof(f));
+    memcpy(&magic, &kDenormMagic, sizeof(magic));
+    f += magic;
+    memcpy(&u, &f, sizeof(u));
+    h = u - kDenormMagic;
+  }
+  else
+  {
+    // normal: rebias the exponent and round to nearest even.
+    const uint32_t mantissaOdd = (u >> 13) & 1;
+    u += (static_cast<uint32_t>(15 - 127) << 23) + 0xfff;
+    u += mantissaOdd;
+    h = u >> 13;
+  }
+  return Float16{static_cast<uint16_t>(h | (sign >> 16))};
+}
+
+inline float float16ToFloat(Float16 x)
+{
+  constexpr uint32_t kMagic = 113 << 23;
+  constexpr uint32_t kShiftedExp = 0x7c00 << 13;
+
+  uint32_t u = (x.bits & 0x7fffu) << 13;
+  const uint32_t exp = u & kShiftedExp;
+  u += (127 - 15) << 23;
+
+  if (exp == kShiftedExp)
+  {
+    // infinity or NaN
+    u += (128 - 16) << 23;
+  }
+  else if (exp == 0)
+  {
+    // denormal or zero: renormalize.
+    u += 1 << 23;
+    float f, magic;
+    memcpy(&f, &u, sizeof(f));
+    memcpy(&magic, &kMagic, sizeof(magic));
+    f -= magic;
+    memcpy(&u, &f, sizeof(u));
+  }
+
+  u |= static_cast<uint32_t>(x.bits & 0x8000u) << 16;
+  float y;
+  memcpy(&y, &u, sizeof(y));
+  return y;
+}
+
+constexpr float kInt16SampleScale = 32767.f;
+constexpr float kInt16SampleScaleInv = 1.f / 32767.f;
+
+inline int16_t floatToInt16(float x)
+{
+  // clip like _mm_max_ps / _mm_min_ps below, which also map NaN to -1.
+  x = (x > -1.f) ? x : -1.f;
+  x = (x < 1.f) ? x : 1.f;
+  return static_cast<int16_t>(std::lrint(x * kInt16SampleScale));
+}
+
+inline float int16ToFloat(int16_t x) { return x * kInt16SampleScaleInv; }
+
+// packSample() / unpackSample() convert one sample to and from any format.
+inline void packSample(float x, float& y) { y = x; }
+inline void packSample(float x, Float16& y) { y = floatToFloat16(x); }
+inline void packSample(float x, int16_t& y) { y = floatToInt16(x); }
+
+inline float unpackSample(float x) { return x; }
+inline float unpackSample(Float16 x) { return float16ToFloat(x); }
+inline float unpackSample(int16_t x) { return int16ToFloat(x); }
+
+// ----------------------------------------------------------------
+// packSamples(src, dest, n): convert n floats to a storage format.
+// unpackSamples(src, dest, n): convert n stored samples to floats.
+// No alignment is required.
+
+inline void packSamples(const float* pSrc, float* pDest, size_t n)
+{
+  std::copy(pSrc, pSrc + n, pDest);
+}
+
+inline void unpackSamples(const float* pSrc, float* pDest, size_t n)
+{
+  std::copy(pSrc, pSrc + n, pDest);
+}
+
+inline void packSamples(const float* pSrc, Float16* pDest, size_t n)
+{
+#ifdef __F16C__
+  const size_t blocks = n / 4;
+  for (size_t b = 0; b < blocks; ++b)
+  {
+    __m128i h = _mm_cvtps_ph(_mm_loadu_ps(pSrc), _MM_FROUND_TO_NEAREST_INT);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(pDest), h);
+    pSrc += 4;
+    pDest += 4;
+  }
+
+  // the remainder is less than 4 samples.
+  n %= 4;
+#endif
+  for (size_t i = 0; i < n; ++i)
+  {
+    pDest[i] = floatToFloat16(pSrc[i]);
+  }
+}
+
+inline void unpackSamples(const Float16* pSrc, float* pDest, size_t n)
+{
+#ifdef __F16C__
+  const size_t blocks = n / 4;
+  for (size_t b = 0; b < blocks; ++b)
+  {
+    __m128i h = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pSrc));
+    _mm_storeu_ps(pDest, _mm_cvtph_ps(h));
+    pSrc += 4;
+    pDest += 4;
+  }
+
+  // the remainder is less than 4 samples.
+  n %= 4;
+#endif
+  for (size_t i = 0; i < n; ++i)
+  {
+    pDest[i] = float16ToFloat(pSrc[i]);
+  }
+}
+
+inline void packSamples(const float* pSrc, int16_t* pDest, size_t n)
+{
+  // _mm_cvtps_epi32 rounds to nearest even like lrint() in the default
+  // rounding mode.
+  const __m128 vMax = _mm_set1_ps(1.f);
+  const __m128 vMin = _mm_set1_ps(-1.f);
+  const __m128 vScale = _mm_set1_ps(kInt16SampleScale);
+  const size_t blocks = n / 8;
+  for (size_t b = 0; b < blocks; ++b)
+  {
+    __m128 lo = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(pSrc), vMin), vMax);
+    __m128 hi = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(pSrc + 4), vMin), vMax);
+    __m128i ilo = _mm_cvtps_epi32(_mm_mul_ps(lo, vScale));
+    __m128i ihi = _mm_cvtps_epi32(_mm_mul_ps(hi, vScale));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDest), _mm_packs_epi32(ilo, ihi));
+    pSrc += 8;
+    pDest += 8;
+  }
+
+  // the remainder is less than 8 samples.
+  const size_t remainder = n % 8;
+  for (size_t i = 0; i < remainder; ++i)
+  {
+    pDest[i] = floatToInt16(pSrc[i]);
+  }
+}
+
+inline void unpackSamples(const int16_t* pSrc, float* pDest, size_t n)
+{
+  const __m128 vScale = _mm_set1_ps(kInt16SampleScaleInv);
+  const size_t blocks = n / 8;
+  for (size_t b = 0; b < blocks; ++b)
+  {
+    __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc));
+
+    // sign extend to 32 bits by unpacking into the high halves and shifting.
+    __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(h, h), 16);
+    __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(h, h), 16);
+    _mm_storeu_ps(pDest, _mm_mul_ps(_mm_cvtepi32_ps(lo), vScale));
+    _mm_storeu_ps(pDest + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), vScale));
+    pSrc += 8;
+    pDest += 8;
+  }
+
+  // the remainder is less than 8 samples.
+  const size_t remainder = n % 8;
+  for (size_t i = 0; i < remainder; ++i)
+  {
+    pDest[i] = int16ToFloat(pSrc[i]);
+  }
+}
+
+// add n floats to the stored samples at pDest.
+template <typename T>
+inline void addSamples(const float* pSrc, T* pDest, size_t n)
+{
+  float buf[kFloatsPerDSPVector];
+  while (n > 0)
+  {
+    size_t chunk = std::min(n, static_cast<size_t>(kFloatsPerDSPVector));
+    unpackSamples(pDest, buf, chunk);
+    for (size_t i = 0; i < chunk; ++i)
+    {
+      buf[i] += pSrc[i];
+    }
+    packSamples(buf, pDest, chunk);
+    pSrc += chunk;
+    pDest += chunk;
+    n -= chunk;
+  }
+}
+
+inline void addSamples(const float* pSrc, float* pDest, size_t n)
+{
+  for (const float* p = pSrc; p < pSrc + n; ++p)
+  {
+    *pDest++ += *p;
+  }
+}
+}  // namespace ml
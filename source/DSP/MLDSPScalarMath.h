@@ -23,6 +23,8 @@ namespace ml
 constexpr float kTwoPi = 6.2831853071795864769252867f;
 constexpr float kPi = 3.1415926535897932384626433f;
 constexpr float kOneOverTwoPi = 1.0f / kTwoPi;
+constexpr double kTwoPiD = 6.2831853071795864769252867;
+constexpr double kPiD = 3.1415926535897932384626433;
 constexpr float kE = 2.718281828459045f;
 constexpr float kTwelfthRootOfTwo = 1.05946309436f;
 constexpr float kMinGain = 0.00001f;  // 10e-5 = -120dB
@@ -240,23 +242,27 @@ constexpr double sqrt(const double x) { return sqrt_helper(x, 1.0); }
 constexpr double cube(const double x) { return x * x * x; }
 
 // Based on the triple-angle formula: sin 3x = 3 sin x - 4 sin ^3 x
+constexpr double sin_triple(const double s) { return 3 * s - 4 * cube(s); }
+
 constexpr double sin_helper(const double x)
 {
-  return x < tol ? x : 3 * (sin_helper(x / 3.0)) - 4 * cube(sin_helper(x / 3.0));
+  return x < tol ? x - cube(x) / 6.0 : sin_triple(sin_helper(x / 3.0));
 }
 
-constexpr double sin(const double x) { return sin_helper(x < 0 ? -x + kPi : x); }
+constexpr double sin(const double x) { return sin_helper(x < 0 ? -x + kPiD : x); }
 
 // sinh 3x = 3 sinh x + 4 sinh ^3 x
+constexpr double sinh_triple(const double s) { return 3 * s + 4 * cube(s); }
+
 constexpr double sinh_helper(const double x)
 {
-  return x < tol ? x : 3 * (sinh_helper(x / 3.0)) + 4 * cube(sinh_helper(x / 3.0));
+  return x < tol ? x : sinh_triple(sinh_helper(x / 3.0));
 }
 
 // sinh 3x = 3 sinh x + 4 sinh ^3 x
 constexpr double sinh(const double x) { return x < 0 ? -sinh_helper(-x) : sinh_helper(x); }
 
-constexpr double cos(const double x) { return sin(kPi * 0.5 - x); }
+constexpr double cos(const double x) { return sin(kPiD * 0.5 - x); }
 
 constexpr double cosh(const double x) { return sqrt(1.0 + square(sinh(x))); }
 
@@ -321,7 +327,15 @@ constexpr double exp_helper(const double r)
 
 // exp(x) = e^n . e^r (where n is an integer, and -0.5 > r < 0.5
 // exp(r) = e^r = 1 + r + r^2/2 + r^3/6 + r^4/24 + r^5/120
-constexpr double exp(const double x) { return pow(kE, nearest(x)) * exp_helper(fraction(x)); }
+constexpr double exp(const double x)
+{
+  return x < 0 ? 1.0 / exp(-x) : pow(2.718281828459045, nearest(x)) * exp_helper(fraction(x));
+}
+
+constexpr double tanh(const double x)
+{
+  return x > 20.0 ? 1.0 : x < -20.0 ? -1.0 : (exp(2.0 * x) - 1.0) / (exp(2.0 * x) + 1.0);
+}
 
 constexpr double mantissa(const double x)
 {
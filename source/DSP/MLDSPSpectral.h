@@ -0,0 +1,344 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// MLDSPSpectral.h
+// Processing in the frequency domain: Spectrum, the FFT of real signals, SIMD
+// operations on spectra and STFT, which runs a function on the short time
+// spectra of a signal and resynthesizes the result by overlap-add.
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "FFTReal.h"
+#include "MLDSPBuffer.h"
+#include "MLDSPOps.h"
+#include "MLDSPUtils.h"
+
+namespace ml
+{
+// Spectrum: the fftSize / 2 + 1 complex bins from DC to the Nyquist frequency
+// of the FFT of a real signal, with the real and imaginary parts in separate
+// arrays. The arrays are padded to a whole number of SIMD vectors.
+
+class Spectrum
+{
+  std::vector<float> mReal;
+  std::vector<float> mImag;
+  int mBins;
+
+ public:
+  explicit Spectrum(int fftSize) : mBins(fftSize / 2 + 1)
+  {
+    const int paddedBins =
+        (mBins + kFloatsPerSIMDVector - 1) / kFloatsPerSIMDVector * kFloatsPerSIMDVector;
+    mReal.resize(paddedBins);
+    mImag.resize(paddedBins);
+  }
+
+  int getBins() const { return mBins; }
+
+  // the number of floats in each array, including padding.
+  int getPaddedBins() const { return static_cast<int>(mReal.size()); }
+
+  float* getReal() { return mReal.data(); }
+  const float* getReal() const { return mReal.data(); }
+  float* getImag() { return mImag.data(); }
+  const float* getImag() const { return mImag.data(); }
+
+  void clear()
+  {
+    std::fill(mReal.begin(), mReal.end(), 0.f);
+    std::fill(mImag.begin(), mImag.end(), 0.f);
+  }
+};
+
+// ----------------------------------------------------------------
+// SIMD operations on spectra. The spectra must be the same size.
+
+// multiply a by b, bin by bin.
+inline void multiply(Spectrum& a, const Spectrum& b)
+{
+  float* par = a.getReal();
+  float* pai = a.getImag();
+  const float* pbr = b.getReal();
+  const float* pbi = b.getImag();
+  for (int i = 0; i < a.getPaddedBins(); i += kFloatsPerSIMDVector)
+  {
+    SIMDVectorFloat ar = vecLoadUnaligned(par + i);
+    SIMDVectorFloat ai = vecLoadUnaligned(pai + i);
+    SIMDVectorFloat br = vecLoadUnaligned(pbr + i);
+    SIMDVectorFloat bi = vecLoadUnaligned(pbi + i);
+    vecStoreUnaligned(par + i, vecSub(vecMul(ar, br), vecMul(ai, bi)));
+    vecStoreUnaligned(pai + i, vecAdd(vecMul(ar, bi), vecMul(ai, br)));
+  }
+}
+
+// multiply each bin of a by a real gain.
+inline void applyGains(Spectrum& a, const float* pGains)
+{
+  float* par = a.getReal();
+  float* pai = a.getImag();
+  for (int i = 0; i < a.getPaddedBins(); i += kFloatsPerSIMDVector)
+  {
+    SIMDVectorFloat g = vecLoadUnaligned(pGains + i);
+    vecStoreUnaligned(par + i, vecMul(vecLoadUnaligned(par + i), g));
+    vecStoreUnaligned(pai + i, vecMul(vecLoadUnaligned(pai + i), g));
+  }
+}
+
+// write the magnitude of each bin of a to the destination, which must have
+// room for a.getPaddedBins() floats.
+inline void magnitudes(const Spectrum& a, float* pDest)
+{
+  const float* par = a.getReal();
+  const float* pai = a.getImag();
+  for (int i = 0; i < a.getPaddedBins(); i += kFloatsPerSIMDVector)
+  {
+    SIMDVectorFloat ar = vecLoadUnaligned(par + i);
+    SIMDVectorFloat ai = vecLoadUnaligned(pai + i);
+    vecStoreUnaligned(pDest + i, vecSqrt(vecAdd(vecMul(ar, ar), vecMul(ai, ai))));
+  }
+}
+
+// set a to a + (b - a) * mix, bin by bin.
+inline void interpolate(Spectrum& a, const Spectrum& b, float mix)
+{
+  const SIMDVectorFloat vMix = vecSet1(mix);
+  float* par = a.getReal();
+  float* pai = a.getImag();
+  const float* pbr = b.getReal();
+  const float* pbi = b.getImag();
+  for (int i = 0; i < a.getPaddedBins(); i += kFloatsPerSIMDVector)
+  {
+    SIMDVectorFloat ar = vecLoadUnaligned(par + i);
+    SIMDVectorFloat ai = vecLoadUnaligned(pai + i);
+    vecStoreUnaligned(par + i, vecAdd(ar, vecMul(vMix, vecSub(vecLoadUnaligned(pbr + i), ar))));
+    vecStoreUnaligned(pai + i, vecAdd(ai, vecMul(vMix, vecSub(vecLoadUnaligned(pbi + i), ai))));
+  }
+}
+
+// FFT: the discrete Fourier transform of real signals of a power of two size,
+// using ffft::FFTReal. The inverse is scaled so that inverse(forward(x)) = x.
+
+class FFT
+{
+  ffft::FFTReal<float> mFFT;
+  std::vector<float> mPacked;
+  int mSize;
+
+ public:
+  explicit FFT(int size) : mFFT(size), mPacked(size), mSize(size) {}
+
+  int getSize() const { return mSize; }
+
+  void forward(const float* px, Spectrum& y)
+  {
+    // FFTReal puts the real parts of bins 0 to size/2 first, followed by the
+    // negated imaginary parts of bins 1 to size/2 - 1.
+    const int half = mSize / 2;
+    mFFT.do_fft(mPacked.data(), px);
+    float* pyr = y.getReal();
+    float* pyi = y.getImag();
+    std::copy(mPacked.data(), mPacked.data() + half + 1, pyr);
+    pyi[0] = pyi[half] = 0.f;
+    for (int i = 1; i < half; ++i)
+    {
+      pyi[i] = -mPacked[half + i];
+    }
+  }
+
+  void inverse(const Spectrum& x, float* py)
+  {
+    const int half = mSize / 2;
+    const float scale = 1.f / mSize;
+    const float* pxr = x.getReal();
+    const float* pxi = x.getImag();
+    for (int i = 0; i <= half; ++i)
+    {
+      mPacked[i] = pxr[i] * scale;
+    }
+    for (int i = 1; i < half; ++i)
+    {
+      mPacked[half + i] = -pxi[i] * scale;
+    }
+    mFFT.do_ifft(mPacked.data(), py);
+  }
+};
+
+// STFT: short time Fourier transform processing.
+//
+// Every hopSize samples, the last fftSize samples of input are windowed and
+// transformed, and a function is called to process the Spectrum in place.
+// The result is transformed back, windowed again and overlap-added to the
+// output. The window is made by makeWindow() in its periodic form, and the
+// synthesis window is normalized so that the output is equal to the input,
+// delayed by getLatency() samples, when the function does nothing. This works
+// for any window that does not sum to zero anywhere when overlapped.
+//
+// fftSize and hopSize must be powers of two, with hopSize no larger than
+// fftSize and fftSize no smaller than kFloatsPerSIMDVector. All memory is
+// allocated in the constructor, so processing can be done on the audio
+// thread.
+//
+//   STFT stft(1024, 256);
+//   DSPVector y = stft(x, [&](Spectrum& s) { applyGains(s, gains); });
+
+class STFT
+{
+  FFT mFFT;
+  Spectrum mSpectrum;
+  int mSize;
+  int mHop;
+
+  std::vector<float> mWindow;
+  std::vector<float> mSynthesisWindow;
+
+  // the last mSize samples of input, of which the last mHop are being filled.
+  std::vector<float> mInput;
+  int mInputCount{0};
+
+  // the frame being processed, and the overlap-added output.
+  std::vector<float> mFrame;
+  std::vector<float> mOutput;
+  DSPBuffer mOutputBuffer;
+
+  // these work on any n, finishing with scalar math when n is not a multiple
+  // of the SIMD vector size.
+  static void multiplyBuffers(const float* pa, const float* pb, float* py, int n)
+  {
+    const int nSIMD = n - n % kFloatsPerSIMDVector;
+    for (int i = 0; i < nSIMD; i += kFloatsPerSIMDVector)
+    {
+      vecStoreUnaligned(py + i, vecMul(vecLoadUnaligned(pa + i), vecLoadUnaligned(pb + i)));
+    }
+    for (int i = nSIMD; i < n; ++i)
+    {
+      py[i] = pa[i] * pb[i];
+    }
+  }
+
+  static void multiplyAddBuffers(const float* pa, const float* pb, float* py, int n)
+  {
+    const int nSIMD = n - n % kFloatsPerSIMDVector;
+    for (int i = 0; i < nSIMD; i += kFloatsPerSIMDVector)
+    {
+      SIMDVectorFloat ab = vecMul(vecLoadUnaligned(pa + i), vecLoadUnaligned(pb + i));
+      vecStoreUnaligned(py + i, vecAdd(vecLoadUnaligned(py + i), ab));
+    }
+    for (int i = nSIMD; i < n; ++i)
+    {
+      py[i] += pa[i] * pb[i];
+    }
+  }
+
+  template <typename FN>
+  void processFrame(FN&& fn)
+  {
+    multiplyBuffers(mInput.data(), mWindow.data(), mFrame.data(), mSize);
+    mFFT.forward(mFrame.data(), mSpectrum);
+    fn(mSpectrum);
+    mFFT.inverse(mSpectrum, mFrame.data());
+
+    // overlap-add the frame and send the first hop, which is complete, to the
+    // output.
+    float* pOut = mOutput.data();
+    multiplyAddBuffers(mFrame.data(), mSynthesisWindow.data(), pOut, mSize);
+    mOutputBuffer.write(pOut, mHop);
+    std::memmove(pOut, pOut + mHop, (mSize - mHop) * sizeof(float));
+    std::fill(pOut + mSize - mHop, pOut + mSize, 0.f);
+  }
+
+ public:
+  STFT(int fftSize, int hopSize, Projection windowShape = windows::raisedCosine)
+      : mFFT(fftSize), mSpectrum(fftSize), mSize(fftSize), mHop(hopSize)
+  {
+    // make a periodic window by leaving off the last point of a symmetric
+    // window one sample longer.
+    mWindow.resize(mSize + 1);
+    makeWindow(mWindow.data(), mSize + 1, windowShape);
+    mWindow.resize(mSize);
+
+    // divide the synthesis window by the sum of the overlapped products of
+    // the two windows, which repeats every hop.
+    mSynthesisWindow.resize(mSize);
+    for (int i = 0; i < mHop; ++i)
+    {
+      float sum = 0.f;
+      for (int j = i; j < mSize; j += mHop)
+      {
+        sum += mWindow[j] * mWindow[j];
+      }
+      for (int j = i; j < mSize; j += mHop)
+      {
+        mSynthesisWindow[j] = (sum > 0.f) ? mWindow[j] / sum : 0.f;
+      }
+    }
+
+    mInput.resize(mSize);
+    mFrame.resize(mSize);
+    mOutput.resize(mSize);
+    mOutputBuffer.resize(mSize + kFloatsPerDSPVector * 2);
+    clear();
+  }
+  ~STFT() = default;
+
+  int getFFTSize() const { return mSize; }
+  int getHopSize() const { return mHop; }
+
+  // the delay from input to output: a frame is complete fftSize samples after
+  // it starts, less the time until the next DSPVector is needed.
+  int getLatency() const { return mSize - std::min(mHop, kFloatsPerDSPVector); }
+
+  void clear()
+  {
+    std::fill(mInput.begin(), mInput.end(), 0.f);
+    std::fill(mOutput.begin(), mOutput.end(), 0.f);
+    mInputCount = 0;
+
+    // the first fftSize - hopSize samples of output come from frames that
+    // start before the input, so they are zeros. Add enough more zeros that
+    // every read can be served before the first frame is done.
+    mOutputBuffer.clear();
+    const DSPVector zeros;
+    for (int i = mHop - std::min(mHop, kFloatsPerDSPVector); i > 0; i -= kFloatsPerDSPVector)
+    {
+      mOutputBuffer.write(zeros.getConstBuffer(), std::min(i, kFloatsPerDSPVector));
+    }
+  }
+
+  template <typename FN>
+  void process(const DSPVector& vx, FN&& fn, DSPVector& vy)
+  {
+    const float* px = vx.getConstBuffer();
+    int remaining = kFloatsPerDSPVector;
+    while (remaining > 0)
+    {
+      const int n = std::min(remaining, mHop - mInputCount);
+      std::copy(px, px + n, mInput.data() + mSize - mHop + mInputCount);
+      px += n;
+      remaining -= n;
+      mInputCount += n;
+      if (mInputCount == mHop)
+      {
+        processFrame(fn);
+        std::memmove(mInput.data(), mInput.data() + mHop, (mSize - mHop) * sizeof(float));
+        mInputCount = 0;
+      }
+    }
+    mOutputBuffer.read(vy);
+  }
+
+  template <typename FN>
+  DSPVector operator()(const DSPVector& vx, FN&& fn)
+  {
+    DSPVector vy;
+    process(vx, fn, vy);
+    return vy;
+  }
+};
+
+}  // namespace ml
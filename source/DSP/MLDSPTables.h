@@ -0,0 +1,117 @@
+// madronalib: a C++ framework for DSP applications.
+// Copyright (c) 2020 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// MLDSPTables.h
+// LookupTable: the values of a function at evenly spaced points, computed at
+// compile time. DSPVectors of inputs are looked up in a table with nearest,
+// linear or cubic interpolation using SIMD gathers. A table lookup can stand
+// in for a sin(), exp() or waveshaping curve that would be too expensive to
+// compute per sample.
+
+#pragma once
+
+#include "MLDSPOps.h"
+
+namespace ml
+{
+// A LookupTable<SIZE> holds the values of a function at SIZE + 1 points
+// evenly spaced over the domain [lo, hi]. With a constexpr function it can be
+// built at compile time:
+//
+//   constexpr float sineFn(float x) { return const_math::sin(x); }
+//   constexpr LookupTable<256> kSineTable(sineFn, 0.f, kTwoPi);
+//   DSPVector y = lookupLinear(kSineTable, phase * DSPVector(kTwoPi));
+//
+// Inputs outside the domain are clamped to it. The function is also
+// evaluated at one point below the domain and two above, so that cubic
+// interpolation has its neighbors at the ends. For one cycle of a periodic
+// function, these are the values wrapped around from the other end.
+template <size_t SIZE>
+class LookupTable
+{
+  static_assert(SIZE >= 2, "LookupTable: SIZE must be at least 2.");
+
+  // the values at indices -1 through SIZE + 2.
+  static constexpr size_t kPoints = SIZE + 4;
+  std::array<float, kPoints> mData;
+  float mScale;
+  float mOffset;
+
+  template <std::size_t... Indices>
+  static constexpr std::array<float, kPoints> makeData(float (*fn)(float), float lo, float hi,
+                                                       ml_index_sequence<Indices...>)
+  {
+    return {{fn(static_cast<float>(lo + (hi - static_cast<double>(lo)) *
+                                            (static_cast<double>(Indices) - 1.0) / SIZE))...}};
+  }
+
+ public:
+  constexpr LookupTable(float (*fn)(float), float lo = 0.f, float hi = 1.f)
+      : mData(makeData(fn, lo, hi, ml_make_index_sequence<kPoints>{})),
+        mScale(SIZE / (hi - lo)),
+        mOffset(-lo * SIZE / (hi - lo))
+  {
+  }
+
+  static constexpr size_t size() { return SIZE; }
+
+  // the value at index i, for i from -1 to SIZE + 2.
+  constexpr float operator[](int i) const { return mData[i + 1]; }
+
+  // the value at index 0, followed by the rest of the table.
+  const float* getData() const { return mData.data() + 1; }
+
+  // the table position of an input x is x * scale + offset.
+  constexpr float getScale() const { return mScale; }
+  constexpr float getOffset() const { return mOffset; }
+};
+
+// ----------------------------------------------------------------
+// table lookup operators
+//
+// lookupNearest returns the table value nearest to each input, lookupLinear
+// interpolates linearly between the two nearest values and lookupCubic uses
+// 4-point Hermite interpolation.
+
+#define DEFINE_TABLE_LOOKUP(opName)                                           \
+  template <size_t SIZE, size_t ROWS>                                         \
+  inline DSPVectorArray<ROWS>(opName)(const LookupTable<SIZE>& table,         \
+                                      const DSPVectorArray<ROWS>& vx1)        \
+  {                                                                           \
+    DSPVectorArray<ROWS> vy;                                                  \
+    const int n = kFloatsPerDSPVector * ROWS;                                 \
+    (ML_DSP_KERNEL(lookup, opName))(table.getData(), static_cast<int>(SIZE),  \
+                                    table.getScale(), table.getOffset(),      \
+                                    vx1.getConstBuffer(), vy.getBuffer(), n); \
+    return vy;                                                                \
+  }
+
+DEFINE_TABLE_LOOKUP(lookupNearest);
+DEFINE_TABLE_LOOKUP(lookupLinear);
+DEFINE_TABLE_LOOKUP(lookupCubic);
+
+// Return the table values at integer indices, which wrap around the table.
+// For one cycle of a waveform, this makes a wavetable oscillator from an
+// integer phase accumulator. SIZE must be a power of two.
+template <size_t SIZE, size_t ROWS>
+inline DSPVectorArray<ROWS> lookup(const LookupTable<SIZE>& table,
+                                   const DSPVectorArrayInt<ROWS>& vi1)
+{
+  static_assert((SIZE & (SIZE - 1)) == 0, "lookup: SIZE must be a power of two.");
+  DSPVectorArray<ROWS> vy;
+  const float* pTable = table.getData();
+  const float* pi1 = vi1.getConstBuffer();
+  float* py1 = vy.getBuffer();
+  const SIMDVectorInt vMask = vecSetInt1(SIZE - 1);
+  for (int n = 0; n < kSIMDVectorsPerDSPVector * ROWS; ++n)
+  {
+    SIMDVectorInt i = vecAndInt(VecF2I(vecLoad(pi1)), vMask);
+    vecStore(py1, vecGather(pTable, i));
+    pi1 += kIntsPerSIMDVector;
+    py1 += kFloatsPerSIMDVector;
+  }
+  return vy;
+}
+
+}  // namespace ml